@@ -0,0 +1,184 @@
+/*
+ * dma_coalesce.c
+ *
+ * Adaptive interrupt coalescing for the AXI DMA channels.
+ *
+ * Every completion interrupt is accounted in a measurement window. When the
+ * window closes, the BD completion rate observed in it is used to retune the
+ * coalescing threshold of the channel:
+ *
+ *  - The threshold needed to keep the interrupt rate under the target is
+ *    ceil(BdRate / TargetIrqRate).
+ *  - A BD waits at most for (threshold - 1) other BDs before its interrupt
+ *    fires, so the latency bound limits the threshold to
+ *    BdRate * MaxLatencyUs / 1e6.
+ *
+ * When both cannot be met, the latency bound wins and the conflict is counted.
+ * The delay timer is always programmed with the latency bound, so that a BD
+ * never waits longer than that when the traffic slows down.
+ *
+ * The bound is only a design target: BD completions are not timestamped. What
+ * is measured is the largest gap between completion interrupts, which also
+ * includes the time the interrupt stays masked by other ISRs.
+ */
+
+/***************************** Include Files *********************************/
+
+#include "dma_coalesce.h"
+#include "timestamp.h"
+#include "xil_printf.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Measurement window
+ */
+#define COALESCE_WINDOW_US			100000
+
+/*
+ * The delay timer of the AXI DMA counts in units of 125 SG clock cycles
+ * (1.25 us with the 100 MHz AXI clock). Both registers are 8 bit wide.
+ */
+#define DELAY_TIMER_UNIT_NS			1250
+#define MAX_COALESCE_REG_VALUE		255
+
+/*****************************************************************************/
+/*
+ *
+ * Initializes the adaptive coalescing state of a channel with the values
+ * already programmed in it.
+ *
+ ******************************************************************************/
+void DmaCoalesce_init(DmaCoalesceState *State, u32 Threshold, u32 DelayTimer,
+		u32 MaxThreshold, u32 TargetIrqRate, u32 MaxLatencyUs) {
+
+	State->TargetIrqRate = TargetIrqRate;
+	State->MaxLatencyUs = MaxLatencyUs;
+	State->MaxThreshold = (MaxThreshold > MAX_COALESCE_REG_VALUE) ?
+			MAX_COALESCE_REG_VALUE : MaxThreshold;
+
+	State->Threshold = Threshold;
+	State->DelayTimer = DelayTimer;
+
+	State->WindowStart = getTimestamp();
+	State->LastIrqTime = State->WindowStart;
+	State->nWindowIrqs = 0;
+	State->nWindowBds = 0;
+	State->WindowMaxGap = 0;
+
+	State->IrqRate = 0;
+	State->BdRate = 0;
+	State->MaxIrqGapUs = 0;
+	State->nDelayIrqs = 0;
+
+	State->nRetunes = 0;
+	State->nConflicts = 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Closes the measurement window and programs the new coalescing values.
+ *
+ ******************************************************************************/
+static void DmaCoalesce_retune(DmaCoalesceState *State,
+		XAxiDma_BdRing *RingPtr, u32 WindowUs) {
+	u32 RateThreshold;
+	u32 LatencyThreshold;
+	u32 NewThreshold;
+	u32 NewDelayTimer;
+
+	State->IrqRate = (u32) (((u64) State->nWindowIrqs * 1000000) / WindowUs);
+	State->BdRate = (u32) (((u64) State->nWindowBds * 1000000) / WindowUs);
+	State->MaxIrqGapUs = timestampToUs(State->WindowMaxGap);
+
+	// Threshold that keeps the interrupt rate under the target
+	RateThreshold = (State->BdRate + State->TargetIrqRate - 1)
+			/ State->TargetIrqRate;
+
+	// Largest threshold that still meets the latency bound
+	LatencyThreshold = (u32) (((u64) State->BdRate * State->MaxLatencyUs)
+			/ 1000000) + 1;
+
+	NewThreshold = RateThreshold;
+	if (NewThreshold > LatencyThreshold) {
+		NewThreshold = LatencyThreshold;
+		State->nConflicts++;
+	}
+	if (NewThreshold > State->MaxThreshold)
+		NewThreshold = State->MaxThreshold;
+	if (NewThreshold < 1)
+		NewThreshold = 1;
+
+	NewDelayTimer = (State->MaxLatencyUs * 1000) / DELAY_TIMER_UNIT_NS;
+	if (NewDelayTimer > MAX_COALESCE_REG_VALUE)
+		NewDelayTimer = MAX_COALESCE_REG_VALUE;
+	if (NewDelayTimer < 1)
+		NewDelayTimer = 1;
+
+	if (NewThreshold != State->Threshold
+			|| NewDelayTimer != State->DelayTimer) {
+		if (XAxiDma_BdRingSetCoalesce(RingPtr, NewThreshold, NewDelayTimer)
+				== XST_SUCCESS) {
+			State->Threshold = NewThreshold;
+			State->DelayTimer = NewDelayTimer;
+			State->nRetunes++;
+		}
+	}
+
+	State->nWindowIrqs = 0;
+	State->nWindowBds = 0;
+	State->WindowMaxGap = 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Accounts one completion interrupt of the channel and retunes the coalescing
+ * when the measurement window closes. Called from the channel ISR.
+ *
+ * @param	State is the coalescing state of the channel.
+ * @param	RingPtr is the BD ring of the channel.
+ * @param	IrqStatus is the acknowledged interrupt status.
+ * @param	BdCount is the number of BDs completed in this interrupt.
+ *
+ ******************************************************************************/
+void DmaCoalesce_onInterrupt(DmaCoalesceState *State, XAxiDma_BdRing *RingPtr,
+		u32 IrqStatus, int BdCount) {
+	u32 Now = getTimestamp();
+	u32 Gap = Now - State->LastIrqTime;
+	u32 WindowUs;
+
+	State->LastIrqTime = Now;
+	State->nWindowIrqs++;
+	if (BdCount > 0)
+		State->nWindowBds += BdCount;
+	if (Gap > State->WindowMaxGap)
+		State->WindowMaxGap = Gap;
+
+	// Only the delay timer fired: the threshold was not reached in time
+	if ((IrqStatus & XAXIDMA_IRQ_DELAY_MASK)
+			&& !(IrqStatus & XAXIDMA_IRQ_IOC_MASK))
+		State->nDelayIrqs++;
+
+	WindowUs = timestampToUs(Now - State->WindowStart);
+	if (WindowUs >= COALESCE_WINDOW_US) {
+		DmaCoalesce_retune(State, RingPtr, WindowUs);
+		State->WindowStart = Now;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Prints the coalescing values and the statistics of the last window.
+ *
+ ******************************************************************************/
+void DmaCoalesce_print(const char *Name, DmaCoalesceState *State) {
+	xil_printf("\r\n%s coalescing: count %d \t delay %d", Name,
+			State->Threshold, State->DelayTimer);
+	xil_printf("\r\n  irq/s %d \t BD/s %d \t max irq gap %d us", State->IrqRate,
+			State->BdRate, State->MaxIrqGapUs);
+	xil_printf("\r\n  delay irqs %d \t retunes %d \t conflicts %d\r\n",
+			State->nDelayIrqs, State->nRetunes, State->nConflicts);
+}
@@ -0,0 +1,48 @@
+/*
+ * dma_coalesce.h
+ */
+
+#ifndef DMA_COALESCE_H_
+#define DMA_COALESCE_H_
+
+#include "xaxidma.h"
+
+/*
+ * State and statistics of the adaptive interrupt coalescing of one AXI DMA
+ * channel. Rates refer to the last closed measurement window.
+ */
+typedef struct {
+	/* Policy */
+	u32 TargetIrqRate;	/* Maximum interrupts per second */
+	u32 MaxLatencyUs;	/* Latency bound the threshold is designed for */
+	u32 MaxThreshold;	/* Upper limit for the coalescing count */
+
+	/* Values currently programmed in the channel */
+	u32 Threshold;
+	u32 DelayTimer;
+
+	/* Current measurement window */
+	u32 WindowStart;
+	u32 LastIrqTime;
+	u32 nWindowIrqs;
+	u32 nWindowBds;
+	u32 WindowMaxGap;
+
+	/* Statistics of the last window */
+	u32 IrqRate;		/* Interrupts per second */
+	u32 BdRate;		/* Completed BDs per second */
+	u32 MaxIrqGapUs;	/* Largest interval between completion interrupts */
+
+	/* Totals */
+	u32 nDelayIrqs;		/* Interrupts raised by the delay timer only */
+	u32 nRetunes;
+	u32 nConflicts;		/* Irq rate target given up to bound the latency */
+} DmaCoalesceState;
+
+void DmaCoalesce_init(DmaCoalesceState *State, u32 Threshold, u32 DelayTimer,
+		u32 MaxThreshold, u32 TargetIrqRate, u32 MaxLatencyUs);
+void DmaCoalesce_onInterrupt(DmaCoalesceState *State, XAxiDma_BdRing *RingPtr,
+		u32 IrqStatus, int BdCount);
+void DmaCoalesce_print(const char *Name, DmaCoalesceState *State);
+
+#endif /* DMA_COALESCE_H_ */
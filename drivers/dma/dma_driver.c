@@ -19,6 +19,23 @@
  * included in the main script, it suffices to fire it once, since no interrupt
  * will be generated for completed transmission when the cyclic mode is used.
  *
+ * Reception (S2MM) runs in continuous capture mode when the CPRI sink is the
+ * DMA (ROE_CPRI_SINK == ROE_SINK_DMA). Every Rx BD owns one buffer within the
+ * Rx buffer region. Completed BDs are invalidated in the data cache, freed and
+ * immediately re-armed with the same buffer, so the ring never runs dry and IQ
+ * samples from the ADC path can be recorded indefinitely. The application
+ * drains completed buffers through "readRxCaptureBuffer()" and monitors the
+ * capture through "getRxCaptureStats()".
+ *
+ * In loopback mode ("startDmaLoopback()"), the S2MM and MM2S channels form a
+ * DDR-backed delay line between the ADC and the DAC. A completed Rx buffer is
+ * not handed to the application, but queued as the source of an MM2S BD as it
+ * is, without any copy or cache maintenance, since the CPU never touches the
+ * samples. Once the buffer is played out, it is re-armed for capture. Playout
+ * starts when the configured number of buffers has been captured, so samples
+ * stay in DDR for that many buffer durations. The end-to-end latency of each
+ * buffer is reported by "getDmaLoopbackStats()".
+ *
  * Regarding the Tx data, either random and preset data can be transmitted. The
  * user has to configure using the "LOAD_TX_WAVEFORM" definition. When using a
  * preset waveform (LOAD_TX_WAVEFORM defined), the waveform has to obey a few
@@ -32,6 +49,7 @@
  *    30, the CPRI packer module will truncate by throwing away the LSB of each
  * 	  16 bit word representing I and Q. Therefore, in this case IQ samples in
  *    the waveform should be generated using a mask of "0xFFFEFFFE".
+ * Headers obeying these rules are generated from IQ files by "tools/wavegen".
  */
 
 /***************************** Include Files *********************************/
@@ -41,13 +59,25 @@
 #include "xintc_driver.h"
 #include "xaxidma.h"
 #include "xil_io.h"
+#include "dma_driver.h"
+#include "dma_coalesce.h"
+#include "ddr_regions.h"
+#include "dma_buffer.h"
+#include "timestamp.h"
+#include "trace_log.h"
 
 /************************** Constant Definitions *****************************/
 
 /*
  * Define the mode of transmission by defining or undefining the following:
+ *
+ * The build options TRANSMIT_IN_INTERRUPT_MODE, NUMBER_OF_BDS_PER_TX,
+ * N_DMA_READ_BURSTS and FIXED_COALESCING override the settings of this file
+ * (used by the host bench of tools/dma_bench to sweep them).
  */
+#ifndef TRANSMIT_IN_INTERRUPT_MODE
 #define TRANSMIT_IN_CYCLIC_MODE
+#endif
 /*
  * Define whether a preset transmit waveform should be loaded
  */
@@ -67,33 +97,23 @@
 //#endif
 
 //#if ROE_CPRI_SINK == ROE_SINK_DMA
-//#define DMA_RX_INTR_ID        XPAR_MICROBLAZE_0_AXI_INTC_AXI_DMA_0_S2MM_INTROUT_INTR
+#define DMA_RX_INTR_ID        XPAR_MICROBLAZE_0_AXI_INTC_AD9361_DMA_S2MM_INTROUT_INTR//XPAR_MICROBLAZE_0_AXI_INTC_AXI_DMA_0_S2MM_INTROUT_INTR
 //#endif
 
 #define DMA_DEV_ID		XPAR_AD9361_DMA_DEVICE_ID//XPAR_AXIDMA_0_DEVICE_ID
-#define DDR_BASE_ADDR	XPAR_MIG7SERIES_0_BASEADDR
 
 /*
- * CAUTION
+ * DDR regions used by the DMA
  *
- * Be careful about the following definitions, which determine the addresses
- * where BD rings are allocated and where the Transmit Buffer (vector of IQ
- * samples) is allocated. Memory regions used by other applications could be
- * overwritten, depending on the linker configuration.
- *
- * The following addresses were tested using:
- *  _STACK_SIZE : 0x40000;
- *  _HEAP_SIZE  : 0x40000;
+ * BD rings and buffers are not placed at fixed addresses. They are requested
+ * at boot from the DDR region allocator (see ddr_regions.c), which places them
+ * after the program image, heap and stack, with the alignment required by the
+ * BDs and by the data cache. Only their sizes are defined here.
  */
-#define MEM_BASE_ADDR		(DDR_BASE_ADDR + 0x1000000)
-
-#define RX_BD_SPACE_BASE	(MEM_BASE_ADDR)
-#define RX_BD_SPACE_HIGH	(MEM_BASE_ADDR + 0x0000FFFF)
-#define TX_BD_SPACE_BASE	(MEM_BASE_ADDR + 0x00010000)
-#define TX_BD_SPACE_HIGH	(MEM_BASE_ADDR + 0x0001FFFF)
-#define TX_BUFFER_BASE		(MEM_BASE_ADDR + 0x00100000)
-#define RX_BUFFER_BASE		(MEM_BASE_ADDR + 0x00300000)
-#define RX_BUFFER_HIGH		(MEM_BASE_ADDR + 0x004FFFFF)
+#define RX_BD_SPACE_SIZE	0x00010000
+#define TX_BD_SPACE_SIZE	0x00010000
+#define TX_BUFFER_SIZE		(N_IQ_SAMPLES * 4)
+#define RX_BUFFER_SIZE		0x00800000
 
 /*
  * Timeout loop counter for reset
@@ -131,23 +151,69 @@
  * Number of BDs per transmission in regular mode
  * (in cyclic mode only one is used)
  */
+#ifndef NUMBER_OF_BDS_PER_TX
 #define NUMBER_OF_BDS_PER_TX		10
+#endif
 
 /* The interrupt coalescing threshold and delay timer threshold
  * Valid range is 1 to 255
  *
  * We set the coalescing threshold to be the total number of packets.
  * The receive side will only get one completion interrupt for this example.
+ *
+ * With ADAPTIVE_COALESCING defined, these are only the initial values. The
+ * thresholds are then retuned at runtime (see dma_coalesce.c) to keep the
+ * interrupt rate under TARGET_IRQ_RATE, while sizing the threshold and the
+ * delay timer for a BD completion latency of MAX_COMPLETION_LATENCY_US (a
+ * design target: only the gap between interrupts is measured).
  */
 #define COALESCING_COUNT		NUMBER_OF_BDS_PER_TX
 #define DELAY_TIMER_COUNT		100
 
+#ifndef FIXED_COALESCING
+#define ADAPTIVE_COALESCING
+#endif
+#define TARGET_IRQ_RATE				2000
+#define MAX_COMPLETION_LATENCY_US	250
+
 /*
  * Buffer and Buffer Descriptor related constant definition
  */
+#ifndef N_DMA_READ_BURSTS
 #define N_DMA_READ_BURSTS  16
+#endif
 #define MAX_PKT_LEN		BYTES_PER_DMA_READ / N_DMA_READ_BURSTS
 
+/*
+ * Continuous capture (S2MM)
+ *
+ * Each Rx BD is attached to its own buffer, so the number of Rx BDs is given
+ * by the size of the Rx buffer region. The buffer length is RX_PKT_LEN_LTE5 in
+ * LTE 5 MHz mode and scales with the sampling frequency of the other modes,
+ * so that every BD holds the same capture duration. It must be a multiple of
+ * the data cache line, since buffers are invalidated individually, and fit
+ * the BD length field in every mode (c_sg_length_width of the AXI DMA in the
+ * block design).
+ */
+#define RX_PKT_LEN_LTE5		(MAX_PKT_LEN)
+
+/*
+ * Largest number of Rx BDs (and thus Rx buffers) fitting the Rx BD space
+ */
+#define MAX_RX_BDS		(RX_BD_SPACE_SIZE / XAXIDMA_BD_MINIMUM_ALIGNMENT)
+
+/*
+ * Loopback (ADC-to-DAC delay line)
+ *
+ * Every BD raises its own interrupt, so that the capture and playout
+ * timestamps of each buffer are taken at its completion. At least
+ * LOOPBACK_MIN_FREE_BDS buffers are left armed for capture beyond the delay
+ * line depth, to absorb the interrupt latency.
+ */
+#define LOOPBACK_COALESCING_COUNT	1
+#define LOOPBACK_DELAY_TIMER_COUNT	0
+#define LOOPBACK_MIN_FREE_BDS		2
+
 /**************************** Type Definitions *******************************/
 
 /***************** Macros (Inline Functions) Definitions *********************/
@@ -156,16 +222,52 @@
 
 static void TxIntrHandler(void *Callback);
 static void RxIntrHandler(void *Callback);
-static void TxCallBack(XAxiDma_BdRing * TxRingPtr);
-static void RxCallBack(XAxiDma_BdRing * RxRingPtr);
+static int TxCallBack(XAxiDma_BdRing * TxRingPtr);
+static int RxCallBack(XAxiDma_BdRing * RxRingPtr);
 static int RxSetup(XAxiDma * AxiDmaInstPtr);
 static int TxSetup(XAxiDma * AxiDmaInstPtr);
 static int SendPacket(XAxiDma * AxiDmaInstPtr);
+static int RxRearm(XAxiDma_BdRing * RxRingPtr, int BdCount);
+static int DmaAllocRegions(void);
+static int DmaChannelsSetup(void);
+static void DmaApplyLteMode(int LteMode);
+static int DmaReset(void);
+static int LoopbackEnqueueTx(int BdCount);
+static void LoopbackTxDone(XAxiDma_BdRing * TxRingPtr, XAxiDma_Bd * BdPtr,
+		int BdCount);
 
 /************************** Variable Definitions *****************************/
 
 static XAxiDma AxiDma; /* Instance of the XAxiDma */
 
+/*
+ * DDR regions of the BD rings and buffers (see DmaAllocRegions)
+ */
+static u32 RxBdSpaceBase;
+static u32 TxBdSpaceBase;
+static u32 TxBufferBase;
+static u32 RxBufferBase;
+
+/*
+ * Source buffers of the Tx channel, which track the range written by the CPU
+ * so that only that range is flushed before a transfer.
+ */
+static DmaBuffer TxBuffer;
+static DmaBuffer TxWaveformBuffer;
+
+/*
+ * Bytes of interleaved AxC waveforms loaded into the Tx buffer by
+ * "loadTxAxcWaveforms()" (0 when the preset "txWaveform" is used). They are
+ * kept across a loopback session, which only uses the Rx buffers, and are
+ * discarded on a change of LTE mode.
+ */
+static u32 TxAxcBytes;
+
+/*
+ * LTE mode the channels are configured for
+ */
+static int DmaLteMode;
+
 /*
  * Flags interrupt handlers use to notify the application context the events.
  */
@@ -173,6 +275,44 @@ volatile int TxDone;
 volatile int RxDone;
 volatile int Error;
 
+/*
+ * Continuous capture state. "RxCompleted" counts the Rx buffers filled by the
+ * hardware (written by the Rx ISR only), while "RxRead" counts the buffers
+ * already handed to the application (written by "readRxCaptureBuffer()" only).
+ */
+static volatile u32 RxCompleted;
+static u32 RxRead;
+static u32 RxNextBufferAddr;
+static volatile RxCaptureStats RxStats;
+
+/*
+ * Rx BD length and number of Rx BDs of the current LTE mode
+ */
+static u32 RxPktLen;
+static u32 nRxBds;
+
+/*
+ * Adaptive interrupt coalescing state of each channel
+ */
+static DmaCoalesceState TxCoalesce;
+static DmaCoalesceState RxCoalesce;
+
+/*
+ * Loopback state. Rx buffers are captured, played out and re-armed in ring
+ * order, so the next buffer to queue for playout follows the last one, just
+ * as "RxNextBufferAddr" does for re-arming. "LoopbackQueued" counts the MM2S
+ * BDs committed to hardware and not yet completed. Both ISRs update it, but
+ * never concurrently (see "RxIntrHandler()").
+ */
+static volatile int LoopbackEnabled;
+static u32 LoopbackDepth;
+static int LoopbackStarted;
+static u32 LoopbackQueued;
+static u32 LoopbackNextTxAddr;
+static u32 LoopbackCaptureTime[MAX_RX_BDS];
+static u64 LoopbackLatencySumUs;
+static volatile DmaLoopbackStats LoopbackStats;
+
 /*****************************************************************************/
 
 /*****************************************************************************/
@@ -207,18 +347,23 @@ int initAXIDma(void) {
 		return XST_FAILURE;
 	}
 
-	/* Set up TX/RX channels to be ready to transmit and receive packets */
-#if ROE_CPRI_SRC == ROE_SRC_DMA
-	Status = TxSetup(&AxiDma);
-
+	/* Place BD rings and buffers in DDR */
+	Status = DmaAllocRegions();
 	if (Status != XST_SUCCESS) {
+		xil_printf("Failed to allocate DMA memory\r\n");
+		return XST_FAILURE;
+	}
 
-		xil_printf("Failed TX setup\r\n");
+	/* Set up TX/RX channels for the current LTE mode */
+	DmaApplyLteMode(getLteMode());
+	Status = DmaChannelsSetup();
+	if (Status != XST_SUCCESS) {
 		return XST_FAILURE;
 	}
 
+	/* Setup the AXI DMA interrupts */
+#if ROE_CPRI_SRC == ROE_SRC_DMA
 	if (Config->HasMm2S) {
-		// Setup the AXI DMA interrupts
 		if (SetUpInterruptSystem(DMA_TX_INTR_ID,
 				(XInterruptHandler) TxIntrHandler,
 				(void *) &AxiDma) != XST_SUCCESS)
@@ -226,20 +371,49 @@ int initAXIDma(void) {
 	}
 #endif
 
-//#if ROE_CPRI_SINK == ROE_SINK_DMA
-//	Status = RxSetup(&AxiDma);
-//	if (Status != XST_SUCCESS) {
-//
-//		xil_printf("Failed RX setup\r\n");
-//		return XST_FAILURE;
-//	}
-//	if (Config->HasS2Mm) {
-//		if (SetUpInterruptSystem(DMA_RX_INTR_ID,
-//						(XInterruptHandler) RxIntrHandler,
-//						(void *) &AxiDma) != XST_SUCCESS)
-//		return XST_FAILURE;
-//	}
-//#endif
+#if ROE_CPRI_SINK == ROE_SINK_DMA
+	if (Config->HasS2Mm) {
+		if (SetUpInterruptSystem(DMA_RX_INTR_ID,
+				(XInterruptHandler) RxIntrHandler,
+				(void *) &AxiDma) != XST_SUCCESS)
+			return XST_FAILURE;
+	}
+#endif
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Sets up the TX/RX channels to be ready to transmit and receive packets and
+ * enables the channel interrupts.
+ *
+ * @return	- XST_SUCCESS if the setup is successful.
+ *		- XST_FAILURE otherwise.
+ *
+ ******************************************************************************/
+static int DmaChannelsSetup(void) {
+	int Status;
+
+#if ROE_CPRI_SRC == ROE_SRC_DMA
+	Status = TxSetup(&AxiDma);
+
+	if (Status != XST_SUCCESS) {
+
+		xil_printf("Failed TX setup\r\n");
+		return XST_FAILURE;
+	}
+#endif
+
+#if ROE_CPRI_SINK == ROE_SINK_DMA
+	Status = RxSetup(&AxiDma);
+	if (Status != XST_SUCCESS) {
+
+		xil_printf("Failed RX setup\r\n");
+		return XST_FAILURE;
+	}
+#endif
 
 	/* Disable all interrupts before setup */
 	XAxiDma_IntrDisable(&AxiDma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DMA_TO_DEVICE);
@@ -248,10 +422,17 @@ int initAXIDma(void) {
 
 	/* Enable all required interrupts */
 #ifdef TRANSMIT_IN_CYCLIC_MODE
-	// When transmitting in Cyclic mode, Tx Complete interrupts are disabled.
-	XAxiDma_IntrEnable(&AxiDma,
-			(XAXIDMA_IRQ_ERROR_MASK | XAXIDMA_IRQ_DELAY_MASK),
-			XAXIDMA_DMA_TO_DEVICE);
+	if (LoopbackEnabled) {
+		// The loopback re-arms capture buffers on Tx completion
+		XAxiDma_IntrEnable(&AxiDma, XAXIDMA_IRQ_ALL_MASK,
+				XAXIDMA_DMA_TO_DEVICE);
+	} else {
+		// When transmitting in Cyclic mode, Tx Complete interrupts are
+		// disabled.
+		XAxiDma_IntrEnable(&AxiDma,
+				(XAXIDMA_IRQ_ERROR_MASK | XAXIDMA_IRQ_DELAY_MASK),
+				XAXIDMA_DMA_TO_DEVICE);
+	}
 #else
 	// When not in Cyclic mode, all interrupts are enabled
 	XAxiDma_IntrEnable(&AxiDma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DMA_TO_DEVICE);
@@ -262,6 +443,132 @@ int initAXIDma(void) {
 	return XST_SUCCESS;
 }
 
+/*****************************************************************************/
+/*
+ *
+ * Sizes the Rx BDs for the given LTE mode, so that each BD holds the same
+ * capture duration regardless of the sampling frequency.
+ *
+ ******************************************************************************/
+static void DmaApplyLteMode(int LteMode) {
+	const LteProfile *Profile = getLteProfile(LteMode);
+	const LteProfile *Lte5 = getLteProfile(LTE5);
+
+	DmaLteMode = LteMode;
+	RxPktLen = RX_PKT_LEN_LTE5 * (Profile->SamplingFreq / Lte5->SamplingFreq);
+	nRxBds = RX_BUFFER_SIZE / RxPktLen;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Reconfigures the DMA for another LTE mode at runtime: both channels are
+ * reset, the Rx ring is rebuilt with the BD length of the new mode and the
+ * AxC waveforms loaded for the previous mode are discarded. Call
+ * "startCyclicDmaRead()" afterwards to resume transmission.
+ *
+ * In LTE 5 MHz mode, the preset waveform ("txWaveform") is transmitted unless
+ * another one is loaded. No preset is built in for the other modes, so their
+ * waveforms must be loaded with "loadTxAxcWaveforms()".
+ *
+ * @param	LteMode is the new mode (see lte_modes.h).
+ *
+ * @return	- XST_SUCCESS if the channels were reconfigured.
+ *		- XST_INVALID_PARAM for an invalid mode.
+ *		- XST_FAILURE otherwise.
+ *
+ ******************************************************************************/
+int setDmaLteMode(int LteMode) {
+
+	if (getLteProfile(LteMode) == 0) {
+		return XST_INVALID_PARAM;
+	}
+
+	/* Stop both channels (and the loopback, if running) */
+	if (DmaReset() != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	TxAxcBytes = 0;
+	DmaApplyLteMode(LteMode);
+
+	return DmaChannelsSetup();
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Resets both channels of an initialized DMA, which stops any transfer in
+ * progress, and leaves the loopback mode.
+ *
+ * @return	- XST_SUCCESS if the reset completed.
+ *		- XST_FAILURE otherwise.
+ *
+ ******************************************************************************/
+static int DmaReset(void) {
+	int TimeOut;
+
+	if (RxBdSpaceBase == 0) {
+		xil_printf("DMA not initialized\r\n");
+		return XST_FAILURE;
+	}
+
+	XAxiDma_Reset(&AxiDma);
+	TimeOut = RESET_TIMEOUT_COUNTER;
+	while (TimeOut) {
+		if (XAxiDma_ResetIsDone(&AxiDma)) {
+			break;
+		}
+		TimeOut -= 1;
+	}
+	if (!TimeOut) {
+		xil_printf("DMA reset timed out\r\n");
+		return XST_FAILURE;
+	}
+
+	LoopbackEnabled = 0;
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Requests the DDR regions of the BD rings and of the Tx/Rx buffers from the
+ * DDR region allocator. BD spaces are aligned to the BD alignment and buffers
+ * to the data cache line (enforced by the allocator).
+ *
+ * @return	- XST_SUCCESS if all regions were allocated.
+ *		- XST_FAILURE otherwise.
+ *
+ ******************************************************************************/
+static int DmaAllocRegions(void) {
+
+	if (RxBdSpaceBase != 0) {
+		// Already allocated in a previous initialization
+		return XST_SUCCESS;
+	}
+
+	RxBdSpaceBase = ddrAllocRegion("DMA Rx BD ring", RX_BD_SPACE_SIZE,
+			XAXIDMA_BD_MINIMUM_ALIGNMENT);
+	TxBdSpaceBase = ddrAllocRegion("DMA Tx BD ring", TX_BD_SPACE_SIZE,
+			XAXIDMA_BD_MINIMUM_ALIGNMENT);
+	TxBufferBase = ddrAllocRegion("DMA Tx buffer", TX_BUFFER_SIZE,
+			DDR_CACHE_LINE_LEN);
+	RxBufferBase = ddrAllocRegion("DMA Rx capture buffer", RX_BUFFER_SIZE,
+			DDR_CACHE_LINE_LEN);
+
+	if (RxBdSpaceBase == 0 || TxBdSpaceBase == 0 || TxBufferBase == 0
+			|| RxBufferBase == 0) {
+		return XST_FAILURE;
+	}
+
+	DmaBuffer_init(&TxBuffer, TxBufferBase, TX_BUFFER_SIZE);
+	DmaBuffer_init(&TxWaveformBuffer, (u32) &txWaveform, sizeof(txWaveform));
+
+	return XST_SUCCESS;
+}
+
 /*****************************************************************************/
 /*
  *
@@ -275,7 +582,7 @@ int loadRndCriDataIntoMemory(XAxiDma * AxiDmaInstPtr) {
 	u8 Value;
 	int iIqSample;
 	int iWordByte;
-	TxBufferPtr = (u8 *) TX_BUFFER_BASE;
+	TxBufferPtr = (u8 *) TxBufferBase;
 
 	/*
 	 * Each packet is limited to TxRingPtr->MaxTransferLen
@@ -302,6 +609,7 @@ int loadRndCriDataIntoMemory(XAxiDma * AxiDmaInstPtr) {
 		}
 		Value = (Value + 1) & 0xFF;
 	}
+	DmaBuffer_markDirty(&TxBuffer, 0, N_IQ_SAMPLES * 4);
 
 	xil_printf("\r\n Random CPRI Data Loaded into Memory \r\n");
 
@@ -353,12 +661,27 @@ static int RxSetup(XAxiDma * AxiDmaInstPtr) {
 	/* Disable all RX interrupts before RxBD space setup */
 	XAxiDma_BdRingIntDisable(RxRingPtr, XAXIDMA_IRQ_ALL_MASK);
 
-	/* Setup Rx BD space */
+	/* Each Rx buffer is received by a single BD */
+	if (RxPktLen > RxRingPtr->MaxTransferLen) {
+		xil_printf("Rx BD length %d exceeds the maximum of %d bytes\r\n",
+				RxPktLen, RxRingPtr->MaxTransferLen);
+		return XST_FAILURE;
+	}
+
+	/*
+	 * Setup Rx BD space. Only one BD per Rx buffer is created, so that the
+	 * ring order and the buffer order coincide.
+	 */
 	BdCount = XAxiDma_BdRingCntCalc(XAXIDMA_BD_MINIMUM_ALIGNMENT,
-			RX_BD_SPACE_HIGH - RX_BD_SPACE_BASE + 1);
+			RX_BD_SPACE_SIZE);
+	if (BdCount < nRxBds) {
+		xil_printf("Rx bd space too small for %d BDs\r\n", nRxBds);
+		return XST_FAILURE;
+	}
+	BdCount = nRxBds;
 
-	Status = XAxiDma_BdRingCreate(RxRingPtr, RX_BD_SPACE_BASE,
-	RX_BD_SPACE_BASE,
+	Status = XAxiDma_BdRingCreate(RxRingPtr, RxBdSpaceBase,
+	RxBdSpaceBase,
 	XAXIDMA_BD_MINIMUM_ALIGNMENT, BdCount);
 	if (Status != XST_SUCCESS) {
 		xil_printf("Rx bd create failed with %d\r\n", Status);
@@ -385,7 +708,13 @@ static int RxSetup(XAxiDma * AxiDmaInstPtr) {
 	}
 
 	BdCurPtr = BdPtr;
-	RxBufferPtr = RX_BUFFER_BASE;
+	RxBufferPtr = RxBufferBase;
+
+	/*
+	 * Make sure no dirty cache line is written back on top of the data
+	 * written by the DMA
+	 */
+	Xil_DCacheInvalidateRange(RxBufferBase, nRxBds * RxPktLen);
 
 	for (Index = 0; Index < FreeBdCount; Index++) {
 
@@ -398,11 +727,11 @@ static int RxSetup(XAxiDma * AxiDmaInstPtr) {
 			return XST_FAILURE;
 		}
 
-		Status = XAxiDma_BdSetLength(BdCurPtr, MAX_PKT_LEN,
+		Status = XAxiDma_BdSetLength(BdCurPtr, RxPktLen,
 				RxRingPtr->MaxTransferLen);
 		if (Status != XST_SUCCESS) {
 			xil_printf("Rx set length %d on BD %x failed %d\r\n",
-			MAX_PKT_LEN, (unsigned int) BdCurPtr, Status);
+			RxPktLen, (unsigned int) BdCurPtr, Status);
 
 			return XST_FAILURE;
 		}
@@ -414,10 +743,15 @@ static int RxSetup(XAxiDma * AxiDmaInstPtr) {
 
 		XAxiDma_BdSetId(BdCurPtr, RxBufferPtr);
 
-		RxBufferPtr += MAX_PKT_LEN;
+		RxBufferPtr += RxPktLen;
 		BdCurPtr = XAxiDma_BdRingNext(RxRingPtr, BdCurPtr);
 	}
 
+	/* The next re-armed BD takes the first buffer again */
+	RxNextBufferAddr = RxBufferBase;
+	RxCompleted = 0;
+	RxRead = 0;
+
 	/*
 	 * Set the coalescing threshold, so only one receive interrupt
 	 * occurs for this example
@@ -425,13 +759,22 @@ static int RxSetup(XAxiDma * AxiDmaInstPtr) {
 	 * If you would like to have multiple interrupts to happen, change
 	 * the COALESCING_COUNT to be a smaller value
 	 */
-	Status = XAxiDma_BdRingSetCoalesce(RxRingPtr, COALESCING_COUNT,
-	DELAY_TIMER_COUNT);
+	if (LoopbackEnabled) {
+		Status = XAxiDma_BdRingSetCoalesce(RxRingPtr,
+				LOOPBACK_COALESCING_COUNT, LOOPBACK_DELAY_TIMER_COUNT);
+	} else {
+		Status = XAxiDma_BdRingSetCoalesce(RxRingPtr, COALESCING_COUNT,
+				DELAY_TIMER_COUNT);
+	}
 	if (Status != XST_SUCCESS) {
 		xil_printf("Rx set coalesce failed with %d\r\n", Status);
 		return XST_FAILURE;
 	}
 
+	/* Keep at least half of the ring with the hardware while coalescing */
+	DmaCoalesce_init(&RxCoalesce, COALESCING_COUNT, DELAY_TIMER_COUNT,
+			nRxBds / 2, TARGET_IRQ_RATE, MAX_COMPLETION_LATENCY_US);
+
 	Status = XAxiDma_BdRingToHw(RxRingPtr, FreeBdCount, BdPtr);
 	if (Status != XST_SUCCESS) {
 		xil_printf("Rx ToHw failed with %d\r\n", Status);
@@ -471,11 +814,18 @@ static int TxSetup(XAxiDma * AxiDmaInstPtr) {
 	int Status;
 	u32 BdCount;
 
-	// Load Random CPRI data into Memory:
-	Status = loadRndCriDataIntoMemory(&AxiDma);
-	if (Status != XST_SUCCESS) {
-		xil_printf("Failed to load data into memory\r\n");
-		return XST_FAILURE;
+	/*
+	 * Load Random CPRI data into Memory, unless AxC waveforms were loaded:
+	 * the channels are set up again when the loopback stops, and the
+	 * waveforms must still be there for the next cyclic transmission (in
+	 * loopback, Rx buffers are sent).
+	 */
+	if (!LoopbackEnabled && TxAxcBytes == 0) {
+		Status = loadRndCriDataIntoMemory(&AxiDma);
+		if (Status != XST_SUCCESS) {
+			xil_printf("Failed to load data into memory\r\n");
+			return XST_FAILURE;
+		}
 	}
 
 	/* Disable all TX interrupts before TxBD space setup */
@@ -483,10 +833,10 @@ static int TxSetup(XAxiDma * AxiDmaInstPtr) {
 
 	/* Setup TxBD space  */
 	BdCount = XAxiDma_BdRingCntCalc(XAXIDMA_BD_MINIMUM_ALIGNMENT,
-			(u32)TX_BD_SPACE_HIGH - (u32)TX_BD_SPACE_BASE + 1);
+			TX_BD_SPACE_SIZE);
 
-	Status = XAxiDma_BdRingCreate(TxRingPtr, TX_BD_SPACE_BASE,
-	TX_BD_SPACE_BASE,
+	Status = XAxiDma_BdRingCreate(TxRingPtr, TxBdSpaceBase,
+	TxBdSpaceBase,
 	XAXIDMA_BD_MINIMUM_ALIGNMENT, BdCount);
 	if (Status != XST_SUCCESS) {
 
@@ -506,6 +856,20 @@ static int TxSetup(XAxiDma * AxiDmaInstPtr) {
 		return XST_FAILURE;
 	}
 
+	if (LoopbackEnabled) {
+		/*
+		 * One interrupt per buffer played out. The channel is started by
+		 * the Rx ISR once the delay line is filled.
+		 */
+		Status = XAxiDma_BdRingSetCoalesce(TxRingPtr,
+				LOOPBACK_COALESCING_COUNT, LOOPBACK_DELAY_TIMER_COUNT);
+		if (Status != XST_SUCCESS) {
+			xil_printf("Failed set loopback coalescing\r\n");
+			return XST_FAILURE;
+		}
+		return XST_SUCCESS;
+	}
+
 #ifndef TRANSMIT_IN_CYCLIC_MODE
 	/*
 	 * Set the coalescing threshold, so only one transmit interrupt
@@ -523,6 +887,13 @@ static int TxSetup(XAxiDma * AxiDmaInstPtr) {
 		return XST_FAILURE;
 	}
 
+	/*
+	 * Only NUMBER_OF_BDS_PER_TX BDs are outstanding per transmission, so a
+	 * larger threshold would only be reached through the delay timer.
+	 */
+	DmaCoalesce_init(&TxCoalesce, COALESCING_COUNT, DELAY_TIMER_COUNT,
+			NUMBER_OF_BDS_PER_TX, TARGET_IRQ_RATE, MAX_COMPLETION_LATENCY_US);
+
 	/* Enable all TX interrupts */
 	XAxiDma_BdRingIntEnable(TxRingPtr, XAXIDMA_IRQ_ALL_MASK);
 
@@ -545,12 +916,12 @@ static int TxSetup(XAxiDma * AxiDmaInstPtr) {
  *
  * @param	TxRingPtr is a pointer to TX channel of the DMA engine.
  *
- * @return	None.
+ * @return	The number of BDs processed.
  *
  * @note		None.
  *
  ******************************************************************************/
-static void TxCallBack(XAxiDma_BdRing * TxRingPtr) {
+static int TxCallBack(XAxiDma_BdRing * TxRingPtr) {
 	int BdCount;
 	u32 BdSts;
 	XAxiDma_Bd *BdPtr;
@@ -573,8 +944,6 @@ static void TxCallBack(XAxiDma_BdRing * TxRingPtr) {
 		BdSts = XAxiDma_BdGetSts(BdCurPtr);
 		if ((BdSts & XAXIDMA_BD_STS_ALL_ERR_MASK)
 				|| (!(BdSts & XAXIDMA_BD_STS_COMPLETE_MASK))) {
-
-			Status = XST_FAILURE;
 			break;
 		}
 
@@ -588,19 +957,43 @@ static void TxCallBack(XAxiDma_BdRing * TxRingPtr) {
 		BdCurPtr = XAxiDma_BdRingNext(TxRingPtr, BdCurPtr);
 	}
 
-	/* Free all processed BDs for future transmission */
-	Status = XAxiDma_BdRingFree(TxRingPtr, BdCount, BdPtr);
+	/*
+	 * The BDs from the failed one on were not played out. Only the Index BDs
+	 * before it are handed back, the others are counted as errors (the
+	 * error interrupt resets the channel).
+	 */
+	if (Index < BdCount) {
+		if (LoopbackEnabled) {
+			RxStats.nErrors += BdCount - Index;
+		}
+		Error = 1;
+	}
+
+	if (Index == 0) {
+		return 0;
+	}
+
+	/* In loopback, the buffers played out go back to the capture ring */
+	if (LoopbackEnabled) {
+		LoopbackTxDone(TxRingPtr, BdPtr, Index);
+		return Index;
+	}
+
+	/* Free the processed BDs for future transmission */
+	Status = XAxiDma_BdRingFree(TxRingPtr, Index, BdPtr);
 	if (Status != XST_SUCCESS) {
 		Error = 1;
 	} else {
-		TxDone += BdCount;
+		TxDone += Index;
 
+		// SendPacket() traces the failure
 		Status = SendPacket(&AxiDma);
 		if (Status != XST_SUCCESS) {
 			Error = 1;
-			xil_printf("Failed send packet\r\n");
 		}
 	}
+
+	return Index;
 }
 
 /*****************************************************************************/
@@ -623,6 +1016,9 @@ static void TxIntrHandler(void *Callback) {
 	XAxiDma_BdRing *TxRingPtr = XAxiDma_GetTxRing((XAxiDma * ) Callback);
 	u32 IrqStatus;
 	int TimeOut;
+#if defined(ADAPTIVE_COALESCING) && !defined(TRANSMIT_IN_CYCLIC_MODE)
+	int BdCount;
+#endif
 
 	/*
 	 * Since the DMA as Tx (Read Channel) has to have highest priority
@@ -651,7 +1047,9 @@ static void TxIntrHandler(void *Callback) {
 	 */
 	if ((IrqStatus & XAXIDMA_IRQ_ERROR_MASK)) {
 
-		XAxiDma_BdRingDumpRegs(TxRingPtr);
+		// Not XAxiDma_BdRingDumpRegs(): printing would stall the handler
+		Trace_log(TRACE_DMA_ERROR, 0, IrqStatus,
+				XAxiDma_ReadReg(TxRingPtr->ChanBase, XAXIDMA_SR_OFFSET));
 
 		Error = 1;
 
@@ -679,7 +1077,15 @@ static void TxIntrHandler(void *Callback) {
 	 * to handle the processed BDs and raise the according flag
 	 */
 	if ((IrqStatus & (XAXIDMA_IRQ_DELAY_MASK | XAXIDMA_IRQ_IOC_MASK))) {
+#if defined(ADAPTIVE_COALESCING) && !defined(TRANSMIT_IN_CYCLIC_MODE)
+		BdCount = TxCallBack(TxRingPtr);
+		if (!LoopbackEnabled) {
+			DmaCoalesce_onInterrupt(&TxCoalesce, TxRingPtr, IrqStatus,
+					BdCount);
+		}
+#else
 		TxCallBack(TxRingPtr);
+#endif
 	}
 
 	allowAllIrq();
@@ -693,22 +1099,44 @@ static void TxIntrHandler(void *Callback) {
  * This function handles finished BDs by hardware, attaches new buffers to those
  * BDs, and give them back to hardware to receive more incoming packets
  *
+ * Each completed buffer is invalidated in the data cache before it is made
+ * visible to the application, so that "readRxCaptureBuffer()" never returns
+ * stale cache contents.
+ *
+ * Only the BDs completed before the first one reporting an error are handed
+ * back. The DMA engine halts on that BD, so it and the following ones are
+ * left to the error interrupt, which resets the engine.
+ *
  * @param	RxRingPtr is a pointer to RX channel of the DMA engine.
  *
- * @return	None.
+ * @return	The number of completed BDs processed.
  *
  * @note		None.
  *
  ******************************************************************************/
-static void RxCallBack(XAxiDma_BdRing * RxRingPtr) {
+static int RxCallBack(XAxiDma_BdRing * RxRingPtr) {
 	int BdCount;
 	XAxiDma_Bd *BdPtr;
 	XAxiDma_Bd *BdCurPtr;
 	u32 BdSts;
+	u32 BufferAddr;
+	u32 Now = getTimestamp();
 	int Index;
+	int Status;
 
 	/* Get finished BDs from hardware */
 	BdCount = XAxiDma_BdRingFromHw(RxRingPtr, XAXIDMA_ALL_BDS, &BdPtr);
+	if (BdCount <= 0) {
+		return 0;
+	}
+
+	/*
+	 * When every BD of the ring comes back at once, the hardware has run out
+	 * of descriptors, so samples may have been dropped at the S2MM input.
+	 */
+	if (BdCount >= nRxBds) {
+		RxStats.nRingStarved++;
+	}
 
 	BdCurPtr = BdPtr;
 	for (Index = 0; Index < BdCount; Index++) {
@@ -721,38 +1149,238 @@ static void RxCallBack(XAxiDma_BdRing * RxRingPtr) {
 		BdSts = XAxiDma_BdGetSts(BdCurPtr);
 		if ((BdSts & XAXIDMA_BD_STS_ALL_ERR_MASK)
 				|| (!(BdSts & XAXIDMA_BD_STS_COMPLETE_MASK))) {
+			RxStats.nErrors++;
 			Error = 1;
 			break;
 		}
 
+		BufferAddr = (u32) XAxiDma_BdGetId(BdCurPtr);
+		if (LoopbackEnabled) {
+			/* Only the DMA reads the buffer, no cache maintenance needed */
+			LoopbackCaptureTime[(BufferAddr - RxBufferBase) / RxPktLen] = Now;
+		} else {
+			/* Drop any cache line that may shadow the new samples */
+			Xil_DCacheInvalidateRange(BufferAddr, RxPktLen);
+		}
+
+		RxStats.nBytesReceived += XAxiDma_BdGetActualLength(BdCurPtr,
+				RxRingPtr->MaxTransferLen);
+		RxStats.nBdsCompleted++;
+		RxCompleted++;
+
 		/* Find the next processed BD */
 		BdCurPtr = XAxiDma_BdRingNext(RxRingPtr, BdCurPtr);
 		RxDone += 1;
 	}
 
+	if (Index == 0) {
+		return 0;
+	}
+
+	/* Free the completed BDs and hand them back to hardware */
+	Status = XAxiDma_BdRingFree(RxRingPtr, Index, BdPtr);
+	if (Status != XST_SUCCESS) {
+		RxStats.nErrors++;
+		Error = 1;
+		return Index;
+	}
+
+	/*
+	 * In loopback, the captured buffers are queued for playout instead. They
+	 * are re-armed once played out (see "LoopbackTxDone()").
+	 */
+	if (LoopbackEnabled) {
+		if (XAxiDma_BdRingGetFreeCnt(RxRingPtr) == RxRingPtr->AllCnt) {
+			LoopbackStats.nOverruns++;
+		}
+		if (LoopbackEnqueueTx(Index) != XST_SUCCESS) {
+			RxStats.nErrors++;
+			Error = 1;
+		}
+		return Index;
+	}
+
+	Status = RxRearm(RxRingPtr, Index);
+	if (Status != XST_SUCCESS) {
+		RxStats.nErrors++;
+		Error = 1;
+	}
+
+	return Index;
 }
 
 /*****************************************************************************/
 /*
  *
- * This is the DMA RX interrupt handler function
- *
- * It gets the interrupt status from the hardware, acknowledges it, and if any
- * error happens, it resets the hardware. Otherwise, if a completion interrupt
- * presents, then it calls the callback function.
+ * Re-arms freed Rx BDs, attaching the next buffers of the Rx buffer region in
+ * ring order, and commits them to hardware.
  *
- * @param	Callback is a pointer to RX channel of the DMA engine.
+ * @param	RxRingPtr is a pointer to RX channel of the DMA engine.
+ * @param	BdCount is the number of BDs to re-arm.
  *
- * @return	None.
+ * @return	- XST_SUCCESS if the BDs were given back to hardware.
+ *		- XST_FAILURE otherwise.
  *
- * @note		None.
+ * @note		Called in interrupt context.
  *
  ******************************************************************************/
-static void RxIntrHandler(void *Callback) {
-	XAxiDma_BdRing *RxRingPtr = XAxiDma_GetRxRing((XAxiDma * ) Callback);
+static int RxRearm(XAxiDma_BdRing * RxRingPtr, int BdCount) {
+	XAxiDma_Bd *BdPtr;
+	XAxiDma_Bd *BdCurPtr;
+	int Status;
+	int Index;
 
-	u32 IrqStatus;
-	int TimeOut;
+	Status = XAxiDma_BdRingAlloc(RxRingPtr, BdCount, &BdPtr);
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	BdCurPtr = BdPtr;
+	for (Index = 0; Index < BdCount; Index++) {
+
+		Status = XAxiDma_BdSetBufAddr(BdCurPtr, RxNextBufferAddr);
+		if (Status != XST_SUCCESS) {
+			XAxiDma_BdRingUnAlloc(RxRingPtr, BdCount, BdPtr);
+			return XST_FAILURE;
+		}
+
+		Status = XAxiDma_BdSetLength(BdCurPtr, RxPktLen,
+				RxRingPtr->MaxTransferLen);
+		if (Status != XST_SUCCESS) {
+			XAxiDma_BdRingUnAlloc(RxRingPtr, BdCount, BdPtr);
+			return XST_FAILURE;
+		}
+
+		XAxiDma_BdSetCtrl(BdCurPtr, 0);
+		XAxiDma_BdSetId(BdCurPtr, RxNextBufferAddr);
+
+		RxNextBufferAddr += RxPktLen;
+		if (RxNextBufferAddr >= RxBufferBase + nRxBds * RxPktLen) {
+			RxNextBufferAddr = RxBufferBase;
+		}
+
+		BdCurPtr = XAxiDma_BdRingNext(RxRingPtr, BdCurPtr);
+	}
+
+	return XAxiDma_BdRingToHw(RxRingPtr, BdCount, BdPtr);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Returns the oldest captured Rx buffer not yet read by the application.
+ *
+ * Buffers are re-armed as soon as they complete, so a buffer remains valid
+ * until the hardware wraps around the ring and reaches it again. If the
+ * application falls behind by a full ring, the overwritten buffers are skipped
+ * and accounted as reader overruns.
+ *
+ * @param	BufferAddr returns the address of the captured buffer.
+ * @param	Length returns the buffer length in bytes.
+ *
+ * @return	- XST_SUCCESS if a buffer was returned.
+ *		- XST_FAILURE if no new buffer is available.
+ *
+ * @note		None.
+ *
+ ******************************************************************************/
+int readRxCaptureBuffer(u32 *BufferAddr, u32 *Length) {
+	u32 Completed = RxCompleted;
+	u32 Pending = Completed - RxRead;
+
+	/* In loopback, captured buffers belong to the playout queue */
+	if (Pending == 0 || LoopbackEnabled) {
+		return XST_FAILURE;
+	}
+
+	/*
+	 * The buffer being filled by the hardware is nRxBds completions ahead
+	 * of the oldest valid one.
+	 */
+	if (Pending >= nRxBds) {
+		RxStats.nReaderOverruns += Pending - (nRxBds - 1);
+		RxRead = Completed - (nRxBds - 1);
+	}
+
+	*BufferAddr = RxBufferBase + (RxRead % nRxBds) * RxPktLen;
+	*Length = RxPktLen;
+	RxRead++;
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Copies the continuous capture statistics.
+ *
+ * @param	Stats is the destination of the statistics.
+ *
+ * @return	None.
+ *
+ * @note		None.
+ *
+ ******************************************************************************/
+void getRxCaptureStats(RxCaptureStats *Stats) {
+	*Stats = RxStats;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Copies the adaptive coalescing state (programmed values and statistics) of
+ * one DMA channel.
+ *
+ * @param	Direction is XAXIDMA_DMA_TO_DEVICE or XAXIDMA_DEVICE_TO_DMA.
+ * @param	State is the destination of the coalescing state.
+ *
+ * @return	None.
+ *
+ * @note		None.
+ *
+ ******************************************************************************/
+void getDmaCoalesceState(int Direction, DmaCoalesceState *State) {
+	if (Direction == XAXIDMA_DMA_TO_DEVICE) {
+		*State = TxCoalesce;
+	} else {
+		*State = RxCoalesce;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * This is the DMA RX interrupt handler function
+ *
+ * It gets the interrupt status from the hardware, acknowledges it, and if any
+ * error happens, it resets the hardware. Otherwise, if a completion interrupt
+ * presents, then it calls the callback function.
+ *
+ * @param	Callback is a pointer to RX channel of the DMA engine.
+ *
+ * @return	None.
+ *
+ * @note		None.
+ *
+ ******************************************************************************/
+static void RxIntrHandler(void *Callback) {
+	XAxiDma_BdRing *RxRingPtr = XAxiDma_GetRxRing((XAxiDma * ) Callback);
+
+	u32 IrqStatus;
+	int TimeOut;
+#ifdef ADAPTIVE_COALESCING
+	int BdCount;
+#endif
+	int Masked = LoopbackEnabled;
+
+	/*
+	 * In loopback, the Rx ISR commits BDs to the Tx ring, while the Tx ISR
+	 * re-arms BDs of the Rx ring. Mask all interrupts, including the Tx one,
+	 * so that the Tx ISR never preempts this one while a ring is updated.
+	 */
+	if (Masked) {
+		preventIrqUpTo(0);
+	}
 
 	/* Read pending interrupts */
 	IrqStatus = XAxiDma_BdRingGetIrq(RxRingPtr);
@@ -764,6 +1392,9 @@ static void RxIntrHandler(void *Callback) {
 	 * If no interrupt is asserted, we do not do anything
 	 */
 	if (!(IrqStatus & XAXIDMA_IRQ_ALL_MASK)) {
+		if (Masked) {
+			allowAllIrq();
+		}
 		return;
 	}
 
@@ -774,8 +1405,10 @@ static void RxIntrHandler(void *Callback) {
 	 */
 	if ((IrqStatus & XAXIDMA_IRQ_ERROR_MASK)) {
 
-		XAxiDma_BdRingDumpRegs(RxRingPtr);
+		Trace_log(TRACE_DMA_ERROR, 1, IrqStatus,
+				XAxiDma_ReadReg(RxRingPtr->ChanBase, XAXIDMA_SR_OFFSET));
 
+		RxStats.nErrors++;
 		Error = 1;
 
 		/* Reset could fail and hang
@@ -793,6 +1426,9 @@ static void RxIntrHandler(void *Callback) {
 			TimeOut -= 1;
 		}
 
+		if (Masked) {
+			allowAllIrq();
+		}
 		return;
 	}
 
@@ -801,7 +1437,20 @@ static void RxIntrHandler(void *Callback) {
 	 * to handle the processed BDs and then raise the according flag.
 	 */
 	if ((IrqStatus & (XAXIDMA_IRQ_DELAY_MASK | XAXIDMA_IRQ_IOC_MASK))) {
+#ifdef ADAPTIVE_COALESCING
+		BdCount = RxCallBack(RxRingPtr);
+		// Loopback keeps one interrupt per BD for the latency timestamps
+		if (!LoopbackEnabled) {
+			DmaCoalesce_onInterrupt(&RxCoalesce, RxRingPtr, IrqStatus,
+					BdCount);
+		}
+#else
 		RxCallBack(RxRingPtr);
+#endif
+	}
+
+	if (Masked) {
+		allowAllIrq();
 	}
 }
 
@@ -816,32 +1465,29 @@ static void RxIntrHandler(void *Callback) {
  * 		- XST_SUCCESS if the DMA accepts all the packets successfully,
  * 		- XST_FAILURE if error occurs
  *
- * @note		None.
+ * @note		Failures are traced (TRACE_DMA_TX_FAILED) rather than printed,
+ * 		since this also runs in the Tx interrupt handler.
  *
  ******************************************************************************/
 static int SendPacket(XAxiDma * AxiDmaInstPtr) {
 	XAxiDma_BdRing *TxRingPtr = XAxiDma_GetTxRing(AxiDmaInstPtr);
-	u8 *TxPacket;
 	XAxiDma_Bd *BdPtr, *BdCurPtr;
 	int Status;
 	int Pkts;
 	u32 BufferAddr;
 
-	TxPacket = (u8 *) TX_BUFFER_BASE;
-
-	/* Flush the SrcBuffer before the DMA transfer, in case the Data Cache
-	 * is enabled
+	/* Flush the range of the SrcBuffer written since the last transfer, in
+	 * case the Data Cache is enabled (nothing, if it was not modified)
 	 */
-	Xil_DCacheFlushRange((u32 )TxPacket, MAX_PKT_LEN * NUMBER_OF_BDS_PER_TX);
+	DmaBuffer_flush(&TxBuffer);
 
 	Status = XAxiDma_BdRingAlloc(TxRingPtr, NUMBER_OF_BDS_PER_TX, &BdPtr);
 	if (Status != XST_SUCCESS) {
-
-		xil_printf("Failed bd alloc \t STATUS \t %d \r\n", Status);
+		Trace_log(TRACE_DMA_TX_FAILED, 1, Status, 0);
 		return XST_FAILURE;
 	}
 
-	BufferAddr = (u32) TX_BUFFER_BASE;
+	BufferAddr = (u32) TxBufferBase;
 	BdCurPtr = BdPtr;
 
 	/*
@@ -854,18 +1500,14 @@ static int SendPacket(XAxiDma * AxiDmaInstPtr) {
 
 		Status = XAxiDma_BdSetBufAddr(BdCurPtr, BufferAddr);
 		if (Status != XST_SUCCESS) {
-			xil_printf("Tx set buffer addr %x on BD %x failed %d\r\n",
-					(unsigned int) BufferAddr, (unsigned int) BdCurPtr, Status);
-
+			Trace_log(TRACE_DMA_TX_FAILED, 2, Status, (u32) BdCurPtr);
 			return XST_FAILURE;
 		}
 
 		Status = XAxiDma_BdSetLength(BdCurPtr, MAX_PKT_LEN,
 				TxRingPtr->MaxTransferLen);
 		if (Status != XST_SUCCESS) {
-			xil_printf("Tx set length %d on BD %x failed %d\r\n",
-			MAX_PKT_LEN, (unsigned int) BdCurPtr, Status);
-
+			Trace_log(TRACE_DMA_TX_FAILED, 3, Status, (u32) BdCurPtr);
 			return XST_FAILURE;
 		}
 
@@ -893,13 +1535,76 @@ static int SendPacket(XAxiDma * AxiDmaInstPtr) {
 	/* Give the BD to hardware */
 	Status = XAxiDma_BdRingToHw(TxRingPtr, NUMBER_OF_BDS_PER_TX, BdPtr);
 	if (Status != XST_SUCCESS) {
+		Trace_log(TRACE_DMA_TX_FAILED, 4, Status, (u32) BdPtr);
+		return XST_FAILURE;
+	}
 
-		xil_printf("Failed to hw, length %d\r\n",
-				(int) XAxiDma_BdGetLength(BdPtr, TxRingPtr->MaxTransferLen));
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Loads the waveforms of "nAxc" antenna-carriers into the Tx buffer, to be
+ * transmitted in cyclic mode by "startCyclicDmaRead()".
+ *
+ * The DAC DMA interface demultiplexes the DMA stream round-robin, word k
+ * feeding AxC (k % DMA_N_AXC). Hence, the waveforms are interleaved sample by
+ * sample in this order. When fewer than DMA_N_AXC waveforms are given, they
+ * are repeated cyclically over the remaining AxCs (e.g. a single waveform is
+ * transmitted on all AxCs).
+ *
+ * The waveforms must be packed as the preset "txWaveform" (Q in the 16 MSBs,
+ * I in the 16 LSBs, truncation mask applied), see "tools/wavegen". Load them
+ * before starting the cyclic transmission, since the buffer is read
+ * continuously afterwards.
+ *
+ * @param	AxcWaveforms holds one pointer to the IQ samples of each AxC.
+ * @param	nAxc is the number of waveforms, which must divide DMA_N_AXC.
+ * @param	nSamples is the number of IQ samples in each waveform.
+ *
+ * @return	- XST_SUCCESS if the waveforms were loaded.
+ *		- XST_INVALID_PARAM if they do not fit the AxCs or the Tx buffer.
+ *		- XST_FAILURE if the DMA was not initialized.
+ *
+ ******************************************************************************/
+int loadTxAxcWaveforms(const u32 * const *AxcWaveforms, int nAxc,
+		u32 nSamples) {
+	u32 *TxWords = (u32 *) TxBufferBase;
+	u32 Bytes = nSamples * DMA_N_AXC * 4;
+	u32 iSample;
+	int iAxc;
+
+	if (nAxc <= 0 || nAxc > DMA_N_AXC || (DMA_N_AXC % nAxc) != 0
+			|| nSamples == 0) {
+		xil_printf("Invalid AxC waveforms: %d AxC for %d DMA AxC\r\n", nAxc,
+				DMA_N_AXC);
+		return XST_INVALID_PARAM;
+	}
 
+	if (TxBufferBase == 0) {
+		xil_printf("DMA must be initialized before loading waveforms\r\n");
 		return XST_FAILURE;
 	}
 
+	if (Bytes > TX_BUFFER_SIZE) {
+		xil_printf("AxC waveforms (%d bytes) exceed the Tx buffer\r\n",
+				Bytes);
+		return XST_INVALID_PARAM;
+	}
+
+	for (iSample = 0; iSample < nSamples; iSample++) {
+		for (iAxc = 0; iAxc < DMA_N_AXC; iAxc++) {
+			*TxWords++ = AxcWaveforms[iAxc % nAxc][iSample];
+		}
+	}
+	DmaBuffer_markDirty(&TxBuffer, 0, Bytes);
+
+	TxAxcBytes = Bytes;
+
+	xil_printf("Loaded %d IQ samples for each of %d AxC\r\n", nSamples,
+			DMA_N_AXC);
+
 	return XST_SUCCESS;
 }
 
@@ -923,13 +1628,29 @@ int startCyclicDmaRead() {
 	XAxiDma_Bd *BdPtr;
 	int Status;
 	u32 BufferAddr;
-#if 1
-	BufferAddr = (u32) &txWaveform;
-#endif
+	u32 Length;
+
+	if (TxAxcBytes != 0) {
+		// Interleaved AxC waveforms loaded by "loadTxAxcWaveforms()"
+		BufferAddr = (u32) TxBufferBase;
+		Length = TxAxcBytes;
+		DmaBuffer_flush(&TxBuffer);
+	} else if (DmaLteMode == LTE5) {
+		BufferAddr = (u32) &txWaveform;
+		Length = BYTES_PER_DMA_READ;
+		DmaBuffer_flush(&TxWaveformBuffer);
+	} else {
+		xil_printf("No preset waveform for %s, load one first\r\n",
+				getLteProfile(DmaLteMode)->Name);
+		return XST_FAILURE;
+	}
 
-#if 0
-	BufferAddr = (u32) TX_BUFFER_BASE;
-#endif
+	/* The whole waveform is read by a single BD */
+	if (Length > TxRingPtr->MaxTransferLen) {
+		xil_printf("Tx BD length %d exceeds the maximum of %d bytes\r\n",
+				Length, TxRingPtr->MaxTransferLen);
+		return XST_FAILURE;
+	}
 
 	/*
 	 * Set cyclic mode for the read channel
@@ -953,9 +1674,20 @@ int startCyclicDmaRead() {
 	/*
 	 * Setup TxBD #1
 	 */
-	XAxiDma_BdSetBufAddr(BdPtr, BufferAddr);
+	Status = XAxiDma_BdSetBufAddr(BdPtr, BufferAddr);
+	if (Status != XST_SUCCESS) {
+		xil_printf("Tx set buffer addr %x failed %d\r\n",
+				(unsigned int) BufferAddr, Status);
+		XAxiDma_BdRingUnAlloc(TxRingPtr, 1, BdPtr);
+		return XST_FAILURE;
+	}
 	// Read the entire buffer at once
-	XAxiDma_BdSetLength(BdPtr, BYTES_PER_DMA_READ, TxRingPtr->MaxTransferLen);
+	Status = XAxiDma_BdSetLength(BdPtr, Length, TxRingPtr->MaxTransferLen);
+	if (Status != XST_SUCCESS) {
+		xil_printf("Tx set length %d failed %d\r\n", Length, Status);
+		XAxiDma_BdRingUnAlloc(TxRingPtr, 1, BdPtr);
+		return XST_FAILURE;
+	}
 	// At the same BD, mark both SOF and EOF
 	XAxiDma_BdSetCtrl(BdPtr,
 	XAXIDMA_BD_CTRL_TXEOF_MASK | XAXIDMA_BD_CTRL_TXSOF_MASK);
@@ -1013,3 +1745,323 @@ int startCyclicDmaRead() {
 
 	return XST_SUCCESS;
 }
+
+/*****************************************************************************/
+/*
+ *
+ * Queues the next captured buffers for playout, committing one MM2S BD per
+ * buffer, and starts the Tx channel once the delay line holds "LoopbackDepth"
+ * buffers.
+ *
+ * @param	BdCount is the number of buffers captured.
+ *
+ * @return	- XST_SUCCESS if the buffers were committed to hardware.
+ *		- XST_FAILURE otherwise.
+ *
+ * @note		Called in interrupt context.
+ *
+ ******************************************************************************/
+static int LoopbackEnqueueTx(int BdCount) {
+	XAxiDma_BdRing *TxRingPtr = XAxiDma_GetTxRing(&AxiDma);
+	XAxiDma_Bd *BdPtr;
+	XAxiDma_Bd *BdCurPtr;
+	int Status;
+	int Index;
+
+	Status = XAxiDma_BdRingAlloc(TxRingPtr, BdCount, &BdPtr);
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	BdCurPtr = BdPtr;
+	for (Index = 0; Index < BdCount; Index++) {
+
+		Status = XAxiDma_BdSetBufAddr(BdCurPtr, LoopbackNextTxAddr);
+		if (Status != XST_SUCCESS) {
+			XAxiDma_BdRingUnAlloc(TxRingPtr, BdCount, BdPtr);
+			return XST_FAILURE;
+		}
+
+		Status = XAxiDma_BdSetLength(BdCurPtr, RxPktLen,
+				TxRingPtr->MaxTransferLen);
+		if (Status != XST_SUCCESS) {
+			XAxiDma_BdRingUnAlloc(TxRingPtr, BdCount, BdPtr);
+			return XST_FAILURE;
+		}
+
+		XAxiDma_BdSetCtrl(BdCurPtr,
+				XAXIDMA_BD_CTRL_TXSOF_MASK | XAXIDMA_BD_CTRL_TXEOF_MASK);
+		XAxiDma_BdSetId(BdCurPtr, LoopbackNextTxAddr);
+
+		LoopbackNextTxAddr += RxPktLen;
+		if (LoopbackNextTxAddr >= RxBufferBase + nRxBds * RxPktLen) {
+			LoopbackNextTxAddr = RxBufferBase;
+		}
+
+		BdCurPtr = XAxiDma_BdRingNext(TxRingPtr, BdCurPtr);
+	}
+
+	Status = XAxiDma_BdRingToHw(TxRingPtr, BdCount, BdPtr);
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+	LoopbackQueued += BdCount;
+
+	/* BDs committed before the start are fetched when the channel starts */
+	if (!LoopbackStarted && LoopbackQueued >= LoopbackDepth) {
+		Status = XAxiDma_BdRingStart(TxRingPtr);
+		if (Status != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		LoopbackStarted = 1;
+	}
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Accounts the latency of the buffers played out and hands them back to the
+ * capture ring.
+ *
+ * @param	TxRingPtr is a pointer to TX channel of the DMA engine.
+ * @param	BdPtr is the first completed MM2S BD.
+ * @param	BdCount is the number of completed MM2S BDs.
+ *
+ * @return	None.
+ *
+ * @note		Called in interrupt context.
+ *
+ ******************************************************************************/
+static void LoopbackTxDone(XAxiDma_BdRing * TxRingPtr, XAxiDma_Bd * BdPtr,
+		int BdCount) {
+	XAxiDma_BdRing *RxRingPtr = XAxiDma_GetRxRing(&AxiDma);
+	XAxiDma_Bd *BdCurPtr;
+	u32 Now = getTimestamp();
+	u32 BufferAddr;
+	u32 LatencyUs;
+	int Index;
+
+	BdCurPtr = BdPtr;
+	for (Index = 0; Index < BdCount; Index++) {
+		BufferAddr = (u32) XAxiDma_BdGetId(BdCurPtr);
+		LatencyUs = timestampToUs(Now
+				- LoopbackCaptureTime[(BufferAddr - RxBufferBase) / RxPktLen]);
+
+		LoopbackStats.LastLatencyUs = LatencyUs;
+		if (LatencyUs < LoopbackStats.MinLatencyUs) {
+			LoopbackStats.MinLatencyUs = LatencyUs;
+		}
+		if (LatencyUs > LoopbackStats.MaxLatencyUs) {
+			LoopbackStats.MaxLatencyUs = LatencyUs;
+		}
+		LoopbackLatencySumUs += LatencyUs;
+		LoopbackStats.nBuffersLooped++;
+
+		BdCurPtr = XAxiDma_BdRingNext(TxRingPtr, BdCurPtr);
+	}
+
+	if (XAxiDma_BdRingFree(TxRingPtr, BdCount, BdPtr) != XST_SUCCESS) {
+		Error = 1;
+		return;
+	}
+
+	LoopbackQueued -= BdCount;
+	if (LoopbackQueued == 0) {
+		LoopbackStats.nUnderruns++;
+	}
+
+	/* Buffers are played out in capture order, i.e. in Rx ring order */
+	if (RxRearm(RxRingPtr, BdCount) != XST_SUCCESS) {
+		RxStats.nErrors++;
+		Error = 1;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Starts the ADC-to-DAC loopback through DDR, replacing the cyclic
+ * transmission and the continuous capture.
+ *
+ * Captured buffers are played out by the MM2S channel straight from the Rx
+ * buffer region, without copy. Playout starts after "Depth" buffers have been
+ * captured, so the delay line holds Depth buffers (of the Rx BD length of the
+ * current LTE mode) and the samples stay in DDR for about Depth buffer
+ * durations. Since the ADC and the DAC run at the same rate, this delay is
+ * kept while the loopback runs.
+ *
+ * Both DMA channels must be enabled in the design (ROE_CPRI_SRC ==
+ * ROE_SRC_DMA and ROE_CPRI_SINK == ROE_SINK_DMA).
+ *
+ * @param	Depth is the number of buffers held in the delay line.
+ *
+ * @return	- XST_SUCCESS if the loopback was started.
+ *		- XST_INVALID_PARAM if the depth does not fit the Rx ring, or if
+ *		an Rx buffer does not fit a single Tx BD.
+ *		- XST_FAILURE otherwise.
+ *
+ ******************************************************************************/
+int startDmaLoopback(u32 Depth) {
+#if ROE_CPRI_SRC == ROE_SRC_DMA && ROE_CPRI_SINK == ROE_SINK_DMA
+	const LteProfile *Profile = getLteProfile(DmaLteMode);
+	int Status;
+
+	if (Depth == 0 || Depth + LOOPBACK_MIN_FREE_BDS > nRxBds) {
+		xil_printf("Invalid loopback depth %d (1 to %d buffers)\r\n", Depth,
+				nRxBds - LOOPBACK_MIN_FREE_BDS);
+		return XST_INVALID_PARAM;
+	}
+
+	/* Each captured buffer is played out by a single BD */
+	if (RxPktLen > XAxiDma_GetTxRing(&AxiDma)->MaxTransferLen) {
+		xil_printf("Tx BD length %d exceeds the maximum of %d bytes\r\n",
+				RxPktLen, XAxiDma_GetTxRing(&AxiDma)->MaxTransferLen);
+		return XST_INVALID_PARAM;
+	}
+
+	/* Stop the current transmission and capture */
+	if (DmaReset() != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	if (XAxiDma_SelectCyclicMode(&AxiDma, XAXIDMA_DMA_TO_DEVICE,
+			FALSE) != XST_SUCCESS) {
+		xil_printf("Problem leaving the cyclic mode\r\n");
+		return XST_FAILURE;
+	}
+
+	/* The state must be ready before the Rx channel starts */
+	LoopbackDepth = Depth;
+	LoopbackStarted = 0;
+	LoopbackQueued = 0;
+	LoopbackNextTxAddr = RxBufferBase;
+	LoopbackLatencySumUs = 0;
+
+	LoopbackStats.Depth = Depth;
+	// Words per buffer over the rate of DMA words (one per AxC per sample)
+	LoopbackStats.BufferUs = ((RxPktLen / 4) * 1000)
+			/ ((Profile->SamplingFreq / 1000) * DMA_N_AXC);
+	LoopbackStats.NominalLatencyUs = Depth * LoopbackStats.BufferUs;
+	LoopbackStats.nBuffersLooped = 0;
+	LoopbackStats.nUnderruns = 0;
+	LoopbackStats.nOverruns = 0;
+	LoopbackStats.MinLatencyUs = 0xFFFFFFFF;
+	LoopbackStats.MaxLatencyUs = 0;
+	LoopbackStats.MeanLatencyUs = 0;
+	LoopbackStats.LastLatencyUs = 0;
+
+	LoopbackEnabled = 1;
+
+	Status = DmaChannelsSetup();
+	if (Status != XST_SUCCESS) {
+		LoopbackEnabled = 0;
+		return XST_FAILURE;
+	}
+
+	xil_printf("DMA loopback: %d buffers of %d us\r\n", Depth,
+			LoopbackStats.BufferUs);
+
+	return XST_SUCCESS;
+#else
+	xil_printf("DMA loopback requires both DMA channels\r\n");
+	return XST_FAILURE;
+#endif
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Stops the loopback and restores the continuous capture. Restart the
+ * transmission with "startCyclicDmaRead()".
+ *
+ * @return	- XST_SUCCESS if the channels were reconfigured.
+ *		- XST_FAILURE otherwise.
+ *
+ ******************************************************************************/
+int stopDmaLoopback(void) {
+
+	if (DmaReset() != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	return DmaChannelsSetup();
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Copies the loopback statistics.
+ *
+ * @param	Stats is the destination of the statistics.
+ *
+ * @return	None.
+ *
+ * @note		None.
+ *
+ ******************************************************************************/
+void getDmaLoopbackStats(DmaLoopbackStats *Stats) {
+	*Stats = LoopbackStats;
+
+	if (Stats->nBuffersLooped != 0) {
+		Stats->MeanLatencyUs = (u32) (LoopbackLatencySumUs
+				/ Stats->nBuffersLooped);
+	} else {
+		Stats->MinLatencyUs = 0;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Prints the loopback statistics.
+ *
+ ******************************************************************************/
+void printDmaLoopbackStats(void) {
+	DmaLoopbackStats Stats;
+
+	getDmaLoopbackStats(&Stats);
+
+	xil_printf("Loopback: %d x %d us buffers (nominal %d us)\r\n",
+			Stats.Depth, Stats.BufferUs, Stats.NominalLatencyUs);
+	xil_printf("  latency (us): last %d, min %d, mean %d, max %d\r\n",
+			Stats.LastLatencyUs, Stats.MinLatencyUs, Stats.MeanLatencyUs,
+			Stats.MaxLatencyUs);
+	xil_printf("  buffers %d, underruns %d, overruns %d\r\n",
+			Stats.nBuffersLooped, Stats.nUnderruns, Stats.nOverruns);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Prints the DMA statistics: interrupt coalescing of the channels, continuous
+ * capture and cache flushes of the Tx buffers.
+ *
+ ******************************************************************************/
+void printDmaStats(void) {
+	DmaBufferStats FlushStats;
+#if ROE_CPRI_SINK == ROE_SINK_DMA
+	RxCaptureStats CaptureStats;
+#endif
+
+#ifndef TRANSMIT_IN_CYCLIC_MODE
+	DmaCoalesce_print("Tx", &TxCoalesce);
+#endif
+
+#if ROE_CPRI_SINK == ROE_SINK_DMA
+	DmaCoalesce_print("Rx", &RxCoalesce);
+
+	getRxCaptureStats(&CaptureStats);
+	xil_printf("Rx capture: %d BDs, %d bytes\r\n", CaptureStats.nBdsCompleted,
+			CaptureStats.nBytesReceived);
+	xil_printf("  ring starved %d, reader overruns %d, errors %d\r\n",
+			CaptureStats.nRingStarved, CaptureStats.nReaderOverruns,
+			CaptureStats.nErrors);
+#endif
+
+	DmaBuffer_getStats(&FlushStats);
+	xil_printf("Tx buffer flushes: %d (%d skipped), %d bytes, %d bytes/s\r\n",
+			FlushStats.nFlushes, FlushStats.nSkippedFlushes,
+			FlushStats.nBytesFlushed, FlushStats.BytesPerSec);
+}
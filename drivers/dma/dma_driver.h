@@ -9,10 +9,59 @@
 #define DMA_DRIVER_H_
 
 #include "xaxidma.h"
+#include "dma_coalesce.h"
+
+/*
+ * Number of antenna-carriers (AxC) the ad9361_data core commutates the DMA
+ * stream through (its "n_axc" generic). Word k of the stream feeds AxC
+ * (k % DMA_N_AXC).
+ */
+#define DMA_N_AXC	2
+
+/*
+ * Statistics of the continuous S2MM capture
+ */
+typedef struct {
+	u32 nBdsCompleted;	/* Rx BDs completed and re-armed */
+	u32 nBytesReceived;	/* Bytes written by the S2MM channel */
+	u32 nRingStarved;	/* The whole Rx ring was consumed before re-arming */
+	u32 nReaderOverruns;	/* Buffers overwritten before being read */
+	u32 nErrors;		/* BD or channel errors */
+} RxCaptureStats;
+
+/*
+ * Statistics of the ADC-to-DAC loopback through DDR. Latencies are measured
+ * from the completion of the S2MM BD that captured a buffer to the completion
+ * of the MM2S BD that played it out, so they exclude the constant latency of
+ * the converter datapaths (FIFOs, FIR filters and the AD9361 itself).
+ */
+typedef struct {
+	u32 Depth;		/* Buffers held in DDR before playout */
+	u32 BufferUs;		/* Duration of the samples in one buffer */
+	u32 NominalLatencyUs;	/* Depth * BufferUs */
+	u32 nBuffersLooped;	/* Buffers played out */
+	u32 nUnderruns;		/* Playout queue drained (DAC path starved) */
+	u32 nOverruns;		/* No capture buffer armed (ADC samples lost) */
+	u32 MinLatencyUs;
+	u32 MaxLatencyUs;
+	u32 MeanLatencyUs;
+	u32 LastLatencyUs;
+} DmaLoopbackStats;
 
 int initAXIDma(void);
 int loadRndCriDataIntoMemory(XAxiDma *);
 int transmitRndCpriData(void);
 int startCyclicDmaRead(void);
+int setDmaLteMode(int LteMode);
+int loadTxAxcWaveforms(const u32 * const *AxcWaveforms, int nAxc,
+		u32 nSamples);
+int readRxCaptureBuffer(u32 *BufferAddr, u32 *Length);
+void getRxCaptureStats(RxCaptureStats *Stats);
+void getDmaCoalesceState(int Direction, DmaCoalesceState *State);
+int startDmaLoopback(u32 Depth);
+int stopDmaLoopback(void);
+void getDmaLoopbackStats(DmaLoopbackStats *Stats);
+void printDmaLoopbackStats(void);
+void printDmaStats(void);
 
 #endif /* DMA_DRIVER_H_ */
@@ -0,0 +1,116 @@
+/*
+ * dsp_trig.c
+ *
+ * Sine and cosine tables shared by the DSP modules (FFT twiddles, NCO).
+ *
+ * Tables are computed with integer arithmetic only, so they are bit-exact on
+ * the MicroBlaze and on the host builds. Each entry is folded into the first
+ * octant, where the Taylor series of sin and cos converge fast, and unfolded
+ * by symmetry.
+ */
+
+/***************************** Include Files *********************************/
+
+#include "dsp_trig.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * 2 * pi in Q30
+ */
+#define TWO_PI_Q30				6746518852LL
+#define ONE_Q30					(1LL << 30)
+
+/*****************************************************************************/
+/*
+ *
+ * sin and cos of x (Q30 radians, 0 <= x <= pi/4) by their Taylor series,
+ * whose truncation error is far below the Q15 resolution in this range.
+ *
+ ******************************************************************************/
+static void sinCosQ30(int64_t x, int64_t *Sin, int64_t *Cos) {
+	int64_t x2 = (x * x) >> 30;
+	int64_t TermS = x;
+	int64_t TermC = ONE_Q30;
+	int64_t i;
+
+	*Sin = TermS;
+	*Cos = TermC;
+	for (i = 1; i <= 6; i++) {
+		TermS = -((TermS * x2) >> 30) / ((2 * i) * (2 * i + 1));
+		TermC = -((TermC * x2) >> 30) / ((2 * i - 1) * (2 * i));
+		*Sin += TermS;
+		*Cos += TermC;
+	}
+}
+
+static int16_t q30ToQ15(int64_t v) {
+	v = (v + (1 << 14)) >> 15;
+	if (v > 32767) {
+		v = 32767;
+	}
+	if (v < -32767) {
+		v = -32767;
+	}
+	return (int16_t) v;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Fills Cos[k] = cos(2 * pi * k / N) and Sin[k] = sin(2 * pi * k / N), in
+ * Q15 (saturated to +-32767), for 0 <= k < Count. Count may exceed N (e.g.
+ * N + 1 for a guard entry). Either table may be null.
+ *
+ * N must be a multiple of 8. Returns 0 on success, -1 otherwise.
+ *
+ ******************************************************************************/
+int DspTrig_table(int16_t *Cos, int16_t *Sin, uint32_t N, uint32_t Count) {
+	const uint32_t m = N / 8;
+	uint32_t k, q, r;
+	int64_t s, c, s0, c0;
+
+	if (N == 0 || (N % 8) != 0) {
+		return -1;
+	}
+
+	for (k = 0; k < Count; k++) {
+		q = k % N;
+		r = q % (2 * m);
+
+		/* First quadrant, from the first octant */
+		if (r <= m) {
+			sinCosQ30(TWO_PI_Q30 * r / N, &s0, &c0);
+		} else {
+			sinCosQ30(TWO_PI_Q30 * (2 * m - r) / N, &c0, &s0);
+		}
+
+		switch (q / (2 * m)) {
+		case 0:
+			c = c0;
+			s = s0;
+			break;
+		case 1:
+			c = -s0;
+			s = c0;
+			break;
+		case 2:
+			c = -c0;
+			s = -s0;
+			break;
+		default:
+			c = s0;
+			s = -c0;
+			break;
+		}
+
+		if (Cos) {
+			Cos[k] = q30ToQ15(c);
+		}
+		if (Sin) {
+			Sin[k] = q30ToQ15(s);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,13 @@
+/*
+ * dsp_trig.h
+ */
+
+#ifndef DSP_TRIG_H_
+#define DSP_TRIG_H_
+
+#include <stdint.h>
+
+/************************** Function Prototypes *****************************/
+int DspTrig_table(int16_t *Cos, int16_t *Sin, uint32_t N, uint32_t Count);
+
+#endif /* DSP_TRIG_H_ */
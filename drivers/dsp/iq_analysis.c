@@ -0,0 +1,786 @@
+/*
+ * iq_analysis.c
+ *
+ * Health metrics of captured IQ buffers: in-band power, adjacent channel
+ * leakage ratio (ACLR) and EVM of an LTE-like OFDM carrier.
+ *
+ * The module only depends on the C library types, so the very same source
+ * runs on the MicroBlaze (on ADC captures) and on the host ("tools/iq_analyze",
+ * on recorded captures), which is how the firmware results are validated.
+ *
+ * Spectrum: Welch average of Hann-windowed, non-overlapping blocks, each
+ * transformed by a fixed-point radix-2 FFT. Samples stay 16 bit and every
+ * stage is scaled only when its input could overflow (block floating point),
+ * so the common exponent of each block is returned with the result. Twiddles
+ * are computed once, with integer arithmetic only (hence bit-exact on any
+ * target), for the largest FFT and shared by all sizes by striding.
+ *
+ * The adjacent channels of LTE lie mostly outside the sampled span (e.g. the
+ * 5 MHz channel sampled at 7.68 MHz sees only 1.34 MHz of each neighbour). The
+ * ACLR is thus measured over the part of each adjacent channel within the
+ * span, assuming a flat leakage density over the whole channel, and the
+ * fraction of the channel actually observed is reported with it.
+ *
+ * EVM: blind, without a reference waveform, assuming QPSK subcarriers (as
+ * generated by "tools/wavegen"):
+ *  1. The slot boundary is found from the cyclic prefix correlation: a coarse
+ *     search locates one cyclic prefix, then every slot phase around it is
+ *     scored by the correlation of the 7 prefixes of a slot.
+ *  2. Every OFDM symbol is demodulated by the FFT, a few samples inside its
+ *     cyclic prefix. The channel of each subcarrier is estimated blindly from
+ *     the fourth power of its samples (which removes the QPSK modulation) and
+ *     from their mean power.
+ *  3. Subcarriers are equalized, the common phase error of each symbol is
+ *     removed and the error to the nearest QPSK point is accumulated.
+ * The per-bin arithmetic of this step is done in single precision float, since
+ * it amounts to a small fraction of the work of the FFTs.
+ */
+
+/***************************** Include Files *********************************/
+
+#include <string.h>
+#include "iq_analysis.h"
+#include "dsp_trig.h"
+#include "lte_modes.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Overflow bounds of one radix-2 butterfly: an output component is at most
+ * (1 + sqrt(2)) times the largest input component.
+ */
+#define BFLY_MAX_NO_SHIFT		13573
+#define BFLY_MAX_ONE_SHIFT		27146
+
+/*
+ * 100 * 10 * log10(2) in Q16 scaled by 100000
+ */
+#define CENTI_DB_PER_LOG2_Q16	30103
+
+#define SLOT_SYMBOLS			7
+#define SQRT1_2					0.70710678f
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * OFDM symbol positions found in a capture
+ */
+typedef struct {
+	int32_t SlotStart;
+	uint32_t SymOffset[SLOT_SYMBOLS];	/* CP start of each symbol in the slot */
+	uint32_t SlotLen;
+	uint32_t Backoff;	/* FFT window advance into the cyclic prefix */
+} OfdmTiming;
+
+/************************** Variable Definitions *****************************/
+
+static const IqAnalysisConfig LteConfigs[N_LTE_MODES] = {
+	[LTE5] = { 7680000, 4500000, 5000000, 1024, 512, 300, 40, 36 },
+	[LTE20] = { 30720000, 18000000, 20000000, 1024, 2048, 1200, 160, 144 },
+};
+
+/*
+ * cos and sin of 2 * pi * k / IQ_MAX_FFT, for 0 <= k <= IQ_MAX_FFT / 2 (Q15)
+ */
+static int16_t CosTable[IQ_MAX_FFT / 2 + 1];
+static int16_t SinTable[IQ_MAX_FFT / 2 + 1];
+static int TablesReady;
+
+static int16_t WorkRe[IQ_MAX_FFT];
+static int16_t WorkIm[IQ_MAX_FFT];
+
+/*
+ * Averaged power spectrum of the last analysis and its full-scale reference
+ */
+static uint64_t PowerAcc[IQ_MAX_FFT];
+static uint32_t PowerFftSize;
+static uint64_t PowerFullScale;
+
+/*
+ * Per-subcarrier EVM state (interleaved re/im)
+ */
+static float ChanAcc[2 * IQ_MAX_SUBCARRIERS];
+static float ChanPower[IQ_MAX_SUBCARRIERS];
+static float SymEq[2 * IQ_MAX_SUBCARRIERS];
+
+/*****************************************************************************/
+/*
+ *
+ * Fills the twiddle tables (see dsp_trig.c).
+ *
+ ******************************************************************************/
+static void initTables(void) {
+	DspTrig_table(CosTable, SinTable, IQ_MAX_FFT, IQ_MAX_FFT / 2 + 1);
+	TablesReady = 1;
+}
+
+static uint32_t absMax16(int32_t a, int32_t b) {
+	a = (a < 0) ? -a : a;
+	b = (b < 0) ? -b : b;
+	return (uint32_t) ((a > b) ? a : b);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * In-place forward FFT of 2^Log2N complex 16-bit samples, in block floating
+ * point: a stage is scaled by 1/2 or 1/4 only when the largest component of
+ * its input could make a butterfly overflow.
+ *
+ * @return	The number of right shifts applied, i.e. the true transform is
+ *		the output times 2^(returned value). -1 for an invalid size.
+ *
+ ******************************************************************************/
+int IqAnalysis_fft(int16_t *Re, int16_t *Im, uint32_t Log2N) {
+	uint32_t N = 1u << Log2N;
+	uint32_t i, j, k, Len, Half, Stride;
+	uint32_t MaxAbs = 0, NewMax;
+	int Shift, Exponent = 0;
+	int16_t t;
+
+	if (Log2N == 0 || Log2N > IQ_MAX_FFT_LOG2) {
+		return -1;
+	}
+	if (!TablesReady) {
+		initTables();
+	}
+
+	/* Bit-reversal permutation */
+	for (i = 1, j = 0; i < N; i++) {
+		uint32_t Bit = N >> 1;
+
+		for (; j & Bit; Bit >>= 1) {
+			j ^= Bit;
+		}
+		j ^= Bit;
+		if (i < j) {
+			t = Re[i]; Re[i] = Re[j]; Re[j] = t;
+			t = Im[i]; Im[i] = Im[j]; Im[j] = t;
+		}
+	}
+
+	for (i = 0; i < N; i++) {
+		NewMax = absMax16(Re[i], Im[i]);
+		if (NewMax > MaxAbs) {
+			MaxAbs = NewMax;
+		}
+	}
+
+	for (Len = 2; Len <= N; Len <<= 1) {
+		Half = Len >> 1;
+		Stride = IQ_MAX_FFT / Len;
+		Shift = (MaxAbs < BFLY_MAX_NO_SHIFT) ? 0 :
+				(MaxAbs < BFLY_MAX_ONE_SHIFT) ? 1 : 2;
+		Exponent += Shift;
+		NewMax = 0;
+
+		for (k = 0; k < Half; k++) {
+			int32_t Wr = CosTable[k * Stride];
+			int32_t Wi = -SinTable[k * Stride];
+
+			for (i = k; i < N; i += Len) {
+				int32_t Ar, Ai, Tr, Ti, Round;
+				uint32_t m;
+
+				j = i + Half;
+				Tr = (Wr * Re[j] - Wi * Im[j] + (1 << 14)) >> 15;
+				Ti = (Wr * Im[j] + Wi * Re[j] + (1 << 14)) >> 15;
+				Ar = Re[i];
+				Ai = Im[i];
+				if (Shift) {
+					Round = 1 << (Shift - 1);
+					Tr = (Tr + Round) >> Shift;
+					Ti = (Ti + Round) >> Shift;
+					Ar = (Ar + Round) >> Shift;
+					Ai = (Ai + Round) >> Shift;
+				}
+				Re[i] = (int16_t) (Ar + Tr);
+				Im[i] = (int16_t) (Ai + Ti);
+				Re[j] = (int16_t) (Ar - Tr);
+				Im[j] = (int16_t) (Ai - Ti);
+
+				m = absMax16(Re[i], Im[i]);
+				NewMax = (m > NewMax) ? m : NewMax;
+				m = absMax16(Re[j], Im[j]);
+				NewMax = (m > NewMax) ? m : NewMax;
+			}
+		}
+		MaxAbs = NewMax;
+	}
+
+	return Exponent;
+}
+
+static uint32_t log2Of(uint32_t n) {
+	uint32_t l = 0;
+
+	while ((1u << l) < n) {
+		l++;
+	}
+	return ((1u << l) == n) ? l : 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * 100 * 10 * log10(v), for v > 0, from the binary logarithm in Q16 (integer
+ * arithmetic only).
+ *
+ ******************************************************************************/
+static int32_t centiDb(uint64_t v) {
+	int32_t IntPart = 63;
+	int32_t Log2Q16;
+	uint64_t x;
+	int i;
+
+	if (v == 0) {
+		return -100000;
+	}
+	while (!(v >> IntPart)) {
+		IntPart--;
+	}
+
+	/* Mantissa in [1, 2), Q30 */
+	x = (IntPart >= 30) ? (v >> (IntPart - 30)) : (v << (30 - IntPart));
+	Log2Q16 = IntPart << 16;
+	for (i = 15; i >= 0; i--) {
+		x = (x * x) >> 30;
+		if (x >= (2ULL << 30)) {
+			x >>= 1;
+			Log2Q16 |= 1 << i;
+		}
+	}
+
+	return (int32_t) (((int64_t) Log2Q16 * CENTI_DB_PER_LOG2_Q16)
+			/ (65536LL * 100));
+}
+
+static float sqrtApprox(float v) {
+	union {
+		float f;
+		uint32_t u;
+	} x;
+	int i;
+
+	if (v <= 0.0f) {
+		return 0.0f;
+	}
+	x.f = v;
+	x.u = (x.u >> 1) + 0x1FC00000;
+	for (i = 0; i < 4; i++) {
+		x.f = 0.5f * (x.f + v / x.f);
+	}
+	return x.f;
+}
+
+/*
+ * Principal square root of a + jb
+ */
+static void complexSqrt(float a, float b, float *r, float *i) {
+	float Max = (((a < 0.0f) ? -a : a) > ((b < 0.0f) ? -b : b)) ?
+			((a < 0.0f) ? -a : a) : ((b < 0.0f) ? -b : b);
+	float Mag;
+
+	/* Scaled magnitude: the fourth powers would overflow when squared */
+	if (Max == 0.0f) {
+		*r = 0.0f;
+		*i = 0.0f;
+		return;
+	}
+	Mag = Max * sqrtApprox((a / Max) * (a / Max) + (b / Max) * (b / Max));
+
+	*r = sqrtApprox(0.5f * (Mag + a));
+	*i = sqrtApprox(0.5f * (Mag - a));
+	if (b < 0.0f) {
+		*i = -*i;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Returns the analysis parameters of an LTE mode (see lte_modes.h), or 0 for
+ * an invalid mode.
+ *
+ ******************************************************************************/
+const IqAnalysisConfig *IqAnalysis_lteConfig(int LteMode) {
+	if (LteMode < 0 || LteMode >= N_LTE_MODES) {
+		return 0;
+	}
+	return &LteConfigs[LteMode];
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Welch power spectrum of the capture into PowerAcc, and the band powers.
+ *
+ ******************************************************************************/
+static int analyzeSpectrum(const IqAnalysisConfig *Config, const int16_t *Iq,
+		uint32_t nSamples, uint32_t Stride, IqAnalysisResult *Result) {
+	uint32_t N = Config->SpectrumFftSize;
+	uint32_t Log2N = log2Of(N);
+	uint32_t WinStride = IQ_MAX_FFT / N;
+	uint32_t nBlocks = nSamples / N;
+	uint64_t InBand = 0, Lower = 0, Upper = 0;
+	uint32_t nIn = 0, nLower = 0, nUpper = 0, nAdjFull;
+	uint64_t SumW2 = 0;
+	uint32_t b, n;
+	int Exponent;
+
+	if (Log2N == 0 || Log2N > IQ_MAX_FFT_LOG2 || nBlocks == 0) {
+		return -1;
+	}
+
+	memset(PowerAcc, 0, N * sizeof(PowerAcc[0]));
+
+	for (b = 0; b < nBlocks; b++) {
+		const int16_t *x = Iq + (uint64_t) b * N * Stride;
+
+		for (n = 0; n < N; n++) {
+			uint32_t c = (n <= N / 2) ? n : N - n;
+			int32_t w = (32767 - CosTable[c * WinStride]) >> 1;
+
+			WorkRe[n] = (int16_t) ((x[n * Stride] * w + (1 << 14)) >> 15);
+			WorkIm[n] = (int16_t) ((x[n * Stride + 1] * w + (1 << 14)) >> 15);
+			if (b == 0) {
+				SumW2 += (uint64_t) (w * w);
+			}
+		}
+
+		Exponent = IqAnalysis_fft(WorkRe, WorkIm, Log2N);
+		for (n = 0; n < N; n++) {
+			uint32_t p = (uint32_t) (WorkRe[n] * WorkRe[n])
+					+ (uint32_t) (WorkIm[n] * WorkIm[n]);
+
+			PowerAcc[n] += (uint64_t) p << (2 * Exponent);
+		}
+	}
+
+	/*
+	 * Parseval: a full-scale complex tone (|x| = 2^15) sums to
+	 * N * 2^30 * sum((w / 2^15)^2) over the bins of one block.
+	 */
+	PowerFftSize = N;
+	PowerFullScale = (uint64_t) nBlocks * N * SumW2;
+
+	for (n = 0; n < N; n++) {
+		int64_t Bin = (n < N / 2) ? (int64_t) n : (int64_t) n - N;
+		int64_t Freq = Bin * Config->SampleRate / N;
+		int64_t HalfBw = Config->MeasBw / 2;
+
+		if (Freq >= -HalfBw && Freq <= HalfBw) {
+			InBand += PowerAcc[n];
+			nIn++;
+		}
+		if (Freq >= (int64_t) Config->ChannelSpacing - HalfBw
+				&& Freq <= (int64_t) Config->ChannelSpacing + HalfBw) {
+			Upper += PowerAcc[n];
+			nUpper++;
+		}
+		if (Freq >= -(int64_t) Config->ChannelSpacing - HalfBw
+				&& Freq <= -(int64_t) Config->ChannelSpacing + HalfBw) {
+			Lower += PowerAcc[n];
+			nLower++;
+		}
+	}
+
+	nAdjFull = nIn;
+	Result->nBlocks = nBlocks;
+	Result->InBandDbfs = centiDb(InBand) - centiDb(PowerFullScale);
+
+	/* Adjacent power scaled from the observed bins to the whole channel */
+	Result->AclrLowerCoverage = nLower * 100 / nAdjFull;
+	Result->AclrUpperCoverage = nUpper * 100 / nAdjFull;
+	Result->AclrLowerDb = (nLower == 0) ? 0 :
+			centiDb(InBand) - (centiDb(Lower) + centiDb(nAdjFull)
+					- centiDb(nLower));
+	Result->AclrUpperDb = (nUpper == 0) ? 0 :
+			centiDb(InBand) - (centiDb(Upper) + centiDb(nAdjFull)
+					- centiDb(nUpper));
+
+	return 0;
+}
+
+/*
+ * Cyclic prefix timing metric of the window [d, d + Len): the magnitude of the
+ * correlation with the samples N later, less half the mean energy of both
+ * windows (maximum likelihood metric for an SNR of 0 dB). The energy term
+ * rejects windows that merely correlate well because the signal is strong
+ * there. The magnitude is approximated by max + 3/8 min.
+ */
+static int64_t cpTimingMetric(int64_t Cr, int64_t Ci, int64_t Energy) {
+	int64_t a = (Cr < 0) ? -Cr : Cr;
+	int64_t b = (Ci < 0) ? -Ci : Ci;
+	int64_t Mag = (a > b) ? a + ((3 * b) >> 3) : b + ((3 * a) >> 3);
+
+	return Mag - (Energy >> 2);
+}
+
+/*
+ * Correlation and energy terms of sample k (see cpTimingMetric())
+ */
+static void cpTerms(const int16_t *Iq, uint32_t Stride, uint32_t k, uint32_t N,
+		int64_t *Cr, int64_t *Ci, int64_t *Energy) {
+	int32_t ar = Iq[k * Stride], ai = Iq[k * Stride + 1];
+	int32_t br = Iq[(k + N) * Stride], bi = Iq[(k + N) * Stride + 1];
+
+	*Cr = (int64_t) ar * br + (int64_t) ai * bi;
+	*Ci = (int64_t) ai * br - (int64_t) ar * bi;
+	*Energy = (int64_t) ar * ar + (int64_t) ai * ai + (int64_t) br * br
+			+ (int64_t) bi * bi;
+}
+
+static int64_t cpMetric(const int16_t *Iq, uint32_t Stride, uint32_t d,
+		uint32_t N, uint32_t Len) {
+	int64_t Cr = 0, Ci = 0, Energy = 0, r, i, e;
+	uint32_t k;
+
+	for (k = d; k < d + Len; k++) {
+		cpTerms(Iq, Stride, k, N, &r, &i, &e);
+		Cr += r;
+		Ci += i;
+		Energy += e;
+	}
+	return cpTimingMetric(Cr, Ci, Energy);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Finds the first slot boundary of the capture (see the file header).
+ *
+ ******************************************************************************/
+static int findOfdmTiming(const IqAnalysisConfig *Config, const int16_t *Iq,
+		uint32_t nSamples, uint32_t Stride, OfdmTiming *Timing) {
+	uint32_t N = Config->OfdmFftSize;
+	uint32_t L = Config->CpOther;
+	uint32_t Delta = Config->CpFirst - Config->CpOther;
+	uint32_t SymMax = N + Config->CpFirst;
+	int64_t Cr = 0, Ci = 0, Energy = 0, r, i, e;
+	int64_t Best = 0, Metric, BestScore = 0;
+	uint32_t d, k, s, Sym, Coarse = 0;
+	int32_t Delay;
+
+	Timing->SymOffset[0] = 0;
+	for (Sym = 1; Sym < SLOT_SYMBOLS; Sym++) {
+		Timing->SymOffset[Sym] = Config->CpFirst + N
+				+ (Sym - 1) * (Config->CpOther + N);
+	}
+	Timing->SlotLen = Timing->SymOffset[SLOT_SYMBOLS - 1] + Config->CpOther
+			+ N;
+	Timing->Backoff = Config->CpOther / 2;
+
+	if (nSamples < SymMax + L + N) {
+		return -1;
+	}
+
+	/* Coarse: one cyclic prefix within the first symbol, by running sums */
+	for (k = 0; k < L; k++) {
+		cpTerms(Iq, Stride, k, N, &r, &i, &e);
+		Cr += r;
+		Ci += i;
+		Energy += e;
+	}
+	for (d = 0; d < SymMax; d++) {
+		Metric = cpTimingMetric(Cr, Ci, Energy);
+		if (d == 0 || Metric > Best) {
+			Best = Metric;
+			Coarse = d;
+		}
+
+		/* Slide: add sample d + L, drop sample d */
+		cpTerms(Iq, Stride, d + L, N, &r, &i, &e);
+		Cr += r;
+		Ci += i;
+		Energy += e;
+		cpTerms(Iq, Stride, d, N, &r, &i, &e);
+		Cr -= r;
+		Ci -= i;
+		Energy -= e;
+	}
+
+	/*
+	 * Fine: score every slot phase placing one of the 7 prefixes around the
+	 * coarse one (the longer first prefix widens the correlation plateau).
+	 * Each window spans a whole prefix: only the longer first one tells the
+	 * slot phases apart, since shifting the slot by one symbol still lands
+	 * the other windows on prefixes.
+	 */
+	Timing->SlotStart = -1;
+	for (Sym = 0; Sym < SLOT_SYMBOLS; Sym++) {
+		for (Delay = -(int32_t) Delta - 2; Delay <= 2; Delay++) {
+			int64_t Start = (int64_t) Coarse + Delay - Timing->SymOffset[Sym];
+			int64_t Score = 0;
+			int32_t nWindows = 0;
+			int64_t Base;
+
+			while (Start < 0) {
+				Start += Timing->SlotLen;
+			}
+			Start %= Timing->SlotLen;
+
+			for (Base = Start; ; Base += Timing->SlotLen) {
+				for (s = 0; s < SLOT_SYMBOLS; s++) {
+					uint32_t w = (uint32_t) Base + Timing->SymOffset[s];
+					uint32_t Len = (s == 0) ? Config->CpFirst : L;
+
+					if (w + Len + N > nSamples) {
+						break;
+					}
+					Score += cpMetric(Iq, Stride, w, N, Len);
+					nWindows++;
+				}
+				if (s < SLOT_SYMBOLS) {
+					break;
+				}
+			}
+
+			if (nWindows != 0 && (Timing->SlotStart < 0
+					|| Score / nWindows > BestScore)) {
+				BestScore = Score / nWindows;
+				Timing->SlotStart = (int32_t) Start;
+			}
+		}
+	}
+
+	return (Timing->SlotStart < 0) ? -1 : 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Demodulates the OFDM symbol whose FFT window starts at "Pos", returning the
+ * FFT exponent. Subcarrier k is then found at bin (k + N) % N.
+ *
+ ******************************************************************************/
+static int demodSymbol(const IqAnalysisConfig *Config, const int16_t *Iq,
+		uint32_t Stride, uint32_t Pos) {
+	uint32_t N = Config->OfdmFftSize;
+	uint32_t n;
+
+	for (n = 0; n < N; n++) {
+		WorkRe[n] = Iq[(Pos + n) * Stride];
+		WorkIm[n] = Iq[(Pos + n) * Stride + 1];
+	}
+	return IqAnalysis_fft(WorkRe, WorkIm, log2Of(N));
+}
+
+/*
+ * Bin of the occupied subcarrier of index Sc (0 .. nSubcarriers - 1)
+ */
+static uint32_t subcarrierBin(const IqAnalysisConfig *Config, uint32_t Sc) {
+	int32_t Half = Config->nSubcarriers / 2;
+	int32_t k = (Sc < (uint32_t) Half) ? (int32_t) Sc - Half : (int32_t) Sc
+			- Half + 1;
+
+	return (uint32_t) (k + (int32_t) Config->OfdmFftSize)
+			% Config->OfdmFftSize;
+}
+
+/*
+ * FFT window start of the i-th symbol counted from the slot before
+ * "SlotStart" (negative before the capture). Returns 0 once past the end of
+ * the capture, 1 otherwise.
+ */
+static int symbolWindow(const IqAnalysisConfig *Config,
+		const OfdmTiming *Timing, uint32_t nSamples, uint32_t i,
+		int64_t *WindowPos) {
+	int64_t Slot = (int64_t) Timing->SlotStart - Timing->SlotLen
+			+ (int64_t) (i / SLOT_SYMBOLS) * Timing->SlotLen;
+	uint32_t Sym = i % SLOT_SYMBOLS;
+	uint32_t Cp = (Sym == 0) ? Config->CpFirst : Config->CpOther;
+	int64_t Pos = Slot + Timing->SymOffset[Sym] + Cp - Timing->Backoff;
+
+	if (Pos + Config->OfdmFftSize > nSamples) {
+		return 0;
+	}
+	*WindowPos = Pos;
+	return 1;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Blind QPSK EVM of the OFDM symbols of the capture.
+ *
+ ******************************************************************************/
+static void analyzeEvm(const IqAnalysisConfig *Config, const int16_t *Iq,
+		uint32_t nSamples, uint32_t Stride, IqAnalysisResult *Result) {
+	uint32_t nSc = Config->nSubcarriers;
+	OfdmTiming Timing;
+	float ErrPower = 0.0f;
+	uint32_t nSymbols = 0, nPoints = 0;
+	uint32_t i, Sc;
+	int64_t Pos;
+
+	Result->EvmPct = 0;
+	Result->EvmDb = 0;
+	Result->nSymbols = 0;
+	Result->SlotStart = 0;
+
+	if (nSc == 0 || nSc > IQ_MAX_SUBCARRIERS
+			|| log2Of(Config->OfdmFftSize) == 0
+			|| findOfdmTiming(Config, Iq, nSamples, Stride, &Timing) != 0) {
+		return;
+	}
+	Result->SlotStart = Timing.SlotStart;
+
+	/* Pass 1: fourth power and power of each subcarrier */
+	memset(ChanAcc, 0, 2 * nSc * sizeof(float));
+	memset(ChanPower, 0, nSc * sizeof(float));
+	for (i = 0; symbolWindow(Config, &Timing, nSamples, i, &Pos); i++) {
+		float Scale;
+
+		if (Pos < 0) {
+			continue;
+		}
+		Scale = (float) (1u << demodSymbol(Config, Iq, Stride, (uint32_t) Pos));
+		for (Sc = 0; Sc < nSc; Sc++) {
+			uint32_t Bin = subcarrierBin(Config, Sc);
+			float yr = WorkRe[Bin] * Scale, yi = WorkIm[Bin] * Scale;
+			float y2r = yr * yr - yi * yi, y2i = 2.0f * yr * yi;
+
+			ChanAcc[2 * Sc] += y2r * y2r - y2i * y2i;
+			ChanAcc[2 * Sc + 1] += 2.0f * y2r * y2i;
+			ChanPower[Sc] += yr * yr + yi * yi;
+		}
+		nSymbols++;
+	}
+	if (nSymbols == 0) {
+		return;
+	}
+
+	/*
+	 * QPSK points to the fourth power are all -1, so the channel is a fourth
+	 * root of -ChanAcc (the pi/2 ambiguity does not change the EVM). Store the
+	 * equalizer conj(h) / |h|^2 in place.
+	 */
+	for (Sc = 0; Sc < nSc; Sc++) {
+		float r, im, Mag, Amp;
+
+		complexSqrt(-ChanAcc[2 * Sc], -ChanAcc[2 * Sc + 1], &r, &im);
+		complexSqrt(r, im, &r, &im);
+		Mag = sqrtApprox(r * r + im * im);
+		Amp = sqrtApprox(ChanPower[Sc] / nSymbols);
+		if (Mag == 0.0f || Amp == 0.0f) {
+			ChanAcc[2 * Sc] = 0.0f;
+			ChanAcc[2 * Sc + 1] = 0.0f;
+			continue;
+		}
+		ChanAcc[2 * Sc] = r / (Mag * Amp);
+		ChanAcc[2 * Sc + 1] = -im / (Mag * Amp);
+	}
+
+	/* Pass 2: equalize, remove the common phase error, accumulate errors */
+	for (i = 0; symbolWindow(Config, &Timing, nSamples, i, &Pos); i++) {
+		float Scale, CpeR = 0.0f, CpeI = 0.0f, CpeMag;
+
+		if (Pos < 0) {
+			continue;
+		}
+		Scale = (float) (1u << demodSymbol(Config, Iq, Stride, (uint32_t) Pos));
+		for (Sc = 0; Sc < nSc; Sc++) {
+			uint32_t Bin = subcarrierBin(Config, Sc);
+			float yr = WorkRe[Bin] * Scale, yi = WorkIm[Bin] * Scale;
+			float gr = ChanAcc[2 * Sc], gi = ChanAcc[2 * Sc + 1];
+			float qr = yr * gr - yi * gi, qi = yr * gi + yi * gr;
+			float dr = (qr >= 0.0f) ? SQRT1_2 : -SQRT1_2;
+			float di = (qi >= 0.0f) ? SQRT1_2 : -SQRT1_2;
+
+			SymEq[2 * Sc] = qr;
+			SymEq[2 * Sc + 1] = qi;
+			CpeR += qr * dr + qi * di;
+			CpeI += qi * dr - qr * di;
+		}
+
+		CpeMag = sqrtApprox(CpeR * CpeR + CpeI * CpeI);
+		if (CpeMag == 0.0f) {
+			continue;
+		}
+		CpeR /= CpeMag;
+		CpeI /= CpeMag;
+
+		for (Sc = 0; Sc < nSc; Sc++) {
+			float qr = SymEq[2 * Sc] * CpeR + SymEq[2 * Sc + 1] * CpeI;
+			float qi = SymEq[2 * Sc + 1] * CpeR - SymEq[2 * Sc] * CpeI;
+			float er = qr - ((qr >= 0.0f) ? SQRT1_2 : -SQRT1_2);
+			float ei = qi - ((qi >= 0.0f) ? SQRT1_2 : -SQRT1_2);
+
+			ErrPower += er * er + ei * ei;
+			nPoints++;
+		}
+	}
+
+	if (nPoints == 0) {
+		return;
+	}
+
+	/* Reference points have unit power */
+	ErrPower /= nPoints;
+	Result->nSymbols = nSymbols;
+	Result->EvmPct = (uint32_t) (sqrtApprox(ErrPower) * 10000.0f + 0.5f);
+	Result->EvmDb = centiDb((uint64_t) (ErrPower * (float) (1ULL << 40)))
+			- centiDb(1ULL << 40);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Analyzes a capture of complex 16-bit samples: sample n has I at
+ * Iq[n * Stride] and Q at Iq[n * Stride + 1] (Stride is 2 for a single
+ * channel, 4 for the first of two interleaved channels).
+ *
+ * @param	Config holds the carrier parameters (see IqAnalysis_lteConfig()).
+ * @param	Iq points to the capture.
+ * @param	nSamples is the number of complex samples in the capture.
+ * @param	Stride is the distance between samples, in 16-bit words.
+ * @param	Result returns the metrics.
+ *
+ * @return	0 on success, -1 if the capture is too short for one spectrum
+ *		block or the configuration is invalid. EVM is reported only when
+ *		at least one OFDM symbol was found (Result->nSymbols != 0).
+ *
+ ******************************************************************************/
+int IqAnalysis_run(const IqAnalysisConfig *Config, const int16_t *Iq,
+		uint32_t nSamples, uint32_t Stride, IqAnalysisResult *Result) {
+
+	if (Config == 0 || Stride < 2) {
+		return -1;
+	}
+	if (!TablesReady) {
+		initTables();
+	}
+
+	if (analyzeSpectrum(Config, Iq, nSamples, Stride, Result) != 0) {
+		return -1;
+	}
+	analyzeEvm(Config, Iq, nSamples, Stride, Result);
+
+	return 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Returns the averaged spectrum of the last analysis in hundredths of dBFS per
+ * bin, from the lowest to the highest frequency (DC at the center).
+ *
+ * @return	The number of bins written.
+ *
+ ******************************************************************************/
+uint32_t IqAnalysis_spectrumDb(int32_t *CentiDb, uint32_t MaxBins) {
+	uint32_t N = PowerFftSize;
+	uint32_t n;
+	int32_t FullScale = centiDb(PowerFullScale);
+
+	if (N > MaxBins) {
+		N = MaxBins & ~1u;
+	}
+	for (n = 0; n < N; n++) {
+		uint32_t Bin = (n + PowerFftSize / 2) % PowerFftSize;
+
+		CentiDb[n] = centiDb(PowerAcc[Bin]) - FullScale;
+	}
+	return N;
+}
@@ -0,0 +1,64 @@
+/*
+ * iq_analysis.h
+ */
+
+#ifndef IQ_ANALYSIS_H_
+#define IQ_ANALYSIS_H_
+
+#include <stdint.h>
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Largest FFT supported (spectrum and OFDM demodulation). The twiddle table is
+ * computed once for this size and shared by all smaller power-of-two sizes.
+ */
+#define IQ_MAX_FFT_LOG2			11
+#define IQ_MAX_FFT				(1 << IQ_MAX_FFT_LOG2)
+
+/*
+ * Largest number of occupied OFDM subcarriers (LTE 20 MHz)
+ */
+#define IQ_MAX_SUBCARRIERS		1200
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * Parameters of the analysis of one carrier
+ */
+typedef struct {
+	uint32_t SampleRate;		/* Hz */
+	uint32_t MeasBw;			/* Measurement bandwidth of a channel (Hz) */
+	uint32_t ChannelSpacing;	/* Offset of the adjacent channels (Hz) */
+	uint32_t SpectrumFftSize;	/* Welch FFT size (power of two) */
+	uint32_t OfdmFftSize;		/* OFDM FFT size (power of two) */
+	uint32_t nSubcarriers;		/* Occupied subcarriers, DC excluded */
+	uint32_t CpFirst;			/* Cyclic prefix of the first symbol of a slot */
+	uint32_t CpOther;			/* Cyclic prefix of the other symbols */
+} IqAnalysisConfig;
+
+/*
+ * Results. Powers and ratios are in hundredths of dB.
+ */
+typedef struct {
+	int32_t InBandDbfs;		/* Power in the measurement bandwidth */
+	int32_t AclrLowerDb;	/* In-band over lower adjacent channel power */
+	int32_t AclrUpperDb;	/* In-band over upper adjacent channel power */
+	uint32_t AclrLowerCoverage;	/* % of the adjacent channel in the span */
+	uint32_t AclrUpperCoverage;
+	uint32_t nBlocks;		/* FFT blocks averaged in the spectrum */
+
+	uint32_t EvmPct;		/* EVM in hundredths of percent */
+	int32_t EvmDb;
+	uint32_t nSymbols;		/* OFDM symbols demodulated (0: no EVM) */
+	uint32_t SlotStart;		/* First slot boundary found in the capture */
+} IqAnalysisResult;
+
+/************************** Function Prototypes *****************************/
+const IqAnalysisConfig *IqAnalysis_lteConfig(int LteMode);
+int IqAnalysis_run(const IqAnalysisConfig *Config, const int16_t *Iq,
+		uint32_t nSamples, uint32_t Stride, IqAnalysisResult *Result);
+uint32_t IqAnalysis_spectrumDb(int32_t *CentiDb, uint32_t MaxBins);
+int IqAnalysis_fft(int16_t *Re, int16_t *Im, uint32_t Log2N);
+
+#endif /* IQ_ANALYSIS_H_ */
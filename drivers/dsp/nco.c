@@ -0,0 +1,196 @@
+/*
+ * nco.c
+ *
+ * Fixed-point NCO synthesizer of multi-tone and chirp IQ waveforms, for
+ * cyclic transmit buffers (e.g. the DAC DMA buffer, see dac_load_nco() in
+ * dac_core.c). Like the other DSP modules, it only depends on the C library,
+ * so the host build ("tools/nco_synth") produces the same samples.
+ *
+ * Each tone has a 64-bit phase accumulator. Its sine and cosine are read from
+ * a Q15 table with linear interpolation, which keeps the spurs below the
+ * 16-bit quantization (the table itself comes from dsp_trig.c).
+ *
+ * The buffer is played cyclically, so a tone is only clean if its phase after
+ * the last sample of the buffer matches the initial phase. NcoSynth_init()
+ * enforces that: the start frequency of each tone (or chirp) is nudged, by at
+ * most half a cycle per buffer, so that the phase advance over the buffer is
+ * a whole number of cycles. Chirps restart from their start frequency at the
+ * end of the buffer with a continuous phase.
+ */
+
+/***************************** Include Files *********************************/
+
+#include "nco.h"
+#include "dsp_trig.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Table lookup: top bits of the phase index the table, the next ones
+ * interpolate between entries
+ */
+#define NCO_FRAC_BITS			15
+#define NCO_INDEX_SHIFT			(64 - NCO_TABLE_LOG2)
+#define NCO_FRAC_SHIFT			(NCO_INDEX_SHIFT - NCO_FRAC_BITS)
+#define NCO_QUARTER				(NCO_TABLE_LEN / 4)
+
+/************************** Variable Definitions *****************************/
+
+/*
+ * sin over one cycle and a quarter (cos(x) = sin(x + pi / 2)), plus a guard
+ * entry for the interpolation
+ */
+static int16_t SinTable[NCO_TABLE_LEN + NCO_QUARTER + 1];
+static int TableReady;
+
+/*****************************************************************************/
+/*
+ *
+ * Num / Den as a Q0.64 fraction of a cycle, for |Num| < Den < 2^32.
+ *
+ ******************************************************************************/
+static uint64_t fractionQ64(int64_t Num, uint64_t Den) {
+	uint64_t a = (uint64_t) ((Num < 0) ? -Num : Num);
+	uint64_t Hi = (a << 32) / Den;
+	uint64_t Lo = (((a << 32) % Den) << 32) / Den;
+	uint64_t Frac = (Hi << 32) | Lo;
+
+	return (Num < 0) ? (uint64_t) 0 - Frac : Frac;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Sets up the generation of a cyclic buffer of Length samples. The frequency
+ * of each tone is adjusted so that the buffer loops seamlessly (see above);
+ * NcoSynth_actualHz() returns the frequency actually generated.
+ *
+ * Returns 0 on success, -1 for an invalid plan.
+ *
+ ******************************************************************************/
+int NcoSynth_init(NcoState *State, const NcoPlan *Plan, uint32_t Length) {
+	int32_t Nyquist = (int32_t) (Plan->SampleRate / 2);
+	uint64_t Advance;
+	uint32_t t;
+
+	if (Length == 0 || Plan->SampleRate == 0 || Plan->nTones > NCO_MAX_TONES) {
+		return -1;
+	}
+
+	if (!TableReady) {
+		DspTrig_table(0, SinTable, NCO_TABLE_LEN,
+				NCO_TABLE_LEN + NCO_QUARTER + 1);
+		TableReady = 1;
+	}
+
+	State->nTones = Plan->nTones;
+	State->Length = Length;
+	State->Index = 0;
+
+	for (t = 0; t < Plan->nTones; t++) {
+		const NcoTone *Tone = &Plan->Tone[t];
+
+		if (Tone->StartHz < -Nyquist || Tone->StartHz > Nyquist
+				|| Tone->StopHz < -Nyquist || Tone->StopHz > Nyquist) {
+			return -1;
+		}
+
+		/* Sweep rate: half the span over twice the rate fits Q0.64 */
+		State->StartFreq[t] = fractionQ64(Tone->StartHz, Plan->SampleRate);
+		State->Sweep[t] = ((int64_t) fractionQ64(
+				(int64_t) Tone->StopHz - Tone->StartHz,
+				2 * (uint64_t) Plan->SampleRate) / (int64_t) Length) * 2;
+
+		/*
+		 * Phase advance over the buffer (modulo one cycle):
+		 * Length * Start + Sweep * Length * (Length - 1) / 2. Spread its
+		 * offset to the nearest whole number of cycles over the samples.
+		 */
+		Advance = (uint64_t) Length * State->StartFreq[t]
+				+ (uint64_t) State->Sweep[t]
+						* ((uint64_t) Length * (Length - 1) / 2);
+		State->StartFreq[t] -= (uint64_t) ((int64_t) Advance
+				/ (int64_t) Length);
+
+		State->Freq[t] = State->StartFreq[t];
+		State->Phase[t] = (uint64_t) Tone->Phase << 32;
+		State->Amplitude[t] = Tone->Amplitude;
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Start frequency actually generated for a tone, in Hz (rounded).
+ *
+ ******************************************************************************/
+int32_t NcoSynth_actualHz(const NcoState *State, uint32_t SampleRate,
+		uint32_t Tone) {
+	int64_t Q32 = (int64_t) State->StartFreq[Tone] >> 32;
+
+	return (int32_t) ((Q32 * (int64_t) SampleRate + (1LL << 31)) >> 32);
+}
+
+static int16_t saturate16(int32_t v) {
+	if (v > 32767) {
+		return 32767;
+	}
+	if (v < -32768) {
+		return -32768;
+	}
+	return (int16_t) v;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Generates the next nSamples of the buffer, continuing from the previous
+ * call. Each sample is written as one DAC word (I in the 16 MSBs, Q in the
+ * 16 LSBs) to nCopies consecutive words, one per DAC channel, so Words must
+ * hold nSamples * nCopies words. Tones are summed and saturated.
+ *
+ ******************************************************************************/
+void NcoSynth_generate(NcoState *State, uint32_t *Words, uint32_t nSamples,
+		uint32_t nCopies) {
+	uint32_t n, t, c;
+
+	for (n = 0; n < nSamples; n++) {
+		int32_t I = 0, Q = 0;
+		uint32_t Word;
+
+		for (t = 0; t < State->nTones; t++) {
+			uint64_t Phase = State->Phase[t];
+			uint32_t Index = (uint32_t) (Phase >> NCO_INDEX_SHIFT);
+			int32_t Frac = (int32_t) (Phase >> NCO_FRAC_SHIFT)
+					& ((1 << NCO_FRAC_BITS) - 1);
+			const int16_t *s = &SinTable[Index];
+			const int16_t *co = &SinTable[Index + NCO_QUARTER];
+			int32_t Sin = s[0] + (((s[1] - s[0]) * Frac
+					+ (1 << (NCO_FRAC_BITS - 1))) >> NCO_FRAC_BITS);
+			int32_t Cos = co[0] + (((co[1] - co[0]) * Frac
+					+ (1 << (NCO_FRAC_BITS - 1))) >> NCO_FRAC_BITS);
+
+			I += (State->Amplitude[t] * Cos + (1 << 14)) >> 15;
+			Q += (State->Amplitude[t] * Sin + (1 << 14)) >> 15;
+
+			State->Phase[t] = Phase + State->Freq[t];
+			State->Freq[t] += (uint64_t) State->Sweep[t];
+		}
+
+		/* End of the buffer: chirps start over */
+		if (++State->Index == State->Length) {
+			State->Index = 0;
+			for (t = 0; t < State->nTones; t++) {
+				State->Freq[t] = State->StartFreq[t];
+			}
+		}
+
+		Word = ((uint32_t) (uint16_t) saturate16(I) << 16)
+				| (uint16_t) saturate16(Q);
+		for (c = 0; c < nCopies; c++) {
+			*Words++ = Word;
+		}
+	}
+}
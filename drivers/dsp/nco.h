@@ -0,0 +1,62 @@
+/*
+ * nco.h
+ */
+
+#ifndef NCO_H_
+#define NCO_H_
+
+#include <stdint.h>
+
+/************************** Constant Definitions *****************************/
+
+#define NCO_MAX_TONES			8
+
+/*
+ * Sine table: 2^NCO_TABLE_LOG2 points per cycle, linearly interpolated
+ */
+#define NCO_TABLE_LOG2			12
+#define NCO_TABLE_LEN			(1 << NCO_TABLE_LOG2)
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * Complex tone, or linear chirp when StopHz differs from StartHz. The
+ * frequency sweeps from StartHz to StopHz over the buffer length and starts
+ * again, with a continuous phase.
+ */
+typedef struct {
+	int32_t StartHz;		/* -SampleRate / 2 .. SampleRate / 2 */
+	int32_t StopHz;
+	uint16_t Amplitude;		/* Peak amplitude, Q15 full scale */
+	uint32_t Phase;			/* Initial phase, 2^32 per cycle */
+} NcoTone;
+
+typedef struct {
+	uint32_t SampleRate;	/* Hz */
+	uint32_t nTones;
+	NcoTone Tone[NCO_MAX_TONES];
+} NcoPlan;
+
+/*
+ * Generator state, kept across NcoSynth_generate() calls. Phases and
+ * frequencies are Q0.64 fractions of a cycle.
+ */
+typedef struct {
+	uint32_t nTones;
+	uint32_t Length;			/* Buffer (sweep) length in samples */
+	uint32_t Index;				/* Next sample within the buffer */
+	uint64_t Phase[NCO_MAX_TONES];
+	uint64_t Freq[NCO_MAX_TONES];	/* Phase increment of the next sample */
+	uint64_t StartFreq[NCO_MAX_TONES];
+	int64_t Sweep[NCO_MAX_TONES];	/* Increment change per sample */
+	int32_t Amplitude[NCO_MAX_TONES];
+} NcoState;
+
+/************************** Function Prototypes *****************************/
+int NcoSynth_init(NcoState *State, const NcoPlan *Plan, uint32_t Length);
+void NcoSynth_generate(NcoState *State, uint32_t *Words, uint32_t nSamples,
+		uint32_t nCopies);
+int32_t NcoSynth_actualHz(const NcoState *State, uint32_t SampleRate,
+		uint32_t Tone);
+
+#endif /* NCO_H_ */
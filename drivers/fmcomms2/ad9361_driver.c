@@ -56,6 +56,23 @@
 #include "adc_core.h"
 #include "dac_core.h"
 #endif
+#include "ddr_regions.h"
+#include "xintc_driver.h"
+#include "timestamp.h"
+#include "iq_analysis.h"
+#include "ad9361_driver.h"
+
+/******************************************************************************/
+/********************** Macros and Constants Definitions **********************/
+/******************************************************************************/
+/*
+ * DDR buffers of the DAC (DATA_SEL_DMA) and of the ADC capture, allocated at
+ * boot from the DDR region allocator. Sizes assume the FMCOMMS5 layout, which
+ * takes 16 bytes per sample.
+ */
+#define DAC_BUFFER_SIZE			0x10000
+#define ADC_CAPTURE_SAMPLES		16384
+#define ADC_CAPTURE_SIZE		(ADC_CAPTURE_SAMPLES * 16)
 
 /******************************************************************************/
 /************************ Variables Definitions *******************************/
@@ -311,12 +328,13 @@ AD9361_InitParam default_init_param = {
 		NULL	//(*ad9361_rfpll_ext_set_rate)()
 		};
 
-#if 1
+/*
+ * FIR configurations of each LTE mode. The sampling frequency and RF bandwidth
+ * come from the mode profile (lte_modes.c).
+ */
 
-#define SAMPLING_FREQ  7680000
-#define RF_BW          4500000
-
-AD9361_TXFIRConfig tx_fir_config = { 3, // tx
+/* LTE 5 MHz: 7.68 MSPS */
+AD9361_TXFIRConfig tx_fir_config_lte5 = { 3, // tx
 		0, // tx gain
 		2, // tx int
 		{ -5, 0, 4, 23, 36, 40, 18, -13, -36, -26, 11, 48, 46, -2, -60, -72,
@@ -334,7 +352,7 @@ AD9361_TXFIRConfig tx_fir_config = { 3, // tx
 		4372840 // tx bandwidth
 		};
 
-AD9361_RXFIRConfig rx_fir_config = { 3, //rx
+AD9361_RXFIRConfig rx_fir_config_lte5 = { 3, //rx
 		-6, // rx_gain
 		2, // rx_dec
 		{ -10, -21, -21, -19, 11, 20, 28, -5, -30, -41, -5, 39, 61, 22, -46,
@@ -351,13 +369,9 @@ AD9361_RXFIRConfig rx_fir_config = { 3, //rx
 		{ 983040000, 122880000, 61440000, 30720000, 15360000, 7680000 }, // rx_path_clks[6]
 		4694670 //rx_bandwidth
 		};
-#endif
-#if 0
 
-#define SAMPLING_FREQ  30720000
-#define RF_BW          18000000
-
-AD9361_TXFIRConfig tx_fir_config = { 3, // tx
+/* LTE 20 MHz: 30.72 MSPS */
+AD9361_TXFIRConfig tx_fir_config_lte20 = { 3, // tx
 		0, // tx gain
 		2, // tx int
 		{ -5, 0, 4, 23, 36, 39, 18, -13, -36, -26, 11, 48, 46, -2, -60, -72,
@@ -375,7 +389,7 @@ AD9361_TXFIRConfig tx_fir_config = { 3, // tx
 		19365438 // tx bandwidth
 		};
 
-AD9361_RXFIRConfig rx_fir_config = { 3, //rx
+AD9361_RXFIRConfig rx_fir_config_lte20 = { 3, //rx
 		-6, // rx_gain
 		2, // rx_dec
 		{ -9, -23, -20, -22, 12, 20, 29, -5, -30, -43, -6, 40, 64, 24, -47, -90,
@@ -392,7 +406,16 @@ AD9361_RXFIRConfig rx_fir_config = { 3, //rx
 		{ 983040000, 491520000, 245760000, 122880000, 61440000, 30720000 }, // rx_path_clks[6]
 		19365514 //rx_bandwidth
 		};
-#endif
+
+static AD9361_TXFIRConfig * const tx_fir_configs[N_LTE_MODES] = {
+	[LTE5] = &tx_fir_config_lte5,
+	[LTE20] = &tx_fir_config_lte20,
+};
+
+static AD9361_RXFIRConfig * const rx_fir_configs[N_LTE_MODES] = {
+	[LTE5] = &rx_fir_config_lte5,
+	[LTE20] = &rx_fir_config_lte20,
+};
 
 struct ad9361_rf_phy *ad9361_phy;
 #ifdef FMCOMMS5
@@ -400,54 +423,45 @@ struct ad9361_rf_phy *ad9361_phy_b;
 #endif
 
 /***************************************************************************//**
- * @brief main
+ * @brief Configures the sampling frequency, the Tx/Rx FIRs and the RF
+ *        bandwidth of the given LTE mode. Can be called again at runtime to
+ *        switch modes.
+ *
+ * @param lte_mode - LTE5 or LTE20.
+ *
+ * @return 0 in case of success, 1 otherwise.
  *******************************************************************************/
-int initAd9361(void) {
+int setAd9361LteMode(int lte_mode) {
 
 	int Status;
-	uint64_t Value;
 	uint8_t en_dis;
+	const LteProfile *profile = getLteProfile(lte_mode);
 
-	/*
-	 * NOTE: The user has to choose the GPIO numbers according to desired
-	 * carrier board. The following configuration is valid for boards other
-	 * than the Fmcomms5.
-	 */
-	default_init_param.gpio_resetb = GPIO_RESET_PIN;
-	default_init_param.gpio_sync = -1;
-	default_init_param.gpio_cal_sw1 = -1;
-	default_init_param.gpio_cal_sw2 = -1;
+	if (profile == 0) {
+		xil_printf("Invalid LTE mode %d\r\n", lte_mode);
+		return 1;
+	}
 
-	/*
-	 * Initialize the GPIO
-	 */
-	gpio_init(GPIO_DEVICE_ID);
-	gpio_direction(default_init_param.gpio_resetb, 1);
+	xil_printf("AD9361 profile: %s\r\n", profile->Name);
 
 	/*
-	 * Initialize the SPI
+	 * The FIRs of the previous mode must not be active while the clock chain
+	 * is reprogrammed
 	 */
-	spi_init(SPI_DEVICE_ID, 1, 0);
-
-	/*
-	 * Initialize AD9361
-	 */
-	Status = ad9361_init(&ad9361_phy, &default_init_param);
+	Status = ad9361_set_trx_fir_en_dis(ad9361_phy, 0);
 	if (Status != 0) {
-		xil_printf("Could not initialize AD9361\r\n");
-		xil_printf("Status\t%d\r\n", Status);
+		xil_printf("Could not disable Tx and Rx FIR\r\n");
 		return 1;
 	}
-
 	/*
 	 * Sampling frequency
 	 */
-	Status = ad9361_set_tx_sampling_freq(ad9361_phy, SAMPLING_FREQ);
+	Status = ad9361_set_tx_sampling_freq(ad9361_phy, profile->SamplingFreq);
 	if (Status != 0) {
 		xil_printf("Could not set Tx sampling freq.\r\n");
 		return 1;
 	}
-	Status = ad9361_set_rx_sampling_freq(ad9361_phy, SAMPLING_FREQ);
+	Status = ad9361_set_rx_sampling_freq(ad9361_phy, profile->SamplingFreq);
 	if (Status != 0) {
 		xil_printf("Could not set Rx sampling freq.\r\n");
 		return 1;
@@ -455,12 +469,12 @@ int initAd9361(void) {
 	/*
 	 * Set Tx and Rx FIR
 	 */
-	Status = ad9361_set_tx_fir_config(ad9361_phy, tx_fir_config);
+	Status = ad9361_set_tx_fir_config(ad9361_phy, *tx_fir_configs[lte_mode]);
 	if (Status != 0) {
 		xil_printf("Could not set Tx FIR\r\n");
 		return 1;
 	}
-	Status = ad9361_set_rx_fir_config(ad9361_phy, rx_fir_config);
+	Status = ad9361_set_rx_fir_config(ad9361_phy, *rx_fir_configs[lte_mode]);
 	if (Status != 0) {
 		xil_printf("Could not set Rx FIR\r\n");
 		return 1;
@@ -489,16 +503,71 @@ int initAd9361(void) {
 	/*
 	 * Rf bandwidth
 	 */
-	Status = ad9361_set_tx_rf_bandwidth(ad9361_phy, RF_BW);
+	Status = ad9361_set_tx_rf_bandwidth(ad9361_phy, profile->RfBandwidth);
 	if (Status != 0) {
 		xil_printf("Could not set Tx Rf bandwidth\r\n");
 		return 1;
 	}
-	Status = ad9361_set_rx_rf_bandwidth(ad9361_phy, RF_BW);
+	Status = ad9361_set_rx_rf_bandwidth(ad9361_phy, profile->RfBandwidth);
 	if (Status != 0) {
 		xil_printf("Could not set Rx Rf bandwidth\r\n");
 		return 1;
 	}
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief main
+ *******************************************************************************/
+int initAd9361(void) {
+
+	int Status;
+	uint64_t Value;
+#if ROE_CPRI_SINK == ROE_SINK_DAC
+	uint32_t dac_buffer;
+#endif
+#if !defined AXI_ADC_NOT_PRESENT && defined XILINX_PLATFORM && defined CAPTURE_SCRIPT
+	uint32_t adc_buffer;
+#endif
+
+	/*
+	 * NOTE: The user has to choose the GPIO numbers according to desired
+	 * carrier board. The following configuration is valid for boards other
+	 * than the Fmcomms5.
+	 */
+	default_init_param.gpio_resetb = GPIO_RESET_PIN;
+	default_init_param.gpio_sync = -1;
+	default_init_param.gpio_cal_sw1 = -1;
+	default_init_param.gpio_cal_sw2 = -1;
+
+	/*
+	 * Initialize the GPIO
+	 */
+	gpio_init(GPIO_DEVICE_ID);
+	gpio_direction(default_init_param.gpio_resetb, 1);
+
+	/*
+	 * Initialize the SPI
+	 */
+	spi_init(SPI_DEVICE_ID, 1, 0);
+
+	/*
+	 * Initialize AD9361
+	 */
+	Status = ad9361_init(&ad9361_phy, &default_init_param);
+	if (Status != 0) {
+		xil_printf("Could not initialize AD9361\r\n");
+		xil_printf("Status\t%d\r\n", Status);
+		return 1;
+	}
+
+	/*
+	 * Sampling frequency, FIR and RF bandwidth of the current LTE mode
+	 */
+	Status = setAd9361LteMode(getLteMode());
+	if (Status != 0) {
+		return 1;
+	}
 	/*
 	 * Gain control mode
 	 */
@@ -526,6 +595,14 @@ int initAd9361(void) {
 	}
 
 #if ROE_CPRI_SINK == ROE_SINK_DAC
+	dac_buffer = ddrAllocRegion("DAC buffer", DAC_BUFFER_SIZE,
+			DDR_CACHE_LINE_LEN);
+	if (dac_buffer == 0) {
+		xil_printf("Could not allocate DAC buffer\r\n");
+		return 1;
+	}
+	dac_set_ddr_baseaddr(dac_buffer);
+	dac_set_ddr_size(DAC_BUFFER_SIZE);
 	dac_init(ad9361_phy, DATA_SEL_DMA, 1);
 #endif
 
@@ -535,9 +612,16 @@ int initAd9361(void) {
 	// cache after each adc_capture() call, keeping in mind that the
 	// size of the capture and the start address must be alinged to the size
 	// of the cache line.
+	adc_buffer = ddrAllocRegion("ADC capture", ADC_CAPTURE_SIZE,
+			DDR_CACHE_LINE_LEN);
+	if (adc_buffer == 0) {
+		xil_printf("Could not allocate ADC capture buffer\r\n");
+		return 1;
+	}
 	mdelay(1000);
-	adc_capture(16384, ADC_DDR_BASEADDR);
-	Xil_DCacheInvalidateRange(ADC_DDR_BASEADDR, 16384);
+	adc_capture(ADC_CAPTURE_SAMPLES, adc_buffer);
+	Xil_DCacheInvalidateRange(adc_buffer, ADC_CAPTURE_SIZE);
+	reportAdcCaptureHealth(adc_buffer, ADC_CAPTURE_SAMPLES);
 #endif
 #endif
 
@@ -578,3 +662,103 @@ int initAd9361(void) {
 
 	return 0;
 }
+
+/***************************************************************************//**
+ * @brief Starts back-to-back ADC captures into two ping-pong DDR buffers,
+ *        without blocking the CPU (see adc_capture_async_start()). Completed
+ *        captures are read with adc_capture_async_get() and handed back with
+ *        adc_capture_async_release().
+ *
+ * @return 0 in case of success, 1 otherwise.
+ *******************************************************************************/
+int startAdcCaptureAsync(void) {
+#if !defined AXI_ADC_NOT_PRESENT && defined CF_AD9361_RX_DMA_INTR_ID
+	static uint32_t capture_buffers[ADC_CAPTURE_BUFFERS];
+	uint8_t i;
+
+	// Buffers are allocated once and kept across restarts
+	for (i = 0; i < ADC_CAPTURE_BUFFERS; i++) {
+		if (capture_buffers[i] != 0) {
+			continue;
+		}
+		capture_buffers[i] = ddrAllocRegion("ADC async capture",
+				ADC_CAPTURE_SIZE, DDR_CACHE_LINE_LEN);
+		if (capture_buffers[i] == 0) {
+			xil_printf("Could not allocate ADC capture buffers\r\n");
+			return 1;
+		}
+	}
+
+	if (SetUpInterruptSystem(CF_AD9361_RX_DMA_INTR_ID,
+			(XInterruptHandler) adc_capture_async_isr, NULL) != XST_SUCCESS) {
+		xil_printf("Could not set up the ADC DMA interrupt\r\n");
+		return 1;
+	}
+
+	if (adc_capture_async_start(ADC_CAPTURE_SAMPLES, capture_buffers[0],
+			capture_buffers[1]) != 0) {
+		xil_printf("Could not start the ADC capture\r\n");
+		return 1;
+	}
+
+	return 0;
+#else
+	xil_printf("No ADC DMA interrupt in the design\r\n");
+	return 1;
+#endif
+}
+
+/*
+ * Prints a value in hundredths as a signed decimal
+ */
+static void print_centi(const char *label, int32_t value, const char *unit)
+{
+	xil_printf("%s%s%d.%02d%s\r\n", label, (value < 0) ? "-" : "",
+			((value < 0) ? -value : value) / 100,
+			((value < 0) ? -value : value) % 100, unit);
+}
+
+/***************************************************************************//**
+ * @brief Analyzes the first channel of an ADC capture as a carrier of the
+ *        current LTE mode and prints its in-band power, ACLR and EVM (see
+ *        iq_analysis.h). The data cache must be invalidated beforehand.
+ *        "tools/iq_analyze" runs the same analysis on a saved capture.
+ *
+ * @param address - DDR address of the capture.
+ * @param samples - Number of samples per channel.
+ *
+ * @return 0 in case of success, 1 otherwise.
+ *******************************************************************************/
+int reportAdcCaptureHealth(uint32_t address, uint32_t samples)
+{
+	const IqAnalysisConfig *config = IqAnalysis_lteConfig(getLteMode());
+	IqAnalysisResult result;
+	uint32_t stride, start;
+
+	// Interleaved 16-bit I and Q of each enabled channel
+#ifdef FMCOMMS5
+	stride = 8;
+#else
+	stride = ad9361_phy->pdata->rx2tx2 ? 4 : 2;
+#endif
+
+	start = getTimestamp();
+	if (config == 0 || IqAnalysis_run(config, (const int16_t *) address,
+			samples, stride, &result) != 0) {
+		xil_printf("ADC capture too short for the analysis\r\n");
+		return 1;
+	}
+
+	xil_printf("ADC capture health (%d samples, %d us):\r\n", samples,
+			timestampToUs(getTimestamp() - start));
+	print_centi("  In-band power: ", result.InBandDbfs, " dBFS");
+	print_centi("  ACLR lower: ", result.AclrLowerDb, " dB");
+	print_centi("  ACLR upper: ", result.AclrUpperDb, " dB");
+	if (result.nSymbols) {
+		print_centi("  EVM: ", (int32_t) result.EvmPct, " %");
+	} else {
+		xil_printf("  EVM: no OFDM symbol found\r\n");
+	}
+
+	return 0;
+}
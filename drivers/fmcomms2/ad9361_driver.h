@@ -8,6 +8,11 @@
 #ifndef AD9361_DRIVER_H_
 #define AD9361_DRIVER_H_
 
+#include <stdint.h>
+
 int initAd9361(void);
+int setAd9361LteMode(int lte_mode);
+int startAdcCaptureAsync(void);
+int reportAdcCaptureHealth(uint32_t address, uint32_t samples);
 
 #endif /* AD9361_DRIVER_H_ */
@@ -47,16 +47,45 @@
 #include "adc_core.h"
 #include "parameters.h"
 #include "util.h"
+#include "ddr_regions.h"
 
 /******************************************************************************/
 /********************** Macros and Constants Definitions **********************/
 /******************************************************************************/
 //#define FMCOMMS5
 
+/* States of an asynchronous capture buffer */
+#define ADC_BUF_FREE			0
+#define ADC_BUF_QUEUED			1	/* Transfer submitted to the DMAC */
+#define ADC_BUF_FULL			2	/* Transfer done, not yet read */
+#define ADC_BUF_READ			3	/* Handed to the application */
+
+/******************************************************************************/
+/*************************** Types Declarations *******************************/
+/******************************************************************************/
+struct adc_capture_buffer
+{
+	uint32_t address;
+	uint32_t transfer_id;
+	uint32_t seq;		/* Submission order */
+	volatile uint8_t state;
+};
+
+struct adc_async_state
+{
+	struct adc_capture_buffer buf[ADC_CAPTURE_BUFFERS];
+	uint32_t length;
+	uint32_t submitted;
+	volatile uint32_t captures;
+	volatile uint32_t stalls;
+	volatile bool running;
+};
+
 /******************************************************************************/
 /************************ Variables Definitions *******************************/
 /******************************************************************************/
 struct adc_state adc_st;
+static struct adc_async_state adc_async;
 
 /***************************************************************************//**
  * @brief adc_read
@@ -99,7 +128,11 @@ void adc_write(struct ad9361_rf_phy *phy, uint32_t regAddr, uint32_t data)
 *******************************************************************************/
 void adc_dma_read(uint32_t regAddr, uint32_t *data)
 {
-	//*data = Xil_In32(CF_AD9361_RX_DMA_BASEADDR + regAddr);
+#ifdef CF_AD9361_RX_DMA_BASEADDR
+	*data = Xil_In32(CF_AD9361_RX_DMA_BASEADDR + regAddr);
+#else
+	*data = 0;
+#endif
 }
 
 /***************************************************************************//**
@@ -107,7 +140,9 @@ void adc_dma_read(uint32_t regAddr, uint32_t *data)
 *******************************************************************************/
 void adc_dma_write(uint32_t regAddr, uint32_t data)
 {
-	//Xil_Out32(CF_AD9361_RX_DMA_BASEADDR + regAddr, data);
+#ifdef CF_AD9361_RX_DMA_BASEADDR
+	Xil_Out32(CF_AD9361_RX_DMA_BASEADDR + regAddr, data);
+#endif
 }
 
 /***************************************************************************//**
@@ -138,12 +173,12 @@ void adc_init(struct ad9361_rf_phy *phy)
 }
 
 /***************************************************************************//**
- * @brief adc_capture
+ * @brief adc_capture_length
+ *
+ * Returns the length in bytes of a capture of "size" samples per channel.
 *******************************************************************************/
-int32_t adc_capture(uint32_t size, uint32_t start_address)
+static uint32_t adc_capture_length(uint32_t size)
 {
-	uint32_t reg_val;
-	uint32_t transfer_id;
 	uint32_t length;
 
 	if(adc_st.rx2tx2)
@@ -159,6 +194,20 @@ int32_t adc_capture(uint32_t size, uint32_t start_address)
 	length = (size * 16);
 #endif
 
+	return length;
+}
+
+/***************************************************************************//**
+ * @brief adc_capture
+*******************************************************************************/
+int32_t adc_capture(uint32_t size, uint32_t start_address)
+{
+	uint32_t reg_val;
+	uint32_t transfer_id;
+	uint32_t length;
+
+	length = adc_capture_length(size);
+
 	adc_dma_write(AXI_DMAC_REG_CTRL, 0x0);
 	adc_dma_write(AXI_DMAC_REG_CTRL, AXI_DMAC_CTRL_ENABLE);
 
@@ -195,3 +244,246 @@ int32_t adc_capture(uint32_t size, uint32_t start_address)
 
 	return 0;
 }
+
+/***************************************************************************//**
+ * @brief adc_capture_submit
+ *
+ * Queues the transfer of one asynchronous capture buffer in the DMAC.
+ *
+ * The buffer is invalidated in the data cache first, so that neither a dirty
+ * line is written back over the new samples nor a stale line is read after the
+ * transfer. The DMAC interrupt is masked while the buffer state is updated: the
+ * done bit of a transfer ID is only cleared when a transfer with that ID is
+ * queued, so the ISR must not see the buffer queued before that.
+ *
+ * @return 0 on success, -1 if the DMAC transfer queue is full.
+*******************************************************************************/
+static int32_t adc_capture_submit(struct adc_capture_buffer *buf)
+{
+	uint32_t reg_val;
+
+	adc_dma_read(AXI_DMAC_REG_START_TRANSFER, &reg_val);
+	if(reg_val == 1)
+	{
+		return -1;
+	}
+
+	Xil_DCacheInvalidateRange(buf->address, adc_async.length);
+
+	adc_dma_write(AXI_DMAC_REG_IRQ_MASK, AXI_DMAC_IRQ_SOT | AXI_DMAC_IRQ_EOT);
+
+	adc_dma_read(AXI_DMAC_REG_TRANSFER_ID, &buf->transfer_id);
+	adc_dma_write(AXI_DMAC_REG_DEST_ADDRESS, buf->address);
+	adc_dma_write(AXI_DMAC_REG_DEST_STRIDE, 0x0);
+	adc_dma_write(AXI_DMAC_REG_X_LENGTH, adc_async.length - 1);
+	adc_dma_write(AXI_DMAC_REG_Y_LENGTH, 0x0);
+	adc_dma_write(AXI_DMAC_REG_START_TRANSFER, 0x1);
+
+	buf->seq = adc_async.submitted++;
+	buf->state = ADC_BUF_QUEUED;
+
+	/* Only the end of transfer interrupt is used */
+	adc_dma_write(AXI_DMAC_REG_IRQ_MASK, AXI_DMAC_IRQ_SOT);
+
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief adc_capture_async_start
+ *
+ * Starts back-to-back captures of "size" samples per channel into two
+ * ping-pong buffers, without blocking. Completion is signalled by the DMAC
+ * end of transfer interrupt, handled by adc_capture_async_isr(), which must be
+ * connected to the interrupt controller beforehand.
+ *
+ * Completed buffers are obtained with adc_capture_async_get() and must be
+ * given back with adc_capture_async_release(), which queues them again.
+ * Captures are contiguous as long as each buffer is released within the
+ * duration of one capture; otherwise the DMAC stalls and the gap is counted.
+ *
+ * Both buffers and the capture length must be aligned to the data cache line.
+ *
+ * @return 0 on success, -1 otherwise.
+*******************************************************************************/
+int32_t adc_capture_async_start(uint32_t size, uint32_t buffer_0,
+		uint32_t buffer_1)
+{
+	uint32_t reg_val;
+	uint8_t i;
+
+	adc_async.length = adc_capture_length(size);
+	if((adc_async.length == 0) ||
+	   ((buffer_0 | buffer_1 | adc_async.length) & (DDR_CACHE_LINE_LEN - 1)))
+	{
+		return -1;
+	}
+
+	adc_dma_write(AXI_DMAC_REG_CTRL, 0x0);
+	adc_dma_write(AXI_DMAC_REG_CTRL, AXI_DMAC_CTRL_ENABLE);
+
+	adc_dma_write(AXI_DMAC_REG_IRQ_MASK, AXI_DMAC_IRQ_SOT | AXI_DMAC_IRQ_EOT);
+	adc_dma_read(AXI_DMAC_REG_IRQ_PENDING, &reg_val);
+	adc_dma_write(AXI_DMAC_REG_IRQ_PENDING, reg_val);
+
+	adc_async.buf[0].address = buffer_0;
+	adc_async.buf[1].address = buffer_1;
+	for(i = 0; i < ADC_CAPTURE_BUFFERS; i++)
+	{
+		adc_async.buf[i].state = ADC_BUF_FREE;
+	}
+	adc_async.submitted = 0;
+	adc_async.captures = 0;
+	adc_async.stalls = 0;
+	adc_async.running = true;
+
+	for(i = 0; i < ADC_CAPTURE_BUFFERS; i++)
+	{
+		if(adc_capture_submit(&adc_async.buf[i]) != 0)
+		{
+			adc_capture_async_stop();
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief adc_capture_async_stop
+ *
+ * Aborts the asynchronous captures. Buffers not yet read are discarded.
+*******************************************************************************/
+void adc_capture_async_stop(void)
+{
+	uint8_t i;
+
+	adc_async.running = false;
+
+	adc_dma_write(AXI_DMAC_REG_IRQ_MASK, AXI_DMAC_IRQ_SOT | AXI_DMAC_IRQ_EOT);
+	adc_dma_write(AXI_DMAC_REG_CTRL, 0x0);
+
+	for(i = 0; i < ADC_CAPTURE_BUFFERS; i++)
+	{
+		adc_async.buf[i].state = ADC_BUF_FREE;
+	}
+}
+
+/***************************************************************************//**
+ * @brief adc_capture_async_get
+ *
+ * Returns the oldest completed capture, if any. The buffer belongs to the
+ * application until it is released.
+ *
+ * @return 0 if a buffer was returned, -1 if no capture is completed.
+*******************************************************************************/
+int32_t adc_capture_async_get(uint32_t *address, uint32_t *length)
+{
+	struct adc_capture_buffer *oldest = NULL;
+	uint8_t i;
+
+	for(i = 0; i < ADC_CAPTURE_BUFFERS; i++)
+	{
+		if(adc_async.buf[i].state != ADC_BUF_FULL)
+		{
+			continue;
+		}
+		if((oldest == NULL) ||
+		   ((int32_t)(adc_async.buf[i].seq - oldest->seq) < 0))
+		{
+			oldest = &adc_async.buf[i];
+		}
+	}
+
+	if(oldest == NULL)
+	{
+		return -1;
+	}
+
+	oldest->state = ADC_BUF_READ;
+	*address = oldest->address;
+	*length = adc_async.length;
+
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief adc_capture_async_release
+ *
+ * Gives a buffer returned by adc_capture_async_get() back to the DMAC. It must
+ * not be accessed afterwards.
+ *
+ * @return 0 on success, -1 if the buffer is not held by the application.
+*******************************************************************************/
+int32_t adc_capture_async_release(uint32_t address)
+{
+	uint8_t i;
+
+	for(i = 0; i < ADC_CAPTURE_BUFFERS; i++)
+	{
+		if((adc_async.buf[i].address == address) &&
+		   (adc_async.buf[i].state == ADC_BUF_READ))
+		{
+			adc_async.buf[i].state = ADC_BUF_FREE;
+			if(!adc_async.running)
+			{
+				return 0;
+			}
+			return adc_capture_submit(&adc_async.buf[i]);
+		}
+	}
+
+	return -1;
+}
+
+/***************************************************************************//**
+ * @brief adc_capture_async_isr
+ *
+ * DMAC interrupt handler: marks the buffers whose transfer is done as full.
+*******************************************************************************/
+void adc_capture_async_isr(void *instance)
+{
+	uint32_t pending;
+	uint32_t done;
+	uint8_t queued = 0;
+	uint8_t i;
+
+	adc_dma_read(AXI_DMAC_REG_IRQ_PENDING, &pending);
+	adc_dma_write(AXI_DMAC_REG_IRQ_PENDING, pending);
+	if(!(pending & AXI_DMAC_IRQ_EOT))
+	{
+		return;
+	}
+
+	adc_dma_read(AXI_DMAC_REG_TRANSFER_DONE, &done);
+	for(i = 0; i < ADC_CAPTURE_BUFFERS; i++)
+	{
+		if(adc_async.buf[i].state != ADC_BUF_QUEUED)
+		{
+			continue;
+		}
+		if(done & (1 << adc_async.buf[i].transfer_id))
+		{
+			adc_async.buf[i].state = ADC_BUF_FULL;
+			adc_async.captures++;
+		}
+		else
+		{
+			queued++;
+		}
+	}
+
+	/* The DMAC is idle until the application releases a buffer */
+	if(adc_async.running && (queued == 0))
+	{
+		adc_async.stalls++;
+	}
+}
+
+/***************************************************************************//**
+ * @brief adc_capture_async_stats
+*******************************************************************************/
+void adc_capture_async_stats(struct adc_capture_stats *stats)
+{
+	stats->captures = adc_async.captures;
+	stats->stalls = adc_async.stalls;
+}
@@ -148,11 +148,27 @@ struct adc_state
 	bool rx2tx2;
 };
 
+/* Buffers of the asynchronous capture (ping-pong) */
+#define ADC_CAPTURE_BUFFERS		2
+
+struct adc_capture_stats
+{
+	uint32_t captures;	/* Completed captures */
+	uint32_t stalls;	/* No transfer queued: samples were lost */
+};
+
 /******************************************************************************/
 /************************ Functions Declarations ******************************/
 /******************************************************************************/
 void adc_init(struct ad9361_rf_phy *phy);
 int32_t adc_capture(uint32_t size, uint32_t start_address);
+int32_t adc_capture_async_start(uint32_t size, uint32_t buffer_0,
+		uint32_t buffer_1);
+void adc_capture_async_stop(void);
+int32_t adc_capture_async_get(uint32_t *address, uint32_t *length);
+int32_t adc_capture_async_release(uint32_t address);
+void adc_capture_async_isr(void *instance);
+void adc_capture_async_stats(struct adc_capture_stats *stats);
 void adc_read(struct ad9361_rf_phy *phy, uint32_t regAddr, uint32_t *data);
 void adc_write(struct ad9361_rf_phy *phy, uint32_t regAddr, uint32_t data);
 
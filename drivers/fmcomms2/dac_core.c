@@ -56,6 +56,8 @@
 /************************ Variables Definitions *******************************/
 /******************************************************************************/
 struct dds_state dds_st[2];
+uint32_t dac_ddr_baseaddr = DAC_DDR_BASEADDR;
+uint32_t dac_ddr_size = 0;
 
 /******************************************************************************/
 /********************** Macros and Constants Definitions **********************/
@@ -67,6 +69,28 @@ const uint16_t sine_lut[32] = {
 		0xF00, 0xF05, 0xF13, 0xF2B, 0xF4B, 0xF72, 0xF9E, 0xFCE
 };
 
+/*
+ * Default DDS tones (1 MHz, quadrature, -12 dBFS per tone) as register images
+ * for the TX sample rates of the LTE modes
+ */
+#define DDS_DEFAULT_IMAGE(clk)	{ (clk), {									\
+		DDS_CHANNEL_IMAGE(1000000, 90000, 250000, clk),	/* TX1_I_F1 */		\
+		DDS_CHANNEL_IMAGE(1000000, 90000, 250000, clk),	/* TX1_I_F2 */		\
+		DDS_CHANNEL_IMAGE(1000000, 0, 250000, clk),		/* TX1_Q_F1 */		\
+		DDS_CHANNEL_IMAGE(1000000, 0, 250000, clk),		/* TX1_Q_F2 */		\
+		DDS_CHANNEL_IMAGE(1000000, 90000, 250000, clk),	/* TX2_I_F1 */		\
+		DDS_CHANNEL_IMAGE(1000000, 90000, 250000, clk),	/* TX2_I_F2 */		\
+		DDS_CHANNEL_IMAGE(1000000, 0, 250000, clk),		/* TX2_Q_F1 */		\
+		DDS_CHANNEL_IMAGE(1000000, 0, 250000, clk),		/* TX2_Q_F2 */		\
+	} }
+
+#define DDS_DEFAULT_IMAGES	2
+
+const struct dds_image dds_default_images[DDS_DEFAULT_IMAGES] = {
+	DDS_DEFAULT_IMAGE(7680000),
+	DDS_DEFAULT_IMAGE(30720000),
+};
+
 /***************************************************************************//**
  * @brief dac_read
 *******************************************************************************/
@@ -108,7 +132,11 @@ void dac_write(struct ad9361_rf_phy *phy, uint32_t regAddr, uint32_t data)
 *******************************************************************************/
 void dac_dma_read(uint32_t regAddr, uint32_t *data)
 {
-	//*data = Xil_In32(CF_AD9361_TX_DMA_BASEADDR + regAddr);
+#ifdef CF_AD9361_TX_DMA_BASEADDR
+	*data = Xil_In32(CF_AD9361_TX_DMA_BASEADDR + regAddr);
+#else
+	*data = 0;
+#endif
 }
 
 /***************************************************************************//**
@@ -116,24 +144,9 @@ void dac_dma_read(uint32_t regAddr, uint32_t *data)
 *******************************************************************************/
 void dac_dma_write(uint32_t regAddr, uint32_t data)
 {
-	//Xil_Out32(CF_AD9361_TX_DMA_BASEADDR + regAddr, data);
-}
-
-/***************************************************************************//**
- * @brief dds_default_setup
-*******************************************************************************/
-int32_t dds_default_setup(struct ad9361_rf_phy *phy,
-							 uint32_t chan, uint32_t phase,
-							 uint32_t freq, int32_t scale)
-{
-	dds_set_phase(phy, chan, phase);
-	dds_set_frequency(phy, chan, freq);
-	dds_set_scale(phy, chan, scale);
-	dds_st[phy->id_no].cached_freq[chan] = freq;
-	dds_st[phy->id_no].cached_phase[chan] = phase;
-	dds_st[phy->id_no].cached_scale[chan] = scale;
-
-	return 0;
+#ifdef CF_AD9361_TX_DMA_BASEADDR
+	Xil_Out32(CF_AD9361_TX_DMA_BASEADDR + regAddr, data);
+#endif
 }
 
 /***************************************************************************//**
@@ -162,6 +175,56 @@ void dac_start_sync(struct ad9361_rf_phy *phy, bool force_on)
 	}
 }
 
+/***************************************************************************//**
+ * @brief dac_set_ddr_baseaddr
+*******************************************************************************/
+void dac_set_ddr_baseaddr(uint32_t baseaddr)
+{
+	dac_ddr_baseaddr = baseaddr;
+}
+
+/***************************************************************************//**
+ * @brief dac_set_ddr_size
+ *
+ * Size of the DAC DDR buffer, checked by dac_load_nco() (0: unknown).
+*******************************************************************************/
+void dac_set_ddr_size(uint32_t size)
+{
+	dac_ddr_size = size;
+}
+
+/***************************************************************************//**
+ * @brief dac_words_per_sample
+ *
+ * Returns the number of 32-bit DMA words of each sample (one per DAC channel).
+*******************************************************************************/
+static uint32_t dac_words_per_sample(struct ad9361_rf_phy *phy)
+{
+#ifdef FMCOMMS5
+	return 4;
+#else
+	return dds_st[phy->id_no].rx2tx2 ? 2 : 1;
+#endif
+}
+
+/***************************************************************************//**
+ * @brief dac_dma_start
+ *
+ * Flushes "length" bytes of the DDR buffer and starts their cyclic transfer.
+*******************************************************************************/
+static void dac_dma_start(uint32_t length)
+{
+	/* Only the buffer written above needs to reach the DDR */
+	Xil_DCacheFlushRange(dac_ddr_baseaddr, length);
+	dac_dma_write(AXI_DMAC_REG_CTRL, 0);
+	dac_dma_write(AXI_DMAC_REG_CTRL, AXI_DMAC_CTRL_ENABLE);
+	dac_dma_write(AXI_DMAC_REG_SRC_ADDRESS, dac_ddr_baseaddr);
+	dac_dma_write(AXI_DMAC_REG_SRC_STRIDE, 0x0);
+	dac_dma_write(AXI_DMAC_REG_X_LENGTH, length - 1);
+	dac_dma_write(AXI_DMAC_REG_Y_LENGTH, 0x0);
+	dac_dma_write(AXI_DMAC_REG_START_TRANSFER, 0x1);
+}
+
 /***************************************************************************//**
  * @brief dac_init
 *******************************************************************************/
@@ -180,6 +243,7 @@ void dac_init(struct ad9361_rf_phy *phy, uint8_t data_sel, uint8_t config_dma)
 	uint32_t data_q2;
 	uint32_t length;
 	uint32_t reg_ctrl_2;
+	const struct dds_image *image;
 
 	dac_write(phy, DAC_REG_RSTN, 0x0);
 	dac_write(phy, DAC_REG_RSTN, DAC_RSTN | DAC_MMCM_RSTN);
@@ -206,17 +270,14 @@ void dac_init(struct ad9361_rf_phy *phy, uint8_t data_sel, uint8_t config_dma)
 	dac_stop(phy);
 	switch (data_sel) {
 	case DATA_SEL_DDS:
-		dds_default_setup(phy, DDS_CHAN_TX1_I_F1, 90000, 1000000, 250000);
-		dds_default_setup(phy, DDS_CHAN_TX1_I_F2, 90000, 1000000, 250000);
-		dds_default_setup(phy, DDS_CHAN_TX1_Q_F1, 0, 1000000, 250000);
-		dds_default_setup(phy, DDS_CHAN_TX1_Q_F2, 0, 1000000, 250000);
-		if(dds_st[phy->id_no].rx2tx2)
+		image = &dds_default_images[0];
+		for(index = 0; index < DDS_DEFAULT_IMAGES; index++)
 		{
-			dds_default_setup(phy, DDS_CHAN_TX2_I_F1, 90000, 1000000, 250000);
-			dds_default_setup(phy, DDS_CHAN_TX2_I_F2, 90000, 1000000, 250000);
-			dds_default_setup(phy, DDS_CHAN_TX2_Q_F1, 0, 1000000, 250000);
-			dds_default_setup(phy, DDS_CHAN_TX2_Q_F2, 0, 1000000, 250000);
+			if(dds_default_images[index].dac_clk == *dds_st[phy->id_no].dac_clk)
+				image = &dds_default_images[index];
 		}
+		dds_apply_image(phy, image, dds_st[phy->id_no].rx2tx2 ?
+				DDS_TX1_TX2_CHANNELS : DDS_TX1_CHANNELS);
 		dac_datasel(phy, -1, DATA_SEL_DDS);
 		break;
 	case DATA_SEL_DMA:
@@ -237,7 +298,7 @@ void dac_init(struct ad9361_rf_phy *phy, uint8_t data_sel, uint8_t config_dma)
 						index_q1 -= (tx_count * 2);
 					data_i1 = (sine_lut[index_i1 / 2] << 20);
 					data_q1 = (sine_lut[index_q1 / 2] << 4);
-					Xil_Out32(DAC_DDR_BASEADDR + index_mem * 4, data_i1 | data_q1);
+					Xil_Out32(dac_ddr_baseaddr + index_mem * 4, data_i1 | data_q1);
 
 					index_i2 = index_i1;
 					index_q2 = index_q1;
@@ -247,10 +308,10 @@ void dac_init(struct ad9361_rf_phy *phy, uint8_t data_sel, uint8_t config_dma)
 						index_q2 -= (tx_count * 2);
 					data_i2 = (sine_lut[index_i2 / 2] << 20);
 					data_q2 = (sine_lut[index_q2 / 2] << 4);
-					Xil_Out32(DAC_DDR_BASEADDR + (index_mem + 1) * 4, data_i2 | data_q2);
+					Xil_Out32(dac_ddr_baseaddr + (index_mem + 1) * 4, data_i2 | data_q2);
 #ifdef FMCOMMS5
-					Xil_Out32(DAC_DDR_BASEADDR + (index_mem + 2) * 4, data_i1 | data_q1);
-					Xil_Out32(DAC_DDR_BASEADDR + (index_mem + 3) * 4, data_i2 | data_q2);
+					Xil_Out32(dac_ddr_baseaddr + (index_mem + 2) * 4, data_i1 | data_q1);
+					Xil_Out32(dac_ddr_baseaddr + (index_mem + 3) * 4, data_i2 | data_q2);
 #endif
 				}
 			}
@@ -264,28 +325,11 @@ void dac_init(struct ad9361_rf_phy *phy, uint8_t data_sel, uint8_t config_dma)
 						index_q1 -= tx_count;
 					data_i1 = (sine_lut[index_i1] << 20);
 					data_q1 = (sine_lut[index_q1] << 4);
-					Xil_Out32(DAC_DDR_BASEADDR + index * 4, data_i1 | data_q1);
+					Xil_Out32(dac_ddr_baseaddr + index * 4, data_i1 | data_q1);
 				}
 			}
-			Xil_DCacheFlush();
-			if(dds_st[phy->id_no].rx2tx2)
-			{
-				length = (tx_count * 8);
-			}
-			else
-			{
-				length = (tx_count * 4);
-			}
-#ifdef FMCOMMS5
-			length = (tx_count * 16);
-#endif
-			dac_dma_write(AXI_DMAC_REG_CTRL, 0);
-			dac_dma_write(AXI_DMAC_REG_CTRL, AXI_DMAC_CTRL_ENABLE);
-			dac_dma_write(AXI_DMAC_REG_SRC_ADDRESS, DAC_DDR_BASEADDR);
-			dac_dma_write(AXI_DMAC_REG_SRC_STRIDE, 0x0);
-			dac_dma_write(AXI_DMAC_REG_X_LENGTH, length - 1);
-			dac_dma_write(AXI_DMAC_REG_Y_LENGTH, 0x0);
-			dac_dma_write(AXI_DMAC_REG_START_TRANSFER, 0x1);
+			length = tx_count * dac_words_per_sample(phy) * 4;
+			dac_dma_start(length);
 		}
 		dac_datasel(phy, -1, DATA_SEL_DMA);
 		break;
@@ -297,64 +341,90 @@ void dac_init(struct ad9361_rf_phy *phy, uint8_t data_sel, uint8_t config_dma)
 }
 
 /***************************************************************************//**
- * @brief dds_set_frequency
+ * @brief dac_load_nco
+ *
+ * Synthesizes a cyclic buffer of "samples" samples with the tones and chirps
+ * of "plan" (see nco.h) directly into the DAC DDR buffer, with the same
+ * waveform on every DAC channel, and plays it through DATA_SEL_DMA. Tone
+ * frequencies are adjusted by less than half a cycle per buffer so that the
+ * buffer loops seamlessly.
+ *
+ * Requires the DAC DMA (CF_AD9361_TX_DMA_BASEADDR).
+ *
+ * @return 0 in case of success, negative error code otherwise.
 *******************************************************************************/
-void dds_set_frequency(struct ad9361_rf_phy *phy, uint32_t chan, uint32_t freq)
+int32_t dac_load_nco(struct ad9361_rf_phy *phy, const NcoPlan *plan,
+		uint32_t samples)
 {
-	uint64_t val64;
-	uint32_t reg;
+	NcoState state;
+	uint32_t words;
+	uint32_t length;
+
+#ifndef CF_AD9361_TX_DMA_BASEADDR
+	/* The buffer could not be played */
+	return -ENODEV;
+#endif
+	words = dac_words_per_sample(phy);
+	length = samples * words * 4;
+	if((samples == 0) || (dac_ddr_size && (length > dac_ddr_size)))
+		return -ENOMEM;
+	if(NcoSynth_init(&state, plan, samples) != 0)
+		return -EINVAL;
 
-	dds_st[phy->id_no].cached_freq[chan] = freq;
 	dac_stop(phy);
-	dac_read(phy, DAC_REG_CHAN_CNTRL_2_IIOCHAN(chan), &reg);
-	reg &= ~DAC_DDS_INCR(~0);
-	val64 = (uint64_t) freq * 0xFFFFULL;
-	do_div(&val64, *dds_st[phy->id_no].dac_clk);
-	reg |= DAC_DDS_INCR(val64) | 1;
-	dac_write(phy, DAC_REG_CHAN_CNTRL_2_IIOCHAN(chan), reg);
+	NcoSynth_generate(&state, (uint32_t *)dac_ddr_baseaddr, samples, words);
+	dac_dma_start(length);
+	dac_datasel(phy, -1, DATA_SEL_DMA);
+	dds_st[phy->id_no].enable = true;
 	dac_start_sync(phy, 0);
+
+	return 0;
 }
 
 /***************************************************************************//**
- * @brief dds_get_frequency
+ * @brief dds_freq_word
+ *
+ * Returns the DAC_REG_CHAN_CNTRL_2 phase increment field of a tone frequency.
 *******************************************************************************/
-void dds_get_frequency(struct ad9361_rf_phy *phy, uint32_t chan, uint32_t *freq)
+static uint32_t dds_freq_word(struct ad9361_rf_phy *phy, uint32_t freq)
 {
-	*freq = dds_st[phy->id_no].cached_freq[chan];
+	struct dds_state *st = &dds_st[phy->id_no];
+	uint64_t val64;
+
+	/* The DAC clock rarely changes: divide by its cached reciprocal */
+	val64 = (uint64_t) freq * 0xFFFFULL;
+	if (st->dac_clk_recip.divisor != *st->dac_clk)
+		util_recip_init(&st->dac_clk_recip, *st->dac_clk);
+	util_recip_div(&val64, &st->dac_clk_recip);
+
+	return DAC_DDS_INCR(val64) | 1;
 }
 
 /***************************************************************************//**
- * @brief dds_set_phase
+ * @brief dds_phase_word
+ *
+ * Returns the DAC_REG_CHAN_CNTRL_2 initial phase field of a tone phase
+ * (in millidegrees).
 *******************************************************************************/
-void dds_set_phase(struct ad9361_rf_phy *phy, uint32_t chan, uint32_t phase)
+static uint32_t dds_phase_word(uint32_t phase)
 {
 	uint64_t val64;
-	uint32_t reg;
 
-	dds_st[phy->id_no].cached_phase[chan] = phase;
-	dac_stop(phy);
-	dac_read(phy, DAC_REG_CHAN_CNTRL_2_IIOCHAN(chan), &reg);
-	reg &= ~DAC_DDS_INIT(~0);
 	val64 = (uint64_t) phase * 0x10000ULL + (360000 / 2);
 	do_div(&val64, 360000);
-	reg |= DAC_DDS_INIT(val64);
-	dac_write(phy, DAC_REG_CHAN_CNTRL_2_IIOCHAN(chan), reg);
-	dac_start_sync(phy, 0);
-}
 
-/***************************************************************************//**
- * @brief dds_get_phase
-*******************************************************************************/
-void dds_get_phase(struct ad9361_rf_phy *phy, uint32_t chan, uint32_t *phase)
-{
-	*phase = dds_st[phy->id_no].cached_phase[chan];
+	return DAC_DDS_INIT(val64);
 }
 
 /***************************************************************************//**
- * @brief dds_set_phase
+ * @brief dds_scale_word
+ *
+ * Returns the DAC_REG_CHAN_CNTRL_1 word of a tone scale (in micro units). The
+ * scale is clamped to the range supported by the core, in place.
 *******************************************************************************/
-void dds_set_scale(struct ad9361_rf_phy *phy, uint32_t chan, int32_t scale_micro_units)
+static uint32_t dds_scale_word(struct ad9361_rf_phy *phy, int32_t *scale)
 {
+	int32_t scale_micro_units = *scale;
 	uint32_t scale_reg;
 	uint32_t sign_part;
 	uint32_t int_part;
@@ -367,7 +437,7 @@ void dds_set_scale(struct ad9361_rf_phy *phy, uint32_t chan, int32_t scale_micro
 			sign_part = 0;
 			int_part = 1;
 			fract_part = 0;
-			dds_st[phy->id_no].cached_scale[chan] = 1000000;
+			*scale = 1000000;
 			goto set_scale_reg;
 		}
 		if(scale_micro_units <= -1000000)
@@ -375,10 +445,9 @@ void dds_set_scale(struct ad9361_rf_phy *phy, uint32_t chan, int32_t scale_micro
 			sign_part = 1;
 			int_part = 1;
 			fract_part = 0;
-			dds_st[phy->id_no].cached_scale[chan] = -1000000;
+			*scale = -1000000;
 			goto set_scale_reg;
 		}
-		dds_st[phy->id_no].cached_scale[chan] = scale_micro_units;
 		if(scale_micro_units < 0)
 		{
 			sign_part = 1;
@@ -406,12 +475,73 @@ void dds_set_scale(struct ad9361_rf_phy *phy, uint32_t chan, int32_t scale_micro
 			scale_reg = 0;
 			scale_micro_units = 0;
 		}
-		dds_st[phy->id_no].cached_scale[chan] = scale_micro_units;
+		*scale = scale_micro_units;
 		fract_part = (uint32_t)(scale_micro_units);
 		scale_reg = 500000 / fract_part;
 	}
+
+	return DAC_DDS_SCALE(scale_reg);
+}
+
+/***************************************************************************//**
+ * @brief dds_set_frequency
+*******************************************************************************/
+void dds_set_frequency(struct ad9361_rf_phy *phy, uint32_t chan, uint32_t freq)
+{
+	uint32_t reg;
+
+	dds_st[phy->id_no].cached_freq[chan] = freq;
+	dac_stop(phy);
+	dac_read(phy, DAC_REG_CHAN_CNTRL_2_IIOCHAN(chan), &reg);
+	reg &= ~DAC_DDS_INCR(~0);
+	reg |= dds_freq_word(phy, freq);
+	dac_write(phy, DAC_REG_CHAN_CNTRL_2_IIOCHAN(chan), reg);
+	dac_start_sync(phy, 0);
+}
+
+/***************************************************************************//**
+ * @brief dds_get_frequency
+*******************************************************************************/
+void dds_get_frequency(struct ad9361_rf_phy *phy, uint32_t chan, uint32_t *freq)
+{
+	*freq = dds_st[phy->id_no].cached_freq[chan];
+}
+
+/***************************************************************************//**
+ * @brief dds_set_phase
+*******************************************************************************/
+void dds_set_phase(struct ad9361_rf_phy *phy, uint32_t chan, uint32_t phase)
+{
+	uint32_t reg;
+
+	dds_st[phy->id_no].cached_phase[chan] = phase;
+	dac_stop(phy);
+	dac_read(phy, DAC_REG_CHAN_CNTRL_2_IIOCHAN(chan), &reg);
+	reg &= ~DAC_DDS_INIT(~0);
+	reg |= dds_phase_word(phase);
+	dac_write(phy, DAC_REG_CHAN_CNTRL_2_IIOCHAN(chan), reg);
+	dac_start_sync(phy, 0);
+}
+
+/***************************************************************************//**
+ * @brief dds_get_phase
+*******************************************************************************/
+void dds_get_phase(struct ad9361_rf_phy *phy, uint32_t chan, uint32_t *phase)
+{
+	*phase = dds_st[phy->id_no].cached_phase[chan];
+}
+
+/***************************************************************************//**
+ * @brief dds_set_phase
+*******************************************************************************/
+void dds_set_scale(struct ad9361_rf_phy *phy, uint32_t chan, int32_t scale_micro_units)
+{
+	uint32_t reg;
+
+	reg = dds_scale_word(phy, &scale_micro_units);
+	dds_st[phy->id_no].cached_scale[chan] = scale_micro_units;
 	dac_stop(phy);
-	dac_write(phy, DAC_REG_CHAN_CNTRL_1_IIOCHAN(chan), DAC_DDS_SCALE(scale_reg));
+	dac_write(phy, DAC_REG_CHAN_CNTRL_1_IIOCHAN(chan), reg);
 	dac_start_sync(phy, 0);
 }
 
@@ -424,18 +554,153 @@ void dds_get_scale(struct ad9361_rf_phy *phy, uint32_t chan, int32_t *scale_micr
 }
 
 /***************************************************************************//**
- * @brief dds_update
+ * @brief dds_plan_init
+ *
+ * Starts a tone plan from the current (cached) state of all the DDS channels.
+ * Tones are then changed with dds_plan_set_tone() and applied together with
+ * dds_plan_commit().
 *******************************************************************************/
-void dds_update(struct ad9361_rf_phy *phy)
+void dds_plan_init(struct ad9361_rf_phy *phy, struct dds_tone_plan *plan)
 {
 	uint32_t chan;
 
-	for(chan = DDS_CHAN_TX1_I_F1; chan <= DDS_CHAN_TX2_Q_F2; chan++)
+	for(chan = 0; chan < DDS_NUM_CHANNELS; chan++)
 	{
-		dds_set_frequency(phy, chan, dds_st[phy->id_no].cached_freq[chan]);
-		dds_set_phase(phy, chan, dds_st[phy->id_no].cached_phase[chan]);
-		dds_set_scale(phy, chan, dds_st[phy->id_no].cached_scale[chan]);
+		plan->tone[chan].freq = dds_st[phy->id_no].cached_freq[chan];
+		plan->tone[chan].phase = dds_st[phy->id_no].cached_phase[chan];
+		plan->tone[chan].scale = dds_st[phy->id_no].cached_scale[chan];
 	}
+	plan->chan_mask = 0;
+}
+
+/***************************************************************************//**
+ * @brief dds_plan_set_tone
+ *
+ * Sets the frequency (Hz), phase (millidegrees) and scale (micro units) of a
+ * channel in a tone plan. Nothing is written to the core.
+*******************************************************************************/
+int32_t dds_plan_set_tone(struct dds_tone_plan *plan, uint32_t chan,
+		uint32_t freq, uint32_t phase, int32_t scale)
+{
+	if(chan >= DDS_NUM_CHANNELS)
+		return -EINVAL;
+
+	plan->tone[chan].freq = freq;
+	plan->tone[chan].phase = phase;
+	plan->tone[chan].scale = scale;
+	plan->chan_mask |= (1 << chan);
+
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief dds_write_image
+ *
+ * Writes the precomputed control words of the channels in "chan_mask" in a
+ * single stop/write/sync sequence and updates the cached state.
+*******************************************************************************/
+static void dds_write_image(struct ad9361_rf_phy *phy, uint32_t chan_mask,
+		const struct dds_channel_image *image)
+{
+	uint32_t chan;
+
+	dac_stop(phy);
+	for(chan = 0; chan < DDS_NUM_CHANNELS; chan++)
+	{
+		if(!(chan_mask & (1 << chan)))
+			continue;
+		dac_write(phy, DAC_REG_CHAN_CNTRL_2_IIOCHAN(chan), image[chan].cntrl_2);
+		dac_write(phy, DAC_REG_CHAN_CNTRL_1_IIOCHAN(chan), image[chan].cntrl_1);
+	}
+	dac_start_sync(phy, 0);
+
+	for(chan = 0; chan < DDS_NUM_CHANNELS; chan++)
+	{
+		if(!(chan_mask & (1 << chan)))
+			continue;
+		dds_st[phy->id_no].cached_freq[chan] = image[chan].tone.freq;
+		dds_st[phy->id_no].cached_phase[chan] = image[chan].tone.phase;
+		dds_st[phy->id_no].cached_scale[chan] = image[chan].tone.scale;
+	}
+}
+
+/***************************************************************************//**
+ * @brief dds_plan_commit
+ *
+ * Applies the channels of a tone plan set with dds_plan_set_tone() in a single
+ * stop/write/sync sequence. All the channel control words are computed up
+ * front, so the DAC is stopped only for the register writes, with no
+ * readback. The cached state is updated as by the dds_set_*() functions.
+*******************************************************************************/
+int32_t dds_plan_commit(struct ad9361_rf_phy *phy, struct dds_tone_plan *plan)
+{
+	struct dds_channel_image image[DDS_NUM_CHANNELS];
+	uint32_t chan;
+
+	if(plan->chan_mask == 0)
+		return 0;
+
+	for(chan = 0; chan < DDS_NUM_CHANNELS; chan++)
+	{
+		if(!(plan->chan_mask & (1 << chan)))
+			continue;
+		image[chan].cntrl_1 = dds_scale_word(phy, &plan->tone[chan].scale);
+		image[chan].cntrl_2 = dds_phase_word(plan->tone[chan].phase) |
+				dds_freq_word(phy, plan->tone[chan].freq);
+		image[chan].tone = plan->tone[chan];
+	}
+
+	dds_write_image(phy, plan->chan_mask, image);
+	plan->chan_mask = 0;
+
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief dds_apply_image
+ *
+ * Applies the channels in "chan_mask" of a register image built at compile
+ * time with DDS_CHANNEL_IMAGE(), as a straight burst of register writes. When
+ * the image does not match the core (other DAC clock, or a core older than
+ * v7.0, with another scale format), the words are computed at run time from
+ * the tones of the image instead.
+*******************************************************************************/
+int32_t dds_apply_image(struct ad9361_rf_phy *phy, const struct dds_image *image,
+		uint32_t chan_mask)
+{
+	struct dds_tone_plan plan;
+	uint32_t chan;
+
+	chan_mask &= (1 << DDS_NUM_CHANNELS) - 1;
+
+	if((image->dac_clk == *dds_st[phy->id_no].dac_clk) &&
+			(PCORE_VERSION_MAJOR(dds_st[phy->id_no].pcore_version) > 6))
+	{
+		dds_write_image(phy, chan_mask, image->chan);
+		return 0;
+	}
+
+	dds_plan_init(phy, &plan);
+	for(chan = 0; chan < DDS_NUM_CHANNELS; chan++)
+	{
+		if(chan_mask & (1 << chan))
+			plan.tone[chan] = image->chan[chan].tone;
+	}
+	plan.chan_mask = chan_mask;
+
+	return dds_plan_commit(phy, &plan);
+}
+
+/***************************************************************************//**
+ * @brief dds_update
+*******************************************************************************/
+void dds_update(struct ad9361_rf_phy *phy)
+{
+	struct dds_tone_plan plan;
+
+	dds_plan_init(phy, &plan);
+	plan.chan_mask = (1 << DDS_NUM_CHANNELS) - 1;
+	dds_plan_commit(phy, &plan);
 }
 
 /***************************************************************************//**
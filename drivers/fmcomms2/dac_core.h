@@ -43,6 +43,8 @@
 /***************************** Include Files **********************************/
 /******************************************************************************/
 #include "ad9361.h"
+#include "nco.h"
+#include "util_math.h"
 
 /******************************************************************************/
 /********************** Macros and Constants Definitions **********************/
@@ -116,6 +118,7 @@ enum dds_data_select {
 #define DDS_CHAN_TX2_I_F2	5
 #define DDS_CHAN_TX2_Q_F1	6
 #define DDS_CHAN_TX2_Q_F2	7
+#define DDS_NUM_CHANNELS	8
 
 #define AXI_DMAC_REG_IRQ_MASK			0x80
 #define AXI_DMAC_REG_IRQ_PENDING		0x84
@@ -152,12 +155,65 @@ struct dds_state
 	int32_t					cached_scale[8];
 	enum dds_data_select	cached_datasel[8];
 	uint32_t				*dac_clk;
+	struct util_recip		dac_clk_recip;	/* Of the last *dac_clk used */
 	uint32_t				pcore_version;
 	uint32_t				num_buf_channels;
 	bool					enable;
 	bool					rx2tx2;
 };
 
+/* Tone of a DDS channel */
+struct dds_tone
+{
+	uint32_t	freq;	/* Hz */
+	uint32_t	phase;	/* millidegrees */
+	int32_t		scale;	/* micro units */
+};
+
+/*
+ * Precomputed control words of a DDS channel (pcore v7.0 and later). Built at
+ * compile time by DDS_CHANNEL_IMAGE() for a given DAC clock, with the same
+ * arithmetic as dds_set_frequency(), dds_set_phase() and dds_set_scale().
+ */
+struct dds_channel_image
+{
+	struct dds_tone	tone;
+	uint32_t		cntrl_1;	/* DAC_REG_CHAN_CNTRL_1_IIOCHAN */
+	uint32_t		cntrl_2;	/* DAC_REG_CHAN_CNTRL_2_IIOCHAN */
+};
+
+struct dds_image
+{
+	uint32_t					dac_clk;	/* Hz */
+	struct dds_channel_image	chan[DDS_NUM_CHANNELS];
+};
+
+#define DDS_IMAGE_INCR(freq, clk)										\
+	(DAC_DDS_INCR(((uint64_t)(freq) * 0xFFFFULL) / (clk)) | 1)
+#define DDS_IMAGE_INIT(phase)											\
+	DAC_DDS_INIT(((uint64_t)(phase) * 0x10000ULL + (360000 / 2)) / 360000)
+#define DDS_IMAGE_SCALE(scale)											\
+	DAC_DDS_SCALE(((scale) >= 1000000) ? (1 << 14) :					\
+		((scale) <= -1000000) ? ((1 << 15) | (1 << 14)) :				\
+		((((scale) < 0) ? (1 << 15) : 0) |								\
+		(uint32_t)(((uint64_t)(((scale) < 0) ? -(scale) : (scale)) *	\
+				0x4000) / 1000000)))
+
+/* freq in Hz, phase in millidegrees, scale in micro units (+-1000000) */
+#define DDS_CHANNEL_IMAGE(freq, phase, scale, clk)						\
+	{ { (freq), (phase), (scale) }, DDS_IMAGE_SCALE(scale),			\
+		DDS_IMAGE_INIT(phase) | DDS_IMAGE_INCR(freq, clk) }
+
+#define DDS_TX1_CHANNELS		0x0F
+#define DDS_TX1_TX2_CHANNELS	0xFF
+
+/* Set of tones applied at once by dds_plan_commit() */
+struct dds_tone_plan
+{
+	struct dds_tone	tone[DDS_NUM_CHANNELS];
+	uint32_t		chan_mask;	/* Channels to write */
+};
+
 #define DAC_REG_CHAN_CNTRL_7(c)		(0x0418 + (c) * 0x40) /* v8.0 */
 #define DAC_DAC_DDS_SEL(x)		(((x) & 0xF) << 0)
 #define DAC_TO_DAC_DDS_SEL(x)		(((x) >> 0) & 0xF)
@@ -165,6 +221,8 @@ struct dds_state
 /******************************************************************************/
 /************************ Functions Declarations ******************************/
 /******************************************************************************/
+void dac_set_ddr_baseaddr(uint32_t baseaddr);
+void dac_set_ddr_size(uint32_t size);
 void dac_init(struct ad9361_rf_phy *phy, uint8_t data_sel, uint8_t config_dma);
 void dds_set_frequency(struct ad9361_rf_phy *phy, uint32_t chan, uint32_t freq);
 void dds_get_frequency(struct ad9361_rf_phy *phy, uint32_t chan, uint32_t *freq);
@@ -173,7 +231,15 @@ void dds_get_phase(struct ad9361_rf_phy *phy, uint32_t chan, uint32_t *phase);
 void dds_set_scale(struct ad9361_rf_phy *phy, uint32_t chan, int32_t scale_micro_units);
 void dds_get_scale(struct ad9361_rf_phy *phy, uint32_t chan, int32_t *scale_micro_units);
 void dds_update(struct ad9361_rf_phy *phy);
+void dds_plan_init(struct ad9361_rf_phy *phy, struct dds_tone_plan *plan);
+int32_t dds_plan_set_tone(struct dds_tone_plan *plan, uint32_t chan,
+		uint32_t freq, uint32_t phase, int32_t scale);
+int32_t dds_plan_commit(struct ad9361_rf_phy *phy, struct dds_tone_plan *plan);
+int32_t dds_apply_image(struct ad9361_rf_phy *phy, const struct dds_image *image,
+		uint32_t chan_mask);
 int32_t dac_datasel(struct ad9361_rf_phy *phy, int32_t chan, enum dds_data_select sel);
+int32_t dac_load_nco(struct ad9361_rf_phy *phy, const NcoPlan *plan,
+		uint32_t samples);
 void dac_get_datasel(struct ad9361_rf_phy *phy, int32_t chan, enum dds_data_select *sel);
 
 #endif
@@ -68,6 +68,9 @@
 #endif
 #ifdef XPAR_AXI_DMAC_0_BASEADDR
 #define CF_AD9361_RX_DMA_BASEADDR	XPAR_AXI_DMAC_0_BASEADDR
+#ifdef XPAR_MICROBLAZE_0_AXI_INTC_AXI_DMAC_0_IRQ_INTR
+#define CF_AD9361_RX_DMA_INTR_ID	XPAR_MICROBLAZE_0_AXI_INTC_AXI_DMAC_0_IRQ_INTR
+#endif
 #else
 //#define CF_AD9361_RX_DMA_BASEADDR	XPAR_AXI_AD9361_ADC_DMA_BASEADDR
 #endif
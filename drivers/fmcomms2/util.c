@@ -41,14 +41,10 @@
 /***************************** Include Files **********************************/
 /******************************************************************************/
 #include "util.h"
+#include "util_math.h"
 #include "string.h"
 #include "platform.h"
 
-/******************************************************************************/
-/*************************** Macros Definitions *******************************/
-/******************************************************************************/
-#define BITS_PER_LONG		32
-
 /***************************************************************************//**
  * @brief clk_prepare_enable
 *******************************************************************************/
@@ -221,24 +217,7 @@ int32_t clk_set_rate(struct ad9361_rf_phy *phy,
 *******************************************************************************/
 uint32_t int_sqrt(uint32_t x)
 {
-	uint32_t b, m, y = 0;
-
-	if (x <= 1)
-		return x;
-
-	m = 1UL << (BITS_PER_LONG - 2);
-	while (m != 0) {
-		b = y + m;
-		y >>= 1;
-
-		if (x >= b) {
-			x -= b;
-			y += m;
-		}
-		m >>= 2;
-	}
-
-	return y;
+	return util_int_sqrt(x);
 }
 
 /***************************************************************************//**
@@ -246,30 +225,7 @@ uint32_t int_sqrt(uint32_t x)
 *******************************************************************************/
 int32_t ilog2(int32_t x)
 {
-	int32_t A = !(!(x >> 16));
-	int32_t count = 0;
-	int32_t x_copy = x;
-
-	count = count + (A << 4);
-
-	x_copy = (((~A + 1) & (x >> 16)) + (~(~A + 1) & x));
-
-	A = !(!(x_copy >> 8));
-	count = count + (A << 3);
-	x_copy = (((~A + 1) & (x_copy >> 8)) + (~(~A + 1) & x_copy));
-
-	A = !(!(x_copy >> 4));
-	count = count + (A << 2);
-	x_copy = (((~A + 1) & (x_copy >> 4)) + (~(~A + 1) & x_copy));
-
-	A = !(!(x_copy >> 2));
-	count = count + (A << 1);
-	x_copy = (((~A + 1) & (x_copy >> 2)) + (~(~A + 1) & x_copy));
-
-	A = !(!(x_copy >> 1));
-	count = count + A;
-
-	return count;
+	return util_ilog2(x);
 }
 
 /***************************************************************************//**
@@ -277,12 +233,7 @@ int32_t ilog2(int32_t x)
 *******************************************************************************/
 uint64_t do_div(uint64_t* n, uint64_t base)
 {
-	uint64_t mod = 0;
-
-	mod = *n % base;
-	*n = *n / base;
-
-	return mod;
+	return util_do_div(n, base);
 }
 
 /***************************************************************************//**
@@ -290,27 +241,7 @@ uint64_t do_div(uint64_t* n, uint64_t base)
 *******************************************************************************/
 uint32_t find_first_bit(uint32_t word)
 {
-	int32_t num = 0;
-
-	if ((word & 0xffff) == 0) {
-			num += 16;
-			word >>= 16;
-	}
-	if ((word & 0xff) == 0) {
-			num += 8;
-			word >>= 8;
-	}
-	if ((word & 0xf) == 0) {
-			num += 4;
-			word >>= 4;
-	}
-	if ((word & 0x3) == 0) {
-			num += 2;
-			word >>= 2;
-	}
-	if ((word & 0x1) == 0)
-			num += 1;
-	return num;
+	return util_find_first_bit(word);
 }
 
 /***************************************************************************//**
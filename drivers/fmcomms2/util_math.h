@@ -0,0 +1,214 @@
+/*
+ * util_math.h
+ *
+ * Integer helpers behind find_first_bit(), ilog2(), int_sqrt() and do_div()
+ * (util.c), and reciprocal division for repeated divisions by the same value.
+ *
+ * Bit scans use __builtin_clz(), which GCC turns into the MicroBlaze "clz"
+ * instruction when the pattern compare unit is enabled (C_USE_PCMP_INSTR, BSP
+ * flag -mxl-pattern-compare), and into a libgcc table lookup otherwise. Other
+ * compilers get a de Bruijn table lookup. Variable shifts rely on the barrel
+ * shifter (C_USE_BARREL, -mxl-barrel-shift).
+ *
+ * The MicroBlaze has no hardware divider in this design, so 64-bit divisions
+ * are long libgcc loops. do_div() avoids them for powers of two and 32-bit
+ * operands, and callers dividing many times by the same value (e.g. a clock
+ * rate) can precompute its reciprocal with util_recip_init() and divide with
+ * two 32x32 multiplies per partial product instead.
+ *
+ * Only stdint.h is needed, so the host build ("tools/util_bench") checks
+ * these helpers against the generic implementations they replace.
+ */
+
+#ifndef UTIL_MATH_H_
+#define UTIL_MATH_H_
+
+#include <stdint.h>
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * Reciprocal of a 32-bit divisor: floor((2^64 - 1) / divisor)
+ */
+struct util_recip
+{
+	uint32_t	divisor;
+	uint64_t	inverse;
+};
+
+/***************************************************************************//**
+ * @brief util_clz32
+ *
+ * Number of leading zero bits of x (32 for x = 0).
+*******************************************************************************/
+static inline uint32_t util_clz32(uint32_t x)
+{
+#if defined(__GNUC__)
+	return x ? (uint32_t)__builtin_clz(x) : 32;
+#else
+	static const uint8_t debruijn_msb[32] = {
+		0, 9, 1, 10, 13, 21, 2, 29, 11, 14, 16, 18, 22, 25, 3, 30,
+		8, 12, 20, 28, 15, 17, 24, 7, 19, 27, 23, 6, 26, 5, 4, 31
+	};
+
+	if (x == 0)
+		return 32;
+	/* Smear the MSB down, then hash 2^(msb + 1) - 1 */
+	x |= x >> 1;
+	x |= x >> 2;
+	x |= x >> 4;
+	x |= x >> 8;
+	x |= x >> 16;
+	return 31 - debruijn_msb[(x * 0x07C4ACDDU) >> 27];
+#endif
+}
+
+/***************************************************************************//**
+ * @brief util_ctz32
+ *
+ * Number of trailing zero bits of x (32 for x = 0).
+*******************************************************************************/
+static inline uint32_t util_ctz32(uint32_t x)
+{
+	if (x == 0)
+		return 32;
+	/* Isolate the lowest set bit */
+	return 31 - util_clz32(x & (0U - x));
+}
+
+/***************************************************************************//**
+ * @brief util_ilog2
+ *
+ * Index of the most significant set bit (0 for x = 0, 31 for x < 0).
+*******************************************************************************/
+static inline int32_t util_ilog2(int32_t x)
+{
+	if (x == 0)
+		return 0;
+
+	return 31 - util_clz32((uint32_t)x);
+}
+
+/***************************************************************************//**
+ * @brief util_find_first_bit
+ *
+ * Index of the least significant set bit (31 for word = 0).
+*******************************************************************************/
+static inline uint32_t util_find_first_bit(uint32_t word)
+{
+	if (word == 0)
+		return 31;
+
+	return util_ctz32(word);
+}
+
+/***************************************************************************//**
+ * @brief util_int_sqrt
+ *
+ * floor(sqrt(x)), bit by bit from the highest power of 4 not above x.
+*******************************************************************************/
+static inline uint32_t util_int_sqrt(uint32_t x)
+{
+	uint32_t b, m, y = 0;
+
+	if (x <= 1)
+		return x;
+
+	m = 1UL << ((31 - util_clz32(x)) & ~1U);
+	while (m != 0) {
+		b = y + m;
+		y >>= 1;
+
+		if (x >= b) {
+			x -= b;
+			y += m;
+		}
+		m >>= 2;
+	}
+
+	return y;
+}
+
+/***************************************************************************//**
+ * @brief util_mulhi64
+ *
+ * High 64 bits of the 128-bit product a * b.
+*******************************************************************************/
+static inline uint64_t util_mulhi64(uint64_t a, uint64_t b)
+{
+	uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+	uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+	uint64_t lo_lo = a_lo * b_lo;
+	uint64_t hi_lo = a_hi * b_lo;
+	uint64_t lo_hi = a_lo * b_hi;
+	uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+
+	return a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+}
+
+/***************************************************************************//**
+ * @brief util_recip_init
+ *
+ * Precomputes the reciprocal of a non-zero divisor (one 64-bit division).
+*******************************************************************************/
+static inline void util_recip_init(struct util_recip *recip, uint32_t divisor)
+{
+	recip->divisor = divisor;
+	recip->inverse = UINT64_MAX / divisor;
+}
+
+/***************************************************************************//**
+ * @brief util_recip_div
+ *
+ * Divides n in place by the divisor of "recip", as do_div(), and returns the
+ * remainder. The estimate from the reciprocal is at most one below the
+ * quotient, so a single correction step makes it exact.
+*******************************************************************************/
+static inline uint32_t util_recip_div(uint64_t *n, const struct util_recip *recip)
+{
+	uint64_t q = util_mulhi64(*n, recip->inverse);
+	uint64_t r = *n - q * recip->divisor;
+
+	if (r >= recip->divisor) {
+		q++;
+		r -= recip->divisor;
+	}
+	*n = q;
+
+	return (uint32_t)r;
+}
+
+/***************************************************************************//**
+ * @brief util_do_div
+ *
+ * Divides n in place by base and returns the remainder, avoiding the 64-bit
+ * division for powers of two and 32-bit operands.
+*******************************************************************************/
+static inline uint64_t util_do_div(uint64_t *n, uint64_t base)
+{
+	uint64_t mod;
+
+	/* Powers of two: shift and mask */
+	if (base && ((base & (base - 1)) == 0)) {
+		mod = *n & (base - 1);
+		if ((uint32_t)base)
+			*n >>= util_ctz32((uint32_t)base);
+		else
+			*n >>= 32 + util_ctz32((uint32_t)(base >> 32));
+		return mod;
+	}
+
+	/* 32-bit operands: a single 32-bit division */
+	if (((*n | base) >> 32) == 0) {
+		mod = (uint32_t)*n % (uint32_t)base;
+		*n = (uint32_t)*n / (uint32_t)base;
+		return mod;
+	}
+
+	mod = *n % base;
+	*n = *n / base;
+
+	return mod;
+}
+
+#endif /* UTIL_MATH_H_ */
@@ -0,0 +1,170 @@
+/*
+ * ddr_regions.c
+ *
+ * Boot-time allocator for the DDR regions shared with DMA engines.
+ *
+ * The program image, heap and stack are placed in DDR by the linker script,
+ * whose last symbol is "_end". Therefore, regions are handed out from the
+ * first free address after "_end" (regardless of _STACK_SIZE and _HEAP_SIZE)
+ * up to the end of the MIG address range, with the requested alignment and
+ * with sizes rounded up to the data cache line.
+ *
+ * Subsystems that must use a fixed address (e.g. a buffer whose address is
+ * hardcoded elsewhere) register it through "ddrReserveRegion()". Once all
+ * subsystems are initialized, "ddrCheckRegions()" prints the memory map and
+ * reports any overlap between regions.
+ *
+ * Regions are never freed.
+ */
+
+/***************************** Include Files *********************************/
+
+#include "ddr_regions.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+
+/************************** Variable Definitions *****************************/
+
+/*
+ * End of the program image (including heap and stack), from the linker script
+ */
+extern char _end[];
+
+static DdrRegion Regions[MAX_DDR_REGIONS];
+static int nRegions = 0;
+static u32 NextFreeAddr = 0;
+
+/*****************************************************************************/
+/*
+ *
+ * Registers a region in the table.
+ *
+ ******************************************************************************/
+static int addRegion(const char *Name, u32 Base, u32 Size, u8 Fixed) {
+	if (nRegions >= MAX_DDR_REGIONS) {
+		xil_printf("\r\nDDR region table full, cannot add %s\r\n", Name);
+		return XST_FAILURE;
+	}
+
+	Regions[nRegions].Name = Name;
+	Regions[nRegions].Base = Base;
+	Regions[nRegions].Size = Size;
+	Regions[nRegions].Fixed = Fixed;
+	nRegions++;
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Initializes the allocator and registers the program image.
+ *
+ ******************************************************************************/
+void initDdrRegions(void) {
+	u32 ProgramEnd = (u32) _end;
+
+	nRegions = 0;
+
+	if (ProgramEnd >= DDR_BASE_ADDR && ProgramEnd <= DDR_HIGH_ADDR) {
+		// Everything below "_end" is conservatively taken by the program
+		addRegion("program/heap/stack", DDR_BASE_ADDR,
+				ProgramEnd - DDR_BASE_ADDR, 1);
+		NextFreeAddr = ProgramEnd;
+	} else {
+		// Program runs from another memory, the whole DDR is free
+		NextFreeAddr = DDR_BASE_ADDR;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Allocates a DDR region.
+ *
+ * @param	Name identifies the region in the memory map report.
+ * @param	Size is the region size in bytes (rounded up to the cache line).
+ * @param	Align is the required alignment in bytes, a power of two. The
+ *		cache line alignment is always enforced.
+ *
+ * @return	The base address of the region, or 0 if it does not fit.
+ *
+ ******************************************************************************/
+u32 ddrAllocRegion(const char *Name, u32 Size, u32 Align) {
+	u32 Base;
+
+	if (NextFreeAddr == 0) {
+		initDdrRegions();
+	}
+
+	if (Align < DDR_CACHE_LINE_LEN)
+		Align = DDR_CACHE_LINE_LEN;
+
+	Size = (Size + DDR_CACHE_LINE_LEN - 1) & ~(DDR_CACHE_LINE_LEN - 1);
+	Base = (NextFreeAddr + Align - 1) & ~(Align - 1);
+
+	if (Size == 0 || Base < NextFreeAddr
+			|| (DDR_HIGH_ADDR - Base) < (Size - 1)) {
+		xil_printf("\r\nDDR allocation of %d bytes for %s failed\r\n", Size,
+				Name);
+		return 0;
+	}
+
+	if (addRegion(Name, Base, Size, 0) != XST_SUCCESS)
+		return 0;
+
+	NextFreeAddr = Base + Size;
+
+	return Base;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Registers a region placed at a fixed address, so that it is considered in
+ * the overlap check. The allocator does not move around fixed regions, so
+ * they should lie above every allocated region or be checked at startup.
+ *
+ ******************************************************************************/
+int ddrReserveRegion(const char *Name, u32 Base, u32 Size) {
+	if (Base < DDR_BASE_ADDR || Size == 0
+			|| (DDR_HIGH_ADDR - Base) < (Size - 1)) {
+		xil_printf("\r\nDDR region %s out of the MIG range\r\n", Name);
+		return XST_FAILURE;
+	}
+
+	return addRegion(Name, Base, Size, 1);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Prints the DDR memory map and reports overlapping regions.
+ *
+ * @return	The number of overlapping region pairs.
+ *
+ ******************************************************************************/
+int ddrCheckRegions(void) {
+	int i, j;
+	int nOverlaps = 0;
+
+	xil_printf("\r\n--- DDR Memory Map --- \r\n");
+	for (i = 0; i < nRegions; i++) {
+		xil_printf("%08x - %08x \t %s%s\r\n", Regions[i].Base,
+				Regions[i].Base + Regions[i].Size - 1, Regions[i].Name,
+				Regions[i].Fixed ? " (fixed)" : "");
+	}
+
+	for (i = 0; i < nRegions; i++) {
+		for (j = i + 1; j < nRegions; j++) {
+			if (Regions[i].Base < Regions[j].Base + Regions[j].Size
+					&& Regions[j].Base < Regions[i].Base + Regions[i].Size) {
+				xil_printf("Warning: DDR region %s overlaps %s\r\n",
+						Regions[i].Name, Regions[j].Name);
+				nOverlaps++;
+			}
+		}
+	}
+
+	return nOverlaps;
+}
@@ -0,0 +1,43 @@
+/*
+ * ddr_regions.h
+ */
+
+#ifndef DDR_REGIONS_H_
+#define DDR_REGIONS_H_
+
+#include "xparameters.h"
+#include "xil_types.h"
+
+/************************** Constant Definitions *****************************/
+
+#define DDR_BASE_ADDR			XPAR_MIG7SERIES_0_BASEADDR
+#define DDR_HIGH_ADDR			XPAR_MIG7SERIES_0_HIGHADDR
+
+/*
+ * Data cache line length in bytes. Regions touched by both the CPU and a DMA
+ * must be aligned to it, since cache maintenance is done per line.
+ */
+#ifdef XPAR_MICROBLAZE_DCACHE_LINE_LEN
+#define DDR_CACHE_LINE_LEN		(XPAR_MICROBLAZE_DCACHE_LINE_LEN * 4)
+#else
+#define DDR_CACHE_LINE_LEN		32
+#endif
+
+#define MAX_DDR_REGIONS			16
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	const char *Name;
+	u32 Base;
+	u32 Size;
+	u8 Fixed;	/* Placed by the caller, not by the allocator */
+} DdrRegion;
+
+/************************** Function Prototypes *****************************/
+void initDdrRegions(void);
+u32 ddrAllocRegion(const char *Name, u32 Size, u32 Align);
+int ddrReserveRegion(const char *Name, u32 Base, u32 Size);
+int ddrCheckRegions(void);
+
+#endif /* DDR_REGIONS_H_ */
@@ -0,0 +1,151 @@
+/*
+ * dma_buffer.c
+ *
+ * DMA source buffers with dirty-range tracking.
+ *
+ * Before a DMA engine reads a buffer, the data written by the CPU must be
+ * flushed from the data cache. Rather than flushing the whole buffer before
+ * every transfer, writers mark the range they modified and "DmaBuffer_flush()"
+ * flushes only that range (rounded to cache lines), or nothing when the
+ * buffer did not change since the last flush.
+ *
+ * Buffers written by the CPU without going through "DmaBuffer_write32()" must
+ * be marked with "DmaBuffer_markDirty()".
+ */
+
+/***************************** Include Files *********************************/
+
+#include "dma_buffer.h"
+#include "ddr_regions.h"
+#include "timestamp.h"
+#include "xil_cache.h"
+#include "xil_io.h"
+
+/************************** Constant Definitions *****************************/
+
+#define FLUSH_RATE_WINDOW_TICKS	((u64) TIMESTAMP_FREQ_HZ)
+
+/************************** Variable Definitions *****************************/
+
+static DmaBufferStats FlushStats;
+static u64 WindowStart;
+static u32 WindowBytes;
+
+/*****************************************************************************/
+/*
+ *
+ * Closes the flush rate window once it lasted one second. The window is also
+ * checked when no flush happens (skipped flushes and statistics queries), so
+ * that the rate drops to 0 when the buffers stop being flushed. It is timed
+ * with the 64-bit timestamp, since flushes may be far more than one wrap of
+ * the 32-bit one apart.
+ *
+ ******************************************************************************/
+static void DmaBuffer_updateRate(void) {
+	u64 Elapsed = getTimestamp64() - WindowStart;
+
+	if (Elapsed >= FLUSH_RATE_WINDOW_TICKS) {
+		FlushStats.BytesPerSec = (u32) (((u64) WindowBytes
+				* TIMESTAMP_FREQ_HZ) / Elapsed);
+		WindowBytes = 0;
+		WindowStart += Elapsed;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Initializes a buffer. The whole buffer is considered dirty, since its
+ * contents were never flushed.
+ *
+ ******************************************************************************/
+void DmaBuffer_init(DmaBuffer *Buffer, u32 Base, u32 Size) {
+	Buffer->Base = Base;
+	Buffer->Size = Size;
+	Buffer->DirtyStart = 0;
+	Buffer->DirtyEnd = Size;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Extends the dirty range of the buffer with [Offset, Offset + Length).
+ *
+ ******************************************************************************/
+void DmaBuffer_markDirty(DmaBuffer *Buffer, u32 Offset, u32 Length) {
+	u32 End;
+
+	if (Length == 0 || Offset >= Buffer->Size)
+		return;
+
+	End = (Length > Buffer->Size - Offset) ? Buffer->Size : Offset + Length;
+
+	if (Buffer->DirtyStart >= Buffer->DirtyEnd) {
+		Buffer->DirtyStart = Offset;
+		Buffer->DirtyEnd = End;
+	} else {
+		if (Offset < Buffer->DirtyStart)
+			Buffer->DirtyStart = Offset;
+		if (End > Buffer->DirtyEnd)
+			Buffer->DirtyEnd = End;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Writes a 32-bit word into the buffer and marks it as dirty.
+ *
+ ******************************************************************************/
+void DmaBuffer_write32(DmaBuffer *Buffer, u32 Offset, u32 Value) {
+	Xil_Out32(Buffer->Base + Offset, Value);
+	DmaBuffer_markDirty(Buffer, Offset, 4);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Flushes the dirty range of the buffer from the data cache, so that it can
+ * be handed to a DMA engine, and marks the buffer as clean.
+ *
+ * @return	The number of bytes flushed (0 if the buffer was clean).
+ *
+ ******************************************************************************/
+u32 DmaBuffer_flush(DmaBuffer *Buffer) {
+	u32 Start, End, Length;
+
+	DmaBuffer_updateRate();
+
+	if (Buffer->DirtyStart >= Buffer->DirtyEnd) {
+		FlushStats.nSkippedFlushes++;
+		return 0;
+	}
+
+	// Whole cache lines are written back
+	Start = (Buffer->Base + Buffer->DirtyStart) & ~(DDR_CACHE_LINE_LEN - 1);
+	End = (Buffer->Base + Buffer->DirtyEnd + DDR_CACHE_LINE_LEN - 1)
+			& ~(DDR_CACHE_LINE_LEN - 1);
+	Length = End - Start;
+
+	Xil_DCacheFlushRange(Start, Length);
+
+	Buffer->DirtyStart = Buffer->Size;
+	Buffer->DirtyEnd = 0;
+
+	FlushStats.nFlushes++;
+	FlushStats.nBytesFlushed += Length;
+	WindowBytes += Length;
+
+	return Length;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Copies the cache flush statistics.
+ *
+ ******************************************************************************/
+void DmaBuffer_getStats(DmaBufferStats *Stats) {
+	DmaBuffer_updateRate();
+	*Stats = FlushStats;
+}
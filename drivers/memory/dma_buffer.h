@@ -0,0 +1,41 @@
+/*
+ * dma_buffer.h
+ */
+
+#ifndef DMA_BUFFER_H_
+#define DMA_BUFFER_H_
+
+#include "xil_types.h"
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * Buffer read by a DMA engine, which tracks the range written by the CPU
+ * since the last cache flush. The dirty range is [DirtyStart, DirtyEnd), in
+ * bytes relative to Base, and is empty when DirtyStart >= DirtyEnd.
+ */
+typedef struct {
+	u32 Base;
+	u32 Size;
+	u32 DirtyStart;
+	u32 DirtyEnd;
+} DmaBuffer;
+
+/*
+ * Cache flush statistics of all DMA buffers
+ */
+typedef struct {
+	u32 nFlushes;		/* Flushes of a non-empty dirty range */
+	u32 nSkippedFlushes;	/* Flush requests with a clean buffer */
+	u32 nBytesFlushed;	/* Total bytes flushed */
+	u32 BytesPerSec;	/* Flush rate over the last closed window (>= 1 s) */
+} DmaBufferStats;
+
+/************************** Function Prototypes *****************************/
+void DmaBuffer_init(DmaBuffer *Buffer, u32 Base, u32 Size);
+void DmaBuffer_markDirty(DmaBuffer *Buffer, u32 Offset, u32 Length);
+void DmaBuffer_write32(DmaBuffer *Buffer, u32 Offset, u32 Value);
+u32 DmaBuffer_flush(DmaBuffer *Buffer);
+void DmaBuffer_getStats(DmaBufferStats *Stats);
+
+#endif /* DMA_BUFFER_H_ */
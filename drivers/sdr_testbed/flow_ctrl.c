@@ -0,0 +1,137 @@
+/*
+ * flow_ctrl.c
+ *
+ * Inter-departure intervals of the cpri2ethernet flow control.
+ *
+ * A packet carries BfsPerPkt CPRI basic frames, and BFs are generated at the
+ * chip rate regardless of the line rate option, so packets must leave every
+ * BfsPerPkt * AxiClkHz / ChipRate AXI clock cycles. The hardware alternates
+ * between two intervals, so a pair of packets takes
+ *
+ *   S = 2 * BfsPerPkt * AxiClkHz / ChipRate
+ *
+ * cycles on average. The integer part of S is split between both intervals
+ * (differing by at most one cycle), and its fractional part Num / Den is
+ * realized by using IntervalB + 1 for Num out of every Den pairs of packets.
+ *
+ * IntervalB is rewritten by the firmware polling loop, which may stall for
+ * several ms (UART output). Rather than assuming that each value was used for
+ * a fixed number of pairs, the dither accounts for the time each value
+ * actually stayed in the register, and picks the next one from the drift
+ * accumulated so far. A late rewrite thus only adds drift, which is paid back
+ * in the next slots, and the average rate stays exact.
+ *
+ * Only the C library is needed, so the host rate model runs the same
+ * computation (see "tools/flow_ctrl_model").
+ */
+
+/***************************** Include Files *********************************/
+
+#include "flow_ctrl.h"
+
+/*****************************************************************************/
+
+static uint64_t gcd64(uint64_t a, uint64_t b) {
+	while (b) {
+		uint64_t t = a % b;
+
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Largest number of BFs per packet that fits the Ethernet payload (93 for
+ * line rate option #1).
+ *
+ ******************************************************************************/
+uint32_t FlowCtrl_maxBfsPerPkt(uint32_t LineRate) {
+	if (LineRate == 0) {
+		return 0;
+	}
+	return FLOW_CTRL_MAX_PAYLOAD / (FLOW_CTRL_BF_BYTES * LineRate);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Computes the intervals for the given number of BFs per packet. Whether
+ * the BFs fit a packet is up to the caller (see FlowCtrl_maxBfsPerPkt()).
+ *
+ * Returns 0 on success, -1 if the intervals (including the dithered
+ * IntervalB + 1) do not fit the registers.
+ *
+ ******************************************************************************/
+int FlowCtrl_plan(FlowCtrlPlan *Plan, uint32_t BfsPerPkt, uint32_t ChipRate,
+		uint32_t AxiClkHz) {
+	uint64_t Num, Den, Gcd, Whole;
+
+	if (BfsPerPkt == 0 || ChipRate == 0) {
+		return -1;
+	}
+
+	/* Cycles per pair of packets, as a reduced fraction */
+	Num = 2ULL * BfsPerPkt * AxiClkHz;
+	Den = ChipRate;
+	Gcd = gcd64(Num, Den);
+	Num /= Gcd;
+	Den /= Gcd;
+
+	Whole = Num / Den;
+	/* IntervalB is the larger half, and is dithered up by one cycle */
+	if (Whole < 2 || (Whole - Whole / 2) + 1 > FLOW_CTRL_MAX_INTERVAL) {
+		return -1;
+	}
+
+	Plan->IntervalA = (uint32_t) (Whole / 2);
+	Plan->IntervalB = (uint32_t) (Whole - Whole / 2);
+	Plan->DitherNum = (uint32_t) (Num % Den);
+	Plan->DitherDen = (uint32_t) Den;
+
+	return 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Starts the dithering of IntervalB.
+ *
+ ******************************************************************************/
+void FlowCtrl_initDither(FlowCtrlDither *Dither, const FlowCtrlPlan *Plan) {
+	Dither->Plan = *Plan;
+	Dither->Acc = 0;
+	Dither->IntervalB = Plan->IntervalB;
+	Dither->Carry = 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * IntervalB for the next dither slot, given the AXI clock cycles elapsed since
+ * the previous value (initially Plan->IntervalB) was written. Slots may have
+ * any length, but the drift grows with it: a slot of K pairs moves the
+ * departures by up to K cycles.
+ *
+ ******************************************************************************/
+uint32_t FlowCtrl_nextIntervalB(FlowCtrlDither *Dither,
+		uint32_t ElapsedCycles) {
+	const FlowCtrlPlan *Plan = &Dither->Plan;
+	uint64_t Cycles = (uint64_t) Dither->Carry + ElapsedCycles;
+	uint32_t PairCycles = Plan->IntervalA + Dither->IntervalB;
+	int64_t nPairs = (int64_t) (Cycles / PairCycles);
+
+	Dither->Carry = (uint32_t) (Cycles % PairCycles);
+	if (Dither->IntervalB == Plan->IntervalB) {
+		Dither->Acc -= nPairs * Plan->DitherNum;
+	} else {
+		Dither->Acc += nPairs * (Plan->DitherDen - Plan->DitherNum);
+	}
+
+	// Longer pairs while the departures are ahead of the exact schedule
+	Dither->IntervalB = Plan->IntervalB + (Dither->Acc < 0 ? 1 : 0);
+
+	return Dither->IntervalB;
+}
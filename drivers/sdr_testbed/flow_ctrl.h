@@ -0,0 +1,59 @@
+/*
+ * flow_ctrl.h
+ */
+
+#ifndef FLOW_CTRL_H_
+#define FLOW_CTRL_H_
+
+#include <stdint.h>
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Largest Ethernet payload, and bytes of one CPRI BF per line rate option
+ */
+#define FLOW_CTRL_MAX_PAYLOAD	1500
+#define FLOW_CTRL_BF_BYTES		16
+
+/*
+ * Largest interval the flow control registers (32-bit) hold
+ */
+#define FLOW_CTRL_MAX_INTERVAL	UINT32_MAX
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * Inter-departure intervals of the cpri2ethernet flow control, in AXI clock
+ * cycles. The hardware alternates between IntervalA (register 0x407) and
+ * IntervalB (register 0x40C). The exact packet period generally lies between
+ * two cycle counts, so IntervalB + 1 must be used for DitherNum out of every
+ * DitherDen pairs of packets (see FlowCtrl_nextIntervalB()).
+ */
+typedef struct {
+	uint32_t IntervalA;
+	uint32_t IntervalB;
+	uint32_t DitherNum;
+	uint32_t DitherDen;
+} FlowCtrlPlan;
+
+/*
+ * First-order dithering of IntervalB. Acc is the drift of the departures from
+ * the exact schedule, in 1 / DitherDen cycles: each pair of packets adds
+ * -DitherNum with IntervalB, and DitherDen - DitherNum with IntervalB + 1.
+ */
+typedef struct {
+	FlowCtrlPlan Plan;
+	int64_t Acc;
+	uint32_t IntervalB;	/* Value in the register */
+	uint32_t Carry;		/* Cycles of the pair in progress */
+} FlowCtrlDither;
+
+/************************** Function Prototypes *****************************/
+uint32_t FlowCtrl_maxBfsPerPkt(uint32_t LineRate);
+int FlowCtrl_plan(FlowCtrlPlan *Plan, uint32_t BfsPerPkt, uint32_t ChipRate,
+		uint32_t AxiClkHz);
+void FlowCtrl_initDither(FlowCtrlDither *Dither, const FlowCtrlPlan *Plan);
+uint32_t FlowCtrl_nextIntervalB(FlowCtrlDither *Dither,
+		uint32_t ElapsedCycles);
+
+#endif /* FLOW_CTRL_H_ */
@@ -0,0 +1,54 @@
+/*
+ * lte_modes.c
+ *
+ * LTE operating mode selected at runtime. The initial mode is "LTE_MODE"
+ * (main.h). The AD9361 and the DMA driver read the profile of the current mode
+ * when they are (re)configured, see "selectLteMode()" in main.c.
+ */
+
+/***************************** Include Files *********************************/
+
+#include "main.h"
+#include "xstatus.h"
+
+/************************** Variable Definitions *****************************/
+
+static const LteProfile LteProfiles[N_LTE_MODES] = {
+	[LTE5] = { "LTE 5 MHz", 7680000, 4500000 },
+	[LTE20] = { "LTE 20 MHz", 30720000, 18000000 },
+};
+
+static int CurrentLteMode = LTE_MODE;
+
+/*****************************************************************************/
+/*
+ *
+ * Returns the profile of the given LTE mode, or NULL for an invalid mode.
+ *
+ ******************************************************************************/
+const LteProfile *getLteProfile(int LteMode) {
+	if (LteMode < 0 || LteMode >= N_LTE_MODES)
+		return 0;
+
+	return &LteProfiles[LteMode];
+}
+
+int getLteMode(void) {
+	return CurrentLteMode;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Sets the current LTE mode. It only takes effect in the AD9361 and the DMA
+ * when they are reconfigured.
+ *
+ ******************************************************************************/
+int setLteMode(int LteMode) {
+	if (getLteProfile(LteMode) == 0)
+		return XST_INVALID_PARAM;
+
+	CurrentLteMode = LteMode;
+
+	return XST_SUCCESS;
+}
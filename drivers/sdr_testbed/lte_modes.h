@@ -11,4 +11,19 @@
 #define LTE5    0
 #define LTE20   1
 
-#endif
\ No newline at end of file
+#define N_LTE_MODES 2
+
+/*
+ * Operating parameters of each LTE mode
+ */
+typedef struct {
+	const char *Name;
+	unsigned int SamplingFreq;	/* AD9361 and DMA IQ sample rate (Hz) */
+	unsigned int RfBandwidth;	/* AD9361 analog filter bandwidth (Hz) */
+} LteProfile;
+
+const LteProfile *getLteProfile(int LteMode);
+int getLteMode(void);
+int setLteMode(int LteMode);
+
+#endif
@@ -6,6 +6,8 @@
 #include "xintc_driver.h"
 #include "xil_cache.h"
 #include "microblaze_sleep.h"
+#include "timestamp.h"
+#include "ddr_regions.h"
 
 /************************** Constant Definitions ****************************/
 
@@ -118,6 +120,16 @@ int main(void) {
 		return XST_FAILURE;
 	}
 
+	/*
+	 * Start the timebase used for rate and latency measurements
+	 */
+	initTimestamp();
+
+	/*
+	 * DDR regions for DMA buffers are handed out after the program image
+	 */
+	initDdrRegions();
+
 	/*
 	 * Init AXI Ethernet
 	 */
@@ -210,6 +222,11 @@ int main(void) {
 	}
 //#endif
 
+	// Report the DDR memory map and any overlapping region
+	if (ddrCheckRegions() != 0) {
+		xil_printf("Warning: overlapping DDR regions\r\n");
+	}
+
 	/*
 	 * Radio over Ethernet Configuration
 	 */
@@ -232,6 +249,7 @@ int main(void) {
 //	//RoE_setEthTypeFilters();
 //
 //	// Initialize "CPRI to Ethernet" module
+//	//RoE_planPacketSize(ROE_LATENCY_BUDGET_NS);
 //	//RoE_initCpri2Ethernet(ROE_FLOW_CONTROL);
 //#endif
 //
@@ -253,3 +271,38 @@ int main(void) {
 	return XST_SUCCESS;
 
 }
+
+/*****************************************************************************/
+/**
+ *
+ * Switches the LTE mode at runtime: the AD9361 sampling frequency, FIRs and
+ * RF bandwidth are reprogrammed and the DMA channels are reconfigured for the
+ * new rate. The DMA transmission is stopped; load a waveform for the new mode
+ * if needed ("loadTxAxcWaveforms()") and restart it with
+ * "startCyclicDmaRead()".
+ *
+ ****************************************************************************/
+int selectLteMode(int LteMode) {
+	int Status;
+
+	Status = setLteMode(LteMode);
+	if (Status != XST_SUCCESS) {
+		xil_printf("Invalid LTE mode %d\r\n", LteMode);
+		return Status;
+	}
+
+	if (setAd9361LteMode(LteMode) != 0) {
+		xil_printf("Failed to configure the AD9361\r\n");
+		return XST_FAILURE;
+	}
+
+	Status = setDmaLteMode(LteMode);
+	if (Status != XST_SUCCESS) {
+		xil_printf("Failed to configure the DMA\r\n");
+		return XST_FAILURE;
+	}
+
+	xil_printf("LTE mode: %s\r\n", getLteProfile(LteMode)->Name);
+
+	return XST_SUCCESS;
+}
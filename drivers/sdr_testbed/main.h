@@ -20,6 +20,7 @@
 #define LTE_MODE LTE5
 
 #undef DEBUG_OCCUPANCY
+#undef DEBUG_ROE_REGS
 
 /*
  * Enable flow control in the RoE cpri2ethernet module.
@@ -29,5 +30,22 @@
 */
 #define ROE_FLOW_CONTROL 0
 
+/*
+ * Latency budget (packetization and serialization) within which the number of
+ * CPRI BFs per Ethernet packet is chosen
+ */
+#define ROE_LATENCY_BUDGET_NS 10000
+
+/*
+ * Send RoE status and radio telemetry reports over the fronthaul, on the
+ * metrics streams of the demux (see roe_metrics.h), instead of polling the
+ * UART. Requires the AXI Timer and the AXI Ethernet (initAxiEthernet()).
+ */
+#define ROE_METRICS 0
+
+/************************** Function Prototypes *****************************/
+
+int selectLteMode(int LteMode);
+
 
 #endif /* CPRI_EMULATION_H_ */
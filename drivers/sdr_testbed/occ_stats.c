@@ -0,0 +1,216 @@
+/*
+ * occ_stats.c
+ *
+ * Streaming statistics of the RoE receive buffer: occupancy histogram,
+ * min/max/mean/standard deviation and percentiles, BF words lost and
+ * correction events.
+ *
+ * Samples are taken at a fixed rate by the polling loop, so the histogram
+ * gives the fraction of time spent at each occupancy. Taking a sample costs
+ * a few additions and one 32-bit multiplication (occupancies are below
+ * 2^16), and the percentiles are only computed when queried, by walking the
+ * histogram. Their resolution is one bin (the buffer depth over
+ * OCC_STATS_BINS words), within which they are interpolated, and they are
+ * clamped to the exact min/max.
+ *
+ * Only the C library is needed, so the statistics also run on the host.
+ */
+
+/***************************** Include Files *********************************/
+
+#include <string.h>
+#include "occ_stats.h"
+
+/*****************************************************************************/
+
+static uint32_t isqrt64(uint64_t x) {
+	uint64_t Bit = 1ULL << 62, y = 0;
+
+	while (Bit > x) {
+		Bit >>= 2;
+	}
+	while (Bit) {
+		if (x >= y + Bit) {
+			x -= y + Bit;
+			y = (y >> 1) + Bit;
+		} else {
+			y >>= 1;
+		}
+		Bit >>= 2;
+	}
+	return (uint32_t) y;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Sets the histogram for a buffer of Depth words and clears the statistics.
+ * BfWordsLost is the current value of the loss counter.
+ *
+ ******************************************************************************/
+void OccStats_init(OccStats *Stats, uint32_t Depth, uint32_t BfWordsLost) {
+	uint32_t Shift = 0;
+
+	while (((uint32_t) OCC_STATS_BINS << Shift) < Depth) {
+		Shift++;
+	}
+	Stats->BinShift = Shift;
+	OccStats_reset(Stats, BfWordsLost);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Clears the statistics. BfWordsLost is the current value of the loss
+ * counter.
+ *
+ ******************************************************************************/
+void OccStats_reset(OccStats *Stats, uint32_t BfWordsLost) {
+	uint32_t Shift = Stats->BinShift;
+
+	memset(Stats, 0, sizeof(*Stats));
+	Stats->BinShift = Shift;
+	Stats->Min = UINT32_MAX;
+	Stats->LastLost = BfWordsLost;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Accounts for one sample of the occupancy and of the loss counter.
+ *
+ ******************************************************************************/
+void OccStats_sample(OccStats *Stats, uint32_t Occupancy,
+		uint32_t BfWordsLost) {
+	uint32_t Bin = Occupancy >> Stats->BinShift;
+	uint32_t Lost = BfWordsLost - Stats->LastLost;
+
+	if (Bin >= OCC_STATS_BINS) {
+		Bin = OCC_STATS_BINS - 1;
+	}
+	Stats->Hist[Bin]++;
+	Stats->nSamples++;
+	Stats->Sum += Occupancy;
+	Stats->SumSq += Occupancy * Occupancy;
+	if (Occupancy < Stats->Min) {
+		Stats->Min = Occupancy;
+	}
+	if (Occupancy > Stats->Max) {
+		Stats->Max = Occupancy;
+	}
+
+	Stats->LastLost = BfWordsLost;
+	if (Lost) {
+		uint32_t k = 0;
+
+		while (k < OCC_STATS_LOSS_BINS - 1 && (Lost >> (k + 1))) {
+			k++;
+		}
+		Stats->LossHist[k]++;
+		Stats->WordsLost += Lost;
+		Stats->nLossSamples++;
+		if (Lost > Stats->MaxLoss) {
+			Stats->MaxLoss = Lost;
+		}
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Counts an occupancy interrupt, by correction code.
+ *
+ ******************************************************************************/
+void OccStats_correction(OccStats *Stats, uint32_t Code) {
+	Stats->nCodes[Code % OCC_STATS_CODES]++;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Counts a clock frequency step (Direction > 0 to increase, < 0 to
+ * decrease).
+ *
+ ******************************************************************************/
+void OccStats_step(OccStats *Stats, int Direction) {
+	if (Direction > 0) {
+		Stats->nIncrease++;
+	} else if (Direction < 0) {
+		Stats->nDecrease++;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Occupancy below which PerMille / 1000 of the samples lie, interpolated
+ * within its histogram bin.
+ *
+ * Returns 0 if there are no samples.
+ *
+ ******************************************************************************/
+uint32_t OccStats_percentile(const OccStats *Stats, uint32_t PerMille) {
+	uint64_t Target, Below = 0;
+	uint32_t Bin, Value;
+
+	if (Stats->nSamples == 0) {
+		return 0;
+	}
+	if (PerMille > 1000) {
+		PerMille = 1000;
+	}
+	/* Rank of the sample, rounded up (at least the first one) */
+	Target = ((uint64_t) Stats->nSamples * PerMille + 999) / 1000;
+	if (Target == 0) {
+		Target = 1;
+	}
+
+	for (Bin = 0; Bin < OCC_STATS_BINS - 1; Bin++) {
+		if (Below + Stats->Hist[Bin] >= Target) {
+			break;
+		}
+		Below += Stats->Hist[Bin];
+	}
+
+	/* Samples spread evenly over the bin */
+	Value = (Bin << Stats->BinShift) + (uint32_t) (((Target - Below)
+			<< Stats->BinShift) / Stats->Hist[Bin]);
+	if (Value < Stats->Min) {
+		Value = Stats->Min;
+	}
+	if (Value > Stats->Max) {
+		Value = Stats->Max;
+	}
+	return Value;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Summary of the occupancy statistics.
+ *
+ ******************************************************************************/
+void OccStats_summarize(const OccStats *Stats, OccStatsSummary *Summary) {
+	memset(Summary, 0, sizeof(*Summary));
+	Summary->nSamples = Stats->nSamples;
+	if (Stats->nSamples == 0) {
+		return;
+	}
+
+	Summary->Min = Stats->Min;
+	Summary->Max = Stats->Max;
+	Summary->MeanQ8 = (uint32_t) ((Stats->Sum << 8) / Stats->nSamples);
+	/* Variance (Q16): E[x^2] - E[x]^2, without overflowing SumSq << 16 */
+	{
+		uint64_t MeanSqQ16 = ((Stats->SumSq / Stats->nSamples) << 16)
+				+ ((Stats->SumSq % Stats->nSamples) << 16) / Stats->nSamples;
+		uint64_t SqMeanQ16 = (uint64_t) Summary->MeanQ8 * Summary->MeanQ8;
+
+		Summary->StdQ8 = isqrt64((MeanSqQ16 > SqMeanQ16) ?
+				MeanSqQ16 - SqMeanQ16 : 0);
+	}
+	Summary->P1 = OccStats_percentile(Stats, 10);
+	Summary->P50 = OccStats_percentile(Stats, 500);
+	Summary->P99 = OccStats_percentile(Stats, 990);
+	Summary->P999 = OccStats_percentile(Stats, 999);
+}
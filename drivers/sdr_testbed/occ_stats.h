@@ -0,0 +1,77 @@
+/*
+ * occ_stats.h
+ */
+
+#ifndef OCC_STATS_H_
+#define OCC_STATS_H_
+
+#include <stdint.h>
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Bins of the occupancy histogram (the bin width is a power of two, so that
+ * the buffer depth fits), and of the loss histogram (bin k counts the
+ * sampling intervals that lost 2^k to 2^(k+1) - 1 words)
+ */
+#define OCC_STATS_BINS			256
+#define OCC_STATS_LOSS_BINS		16
+
+/*
+ * Correction codes of the occupancy interrupt (register 0x40B, bits 31:29)
+ */
+#define OCC_STATS_CODES			8
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * Streaming statistics of the RoE receive buffer, since the last reset.
+ * Occupancies are in words. BF words lost are taken from the cumulative
+ * counter (register 0x401), as differences between samples.
+ */
+typedef struct {
+	uint32_t BinShift;			/* log2 of the words per bin */
+	uint32_t nSamples;
+	uint32_t Min;
+	uint32_t Max;
+	uint64_t Sum;
+	uint64_t SumSq;
+	uint32_t Hist[OCC_STATS_BINS];
+	/* Loss */
+	uint32_t LastLost;			/* Counter at the previous sample */
+	uint64_t WordsLost;
+	uint32_t nLossSamples;		/* Sampling intervals with loss */
+	uint32_t MaxLoss;			/* Largest loss in one interval */
+	uint32_t LossHist[OCC_STATS_LOSS_BINS];
+	/* Corrections */
+	uint32_t nCodes[OCC_STATS_CODES];	/* Occupancy interrupts, by code */
+	uint32_t nIncrease;			/* Clock frequency steps */
+	uint32_t nDecrease;
+} OccStats;
+
+/*
+ * Summary, with the percentiles interpolated within the histogram bins
+ */
+typedef struct {
+	uint32_t nSamples;
+	uint32_t Min;
+	uint32_t Max;
+	uint32_t MeanQ8;
+	uint32_t StdQ8;				/* Standard deviation */
+	uint32_t P1;				/* 1st percentile */
+	uint32_t P50;
+	uint32_t P99;
+	uint32_t P999;				/* 99.9th percentile */
+} OccStatsSummary;
+
+/************************** Function Prototypes *****************************/
+void OccStats_init(OccStats *Stats, uint32_t Depth, uint32_t BfWordsLost);
+void OccStats_reset(OccStats *Stats, uint32_t BfWordsLost);
+void OccStats_sample(OccStats *Stats, uint32_t Occupancy,
+		uint32_t BfWordsLost);
+void OccStats_correction(OccStats *Stats, uint32_t Code);
+void OccStats_step(OccStats *Stats, int Direction);
+uint32_t OccStats_percentile(const OccStats *Stats, uint32_t PerMille);
+void OccStats_summarize(const OccStats *Stats, OccStatsSummary *Summary);
+
+#endif /* OCC_STATS_H_ */
@@ -0,0 +1,228 @@
+/*
+ * occupancy_ctrl.c
+ *
+ * Proportional-integral clock recovery from the occupancy of the RoE receive
+ * buffer (RRU side, buffer-based synchronization).
+ *
+ * The buffer is written at the rate of the remote (BBU) clock and read at the
+ * rate of the local CPRI clock, so its occupancy integrates their frequency
+ * offset. The controller averages occupancy samples over each update period,
+ * then computes a frequency correction (ppb) from the error to the setpoint:
+ *
+ *   u = Kp * e + Ki * sum(e)
+ *
+ * The integral term converges to the offset between both clocks, which
+ * brings the occupancy back to the setpoint instead of letting it oscillate
+ * between two thresholds. It is clamped, and frozen while the output is
+ * ahead of what the clock can follow (anti-windup).
+ *
+ * The clock is only adjustable in fixed steps, so the output is quantized:
+ * one step is requested when it moves more than half a step (plus some
+ * hysteresis) away from the current correction, and no further step is
+ * requested until the clock has settled.
+ *
+ * Only the C library is needed, so the controller also runs on the host.
+ */
+
+/***************************** Include Files *********************************/
+
+#include <string.h>
+#include "occupancy_ctrl.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * 2 * pi in Q16, and twice the damping factor (0.707) in Q7
+ */
+#define TWO_PI_Q16				411775
+#define TWO_ZETA_Q7				181
+
+/*****************************************************************************/
+/*
+ *
+ * Sets the gains for a loop with a damping factor of 0.707 and the
+ * given natural frequency, in mHz. The buffer occupancy drifts by WordRate
+ * words per second per unit of relative frequency offset, and the controller
+ * is updated every PeriodUs. The other parameters are left untouched.
+ *
+ ******************************************************************************/
+void OccCtrl_design(OccCtrlConfig *Config, uint32_t WordRate,
+		uint32_t PeriodUs, uint32_t BandwidthMhz) {
+	/* Natural angular frequency (rad/s, Q16) and its square (Q16) */
+	int64_t WnQ16 = (int64_t) BandwidthMhz * TWO_PI_Q16 / 1000;
+	int64_t Wn2Q16 = (WnQ16 * WnQ16) >> 16;
+
+	/*
+	 * Occupancy error dynamics: de/dt = -G * u, with G = WordRate * 1e-9
+	 * words/s per ppb. The closed loop is s^2 + G Kp s + G Ki = 0, hence
+	 * Kp = 2 zeta wn / G, and Ki = wn^2 / G per second.
+	 */
+	Config->KpQ16 = (int32_t) (WnQ16 * TWO_ZETA_Q7 / 128 * 1000000000LL
+			/ WordRate);
+	Config->KiQ16 = (int32_t) (Wn2Q16 * PeriodUs * 1000LL / WordRate);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Starts the controller at the nominal clock frequency.
+ *
+ ******************************************************************************/
+void OccCtrl_init(OccCtrlState *State, const OccCtrlConfig *Config) {
+	memset(State, 0, sizeof(*State));
+	State->Config = *Config;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Accumulates one occupancy sample, averaged at the next update.
+ *
+ ******************************************************************************/
+void OccCtrl_sample(OccCtrlState *State, uint32_t Occupancy) {
+	State->SampleSum += Occupancy;
+	State->nSamples++;
+}
+
+static void updateStats(OccCtrlState *State, int32_t ErrorQ8) {
+	const OccCtrlConfig *Config = &State->Config;
+	uint32_t AbsQ8 = (uint32_t) ((ErrorQ8 < 0) ? -ErrorQ8 : ErrorQ8);
+
+	if (State->ConvergedAt == 0) {
+		if (AbsQ8 > (Config->ConvergedBand << 8)) {
+			State->InBand = 0;
+			return;
+		}
+		if (++State->InBand < Config->ConvergedUpdates) {
+			return;
+		}
+		State->ConvergedAt = State->nUpdates - State->InBand + 1;
+	}
+
+	State->nSteady++;
+	State->SteadySumQ8 += ErrorQ8;
+	State->SteadySumSqQ16 += (uint64_t) ((int64_t) ErrorQ8 * ErrorQ8);
+	if (AbsQ8 > State->SteadyPeakQ8) {
+		State->SteadyPeakQ8 = AbsQ8;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Runs the controller on the samples accumulated since the previous update.
+ * Call it once per update period (the period of the gains).
+ *
+ * Returns OCC_CTRL_INCREASE or OCC_CTRL_DECREASE when the clock must be
+ * adjusted by one step, OCC_CTRL_HOLD otherwise.
+ *
+ ******************************************************************************/
+int OccCtrl_update(OccCtrlState *State) {
+	const OccCtrlConfig *Config = &State->Config;
+	int64_t Limit = (int64_t) Config->IntegralLimitPpb << 16;
+	int64_t PropQ16;
+	int32_t ErrorQ8, Current, Threshold, Ahead;
+
+	if (State->nSamples == 0) {
+		return OCC_CTRL_HOLD;
+	}
+
+	ErrorQ8 = (int32_t) ((State->SampleSum << 8) / State->nSamples)
+			- (int32_t) (Config->Setpoint << 8);
+	State->SampleSum = 0;
+	State->nSamples = 0;
+	State->ErrorQ8 = ErrorQ8;
+	State->nUpdates++;
+
+	/*
+	 * Anti-windup: do not integrate while the output is ahead of the clock
+	 * (at the end of its pull range, or waiting for it to settle), in the
+	 * direction of the error
+	 */
+	Current = State->Steps * Config->StepPpb;
+	Threshold = Config->StepPpb / 2 + Config->HysteresisPpb;
+	PropQ16 = ((int64_t) Config->KpQ16 * ErrorQ8) >> 8;
+	Ahead = (int32_t) ((PropQ16 + State->IntegralQ16) >> 16) - Current;
+
+	if (!(Ahead > Threshold && ErrorQ8 > 0)
+			&& !(Ahead < -Threshold && ErrorQ8 < 0)) {
+		State->IntegralQ16 += ((int64_t) Config->KiQ16 * ErrorQ8) >> 8;
+		if (State->IntegralQ16 > Limit) {
+			State->IntegralQ16 = Limit;
+		} else if (State->IntegralQ16 < -Limit) {
+			State->IntegralQ16 = -Limit;
+		}
+	}
+
+	State->OutputPpb = (int32_t) ((PropQ16 + State->IntegralQ16) >> 16);
+
+	updateStats(State, ErrorQ8);
+
+	if (State->Hold) {
+		State->Hold--;
+		return OCC_CTRL_HOLD;
+	}
+
+	/* Quantize to clock steps, with hysteresis against chattering */
+	if (State->OutputPpb > Current + Threshold
+			&& State->Steps < Config->MaxSteps) {
+		State->Steps++;
+		State->nIncrease++;
+		State->Hold = Config->HoldUpdates;
+		return OCC_CTRL_INCREASE;
+	}
+	if (State->OutputPpb < Current - Threshold
+			&& State->Steps > -Config->MaxSteps) {
+		State->Steps--;
+		State->nDecrease++;
+		State->Hold = Config->HoldUpdates;
+		return OCC_CTRL_DECREASE;
+	}
+
+	return OCC_CTRL_HOLD;
+}
+
+static uint32_t isqrt64(uint64_t x) {
+	uint64_t Bit = 1ULL << 62, y = 0;
+
+	while (Bit > x) {
+		Bit >>= 2;
+	}
+	while (Bit) {
+		if (x >= y + Bit) {
+			x -= y + Bit;
+			y = (y >> 1) + Bit;
+		} else {
+			y >>= 1;
+		}
+		Bit >>= 2;
+	}
+	return (uint32_t) y;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Convergence time and steady-state jitter of the occupancy so far.
+ *
+ ******************************************************************************/
+void OccCtrl_getStats(const OccCtrlState *State, OccCtrlStats *Stats) {
+	Stats->Converged = (State->ConvergedAt != 0);
+	Stats->ConvergenceUpdates = State->ConvergedAt;
+	Stats->nSteady = State->nSteady;
+	Stats->MeanErrorQ8 = 0;
+	Stats->RmsJitterQ8 = 0;
+	Stats->PeakErrorQ8 = State->SteadyPeakQ8;
+	Stats->FreqOffsetPpb = State->Steps * State->Config.StepPpb;
+	Stats->nIncrease = State->nIncrease;
+	Stats->nDecrease = State->nDecrease;
+
+	if (State->nSteady) {
+		int64_t Mean = State->SteadySumQ8 / (int64_t) State->nSteady;
+		uint64_t MeanSq = State->SteadySumSqQ16 / State->nSteady;
+		uint64_t Sq = (uint64_t) (Mean * Mean);
+
+		Stats->MeanErrorQ8 = (int32_t) Mean;
+		Stats->RmsJitterQ8 = isqrt64((MeanSq > Sq) ? MeanSq - Sq : 0);
+	}
+}
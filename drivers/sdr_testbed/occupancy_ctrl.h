@@ -0,0 +1,87 @@
+/*
+ * occupancy_ctrl.h
+ */
+
+#ifndef OCCUPANCY_CTRL_H_
+#define OCCUPANCY_CTRL_H_
+
+#include <stdint.h>
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Frequency step requested by OccCtrl_update()
+ */
+#define OCC_CTRL_HOLD			0
+#define OCC_CTRL_INCREASE		1		/* Buffer filling: read faster */
+#define OCC_CTRL_DECREASE		-1		/* Buffer emptying: read slower */
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * Controller parameters. Occupancies and errors are in 32-bit words of the
+ * RoE receive buffer, frequencies in ppb of the CPRI (read) clock. Gains are
+ * Q16: KpQ16 in ppb per word, KiQ16 in ppb per word per update.
+ */
+typedef struct {
+	uint32_t Setpoint;			/* Target occupancy */
+	int32_t KpQ16;
+	int32_t KiQ16;
+	int32_t IntegralLimitPpb;	/* Anti-windup clamp of the integral term */
+	int32_t StepPpb;			/* Frequency change of one clock adjustment */
+	int32_t HysteresisPpb;		/* Beyond half a step, before stepping */
+	int32_t MaxSteps;			/* Pull range, in steps from the nominal */
+	uint32_t HoldUpdates;		/* Clock settling time after a step */
+	uint32_t ConvergedBand;		/* |Error| considered converged (words) */
+	uint32_t ConvergedUpdates;	/* Consecutive updates within the band */
+} OccCtrlConfig;
+
+/*
+ * Controller state. Errors are Q8 words.
+ */
+typedef struct {
+	OccCtrlConfig Config;
+	int64_t SampleSum;			/* Occupancy samples since the last update */
+	uint32_t nSamples;
+	int64_t IntegralQ16;		/* ppb, Q16 */
+	int32_t OutputPpb;			/* Last unquantized output */
+	int32_t Steps;				/* Clock steps applied, from the nominal */
+	uint32_t Hold;				/* Updates left before the next step */
+	int32_t ErrorQ8;			/* Last averaged occupancy error */
+
+	/* Statistics */
+	uint32_t nUpdates;
+	uint32_t nIncrease;
+	uint32_t nDecrease;
+	uint32_t InBand;			/* Consecutive updates within the band */
+	uint32_t ConvergedAt;		/* Update that entered the band, 0: never */
+	uint32_t nSteady;			/* Updates since convergence */
+	int64_t SteadySumQ8;
+	uint64_t SteadySumSqQ16;
+	uint32_t SteadyPeakQ8;
+} OccCtrlState;
+
+/*
+ * Convergence and steady-state jitter (after convergence) of the occupancy
+ */
+typedef struct {
+	uint32_t Converged;
+	uint32_t ConvergenceUpdates;
+	uint32_t nSteady;			/* Updates in the jitter statistics */
+	int32_t MeanErrorQ8;
+	uint32_t RmsJitterQ8;		/* Standard deviation of the error */
+	uint32_t PeakErrorQ8;		/* Largest |error| */
+	int32_t FreqOffsetPpb;		/* Applied correction (Steps * StepPpb) */
+	uint32_t nIncrease;
+	uint32_t nDecrease;
+} OccCtrlStats;
+
+/************************** Function Prototypes *****************************/
+void OccCtrl_design(OccCtrlConfig *Config, uint32_t WordRate,
+		uint32_t PeriodUs, uint32_t BandwidthMhz);
+void OccCtrl_init(OccCtrlState *State, const OccCtrlConfig *Config);
+void OccCtrl_sample(OccCtrlState *State, uint32_t Occupancy);
+int OccCtrl_update(OccCtrlState *State);
+void OccCtrl_getStats(const OccCtrlState *State, OccCtrlStats *Stats);
+
+#endif /* OCCUPANCY_CTRL_H_ */
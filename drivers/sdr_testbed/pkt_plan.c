@@ -0,0 +1,122 @@
+/*
+ * pkt_plan.c
+ *
+ * Choice of the number of CPRI BFs per Ethernet packet.
+ *
+ * Each packet pays a fixed framing overhead (MAC header, FCS, preamble and
+ * inter-frame gap: 38 bytes), so the link efficiency grows with the number of
+ * BFs per packet. On the other hand, the first BF of a packet waits for the
+ * last one before the packet leaves, so the packetization delay grows with it
+ * too (one chip period, 260.4 ns, per BF). The planner picks the most
+ * efficient packetization whose latency (packetization plus serialization)
+ * fits the budget, the link capacity and the Ethernet payload.
+ *
+ * Only the C library is needed, so the planner also runs on the host (see
+ * "tools/pkt_plan").
+ */
+
+/***************************** Include Files *********************************/
+
+#include <string.h>
+#include "pkt_plan.h"
+
+/*****************************************************************************/
+/*
+ *
+ * Payload bytes of one BF, after compression.
+ *
+ * Returns 0 if the AxCs do not fit a BF of the line rate option.
+ *
+ ******************************************************************************/
+uint32_t PktPlan_bfBytes(const PktPlanConfig *Config) {
+	uint32_t Bytes = Config->nAxc * PKT_PLAN_AXC_BYTES;
+
+	if (Config->nAxc == 0 || Config->nAxc > 4 * Config->LineRate
+			|| Config->CompressionQ8 < 256) {
+		return 0;
+	}
+	return (Bytes * 256 + Config->CompressionQ8 - 1) / Config->CompressionQ8;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Packetization with BfsPerPkt BFs per packet.
+ *
+ * Returns 0 if it fits the latency budget and the link, 1 if it does not
+ * (the plan is still filled), and -1 if the BFs do not fit a packet.
+ *
+ ******************************************************************************/
+int PktPlan_evaluate(PktPlan *Plan, const PktPlanConfig *Config,
+		uint32_t BfsPerPkt) {
+	uint32_t BfBytes = PktPlan_bfBytes(Config);
+	uint32_t Frame;
+	uint64_t LatencyNs;
+
+	memset(Plan, 0, sizeof(*Plan));
+
+	if (BfBytes == 0 || BfsPerPkt == 0 || BfsPerPkt > PKT_PLAN_MAX_BFS
+			|| BfsPerPkt * BfBytes > FLOW_CTRL_MAX_PAYLOAD
+			|| Config->ChipRate == 0 || Config->LinkMbps == 0) {
+		return -1;
+	}
+	if (FlowCtrl_plan(&Plan->FlowCtrl, BfsPerPkt, Config->ChipRate,
+			Config->AxiClkHz) != 0) {
+		return -1;
+	}
+
+	Plan->BfsPerPkt = BfsPerPkt;
+	Plan->PayloadBytes = BfsPerPkt * BfBytes;
+
+	Frame = PKT_PLAN_MAC_HEADER + Plan->PayloadBytes;
+	if (Frame < PKT_PLAN_MIN_FRAME) {
+		Frame = PKT_PLAN_MIN_FRAME;
+	}
+	Plan->WireBytes = Frame + PKT_PLAN_FCS + PKT_PLAN_PREAMBLE + PKT_PLAN_IFG;
+
+	Plan->EfficiencyPpm = (uint32_t) ((uint64_t) Plan->PayloadBytes * 1000000
+			/ Plan->WireBytes);
+	Plan->LinkLoadPpm = (uint32_t) ((uint64_t) Plan->WireBytes * 8
+			* Config->ChipRate / ((uint64_t) BfsPerPkt * Config->LinkMbps));
+
+	LatencyNs = (uint64_t) BfsPerPkt * 1000000000 / Config->ChipRate
+			+ (uint64_t) Plan->WireBytes * 8000 / Config->LinkMbps;
+	Plan->LatencyNs = (LatencyNs > UINT32_MAX) ? UINT32_MAX
+			: (uint32_t) LatencyNs;
+
+	if (Plan->LatencyNs > Config->LatencyBudgetNs
+			|| Plan->LinkLoadPpm > 1000000) {
+		return 1;
+	}
+	return 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Picks the number of BFs per packet that maximizes the link efficiency
+ * within the latency budget (the smallest one, among equally efficient).
+ *
+ * Returns 0 on success, -1 if no packetization fits.
+ *
+ ******************************************************************************/
+int PktPlan_choose(PktPlan *Plan, const PktPlanConfig *Config) {
+	PktPlan Candidate;
+	uint32_t Bfs;
+	int Found = 0;
+
+	for (Bfs = 1; Bfs <= PKT_PLAN_MAX_BFS; Bfs++) {
+		int Status = PktPlan_evaluate(&Candidate, Config, Bfs);
+
+		if (Status < 0) {
+			break;
+		}
+		if (Status == 0 && (!Found
+				|| Candidate.EfficiencyPpm > Plan->EfficiencyPpm)) {
+			*Plan = Candidate;
+			Found = 1;
+		}
+	}
+
+	return Found ? 0 : -1;
+}
@@ -0,0 +1,67 @@
+/*
+ * pkt_plan.h
+ */
+
+#ifndef PKT_PLAN_H_
+#define PKT_PLAN_H_
+
+#include <stdint.h>
+#include "flow_ctrl.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Ethernet framing, in bytes: MAC header (untagged), FCS, preamble and SFD,
+ * inter-frame gap, and smallest frame (without the FCS)
+ */
+#define PKT_PLAN_MAC_HEADER		14
+#define PKT_PLAN_FCS			4
+#define PKT_PLAN_PREAMBLE		8
+#define PKT_PLAN_IFG			12
+#define PKT_PLAN_MIN_FRAME		60
+
+/*
+ * Bytes of one AxC container in a BF (16-bit I and Q), and largest number of
+ * BFs per packet (register 0x403 is 8 bits wide)
+ */
+#define PKT_PLAN_AXC_BYTES		4
+#define PKT_PLAN_MAX_BFS		255
+
+#define PKT_PLAN_LINK_1000BASE_T	1000
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * Fronthaul stream to be packetized. The cpri2ethernet core packs whole,
+ * uncompressed BFs, i.e. 4 * LineRate AxCs and a CompressionQ8 of 256.
+ */
+typedef struct {
+	uint32_t LineRate;			/* CPRI line rate option */
+	uint32_t nAxc;				/* AxC containers carried per BF */
+	uint32_t CompressionQ8;		/* Compression ratio, Q8 (256 for none) */
+	uint32_t LatencyBudgetNs;	/* Packetization + serialization */
+	uint32_t LinkMbps;			/* Ethernet link rate */
+	uint32_t ChipRate;			/* BF rate (Hz) */
+	uint32_t AxiClkHz;			/* Clock of the flow control */
+} PktPlanConfig;
+
+/*
+ * Packetization of the stream with a given number of BFs per packet
+ */
+typedef struct {
+	uint32_t BfsPerPkt;
+	uint32_t PayloadBytes;
+	uint32_t WireBytes;			/* Including the framing overhead */
+	uint32_t EfficiencyPpm;		/* Payload / wire bytes */
+	uint32_t LinkLoadPpm;		/* Wire rate / link rate */
+	uint32_t LatencyNs;			/* Packetization + serialization */
+	FlowCtrlPlan FlowCtrl;
+} PktPlan;
+
+/************************** Function Prototypes *****************************/
+uint32_t PktPlan_bfBytes(const PktPlanConfig *Config);
+int PktPlan_evaluate(PktPlan *Plan, const PktPlanConfig *Config,
+		uint32_t BfsPerPkt);
+int PktPlan_choose(PktPlan *Plan, const PktPlanConfig *Config);
+
+#endif /* PKT_PLAN_H_ */
@@ -14,6 +14,22 @@
 #include "clock.h"
 #include "xil_io.h"
 #include "microblaze_sleep.h"
+#include "timestamp.h"
+#include "occupancy_ctrl.h"
+#include "flow_ctrl.h"
+#include "pkt_plan.h"
+#include "roe_metrics.h"
+#include "trace_log.h"
+#include "occ_stats.h"
+#include "dma_driver.h"
+#if ROE_METRICS
+#include <string.h>
+#include "xllfifo.h"
+#include "ad9361_api.h"
+#endif
+#if defined(STDIN_BASEADDRESS) && defined(XPAR_XUARTLITE_NUM_INSTANCES)
+#include "xuartlite_l.h"
+#endif
 
 /******************* Constant and Parameter Definitions **********************/
 
@@ -24,10 +40,11 @@
 #define LINE_RATE_OPTION_2 			2
 
 /*
- * Enable clock control through polling of occupancy.
- * Otherwise, only interrupts are used to control the clock.
+ * Enable clock control through polling of occupancy (PI controller, which
+ * requires the AXI Timer). Otherwise, only interrupts are used to control the
+ * clock.
  */
-#define POLL_CLK_CONTROL 			1
+#define POLL_CLK_CONTROL 			TIMESTAMP_AVAILABLE
 /*
  * CPRI Line Rate option
  * Currently (for 1G Ethernet), only line rates 1 and 2 are supported
@@ -41,15 +58,80 @@
 // RoE Rx Occupancy Interrupt
 #define ROE_INTR_ID	  XPAR_MICROBLAZE_0_AXI_INTC_RADIO_OVER_ETHERNET_0_INTERRUPT_INTR
 
-// Packet/Buffer lengths
+// Packet/Buffer lengths (BFs per packet unless planned by RoE_planPacketSize)
 #define BFs_PER_PKT 				16
 #define BUFFER_DEPTH 				8192
 #define BUFFER_CENTER				BUFFER_DEPTH/2
-#define N_32BIT_WORDS_PER_PKT 		BFs_PER_PKT * (LINE_RATE_OPTION*8*16) / 32
+#define N_32BIT_WORDS_PER_BF 		((LINE_RATE_OPTION*8*16) / 32)
+#define N_32BIT_WORDS_PER_PKT 		BFs_PER_PKT * N_32BIT_WORDS_PER_BF
+
+// CPRI BF (chip) rate, and words written to (and read from) the buffer per
+// second
+#define CPRI_CHIP_RATE 				3840000
+#define CPRI_WORD_RATE 				(CPRI_CHIP_RATE * LINE_RATE_OPTION * 4)
+
+// AXI clock of the RoE core, which times the flow control
+#define ROE_AXI_CLK_HZ 				100000000
 
-// Thresholds for poll-based control
-#define TF0 	N_32BIT_WORDS_PER_PKT
-#define TE0 	-N_32BIT_WORDS_PER_PKT
+// Pairs of packets per flow control dither slot
+#define FLOW_CTRL_DITHER_PAIRS 		256
+
+/*
+ * Poll-based clock control (see occupancy_ctrl.c)
+ *
+ * CLK_CTRL_STEP_PPB is not set by the controller: it must be the frequency
+ * step that one adjustFreq() call applies to the CPRI clock, as configured in
+ * the clock driver (clock.c, built with this firmware but not part of this
+ * tree). The controller converts its output into steps of this size, so a
+ * mismatch scales the loop gain (and the reported frequency offset).
+ *
+ * Supported clock offsets, from "tools/roe_clk_sim" with the Si5324 and the
+ * defaults below (LINE_RATE_OPTION 1, BUFFER_DEPTH 8192, 5 runs of 30 s,
+ * e.g. "roe_clk_sim -j 10 -r 5 -s ppm=-90:90:10"), without any underflow or
+ * overflow:
+ *
+ *   mean PDV    RRU clock offset
+ *      5 us     -70 to +60 ppm
+ *     10 us     -70 to +50 ppm
+ *     15 us     -70 to +40 ppm
+ *     20 us     none: the PDV alone underflows the half buffer (4096 words)
+ *
+ * Beyond that, the buffer drains or fills while the controller steps one
+ * CLK_CTRL_SETTLE_US hold at a time, before it converges.
+ */
+#define CLK_CTRL_PERIOD_US 			10000	// Controller update period
+#define CLK_CTRL_BANDWIDTH_MHZ 		200		// Loop natural frequency (mHz)
+#define CLK_CTRL_STEP_PPB 			1000	// Must match adjustFreq() (clock.c)
+#define CLK_CTRL_HYSTERESIS_PPB 	250
+#define CLK_CTRL_MAX_STEPS 			100		// Pull range of the clock
+#define CLK_CTRL_LOG_INTERVAL_US 	1000000
+#if SI_5324
+#define CLK_CTRL_SETTLE_US 			70000	// Lock of a new Si5324 configuration
+#else
+#define CLK_CTRL_SETTLE_US 			0
+#endif
+
+/*
+ * Metrics reports sent over the fronthaul (see roe_metrics.h)
+ */
+#define METRICS_PERIOD_US 			100000	// Status report period
+#define METRICS_TELEMETRY_EVERY 	10		// Status reports per telemetry one
+
+/*
+ * Occupancy statistics (see occ_stats.c)
+ */
+#define OCC_STATS_PERIOD_US 		1000	// Sampling period
+
+// Console commands are read from the UART Lite of stdin, when there is one
+#if defined(STDIN_BASEADDRESS) && defined(XPAR_XUARTLITE_NUM_INSTANCES)
+#define ROE_CONSOLE 				1
+#else
+#define ROE_CONSOLE 				0
+#endif
+
+// Trace events printed per iteration of the polling loop (a line takes about
+// 3 ms at 115200 baud)
+#define TRACE_DRAIN_BATCH 			1
 
 #define CPRI2ETHERNET_ENABLE 	0x00000001
 #define FLOW_CONTROL_ENABLE 	0x00000002
@@ -70,6 +152,10 @@
 /************************** Variable Definitions ****************************/
 
 extern struct clock * clock;
+#if ROE_METRICS
+extern XLlFifo FifoInstance;
+extern struct ad9361_rf_phy *ad9361_phy;
+#endif
 
 volatile static int nFullInterrupts = 0;
 volatile static int nEmptyInterrupts = 0;
@@ -86,14 +172,58 @@ static u32 interruptInfo;
 static u8 correctionCode;
 static u16 occupancy, transitionCount;
 
+#if RRU_MODE && SYNC_MODE == BUFFER_BASED && POLL_CLK_CONTROL
+static OccCtrlState clkCtrl;
+#endif
+
+static u8 bfsPerPkt = BFs_PER_PKT;
+
+static FlowCtrlDither flowCtrlDither;
+static u8 flowCtrlDithering = 0;
+static u32 flowCtrlSlotEnd;
+static u32 flowCtrlLastWrite;
+
+#if ROE_METRICS && TIMESTAMP_AVAILABLE
+static RoeMetricsHeader metricsStatusHeader, metricsTelemetryHeader;
+static RoeMetricsStatus metricsStatus;
+static u32 metricsLast, metricsTimeUs;
+static u8 metricsReports;
+#endif
+
+static OccStats occStats;
+#if TIMESTAMP_AVAILABLE
+static u32 occStatsNext;
+#endif
+
 /************************** Function Prototypes *****************************/
 
 void RoE_reset();
+int RoE_planPacketSize(u32);
 void RoE_initCpri2Ethernet(u8);
 void RoE_initCpriEmulator();
 void RoE_configEthFlowControl(u8);
 void RoE_disableCpri2Ethernet();
 void RoE_pollStatus();
+void RoE_ditherFlowControl();
+void RoE_sendMetrics();
+void RoE_sampleOccStats();
+void RoE_printOccStats();
+void RoE_exportOccStats();
+
+/*******************************************************************************
+ * Write a RoE register
+ *
+ * With DEBUG_ROE_REGS, the write is also printed as "roe_reg <offset> <value>"
+ * (hex), so that a console log of the configuration can be replayed by the
+ * host model of the RoE (tools/roe_model).
+ *
+ ******************************************************************************/
+static void RoE_writeReg(u32 offset, u32 value) {
+	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + offset, value);
+#ifdef DEBUG_ROE_REGS
+	xil_printf("\r\nroe_reg %x %x", offset, value);
+#endif
+}
 
 /*******************************************************************************
  * 	Reset RoE
@@ -103,7 +233,51 @@ void RoE_pollStatus();
  *
  ******************************************************************************/
 void RoE_reset() {
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x0, 0); //RESET
+	RoE_writeReg(0x0, 0); //RESET
+}
+
+/*******************************************************************************
+ * Plan the packet size
+ *
+ * Picks the number of CPRI BFs per Ethernet packet that maximizes the
+ * efficiency of the 1000BASE-T link, while the packetization and
+ * serialization delays fit the latency budget (see pkt_plan.c). The
+ * cpri2ethernet module packs whole, uncompressed BFs. The choice is applied
+ * by the next RoE_initCpri2Ethernet().
+ *
+ * @param	latencyBudgetNs is the latency budget, in ns.
+ *
+ * @return	XST_SUCCESS, or XST_FAILURE if no packet size fits the budget (the
+ *		previous one is kept).
+ *
+ ******************************************************************************/
+int RoE_planPacketSize(u32 latencyBudgetNs) {
+
+	PktPlanConfig config;
+	PktPlan plan;
+
+	config.LineRate = LINE_RATE_OPTION;
+	config.nAxc = 4 * LINE_RATE_OPTION;
+	config.CompressionQ8 = 256;
+	config.LatencyBudgetNs = latencyBudgetNs;
+	config.LinkMbps = PKT_PLAN_LINK_1000BASE_T;
+	config.ChipRate = CPRI_CHIP_RATE;
+	config.AxiClkHz = ROE_AXI_CLK_HZ;
+
+	if (PktPlan_choose(&plan, &config) != 0) {
+		xil_printf("\r\n Warning: no packet size fits %d ns", latencyBudgetNs);
+		xil_printf(", keeping %d BFs per packet\r\n", bfsPerPkt);
+		return XST_FAILURE;
+	}
+
+	bfsPerPkt = plan.BfsPerPkt;
+
+	xil_printf("\r\n %d BFs per packet: %d bytes, latency %d ns, ", bfsPerPkt,
+			plan.PayloadBytes, plan.LatencyNs);
+	xil_printf("efficiency %d ppm, link load %d ppm\r\n", plan.EfficiencyPpm,
+			plan.LinkLoadPpm);
+
+	return XST_SUCCESS;
 }
 
 /*******************************************************************************
@@ -176,22 +350,22 @@ void RoE_initCpri2Ethernet(u8 enFlowControl) {
 	/*
 	 * Number of BFs per Ethernet packet
 	 */
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x403, BFs_PER_PKT);
+	RoE_writeReg(0x403, bfsPerPkt);
 
 	/*
 	 * Source and Destiation MAC Addresses
 	 */
 	// MACSRC 4 bytes right
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x404, mac_addr_reg_0);
+	RoE_writeReg(0x404, mac_addr_reg_0);
 	// MACDEST 4 bytes right
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x405, mac_addr_reg_1);
+	RoE_writeReg(0x405, mac_addr_reg_1);
 	// MACSRC 2 bytes right MACDEST 2 bytes right:
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x406, mac_addr_reg_2);
+	RoE_writeReg(0x406, mac_addr_reg_2);
 
 	/*
 	 * Ethernet Type
 	 */
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x408, 0xCD);
+	RoE_writeReg(0x408, 0xCD);
 
 	/*
 	 * Operation control (opCtrl)
@@ -201,7 +375,7 @@ void RoE_initCpri2Ethernet(u8 enFlowControl) {
 	 */
 	if (enFlowControl) {
 
-		RoE_configEthFlowControl(BFs_PER_PKT);
+		RoE_configEthFlowControl(bfsPerPkt);
 
 		cpri2ethernetCfg |= FLOW_CONTROL_ENABLE;
 	}
@@ -209,7 +383,7 @@ void RoE_initCpri2Ethernet(u8 enFlowControl) {
 	cpri2ethernetCfg |= CPRI2ETHERNET_ENABLE; //Enable cpri2eth transmission
 
 	// Configure operation control (opCtrl) of cpri2ethernet module:
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x409, cpri2ethernetCfg);
+	RoE_writeReg(0x409, cpri2ethernetCfg);
 
 	// Wait until it is enabled
 	while ((Xil_In32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x409)
@@ -222,7 +396,7 @@ void RoE_initCpri2Ethernet(u8 enFlowControl) {
  ******************************************************************************/
 void RoE_disableCpri2Ethernet() {
 	xil_printf("\r\nDisabling CPRI");
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x409, 0);
+	RoE_writeReg(0x409, 0);
 }
 
 /*******************************************************************************
@@ -247,8 +421,7 @@ void RoE_setCpriControlWord() {
 	temp = Xil_In32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40A);
 
 	// Configure BF control word (16 MSB) and enable CPRI emulation (LSB):
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40A,
-			controlWord << 16 | (~CTRL_WORD_MASK & temp));
+	RoE_writeReg(0x40A, controlWord << 16 | (~CTRL_WORD_MASK & temp));
 
 	temp = Xil_In32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40A);
 
@@ -271,8 +444,393 @@ void RoE_initCpriEmulator() {
 	temp = Xil_In32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40A);
 
 	// Configure BF control word (16 MSB) and enable CPRI emulation (LSB):
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40A,
-			temp | CPRI_EMULATION_ENABLE);
+	RoE_writeReg(0x40A, temp | CPRI_EMULATION_ENABLE);
+}
+
+#if RRU_MODE && SYNC_MODE == BUFFER_BASED && POLL_CLK_CONTROL
+/*******************************************************************************
+ * Initialize the clock controller
+ *
+ * PI controller that keeps the RoE receive buffer occupancy at BUFFER_CENTER.
+ *
+ ******************************************************************************/
+static void RoE_initClkControl() {
+
+	OccCtrlConfig config;
+
+	config.Setpoint = BUFFER_CENTER;
+	config.IntegralLimitPpb = CLK_CTRL_MAX_STEPS * CLK_CTRL_STEP_PPB;
+	config.StepPpb = CLK_CTRL_STEP_PPB;
+	config.HysteresisPpb = CLK_CTRL_HYSTERESIS_PPB;
+	config.MaxSteps = CLK_CTRL_MAX_STEPS;
+	config.HoldUpdates = (CLK_CTRL_SETTLE_US + CLK_CTRL_PERIOD_US - 1)
+			/ CLK_CTRL_PERIOD_US;
+	// Converged within one packet (as planned) of the center for one second
+	config.ConvergedBand = bfsPerPkt * N_32BIT_WORDS_PER_BF;
+	config.ConvergedUpdates = 1000000 / CLK_CTRL_PERIOD_US;
+	OccCtrl_design(&config, CPRI_WORD_RATE, CLK_CTRL_PERIOD_US,
+			CLK_CTRL_BANDWIDTH_MHZ);
+
+	OccCtrl_init(&clkCtrl, &config);
+}
+
+/*******************************************************************************
+ * Log the clock controller status
+ *
+ * Occupancy error, applied frequency correction, convergence time and
+ * steady-state jitter of the occupancy (standard deviation and peak of the
+ * averaged error, in words).
+ *
+ ******************************************************************************/
+static void RoE_logClkControl() {
+
+	OccCtrlStats stats;
+
+	OccCtrl_getStats(&clkCtrl, &stats);
+
+	xil_printf("\r\nOcc_offset \t %d \t", clkCtrl.ErrorQ8 / 256);
+	xil_printf("Freq offset \t %d ppb \t", stats.FreqOffsetPpb);
+	xil_printf("Steps \t +%d -%d", stats.nIncrease, stats.nDecrease);
+
+	if (stats.Converged) {
+		xil_printf("\r\nConverged in %d ms \t",
+				stats.ConvergenceUpdates * (CLK_CTRL_PERIOD_US / 1000));
+		xil_printf("Jitter rms \t %d.%02d \t",
+				stats.RmsJitterQ8 >> 8, ((stats.RmsJitterQ8 & 0xFF) * 100) >> 8);
+		xil_printf("peak \t %d words", stats.PeakErrorQ8 >> 8);
+	}
+}
+#endif
+
+#if ROE_METRICS && TIMESTAMP_AVAILABLE
+/*******************************************************************************
+ * Initialize the metrics reports
+ *
+ * Reports go from the local MAC to the destination MAC of the fronthaul.
+ *
+ ******************************************************************************/
+static void RoE_initMetrics() {
+
+	int i;
+
+	for (i = 0; i < 6; i++) {
+		metricsStatusHeader.Src[i] = (u8) AxiEthernetMAC[i];
+		metricsStatusHeader.Dst[i] = (u8) destMAC[i];
+	}
+	metricsStatusHeader.Seq = 0;
+	metricsTelemetryHeader = metricsStatusHeader;
+
+	memset(&metricsStatus, 0, sizeof(metricsStatus));
+	metricsStatus.OccupancyMin = 0xFFFF;
+	metricsReports = 0;
+	metricsLast = getTimestamp();
+	metricsTimeUs = 0;
+}
+
+/*******************************************************************************
+ * Send a metrics frame
+ *
+ * Through the AXI FIFO of the Ethernet MAC. The frame is dropped rather than
+ * waiting for room in the FIFO: the receiver sees a gap in the sequence.
+ *
+ ******************************************************************************/
+static void RoE_sendMetricsFrame(const u32 *frame, u32 length) {
+
+	if (XLlFifo_iTxVacancy(&FifoInstance) < (length + 3) / 4) {
+		return;
+	}
+	XLlFifo_Write(&FifoInstance, (void *) frame, length);
+	XLlFifo_TxSetLen(&FifoInstance, length);
+}
+
+/*******************************************************************************
+ * Read the radio telemetry
+ *
+ * Channel 2 is only read in 2x2 mode. Values that cannot be read are zero.
+ *
+ ******************************************************************************/
+static void RoE_getTelemetry(RoeMetricsTelemetry *telemetry) {
+
+	struct rf_rssi rssi;
+	int32_t gain;
+	uint32_t attenuation;
+	uint64_t lo;
+	u8 ch, nCh;
+
+	memset(telemetry, 0, sizeof(*telemetry));
+	if (ad9361_phy == NULL) {
+		return;
+	}
+
+	telemetry->TemperatureMc = ad9361_get_temp(ad9361_phy);
+	nCh = ad9361_phy->pdata->rx2tx2 ? 2 : 1;
+	for (ch = 0; ch < nCh; ch++) {
+		if (ad9361_get_rx_rssi(ad9361_phy, ch, &rssi) == 0
+				&& rssi.multiplier > 0) {
+			// Symbol RSSI, in dB below full scale times the multiplier
+			telemetry->RssiMdb[ch] = -(int32_t) ((u64) rssi.symbol * 1000
+					/ rssi.multiplier);
+		}
+		if (ad9361_get_rx_rf_gain(ad9361_phy, ch, &gain) == 0) {
+			telemetry->RxGainDb[ch] = (int16_t) gain;
+		}
+		if (ad9361_get_tx_attenuation(ad9361_phy, ch, &attenuation) == 0) {
+			telemetry->TxAttenuationMdb[ch] = attenuation;
+		}
+	}
+	if (ad9361_get_rx_lo_freq(ad9361_phy, &lo) == 0) {
+		telemetry->RxLoKhz = (u32) (lo / 1000);
+	}
+	if (ad9361_get_tx_lo_freq(ad9361_phy, &lo) == 0) {
+		telemetry->TxLoKhz = (u32) (lo / 1000);
+	}
+}
+#endif
+
+/*******************************************************************************
+ * Send the metrics reports
+ *
+ * Samples the RoE receive buffer occupancy and, every METRICS_PERIOD_US,
+ * sends a status report (occupancy range over the period, BF words lost,
+ * occupancy interrupts and clock corrections) over the fronthaul, on the
+ * status metrics stream. Every METRICS_TELEMETRY_EVERY status reports, it
+ * also sends the radio telemetry. Call it frequently (e.g. from the polling
+ * loop). The host receiver is "tools/roe_metrics".
+ *
+ * Requires ROE_METRICS, the AXI Timer, and the AXI Ethernet and its FIFO
+ * initialized by initAxiEthernet().
+ *
+ ******************************************************************************/
+void RoE_sendMetrics() {
+
+#if ROE_METRICS && TIMESTAMP_AVAILABLE
+	u32 frame[(ROE_METRICS_MAX_FRAME + 3) / 4], elapsedUs, length;
+	u16 occupancySample;
+#if RRU_MODE && SYNC_MODE == BUFFER_BASED && POLL_CLK_CONTROL
+	OccCtrlStats stats;
+#endif
+
+	occupancySample = (u16) ((Xil_In32(
+	XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40B) & 0x1FFF0000) >> 16);
+	metricsStatus.Occupancy = occupancySample;
+	if (occupancySample < metricsStatus.OccupancyMin) {
+		metricsStatus.OccupancyMin = occupancySample;
+	}
+	if (occupancySample > metricsStatus.OccupancyMax) {
+		metricsStatus.OccupancyMax = occupancySample;
+	}
+	if (metricsStatus.nSamples < 0xFFFF) {
+		metricsStatus.nSamples++;
+	}
+
+	// Time since the metrics started (the timer wraps in seconds)
+	elapsedUs = timestampToUs(getTimestamp() - metricsLast);
+	if (elapsedUs < METRICS_PERIOD_US) {
+		return;
+	}
+	metricsLast += elapsedUs * TIMESTAMP_TICKS_PER_US;
+	metricsTimeUs += elapsedUs;
+
+	metricsStatus.BfWordsLost = Xil_In32(
+	XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x401);
+	metricsStatus.nEmptyInterrupts = (u16) nEmptyInterrupts;
+	metricsStatus.nFullInterrupts = (u16) nFullInterrupts;
+#if RRU_MODE && SYNC_MODE == BUFFER_BASED && POLL_CLK_CONTROL
+	OccCtrl_getStats(&clkCtrl, &stats);
+	metricsStatus.FreqOffsetPpb = stats.FreqOffsetPpb;
+	metricsStatus.nIncrease = (u16) stats.nIncrease;
+	metricsStatus.nDecrease = (u16) stats.nDecrease;
+#endif
+
+	metricsStatusHeader.TimeUs = metricsTimeUs;
+	length = RoeMetrics_buildStatus((u8 *) frame, &metricsStatusHeader,
+			&metricsStatus);
+	RoE_sendMetricsFrame(frame, length);
+	metricsStatusHeader.Seq++;
+
+	metricsStatus.OccupancyMin = 0xFFFF;
+	metricsStatus.OccupancyMax = 0;
+	metricsStatus.nSamples = 0;
+
+	if (++metricsReports >= METRICS_TELEMETRY_EVERY) {
+		RoeMetricsTelemetry telemetry;
+
+		metricsReports = 0;
+		RoE_getTelemetry(&telemetry);
+		metricsTelemetryHeader.TimeUs = metricsTimeUs;
+		length = RoeMetrics_buildTelemetry((u8 *) frame,
+				&metricsTelemetryHeader, &telemetry);
+		RoE_sendMetricsFrame(frame, length);
+		metricsTelemetryHeader.Seq++;
+	}
+#endif
+}
+
+/*******************************************************************************
+ * Initialize the occupancy statistics
+ *
+ ******************************************************************************/
+static void RoE_initOccStats() {
+
+	OccStats_init(&occStats, BUFFER_DEPTH,
+			Xil_In32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x401));
+#if TIMESTAMP_AVAILABLE
+	occStatsNext = getTimestamp();
+#endif
+}
+
+/*******************************************************************************
+ * Sample the occupancy statistics
+ *
+ * Reads the RoE receive buffer occupancy and the BF words lost every
+ * OCC_STATS_PERIOD_US into the statistics (see occ_stats.c), at fixed
+ * deadlines, so that the histogram weights every occupancy by the time spent
+ * at it. Two register reads and a few additions per sample, instead of the
+ * milliseconds that printing the occupancy takes. Call it frequently (e.g.
+ * from the polling loop).
+ *
+ * Requires the AXI Timer.
+ *
+ ******************************************************************************/
+void RoE_sampleOccStats() {
+
+#if TIMESTAMP_AVAILABLE
+	u32 now = getTimestamp(), info;
+
+	if ((s32) (now - occStatsNext) < 0) {
+		return;
+	}
+	occStatsNext += OCC_STATS_PERIOD_US * TIMESTAMP_TICKS_PER_US;
+	// After a stall of the loop, skip the missed samples rather than taking
+	// them all at once
+	if ((s32) (now - occStatsNext) >= 0) {
+		occStatsNext = now + OCC_STATS_PERIOD_US * TIMESTAMP_TICKS_PER_US;
+	}
+
+	info = Xil_In32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40B);
+	OccStats_sample(&occStats, (info & 0x1FFF0000) >> 16,
+			Xil_In32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x401));
+#endif
+}
+
+/*******************************************************************************
+ * Print the occupancy statistics
+ *
+ * Occupancy (in words) since the last reset: mean, standard deviation and
+ * percentiles, BF words lost, occupancy interrupts by correction code and
+ * clock frequency steps.
+ *
+ ******************************************************************************/
+void RoE_printOccStats() {
+
+	OccStatsSummary summary;
+	int i;
+
+	OccStats_summarize(&occStats, &summary);
+
+	xil_printf("\r\nOccupancy \t %d samples \t", summary.nSamples);
+	xil_printf("mean \t %d.%02d \t", summary.MeanQ8 >> 8,
+			((summary.MeanQ8 & 0xFF) * 100) >> 8);
+	xil_printf("std \t %d.%02d", summary.StdQ8 >> 8,
+			((summary.StdQ8 & 0xFF) * 100) >> 8);
+	xil_printf("\r\nmin \t %d \tp1 \t %d \tp50 \t %d \t", summary.Min,
+			summary.P1, summary.P50);
+	xil_printf("p99 \t %d \tp99.9 \t %d \tmax \t %d", summary.P99,
+			summary.P999, summary.Max);
+	xil_printf("\r\nBF words lost \t %d \t", (u32) occStats.WordsLost);
+	xil_printf("in %d samples \t", occStats.nLossSamples);
+	xil_printf("max \t %d", occStats.MaxLoss);
+	xil_printf("\r\nInterrupts by code \t");
+	for (i = 0; i < OCC_STATS_CODES; i++) {
+		xil_printf("%d ", occStats.nCodes[i]);
+	}
+	xil_printf("\tSteps \t +%d -%d", occStats.nIncrease, occStats.nDecrease);
+}
+
+/*******************************************************************************
+ * Export the occupancy statistics
+ *
+ * Prints the raw statistics, in hex, as "occ_stats <name> <value>" lines
+ * (64-bit values as 16 digits), the non-empty bins of the occupancy histogram
+ * as "occ_hist <first word> <samples>" and of the loss histogram as
+ * "loss_hist <bin> <samples>", terminated by "occ_end". The host decoder is
+ * "tools/occ_stats".
+ *
+ ******************************************************************************/
+void RoE_exportOccStats() {
+
+	int i;
+
+	xil_printf("\r\nocc_stats period_us %x", OCC_STATS_PERIOD_US);
+	xil_printf("\r\nocc_stats bin_shift %x", occStats.BinShift);
+	xil_printf("\r\nocc_stats samples %x", occStats.nSamples);
+	xil_printf("\r\nocc_stats min %x", occStats.Min);
+	xil_printf("\r\nocc_stats max %x", occStats.Max);
+	// xil_printf has no 64-bit conversions: high and low words
+	xil_printf("\r\nocc_stats sum %08x%08x", (u32) (occStats.Sum >> 32),
+			(u32) occStats.Sum);
+	xil_printf("\r\nocc_stats sum_sq %08x%08x",
+			(u32) (occStats.SumSq >> 32), (u32) occStats.SumSq);
+	xil_printf("\r\nocc_stats words_lost %08x%08x",
+			(u32) (occStats.WordsLost >> 32), (u32) occStats.WordsLost);
+	xil_printf("\r\nocc_stats loss_samples %x", occStats.nLossSamples);
+	xil_printf("\r\nocc_stats max_loss %x", occStats.MaxLoss);
+	xil_printf("\r\nocc_stats increase %x", occStats.nIncrease);
+	xil_printf("\r\nocc_stats decrease %x", occStats.nDecrease);
+	for (i = 0; i < OCC_STATS_CODES; i++) {
+		xil_printf("\r\nocc_stats code%d %x", i, occStats.nCodes[i]);
+	}
+	for (i = 0; i < OCC_STATS_BINS; i++) {
+		if (occStats.Hist[i]) {
+			xil_printf("\r\nocc_hist %x %x", i << occStats.BinShift,
+					occStats.Hist[i]);
+		}
+	}
+	for (i = 0; i < OCC_STATS_LOSS_BINS; i++) {
+		if (occStats.LossHist[i]) {
+			xil_printf("\r\nloss_hist %x %x", i, occStats.LossHist[i]);
+		}
+	}
+	xil_printf("\r\nocc_end");
+}
+
+/*******************************************************************************
+ * Poll the console
+ *
+ * Single-key commands, read without blocking from the UART Lite:
+ *   s: print the occupancy statistics
+ *   e: export the occupancy statistics
+ *   r: reset the occupancy statistics
+ *   d: print the DMA statistics
+ *
+ ******************************************************************************/
+static void RoE_pollConsole() {
+
+#if ROE_CONSOLE
+	if (XUartLite_IsReceiveEmpty(STDIN_BASEADDRESS)) {
+		return;
+	}
+
+	switch (XUartLite_RecvByte(STDIN_BASEADDRESS)) {
+	case 's':
+		RoE_printOccStats();
+		break;
+	case 'e':
+		RoE_exportOccStats();
+		break;
+	case 'r':
+		OccStats_reset(&occStats,
+				Xil_In32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x401));
+		xil_printf("\r\nOccupancy statistics reset");
+		break;
+	case 'd':
+		xil_printf("\r\n");
+		printDmaStats();
+		break;
+	default:
+		break;
+	}
+#endif
 }
 
 /*******************************************************************************
@@ -280,6 +838,16 @@ void RoE_initCpriEmulator() {
  *
  * CPRI receiver occupancy and words losts in the emulator.
  *
+ * In RRU mode with buffer-based synchronization, the CPRI clock is recovered
+ * from the occupancy: with POLL_CLK_CONTROL, the occupancy is sampled
+ * continuously and a PI controller steers the clock one step at a time, so
+ * that the occupancy converges to the center of the buffer. Otherwise, the
+ * clock is stepped whenever the occupancy interrupt reports a threshold
+ * crossing, and the RoE is reset if the clock needs to lock again.
+ *
+ * The occupancy and the words lost are also sampled into statistics, which
+ * are queried through the console (see RoE_pollConsole()).
+ *
  ******************************************************************************/
 void RoE_pollStatus() {
 
@@ -289,25 +857,81 @@ void RoE_pollStatus() {
 	u16 occupancy;
 	int interruptInfo;
 #endif
+#if RRU_MODE && SYNC_MODE == BUFFER_BASED && POLL_CLK_CONTROL
+	u32 lastUpdate = getTimestamp(), lastLog = lastUpdate, now;
+	u16 occupancySample;
+
+	RoE_initClkControl();
+#endif
+
+#if ROE_METRICS && TIMESTAMP_AVAILABLE
+	RoE_initMetrics();
+#endif
+	RoE_initOccStats();
 
 	while (1) {
 
+		RoE_ditherFlowControl();
+		RoE_sendMetrics();
+		RoE_sampleOccStats();
+		RoE_pollConsole();
+		Trace_drain(TRACE_DRAIN_BATCH);
+
 #if RRU_MODE && SYNC_MODE == BUFFER_BASED // Clock corrections only for RRU mode
 
 #if POLL_CLK_CONTROL
+		occupancySample = (u16) ((Xil_In32(
+		XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40B) & 0x1FFF0000) >> 16);
+
+		// Start once the buffer receives data
+		if (occupancySample > 0) {
+			roe_started = 1;
+		}
+
+		now = getTimestamp();
+
 		if (roe_started) {
-			if (occupancy_offset > TF0) {
-				correctionFlag = 1;
-				correctionCode = 5;
-				occupancy_offset = 0;
-			} else if (occupancy_offset < TE0) {
-				correctionFlag = 1;
-				correctionCode = 1;
-				occupancy_offset = 0;
+			OccCtrl_sample(&clkCtrl, occupancySample);
+
+			if (timestampToUs(now - lastUpdate) >= CLK_CTRL_PERIOD_US) {
+				lastUpdate = now;
+
+				switch (OccCtrl_update(&clkCtrl)) {
+				case OCC_CTRL_INCREASE:
+					adjustFreq(clock, INCREASE_FREQ);
+					OccStats_step(&occStats, 1);
+					break;
+				case OCC_CTRL_DECREASE:
+					adjustFreq(clock, DECREASE_FREQ);
+					OccStats_step(&occStats, -1);
+					break;
+				default:
+					break;
+				}
+			}
+
+			if (timestampToUs(now - lastLog) >= CLK_CTRL_LOG_INTERVAL_US) {
+				lastLog = now;
+				RoE_logClkControl();
 			}
 		}
-#endif
 
+		/*
+		 * The occupancy interrupt only reports that a threshold was crossed:
+		 * the controller already acts on the occupancy.
+		 */
+		if (correctionFlag) {
+			OccStats_correction(&occStats, correctionCode);
+			if (correctionCode > 0 && correctionCode < 4) {
+				nEmptyInterrupts++;
+			} else if (correctionCode > 4) {
+				nFullInterrupts++;
+			}
+
+			correctionFlag = 0;
+			enableInterrupt(ROE_INTR_ID);
+		}
+#else
 		/*
 		 *  Clock correction may yield a temporary clock instability (until
 		 * lock). This could lead an empty of full buffer, which would cause RoE
@@ -315,6 +939,7 @@ void RoE_pollStatus() {
 		 * communication
 		 */
 		if (correctionFlag) {
+			OccStats_correction(&occStats, correctionCode);
 
 			// Correct clock if applicable
 			if (correctionCode > 0) {
@@ -326,6 +951,7 @@ void RoE_pollStatus() {
 					 * clk frequency.
 					 */
 					adjustFreq(clock, DECREASE_FREQ);
+					OccStats_step(&occStats, -1);
 				} else if (correctionCode > 4) {
 					nFullInterrupts++;
 					/*
@@ -334,6 +960,7 @@ void RoE_pollStatus() {
 					 */
 					xil_printf("\r\nIncreasing frequency");
 					adjustFreq(clock, INCREASE_FREQ);
+					OccStats_step(&occStats, 1);
 				}
 
 #if SI_5324
@@ -352,6 +979,7 @@ void RoE_pollStatus() {
 			enableInterrupt(ROE_INTR_ID);
 		}
 #endif
+#endif
 
 #ifdef DEBUG_OCCUPANCY
 		// Print once every second
@@ -381,10 +1009,11 @@ void RoE_pollStatus() {
  *  Alternate between two inter-departure intervals in order to achieve the
  * target CPRI line rate.
  * 	Since the CPRI BF period is fixed and equal to the chip period of
- * 60.416 us, the number of CPRI BFs per packet define the Ethernet frame
+ * 260.416 ns, the number of CPRI BFs per packet define the Ethernet frame
  * inter-departure interval. If this inter-departure is not an integer multiple
  * of the AXI clock, then use the two alternatives to approximate the value on
- * average.
+ * average (see flow_ctrl.c). When the average still falls between two cycle
+ * counts, the second interval is dithered by RoE_ditherFlowControl().
  *
  * Note #1: the following rates are valid assuming a CPRI BF is formed within
  * the number of clock cycles corresponding to the oversampling ratio with
@@ -395,40 +1024,84 @@ void RoE_pollStatus() {
  ******************************************************************************/
 void RoE_configEthFlowControl(u8 nBFsPerPkt) {
 
+	FlowCtrlPlan plan;
+
 	xil_printf("\r\n ****** Configuring RoE Flow Control ******  \r\n");
 
-	switch (nBFsPerPkt) {
-	case 64:
-		xil_printf("\r\n 64 CPRI BFs per Ethernet Frame\r\n");
-		Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x407, 0x00000682);
-		Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40C, 0x00000683);
-		break;
+	if (nBFsPerPkt > FlowCtrl_maxBfsPerPkt(LINE_RATE_OPTION)
+			|| FlowCtrl_plan(&plan, nBFsPerPkt, CPRI_CHIP_RATE,
+					ROE_AXI_CLK_HZ) != 0) {
+		xil_printf("\r\n Warning: number of BFs not supported (max %d). \r\n",
+				FlowCtrl_maxBfsPerPkt(LINE_RATE_OPTION));
+		nBFsPerPkt = 16;
+		FlowCtrl_plan(&plan, nBFsPerPkt, CPRI_CHIP_RATE, ROE_AXI_CLK_HZ);
+	}
 
-	case 32:
-		xil_printf("\r\n 32 CPRI BFs per Ethernet Frame\r\n");
-		Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x407, 0x00000342);
-		Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40C, 0x00000341);
-		break;
+	xil_printf("\r\n %d CPRI BFs per Ethernet Frame\r\n", nBFsPerPkt);
+	xil_printf(" Inter-departure %d / %d cycles", plan.IntervalA,
+			plan.IntervalB);
+	if (plan.DitherNum) {
+		xil_printf(", +1 in %d of %d pairs", plan.DitherNum, plan.DitherDen);
+	}
+	xil_printf("\r\n");
 
-	case 16:
-		xil_printf("\r\n 16 CPRI BFs per Ethernet Frame\r\n");
-		Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x407, 0x000001A0);
-		Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40C, 0x000001A1);
-		break;
+	FlowCtrl_initDither(&flowCtrlDither, &plan);
+	flowCtrlDithering = 0;
 
-	case 8:
-		xil_printf("\r\n 8 CPRI BFs per Ethernet Frame\r\n");
-		Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x407, 0x00000209);
-		Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40C, 0x00000208);
-		break;
+	RoE_writeReg(0x407, plan.IntervalA);
+	RoE_writeReg(0x40C, plan.IntervalB);
 
-	default:
-		xil_printf("\r\n Warning: number of BFs not supported. \r\n");
-		xil_printf("\r\n 16 CPRI BFs per Ethernet Frame\r\n");
-		Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x407, 0x000001A0);
-		Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40C, 0x000001A1);
-		break;
+#if TIMESTAMP_AVAILABLE
+	if (plan.DitherNum) {
+		flowCtrlSlotEnd = getTimestamp();
+		flowCtrlLastWrite = flowCtrlSlotEnd;
+		flowCtrlDithering = 1;
+		RoE_ditherFlowControl();
+	}
+#else
+	if (plan.DitherNum) {
+		xil_printf(" Warning: no AXI Timer, the rate is approximate\r\n");
+	}
+#endif
+}
+
+/*******************************************************************************
+ * Dither the flow control
+ *
+ * Moves to the next dither slot of the second inter-departure interval, once
+ * the current slot of FLOW_CTRL_DITHER_PAIRS pairs of packets is over. Call
+ * it frequently (e.g. from the polling loop).
+ *
+ * The polling loop stalls while the UART prints (about 3 ms per line at
+ * 115200 baud, longer than a slot), so calls may come late by several slots.
+ * The dither is given the time the previous value actually stayed in the
+ * register, so a late call only adds drift, which the next slots pay back,
+ * and the average rate stays exact (see flow_ctrl.c and
+ * "tools/flow_ctrl_model", option -s).
+ *
+ ******************************************************************************/
+void RoE_ditherFlowControl() {
+
+#if TIMESTAMP_AVAILABLE
+	u32 now, intervalB, slotCycles;
+
+	now = getTimestamp();
+	if (!flowCtrlDithering || (s32) (now - flowCtrlSlotEnd) < 0) {
+		return;
 	}
+
+	intervalB = FlowCtrl_nextIntervalB(&flowCtrlDither,
+			(u32) ((u64) (now - flowCtrlLastWrite) * ROE_AXI_CLK_HZ
+					/ TIMESTAMP_FREQ_HZ));
+	// Not logged by RoE_writeReg(), it would flood the UART
+	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x40C, intervalB);
+	flowCtrlLastWrite = now;
+
+	slotCycles = FLOW_CTRL_DITHER_PAIRS
+			* (flowCtrlDither.Plan.IntervalA + intervalB);
+	flowCtrlSlotEnd = now + (u32) ((u64) slotCycles * TIMESTAMP_FREQ_HZ
+			/ ROE_AXI_CLK_HZ);
+#endif
 }
 
 /*******************************************************************************
@@ -443,11 +1116,10 @@ void RoE_setEthTypeFilters() {
 	// Configure the demux filter by Ether-type
 
 	// CPRI TRX Stream
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x101, 0xCD);
-	// Stream 02 (not used yet)
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x102, 0x00);
-	// Metrics Stream
-	Xil_Out32(XPAR_RADIO_OVER_ETHERNET_0_BASEADDR + 0x103, 0x00);
+	RoE_writeReg(0x101, 0xCD);
+	// Metrics Streams: RoE status and radio telemetry (see roe_metrics.h)
+	RoE_writeReg(0x102, ROE_METRICS_ETHER_TYPE_STATUS);
+	RoE_writeReg(0x103, ROE_METRICS_ETHER_TYPE_TELEMETRY);
 
 }
 
@@ -482,10 +1154,8 @@ void RoE_interruptHandler(void *CallbackRef) {
 	occupancy = (u16) ((interruptInfo & 0x1FFF0000) >> 16);
 	transitionCount = (u16) (interruptInfo & 0x0000FFFF);
 
-	// Print
-	xil_printf("\r\nCorrection Code: %d", correctionCode);
-	xil_printf("\r\nOccupancy: %d \t Transition: %d\r\n", occupancy,
-			transitionCount);
+	// Printed later by the polling loop (Trace_drain())
+	Trace_log(TRACE_ROE_OCCUPANCY, correctionCode, occupancy, transitionCount);
 
 	// Flag clock correction
 	correctionFlag = 1;
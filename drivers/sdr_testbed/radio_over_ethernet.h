@@ -11,10 +11,16 @@
 #include "xil_types.h"
 
 /************************** Function Prototypes *****************************/
+int RoE_planPacketSize(u32);
 void RoE_initCpri2Ethernet(u8);
 void RoE_setCpriControlWord(void);
 void RoE_initCpriEmulator(void);
 void RoE_configEthFlowControl(u8);
+void RoE_ditherFlowControl(void);
+void RoE_sendMetrics(void);
+void RoE_sampleOccStats(void);
+void RoE_printOccStats(void);
+void RoE_exportOccStats(void);
 void RoE_disableCpri2Ethernet(void);
 void RoE_pollStatus(void);
 void RoE_setEthTypeFilters(void);
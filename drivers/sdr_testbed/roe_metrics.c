@@ -0,0 +1,183 @@
+/*
+ * roe_metrics.c
+ *
+ * Metrics frames sent by the RRU over the fronthaul (see roe_metrics.h), so
+ * that it can be monitored remotely without polling its UART.
+ *
+ * Only the C library is needed, so the host receiver parses the frames with
+ * the same code (see "tools/roe_metrics").
+ */
+
+/***************************** Include Files *********************************/
+
+#include <string.h>
+#include "roe_metrics.h"
+
+/*****************************************************************************/
+
+static uint8_t *put16(uint8_t *p, uint16_t Value) {
+	p[0] = (uint8_t) (Value >> 8);
+	p[1] = (uint8_t) Value;
+	return p + 2;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t Value) {
+	p[0] = (uint8_t) (Value >> 24);
+	p[1] = (uint8_t) (Value >> 16);
+	p[2] = (uint8_t) (Value >> 8);
+	p[3] = (uint8_t) Value;
+	return p + 4;
+}
+
+static uint16_t get16(const uint8_t *p) {
+	return (uint16_t) ((p[0] << 8) | p[1]);
+}
+
+static uint32_t get32(const uint8_t *p) {
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16)
+			| ((uint32_t) p[2] << 8) | p[3];
+}
+
+/*
+ * MAC and metrics headers. Returns the start of the report.
+ */
+static uint8_t *putHeader(uint8_t *Frame, const RoeMetricsHeader *Header) {
+	uint8_t *p = Frame;
+
+	memcpy(p, Header->Dst, 6);
+	memcpy(p + 6, Header->Src, 6);
+	p = put16(p + 12, Header->EtherType);
+	*p++ = ROE_METRICS_VERSION;
+	*p++ = 0;
+	p = put16(p, Header->Seq);
+	return put32(p, Header->TimeUs);
+}
+
+static size_t pad(uint8_t *Frame, size_t Length) {
+	if (Length < ROE_METRICS_MIN_FRAME) {
+		memset(Frame + Length, 0, ROE_METRICS_MIN_FRAME - Length);
+		Length = ROE_METRICS_MIN_FRAME;
+	}
+	return Length;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Builds a status frame (without FCS) in a buffer of ROE_METRICS_MAX_FRAME
+ * bytes.
+ *
+ * Returns the frame length.
+ *
+ ******************************************************************************/
+size_t RoeMetrics_buildStatus(uint8_t *Frame, RoeMetricsHeader *Header,
+		const RoeMetricsStatus *Status) {
+	uint8_t *p;
+
+	Header->EtherType = ROE_METRICS_ETHER_TYPE_STATUS;
+	p = putHeader(Frame, Header);
+	p = put16(p, Status->Occupancy);
+	p = put16(p, Status->OccupancyMin);
+	p = put16(p, Status->OccupancyMax);
+	p = put16(p, Status->nSamples);
+	p = put32(p, Status->BfWordsLost);
+	p = put16(p, Status->nEmptyInterrupts);
+	p = put16(p, Status->nFullInterrupts);
+	p = put32(p, (uint32_t) Status->FreqOffsetPpb);
+	p = put16(p, Status->nIncrease);
+	p = put16(p, Status->nDecrease);
+	return pad(Frame, (size_t) (p - Frame));
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Builds a telemetry frame (without FCS) in a buffer of ROE_METRICS_MAX_FRAME
+ * bytes.
+ *
+ * Returns the frame length.
+ *
+ ******************************************************************************/
+size_t RoeMetrics_buildTelemetry(uint8_t *Frame, RoeMetricsHeader *Header,
+		const RoeMetricsTelemetry *Telemetry) {
+	uint8_t *p;
+	int i;
+
+	Header->EtherType = ROE_METRICS_ETHER_TYPE_TELEMETRY;
+	p = putHeader(Frame, Header);
+	p = put32(p, (uint32_t) Telemetry->TemperatureMc);
+	for (i = 0; i < 2; i++) {
+		p = put32(p, (uint32_t) Telemetry->RssiMdb[i]);
+	}
+	for (i = 0; i < 2; i++) {
+		p = put16(p, (uint16_t) Telemetry->RxGainDb[i]);
+	}
+	for (i = 0; i < 2; i++) {
+		p = put32(p, Telemetry->TxAttenuationMdb[i]);
+	}
+	p = put32(p, Telemetry->RxLoKhz);
+	p = put32(p, Telemetry->TxLoKhz);
+	return pad(Frame, (size_t) (p - Frame));
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Parses a metrics frame (without FCS, possibly padded). Only the report
+ * matching the EtherType is filled.
+ *
+ * Returns ROE_METRICS_TYPE_STATUS or ROE_METRICS_TYPE_TELEMETRY, 0 if the
+ * frame is not a metrics frame, or -1 if it is malformed or of another
+ * version.
+ *
+ ******************************************************************************/
+int RoeMetrics_parse(const uint8_t *Frame, size_t Length,
+		RoeMetricsHeader *Header, RoeMetricsStatus *Status,
+		RoeMetricsTelemetry *Telemetry) {
+	const uint8_t *p = Frame + ROE_METRICS_MAC_HEADER + ROE_METRICS_HEADER;
+	int i;
+
+	if (Length < ROE_METRICS_MAC_HEADER) {
+		return -1;
+	}
+	Header->EtherType = get16(Frame + 12);
+	if (Header->EtherType != ROE_METRICS_ETHER_TYPE_STATUS
+			&& Header->EtherType != ROE_METRICS_ETHER_TYPE_TELEMETRY) {
+		return 0;
+	}
+	if (Length < ROE_METRICS_MAC_HEADER + ROE_METRICS_HEADER
+			+ ((Header->EtherType == ROE_METRICS_ETHER_TYPE_STATUS) ?
+					ROE_METRICS_STATUS : ROE_METRICS_TELEMETRY)
+			|| Frame[ROE_METRICS_MAC_HEADER] != ROE_METRICS_VERSION) {
+		return -1;
+	}
+
+	memcpy(Header->Dst, Frame, 6);
+	memcpy(Header->Src, Frame + 6, 6);
+	Header->Seq = get16(Frame + ROE_METRICS_MAC_HEADER + 2);
+	Header->TimeUs = get32(Frame + ROE_METRICS_MAC_HEADER + 4);
+
+	if (Header->EtherType == ROE_METRICS_ETHER_TYPE_STATUS) {
+		Status->Occupancy = get16(p);
+		Status->OccupancyMin = get16(p + 2);
+		Status->OccupancyMax = get16(p + 4);
+		Status->nSamples = get16(p + 6);
+		Status->BfWordsLost = get32(p + 8);
+		Status->nEmptyInterrupts = get16(p + 12);
+		Status->nFullInterrupts = get16(p + 14);
+		Status->FreqOffsetPpb = (int32_t) get32(p + 16);
+		Status->nIncrease = get16(p + 20);
+		Status->nDecrease = get16(p + 22);
+		return ROE_METRICS_TYPE_STATUS;
+	}
+
+	Telemetry->TemperatureMc = (int32_t) get32(p);
+	for (i = 0; i < 2; i++) {
+		Telemetry->RssiMdb[i] = (int32_t) get32(p + 4 + 4 * i);
+		Telemetry->RxGainDb[i] = (int16_t) get16(p + 12 + 2 * i);
+		Telemetry->TxAttenuationMdb[i] = get32(p + 16 + 4 * i);
+	}
+	Telemetry->RxLoKhz = get32(p + 24);
+	Telemetry->TxLoKhz = get32(p + 28);
+	return ROE_METRICS_TYPE_TELEMETRY;
+}
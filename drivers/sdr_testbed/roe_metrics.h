@@ -0,0 +1,89 @@
+/*
+ * roe_metrics.h
+ */
+
+#ifndef ROE_METRICS_H_
+#define ROE_METRICS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * EtherTypes of the metrics streams, demultiplexed by the second (0x102) and
+ * third (0x103) filters of the RoE demux. Status reports are frequent (RoE
+ * buffer and clock recovery), telemetry reports are slow (AD9361).
+ */
+#define ROE_METRICS_ETHER_TYPE_STATUS		0xCE
+#define ROE_METRICS_ETHER_TYPE_TELEMETRY	0xCF
+
+#define ROE_METRICS_VERSION		1
+
+/*
+ * Frame layout (big-endian): MAC header, metrics header (version, reserved
+ * byte, sequence number, RRU time in us), then the report. Frames are padded
+ * to the smallest Ethernet frame.
+ */
+#define ROE_METRICS_MAC_HEADER	14
+#define ROE_METRICS_HEADER		8
+#define ROE_METRICS_STATUS		24
+#define ROE_METRICS_TELEMETRY	32
+#define ROE_METRICS_MIN_FRAME	60
+#define ROE_METRICS_MAX_FRAME	ROE_METRICS_MIN_FRAME	/* Both reports fit */
+
+/*
+ * Report types returned by RoeMetrics_parse()
+ */
+#define ROE_METRICS_TYPE_STATUS		1
+#define ROE_METRICS_TYPE_TELEMETRY	2
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	uint8_t Dst[6];
+	uint8_t Src[6];
+	uint16_t EtherType;			/* Set by the build functions */
+	uint16_t Seq;				/* Per stream */
+	uint32_t TimeUs;			/* RRU time of the report (wraps) */
+} RoeMetricsHeader;
+
+/*
+ * RoE receive buffer and clock recovery, over the report period. Counters
+ * are cumulative (they wrap), so lost reports do not lose events.
+ */
+typedef struct {
+	uint16_t Occupancy;			/* Last sample, in words */
+	uint16_t OccupancyMin;
+	uint16_t OccupancyMax;
+	uint16_t nSamples;			/* Occupancy samples (saturated) */
+	uint32_t BfWordsLost;		/* Register 0x401 */
+	uint16_t nEmptyInterrupts;
+	uint16_t nFullInterrupts;
+	int32_t FreqOffsetPpb;		/* Clock correction applied */
+	uint16_t nIncrease;			/* Frequency steps */
+	uint16_t nDecrease;
+} RoeMetricsStatus;
+
+/*
+ * Radio (AD9361) telemetry, per channel where applicable
+ */
+typedef struct {
+	int32_t TemperatureMc;		/* Milli-degrees Celsius */
+	int32_t RssiMdb[2];			/* Received signal strength, mdB */
+	int16_t RxGainDb[2];
+	uint32_t TxAttenuationMdb[2];
+	uint32_t RxLoKhz;
+	uint32_t TxLoKhz;
+} RoeMetricsTelemetry;
+
+/************************** Function Prototypes *****************************/
+size_t RoeMetrics_buildStatus(uint8_t *Frame, RoeMetricsHeader *Header,
+		const RoeMetricsStatus *Status);
+size_t RoeMetrics_buildTelemetry(uint8_t *Frame, RoeMetricsHeader *Header,
+		const RoeMetricsTelemetry *Telemetry);
+int RoeMetrics_parse(const uint8_t *Frame, size_t Length,
+		RoeMetricsHeader *Header, RoeMetricsStatus *Status,
+		RoeMetricsTelemetry *Telemetry);
+
+#endif /* ROE_METRICS_H_ */
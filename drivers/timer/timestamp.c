@@ -0,0 +1,100 @@
+/*
+ * timestamp.c
+ *
+ * Free-running timebase used to measure rates and latencies in the firmware.
+ *
+ * Both timers of the AXI Timer are cascaded into a 64-bit up-counter with
+ * auto-reload and no interrupt. "getTimestamp()" returns its 32 LSBs (timer
+ * 0): differences between two such timestamps are valid as long as the
+ * interval is shorter than one wrap (about 42 s with a 100 MHz AXI clock),
+ * since unsigned subtraction handles a single wrap. Longer intervals are
+ * measured with "getTimestamp64()".
+ */
+
+/***************************** Include Files *********************************/
+
+#include "timestamp.h"
+#include "xil_printf.h"
+#if TIMESTAMP_AVAILABLE
+#include "xtmrctr_l.h"
+#endif
+
+/************************** Constant Definitions *****************************/
+
+#define TIMESTAMP_TIMER_NUMBER	0
+#define TIMESTAMP_HIGH_TIMER_NUMBER	1
+
+/*****************************************************************************/
+/*
+ *
+ * Starts the free-running timestamp counter.
+ *
+ ******************************************************************************/
+void initTimestamp(void) {
+#if TIMESTAMP_AVAILABLE
+	// Load zero into both counters, then let them run with auto-reload
+	XTmrCtr_SetLoadReg(XPAR_TMRCTR_0_BASEADDR, TIMESTAMP_TIMER_NUMBER, 0);
+	XTmrCtr_SetLoadReg(XPAR_TMRCTR_0_BASEADDR, TIMESTAMP_HIGH_TIMER_NUMBER, 0);
+	XTmrCtr_SetControlStatusReg(XPAR_TMRCTR_0_BASEADDR,
+			TIMESTAMP_HIGH_TIMER_NUMBER, XTC_CSR_LOAD_MASK);
+	XTmrCtr_SetControlStatusReg(XPAR_TMRCTR_0_BASEADDR, TIMESTAMP_TIMER_NUMBER,
+			XTC_CSR_LOAD_MASK);
+	// In cascade mode, timer 0 controls the 64-bit counter
+	XTmrCtr_SetControlStatusReg(XPAR_TMRCTR_0_BASEADDR, TIMESTAMP_TIMER_NUMBER,
+			XTC_CSR_ENABLE_TMR_MASK | XTC_CSR_AUTO_RELOAD_MASK
+					| XTC_CSR_CASC_MASK);
+#else
+	xil_printf("\r\nWarning: no AXI Timer, timestamps are not available\r\n");
+#endif
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Returns the current timestamp in timer ticks.
+ *
+ ******************************************************************************/
+u32 getTimestamp(void) {
+#if TIMESTAMP_AVAILABLE
+	return XTmrCtr_GetTimerCounterReg(XPAR_TMRCTR_0_BASEADDR,
+			TIMESTAMP_TIMER_NUMBER);
+#else
+	return 0;
+#endif
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Returns the current value of the 64-bit counter in timer ticks, which does
+ * not wrap in practice.
+ *
+ ******************************************************************************/
+u64 getTimestamp64(void) {
+#if TIMESTAMP_AVAILABLE
+	u32 High, Low;
+
+	// Read the MSBs again in case the LSBs wrapped in between
+	do {
+		High = XTmrCtr_GetTimerCounterReg(XPAR_TMRCTR_0_BASEADDR,
+				TIMESTAMP_HIGH_TIMER_NUMBER);
+		Low = XTmrCtr_GetTimerCounterReg(XPAR_TMRCTR_0_BASEADDR,
+				TIMESTAMP_TIMER_NUMBER);
+	} while (XTmrCtr_GetTimerCounterReg(XPAR_TMRCTR_0_BASEADDR,
+			TIMESTAMP_HIGH_TIMER_NUMBER) != High);
+
+	return ((u64) High << 32) | Low;
+#else
+	return 0;
+#endif
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Converts a number of timer ticks into microseconds.
+ *
+ ******************************************************************************/
+u32 timestampToUs(u32 ticks) {
+	return ticks / TIMESTAMP_TICKS_PER_US;
+}
@@ -0,0 +1,33 @@
+/*
+ * timestamp.h
+ */
+
+#ifndef TIMESTAMP_H_
+#define TIMESTAMP_H_
+
+#include "xparameters.h"
+#include "xil_types.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * The timestamp is the free-running counter of the AXI Timer (both timers
+ * cascaded), which runs at the AXI clock. Without an AXI Timer in the design, timestamps are always 0.
+ */
+#ifdef XPAR_TMRCTR_0_BASEADDR
+#define TIMESTAMP_AVAILABLE		1
+#define TIMESTAMP_FREQ_HZ		XPAR_TMRCTR_0_CLOCK_FREQ_HZ
+#else
+#define TIMESTAMP_AVAILABLE		0
+#define TIMESTAMP_FREQ_HZ		XPAR_MICROBLAZE_CORE_CLOCK_FREQ_HZ
+#endif
+
+#define TIMESTAMP_TICKS_PER_US	(TIMESTAMP_FREQ_HZ / 1000000)
+
+/************************** Function Prototypes *****************************/
+void initTimestamp(void);
+u32 getTimestamp(void);
+u64 getTimestamp64(void);
+u32 timestampToUs(u32 ticks);
+
+#endif /* TIMESTAMP_H_ */
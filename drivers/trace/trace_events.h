@@ -0,0 +1,46 @@
+/*
+ * trace_events.h
+ *
+ * Events of the trace log (see trace_log.c).
+ *
+ * Each event is declared once below, with the format of its arguments. The
+ * firmware only uses the identifiers: the format strings are never compiled
+ * into it, but resolved offline by "tools/trace_dump". Arguments are passed
+ * to the format in order: Arg0 (16 bits), Arg1 and Arg2 (32 bits). Add new
+ * events at the end, so that older logs still decode.
+ *
+ * Only the C preprocessor is needed, so that the host tool includes this file.
+ */
+
+#ifndef TRACE_EVENTS_H_
+#define TRACE_EVENTS_H_
+
+/************************** Constant Definitions *****************************/
+
+#define TRACE_EVENTS(EVENT) \
+	EVENT(TRACE_ROE_OCCUPANCY, \
+		"RoE occupancy interrupt: correction code %u, occupancy %u, " \
+		"transition %u") \
+	EVENT(TRACE_DMA_ERROR, \
+		"DMA error on channel %u (0: Tx, 1: Rx): irq status 0x%x, " \
+		"channel status 0x%x") \
+	EVENT(TRACE_DMA_TX_FAILED, \
+		"DMA Tx send failed at step %u (1: BD alloc, 2: buffer address, " \
+		"3: length, 4: to hardware): status %d, BD 0x%x")
+
+/*
+ * Events held by the log (power of two). The log layout (trace_log.h) is
+ * also read from memory dumps by the host tool.
+ */
+#define TRACE_LOG_EVENTS		256
+
+/**************************** Type Definitions *******************************/
+
+#define TRACE_EVENT_ID(Id, Format)	Id,
+
+typedef enum {
+	TRACE_EVENTS(TRACE_EVENT_ID)
+	TRACE_N_EVENTS
+} TraceEventId;
+
+#endif /* TRACE_EVENTS_H_ */
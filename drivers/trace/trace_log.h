@@ -0,0 +1,44 @@
+/*
+ * trace_log.h
+ */
+
+#ifndef TRACE_LOG_H_
+#define TRACE_LOG_H_
+
+#include "xil_types.h"
+#include "trace_events.h"
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * Event: timestamp (timer ticks), identifier in the 16 MSBs and first
+ * argument in the 16 LSBs of IdArg0, then two 32-bit arguments
+ */
+typedef struct {
+	u32 Timestamp;
+	u32 IdArg0;
+	u32 Arg1;
+	u32 Arg2;
+} TraceEvent;
+
+/*
+ * Ring of events. Head counts the events written and Tail the events read
+ * (both wrap), so the log holds Head - Tail events. Events that do not fit
+ * are dropped and counted.
+ */
+typedef struct {
+	volatile u32 Head;
+	volatile u32 Tail;
+	volatile u32 nDropped;
+	TraceEvent Events[TRACE_LOG_EVENTS];
+} TraceLog;
+
+/************************** Function Prototypes *****************************/
+void Trace_log(u16 Id, u16 Arg0, u32 Arg1, u32 Arg2);
+int Trace_drain(int MaxEvents);
+
+/************************** Variable Definitions ****************************/
+
+extern TraceLog traceLog;
+
+#endif /* TRACE_LOG_H_ */
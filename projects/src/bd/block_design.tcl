@@ -34,7 +34,8 @@ apply_board_connection -board_interface "rs232_uart" -ip_intf "axi_uartlite_0/UA
 set_property -dict [list CONFIG.C_BAUDRATE {9600}] [get_bd_cells axi_uartlite_0]
 
 # AXI Timer
-#create_bd_cell -type ip -vlnv xilinx.com:ip:axi_timer:2.0 axi_timer_0
+# Free-running timebase for the firmware (no interrupt is used)
+create_bd_cell -type ip -vlnv xilinx.com:ip:axi_timer:2.0 axi_timer_0
 
 if {$::eth == "YES"} {
 if {$::board == "VC707"} {
@@ -138,7 +139,7 @@ apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config {Master "/microblaze_0
 # Standard AXI memory-mapped automated connections
 # Namely add one more Master interface in the AXI interconnect and connect
 # system clock and reset signals
-#apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config {Master "/microblaze_0 (Periph)" Clk "Auto" }  [get_bd_intf_pins axi_timer_0/S_AXI]
+apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config {Master "/microblaze_0 (Periph)" Clk "Auto" }  [get_bd_intf_pins axi_timer_0/S_AXI]
 
 if {$::eth == "YES"} {
 
@@ -163,6 +164,9 @@ if {$::board == "VC707"} {
 	#create adc_dma and dac_dma
 	create_bd_cell -type ip -vlnv xilinx.com:ip:axi_dma:7.1 axi_dma_0
 	set_property name ad9361_dma [get_bd_cells axi_dma_0]
+	# BD length field of 23 bits (up to 8 MB - 1 per BD): the default 14 bits
+	# (16 kB - 1) do not fit the cyclic transmit BD nor the Rx capture BDs
+	set_property -dict [ list CONFIG.c_sg_length_width {23} ] [get_bd_cells ad9361_dma]
 
 
 	#create instance: ad9361_data_0, and set properties
@@ -0,0 +1,1300 @@
+/*
+ * axidma_model.c
+ *
+ * Host model of the DMA subsystem of the design (see "axidma_model.h").
+ *
+ * Each AXI DMA channel follows the scatter-gather engine of PG021:
+ *
+ *  - Once started (run/stop bit set), the engine waits for a write of the
+ *    tail descriptor register, then processes BDs from the current descriptor
+ *    on, following the next descriptor pointers, until it completes the tail
+ *    BD. A later tail write resumes it after that BD. In cyclic mode, the
+ *    tail is ignored and the BDs are processed forever.
+ *  - A BD is fetched, its data moved in bursts, and its status written back
+ *    with the Cmplt bit and the length transferred (plus SOF/EOF on S2MM,
+ *    where the stream is framed as one packet per BD, as the driver expects).
+ *    Fetching a BD whose Cmplt bit is still set, outside the cyclic mode,
+ *    halts the channel with an SG internal error.
+ *  - The MM2S engine reads the buffer in bursts of up to BurstBeats beats,
+ *    with up to Outstanding reads in flight, while the stream FIFO has room
+ *    for them. The S2MM engine writes a burst once the stream FIFO holds it.
+ *    The data beats of a channel are serialized, each read beat arrives
+ *    DdrLatency cycles after the request, and each write completes
+ *    DdrLatency cycles after its last beat.
+ *  - Every completed BD decrements the coalescing counter, which raises the
+ *    IOC interrupt when it reaches the threshold. The delay timer runs while
+ *    completions are pending and raises the delay interrupt after the
+ *    programmed number of 125-cycle units without completion.
+ *
+ * The interrupt controller enters the ISR of the highest priority channel
+ * with an enabled interrupt pending IrqLatency cycles after the CPU is free.
+ */
+
+/***************************** Include Files *********************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include "axidma_model.h"
+#include "xparameters.h"
+#include "xaxidma.h"
+#include "xtmrctr_l.h"
+#include "xintc_driver.h"
+
+/************************** Constant Definitions *****************************/
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE		0x100000
+#endif
+
+#define DDR_BASE			XPAR_MIG7SERIES_0_BASEADDR
+#define DDR_SIZE			(XPAR_MIG7SERIES_0_HIGHADDR \
+		- XPAR_MIG7SERIES_0_BASEADDR + 1)
+
+#define DMA_BASE			XPAR_AD9361_DMA_BASEADDR
+#define DMA_REGS_SIZE		0x60
+#define TIMER_BASE			XPAR_TMRCTR_0_BASEADDR
+#define TIMER_REGS_SIZE		(2 * XTC_TIMER_COUNTER_OFFSET)
+
+#define CACHE_LINE_LEN		(XPAR_MICROBLAZE_DCACHE_LINE_LEN * 4)
+
+/*
+ * Delay timer resolution in SG clock cycles
+ */
+#define DELAY_TIMER_UNIT	125
+
+/*
+ * Bytes of a stream word (one IQ sample of one AxC)
+ */
+#define STREAM_WORD_BYTES	4
+
+#define N_CHANNELS			2
+
+/**************************** Type Definitions *******************************/
+
+enum {
+	ENG_IDLE, ENG_FETCH, ENG_DATA, ENG_UPDATE
+};
+
+typedef struct {
+	u64 DoneAt;		/* Data in the FIFO (MM2S) or written (S2MM) */
+	u32 Offset;		/* Within the BD buffer */
+	u32 Len;
+	int First;
+	int Last;
+} Burst;
+
+typedef struct {
+	int IsRx;
+	u8 IrqId;
+	XInterruptHandler Handler;
+	void *HandlerRef;
+
+	/* Registers */
+	u32 Cr;
+	u32 Sr;			/* Error and interrupt bits */
+	u32 CurDesc;
+	u32 TailDesc;
+	int Halted;
+
+	/* Tail written by an ISR, taking effect at the CPU time of the write */
+	int TailPending;
+	u32 PendingTail;
+	u64 TailAt;
+
+	/* Engine */
+	int State;
+	u64 StateEnd;
+	int DescValid;	/* The current descriptor may be fetched */
+	int AtTail;		/* Stopped after the tail BD, resumes at NextDesc */
+	u32 NextDesc;
+	u32 BdAddr;
+	u32 BufAddr;
+	u32 BdLen;
+	u32 Issued;
+	Burst Bursts[AXIDMA_MODEL_MAX_OUTSTANDING];
+	int BurstHead;
+	int nBursts;
+	u64 DataFree;	/* First cycle the data beats of the channel are free */
+	u64 LastBdEnd;
+	int HaveLastBdEnd;
+
+	/* Interrupt coalescing */
+	u32 nPending;
+	u64 SinceCompletion;
+
+	/* Stream FIFO */
+	u8 Fifo[AXIDMA_MODEL_MAX_FIFO_BYTES];
+	u32 FifoHead;
+	u32 FifoCount;
+	u32 FifoReserved;	/* Room taken by reads in flight (MM2S) */
+	double StreamAcc;
+	int StreamStarted;
+
+	AxiDmaChannelStats Stats;
+} Channel;
+
+/************************** Variable Definitions *****************************/
+
+static AxiDmaModelParams P;
+static Channel Channels[N_CHANNELS];
+static XAxiDma_Config Config;
+static u64 Now;
+static double WordsPerCycle;
+static int Verbose;
+
+/* CPU */
+static int InIsr;
+static u64 CpuTime;
+static u64 CpuBusyUntil;
+static Channel *IsrChannel;
+static u64 IsrEntry;
+static u32 IrqLevel = 0xFFFFFFFF;
+
+/* AXI Timer (cascaded 64-bit counter) */
+static int TimerRunning;
+static u64 TimerStart;
+
+/* Streams */
+static AxiDmaSink Sink;
+static void *SinkRef;
+static AxiDmaSource Source;
+static void *SourceRef;
+static u32 SourceCounter;
+
+/*****************************************************************************/
+/*
+ *
+ * CPU time: the ISR clock while an ISR runs, the simulation time otherwise.
+ *
+ ******************************************************************************/
+static u64 cpuNow(void) {
+	return InIsr ? CpuTime : Now;
+}
+
+static void charge(u32 Cycles) {
+	if (InIsr)
+		CpuTime += Cycles;
+}
+
+/*
+ * A BD ring operation, with an access and the maintenance of the two cache
+ * lines of each BD it walks
+ */
+static void chargeBds(int nBds) {
+	charge(nBds * (P.BdCycles + 2 * P.CacheLineCycles));
+}
+
+static void chargeRing(int nBds) {
+	charge(P.RingCycles);
+	chargeBds(nBds);
+}
+
+/*****************************************************************************/
+
+#define BD_WORD(BdAddr, Offset)	(((volatile u32 *) (UINTPTR) (BdAddr))[(Offset) / 4])
+
+static u32 lengthMask(void) {
+	return (1u << P.SgLengthWidth) - 1;
+}
+
+static int inDdr(u32 Addr, u32 Len) {
+	return Addr >= DDR_BASE && Len <= DDR_SIZE && Addr - DDR_BASE <= DDR_SIZE - Len;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Stream FIFO
+ *
+ ******************************************************************************/
+static void fifoPush(Channel *Ch, const u8 *Data, u32 Len) {
+	u32 Tail = (Ch->FifoHead + Ch->FifoCount) % P.FifoBytes;
+	u32 First = P.FifoBytes - Tail;
+
+	if (First > Len)
+		First = Len;
+	memcpy(&Ch->Fifo[Tail], Data, First);
+	memcpy(&Ch->Fifo[0], Data + First, Len - First);
+	Ch->FifoCount += Len;
+}
+
+static void fifoPop(Channel *Ch, u8 *Data, u32 Len) {
+	u32 First = P.FifoBytes - Ch->FifoHead;
+
+	if (First > Len)
+		First = Len;
+	memcpy(Data, &Ch->Fifo[Ch->FifoHead], First);
+	memcpy(Data + First, &Ch->Fifo[0], Len - First);
+	Ch->FifoHead = (Ch->FifoHead + Len) % P.FifoBytes;
+	Ch->FifoCount -= Len;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Channel control
+ *
+ ******************************************************************************/
+static void resetChannel(Channel *Ch) {
+	Ch->Cr = 1 << XAXIDMA_COALESCE_SHIFT;
+	Ch->Sr = 0;
+	Ch->Halted = 1;
+	Ch->TailPending = 0;
+	Ch->State = ENG_IDLE;
+	Ch->DescValid = 0;
+	Ch->AtTail = 0;
+	Ch->nBursts = 0;
+	Ch->DataFree = Now;
+	Ch->HaveLastBdEnd = 0;
+	Ch->nPending = 0;
+	Ch->SinceCompletion = 0;
+	Ch->FifoHead = 0;
+	Ch->FifoCount = 0;
+	Ch->FifoReserved = 0;
+	Ch->StreamStarted = 0;
+}
+
+static void haltOnError(Channel *Ch, u32 ErrorBits) {
+	Ch->Sr |= ErrorBits | XAXIDMA_IRQ_ERROR_MASK;
+	Ch->Halted = 1;
+	Ch->State = ENG_IDLE;
+	Ch->nBursts = 0;
+	Ch->Stats.nErrors++;
+}
+
+static void applyTail(Channel *Ch, u32 Tail) {
+	Ch->TailDesc = Tail;
+	if (!Ch->Halted && !Ch->DescValid && Ch->State == ENG_IDLE) {
+		if (Ch->AtTail)
+			Ch->CurDesc = Ch->NextDesc;
+		Ch->AtTail = 0;
+		Ch->DescValid = 1;
+	}
+}
+
+static u32 readStatus(Channel *Ch) {
+	u32 Sr = Ch->Sr;
+
+	if (Ch->Halted)
+		Sr |= XAXIDMA_HALTED_MASK;
+	else if (Ch->State == ENG_IDLE && !Ch->DescValid)
+		Sr |= XAXIDMA_IDLE_MASK;
+
+	return Sr;
+}
+
+static u32 dmaRead(u32 Offset) {
+	Channel *Ch = &Channels[Offset >= XAXIDMA_RX_OFFSET];
+
+	switch (Offset % XAXIDMA_RX_OFFSET) {
+	case XAXIDMA_CR_OFFSET:
+		return Ch->Cr;
+	case XAXIDMA_SR_OFFSET:
+		return readStatus(Ch);
+	case XAXIDMA_CDESC_OFFSET:
+		return Ch->CurDesc;
+	case XAXIDMA_TDESC_OFFSET:
+		return Ch->TailDesc;
+	default:
+		return 0;
+	}
+}
+
+static void dmaWrite(u32 Offset, u32 Value) {
+	Channel *Ch = &Channels[Offset >= XAXIDMA_RX_OFFSET];
+	u32 Old = Ch->Cr;
+	int i;
+
+	switch (Offset % XAXIDMA_RX_OFFSET) {
+	case XAXIDMA_CR_OFFSET:
+		// The reset of either channel resets the whole core
+		if (Value & XAXIDMA_CR_RESET_MASK) {
+			for (i = 0; i < N_CHANNELS; i++)
+				resetChannel(&Channels[i]);
+			return;
+		}
+		Ch->Cr = Value;
+		if ((Old ^ Value) & XAXIDMA_COALESCE_MASK)
+			Ch->nPending = 0;
+		if (!(Old & XAXIDMA_CR_RUNSTOP_MASK)
+				&& (Value & XAXIDMA_CR_RUNSTOP_MASK)) {
+			Ch->Halted = 0;
+			Ch->State = ENG_IDLE;
+			Ch->DescValid = 0;
+			Ch->AtTail = 0;
+		} else if (!(Value & XAXIDMA_CR_RUNSTOP_MASK)) {
+			Ch->Halted = 1;
+			Ch->State = ENG_IDLE;
+			Ch->nBursts = 0;
+		}
+		break;
+	case XAXIDMA_SR_OFFSET:
+		Ch->Sr &= ~(Value & XAXIDMA_IRQ_ALL_MASK);
+		break;
+	case XAXIDMA_CDESC_OFFSET:
+		if (Ch->Halted)
+			Ch->CurDesc = Value;
+		break;
+	case XAXIDMA_TDESC_OFFSET:
+		if (InIsr) {
+			Ch->TailPending = 1;
+			Ch->PendingTail = Value;
+			Ch->TailAt = CpuTime;
+		} else {
+			applyTail(Ch, Value);
+		}
+		break;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * AXI Timer: timer 0 holds the LSBs and timer 1 the MSBs of the counter.
+ *
+ ******************************************************************************/
+static u32 timerRead(u32 Offset) {
+	u64 Count = TimerRunning ? cpuNow() - TimerStart : 0;
+
+	if (Offset == XTC_TCR_OFFSET)
+		return (u32) Count;
+	if (Offset == XTC_TIMER_COUNTER_OFFSET + XTC_TCR_OFFSET)
+		return (u32) (Count >> 32);
+	return 0;
+}
+
+static void timerWrite(u32 Offset, u32 Value) {
+	if (Offset == XTC_TCSR_OFFSET) {
+		if (Value & XTC_CSR_LOAD_MASK) {
+			TimerRunning = 0;
+		} else if ((Value & XTC_CSR_ENABLE_TMR_MASK) && !TimerRunning) {
+			TimerRunning = 1;
+			TimerStart = cpuNow();
+		}
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Engine
+ *
+ ******************************************************************************/
+static void fetchBd(Channel *Ch) {
+	u32 Bd = Ch->CurDesc;
+	u32 Sts;
+
+	if ((Bd % XAXIDMA_BD_MINIMUM_ALIGNMENT) || !inDdr(Bd, sizeof(XAxiDma_Bd))) {
+		haltOnError(Ch, XAXIDMA_ERR_SG_INT_MASK);
+		return;
+	}
+
+	Sts = BD_WORD(Bd, XAXIDMA_BD_STS_OFFSET);
+	if (!(Ch->Cr & XAXIDMA_CR_CYCLIC_MASK)
+			&& (Sts & XAXIDMA_BD_STS_COMPLETE_MASK)) {
+		haltOnError(Ch, XAXIDMA_ERR_SG_INT_MASK);
+		return;
+	}
+
+	Ch->BdAddr = Bd;
+	Ch->NextDesc = BD_WORD(Bd, XAXIDMA_BD_NDESC_OFFSET);
+	Ch->BufAddr = BD_WORD(Bd, XAXIDMA_BD_BUFA_OFFSET);
+	Ch->BdLen = BD_WORD(Bd, XAXIDMA_BD_CTRL_LEN_OFFSET) & lengthMask();
+	Ch->Issued = 0;
+
+	if (Ch->BdLen == 0 || Ch->BufAddr == 0) {
+		BD_WORD(Bd, XAXIDMA_BD_STS_OFFSET) = XAXIDMA_BD_STS_INT_ERR_MASK;
+		haltOnError(Ch, XAXIDMA_ERR_INTERNAL_MASK);
+		return;
+	}
+
+	Ch->State = ENG_DATA;
+}
+
+static void issueBurst(Channel *Ch) {
+	u32 Len = Ch->BdLen - Ch->Issued;
+	u32 Beats;
+	u64 Start;
+	Burst *B;
+
+	if (Ch->nBursts >= P.Outstanding)
+		return;
+	if (Len > (u32) (P.BurstBeats * P.DataBytes))
+		Len = P.BurstBeats * P.DataBytes;
+	Beats = (Len + P.DataBytes - 1) / P.DataBytes;
+
+	B = &Ch->Bursts[(Ch->BurstHead + Ch->nBursts) % AXIDMA_MODEL_MAX_OUTSTANDING];
+	if (!Ch->IsRx) {
+		// The stream backpressure stalls new reads
+		if (Ch->FifoCount + Ch->FifoReserved + Len > (u32) P.FifoBytes)
+			return;
+		Ch->FifoReserved += Len;
+		Start = Now + P.DdrLatency;
+		if (Start < Ch->DataFree)
+			Start = Ch->DataFree;
+		Ch->DataFree = Start + Beats;
+		B->DoneAt = Ch->DataFree;
+	} else {
+		if (Ch->FifoCount < Len)
+			return;
+		fifoPop(Ch, (u8 *) (UINTPTR) (Ch->BufAddr + Ch->Issued), Len);
+		Start = Now;
+		if (Start < Ch->DataFree)
+			Start = Ch->DataFree;
+		Ch->DataFree = Start + Beats;
+		B->DoneAt = Ch->DataFree + P.DdrLatency;
+	}
+
+	B->Offset = Ch->Issued;
+	B->Len = Len;
+	B->First = (Ch->Issued == 0);
+	Ch->Issued += Len;
+	B->Last = (Ch->Issued == Ch->BdLen);
+	Ch->nBursts++;
+}
+
+static void completeBurst(Channel *Ch, Burst *B) {
+	if (!Ch->IsRx) {
+		fifoPush(Ch, (const u8 *) (UINTPTR) (Ch->BufAddr + B->Offset), B->Len);
+		Ch->FifoReserved -= B->Len;
+		Ch->StreamStarted = 1;
+
+		if (B->First && Ch->HaveLastBdEnd
+				&& Now - Ch->LastBdEnd > Ch->Stats.MaxRefillCycles)
+			Ch->Stats.MaxRefillCycles = Now - Ch->LastBdEnd;
+		if (B->Last) {
+			Ch->LastBdEnd = Now;
+			Ch->HaveLastBdEnd = 1;
+		}
+	}
+	Ch->Stats.nBytes += B->Len;
+}
+
+static void completeBd(Channel *Ch) {
+	u32 Sts = XAXIDMA_BD_STS_COMPLETE_MASK | Ch->BdLen;
+	u32 Threshold = (Ch->Cr & XAXIDMA_COALESCE_MASK) >> XAXIDMA_COALESCE_SHIFT;
+
+	if (Ch->IsRx)
+		Sts |= XAXIDMA_BD_STS_RXSOF_MASK | XAXIDMA_BD_STS_RXEOF_MASK;
+	BD_WORD(Ch->BdAddr, XAXIDMA_BD_STS_OFFSET) = Sts;
+
+	Ch->Stats.nBds++;
+	Ch->Stats.LastBdLen = Ch->BdLen;
+
+	Ch->SinceCompletion = 0;
+	if (++Ch->nPending >= Threshold) {
+		Ch->Sr |= XAXIDMA_IRQ_IOC_MASK;
+		Ch->nPending = 0;
+	}
+
+	Ch->State = ENG_IDLE;
+	if (Ch->Cr & XAXIDMA_CR_CYCLIC_MASK) {
+		Ch->CurDesc = Ch->NextDesc;
+	} else if (Ch->BdAddr == Ch->TailDesc) {
+		Ch->CurDesc = Ch->BdAddr;
+		Ch->DescValid = 0;
+		Ch->AtTail = 1;
+	} else {
+		Ch->CurDesc = Ch->NextDesc;
+	}
+}
+
+static void stepStream(Channel *Ch) {
+	u32 Word;
+
+	Ch->StreamAcc += WordsPerCycle;
+	while (Ch->StreamAcc >= 1.0) {
+		Ch->StreamAcc -= 1.0;
+
+		if (Ch->IsRx) {
+			Word = Source ? Source(SourceRef) : SourceCounter++;
+			if (!Ch->Halted
+					&& Ch->FifoCount + STREAM_WORD_BYTES <= (u32) P.FifoBytes) {
+				fifoPush(Ch, (const u8 *) &Word, STREAM_WORD_BYTES);
+				Ch->Stats.nWords++;
+			} else {
+				Ch->Stats.nLostWords++;
+			}
+		} else if (Ch->StreamStarted) {
+			if (Ch->FifoCount >= STREAM_WORD_BYTES) {
+				fifoPop(Ch, (u8 *) &Word, STREAM_WORD_BYTES);
+				if (Sink)
+					Sink(Word, SinkRef);
+				Ch->Stats.nWords++;
+			} else {
+				Ch->Stats.nLostWords++;
+			}
+		}
+	}
+}
+
+static void stepChannel(Channel *Ch) {
+	u32 Delay;
+
+	if (Ch->TailPending && Now >= Ch->TailAt) {
+		Ch->TailPending = 0;
+		applyTail(Ch, Ch->PendingTail);
+	}
+
+	while (Ch->nBursts > 0 && Ch->Bursts[Ch->BurstHead].DoneAt <= Now) {
+		completeBurst(Ch, &Ch->Bursts[Ch->BurstHead]);
+		Ch->BurstHead = (Ch->BurstHead + 1) % AXIDMA_MODEL_MAX_OUTSTANDING;
+		Ch->nBursts--;
+	}
+
+	if (!Ch->Halted) {
+		switch (Ch->State) {
+		case ENG_IDLE:
+			if (Ch->DescValid) {
+				Ch->State = ENG_FETCH;
+				Ch->StateEnd = Now + P.BdFetchCycles;
+			}
+			break;
+		case ENG_FETCH:
+			if (Now >= Ch->StateEnd)
+				fetchBd(Ch);
+			break;
+		case ENG_DATA:
+			if (Ch->Issued < Ch->BdLen) {
+				issueBurst(Ch);
+			} else if (Ch->nBursts == 0) {
+				Ch->State = ENG_UPDATE;
+				Ch->StateEnd = Now + P.BdUpdateCycles;
+			}
+			break;
+		case ENG_UPDATE:
+			if (Now >= Ch->StateEnd)
+				completeBd(Ch);
+			break;
+		}
+	}
+
+	Delay = (Ch->Cr & XAXIDMA_DELAY_MASK) >> XAXIDMA_DELAY_SHIFT;
+	if (Ch->nPending > 0 && Delay > 0
+			&& ++Ch->SinceCompletion >= (u64) Delay * DELAY_TIMER_UNIT) {
+		Ch->Sr |= XAXIDMA_IRQ_DELAY_MASK;
+		Ch->nPending = 0;
+		Ch->SinceCompletion = 0;
+	}
+
+	stepStream(Ch);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Interrupt controller and CPU
+ *
+ ******************************************************************************/
+static void runIsr(Channel *Ch) {
+	InIsr = 1;
+	CpuTime = Now;
+	Ch->Handler(Ch->HandlerRef);
+	InIsr = 0;
+
+	Ch->Stats.nIrqs++;
+	Ch->Stats.IsrCycles += P.IrqLatency + (CpuTime - Now);
+	CpuBusyUntil = CpuTime;
+}
+
+static void stepCpu(void) {
+	Channel *Ch;
+	int i;
+
+	if (IsrChannel) {
+		if (Now >= IsrEntry) {
+			Ch = IsrChannel;
+			IsrChannel = NULL;
+			runIsr(Ch);
+		}
+		return;
+	}
+	if (Now < CpuBusyUntil)
+		return;
+
+	for (i = 0; i < N_CHANNELS; i++) {
+		Ch = &Channels[i];
+		if (Ch->Handler && Ch->IrqId < IrqLevel
+				&& (Ch->Sr & Ch->Cr & XAXIDMA_IRQ_ALL_MASK)
+				&& (!IsrChannel || Ch->IrqId < IsrChannel->IrqId)) {
+			IsrChannel = Ch;
+		}
+	}
+	if (IsrChannel)
+		IsrEntry = Now + P.IrqLatency;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Model interface
+ *
+ ******************************************************************************/
+void AxiDmaModel_defaultParams(AxiDmaModelParams *Params) {
+	Params->ClkHz = 100000000;
+	Params->DataBytes = 4;
+	Params->BurstBeats = 16;
+	Params->Outstanding = 4;
+	Params->DdrLatency = 30;
+	Params->BdFetchCycles = 40;
+	Params->BdUpdateCycles = 20;
+	Params->SgLengthWidth = XPAR_AD9361_DMA_SG_LENGTH_WIDTH;
+	Params->FifoBytes = 2048;
+	Params->IrqLatency = 200;
+	Params->RegCycles = 20;
+	Params->BdCycles = 10;
+	Params->RingCycles = 50;
+	Params->CacheLineCycles = 4;
+}
+
+int AxiDmaModel_init(const AxiDmaModelParams *Params) {
+	static void *Ddr = NULL;
+	int i;
+
+	if (Params->FifoBytes < Params->BurstBeats * Params->DataBytes
+			|| Params->FifoBytes > AXIDMA_MODEL_MAX_FIFO_BYTES
+			|| Params->FifoBytes % STREAM_WORD_BYTES
+			|| Params->Outstanding < 1
+			|| Params->Outstanding > AXIDMA_MODEL_MAX_OUTSTANDING
+			|| Params->SgLengthWidth < 8 || Params->SgLengthWidth > 26) {
+		fprintf(stderr, "Invalid AXI DMA model parameters\n");
+		return XST_INVALID_PARAM;
+	}
+	P = *Params;
+
+	// The driver handles DDR addresses as u32, so map it where it lies
+	if (Ddr == NULL) {
+		Ddr = mmap((void *) (UINTPTR) DDR_BASE, DDR_SIZE,
+				PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+		if (Ddr != (void *) (UINTPTR) DDR_BASE) {
+			perror("DDR mapping");
+			Ddr = NULL;
+			return XST_FAILURE;
+		}
+	}
+
+	Now = 0;
+	InIsr = 0;
+	CpuBusyUntil = 0;
+	IsrChannel = NULL;
+	IrqLevel = 0xFFFFFFFF;
+	TimerRunning = 0;
+	for (i = 0; i < N_CHANNELS; i++) {
+		memset(&Channels[i], 0, sizeof(Channels[i]));
+		resetChannel(&Channels[i]);
+	}
+	Channels[XAXIDMA_DMA_TO_DEVICE].IrqId =
+			XPAR_MICROBLAZE_0_AXI_INTC_AD9361_DMA_MM2S_INTROUT_INTR;
+	Channels[XAXIDMA_DEVICE_TO_DMA].IsRx = 1;
+	Channels[XAXIDMA_DEVICE_TO_DMA].IrqId =
+			XPAR_MICROBLAZE_0_AXI_INTC_AD9361_DMA_S2MM_INTROUT_INTR;
+
+	Config.DeviceId = XPAR_AD9361_DMA_DEVICE_ID;
+	Config.BaseAddr = DMA_BASE;
+	Config.HasMm2S = 1;
+	Config.HasMm2SDRE = 0;
+	Config.Mm2SDataWidth = P.DataBytes * 8;
+	Config.HasS2Mm = 1;
+	Config.HasS2MmDRE = 0;
+	Config.S2MmDataWidth = P.DataBytes * 8;
+	Config.HasSg = 1;
+	Config.Mm2SBurstSize = P.BurstBeats;
+	Config.S2MmBurstSize = P.BurstBeats;
+	Config.SgLengthWidth = P.SgLengthWidth;
+
+	return XST_SUCCESS;
+}
+
+void AxiDmaModel_setStreamRate(double WordsPerSec) {
+	WordsPerCycle = WordsPerSec / P.ClkHz;
+}
+
+void AxiDmaModel_setSink(AxiDmaSink NewSink, void *Ref) {
+	Sink = NewSink;
+	SinkRef = Ref;
+}
+
+void AxiDmaModel_setSource(AxiDmaSource NewSource, void *Ref) {
+	Source = NewSource;
+	SourceRef = Ref;
+}
+
+void AxiDmaModel_setVerbose(int NewVerbose) {
+	Verbose = NewVerbose;
+}
+
+void AxiDmaModel_run(u64 Cycles) {
+	u64 End = Now + Cycles;
+	int i;
+
+	for (; Now < End; Now++) {
+		for (i = 0; i < N_CHANNELS; i++)
+			stepChannel(&Channels[i]);
+		stepCpu();
+	}
+}
+
+u64 AxiDmaModel_now(void) {
+	return Now;
+}
+
+void AxiDmaModel_getStats(int Direction, AxiDmaChannelStats *Stats) {
+	*Stats = Channels[Direction].Stats;
+}
+
+void AxiDmaModel_clearStats(void) {
+	int i;
+
+	for (i = 0; i < N_CHANNELS; i++) {
+		memset(&Channels[i].Stats, 0, sizeof(Channels[i].Stats));
+		Channels[i].HaveLastBdEnd = 0;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Standalone BSP
+ *
+ ******************************************************************************/
+u32 Xil_In32(UINTPTR Addr) {
+	if (Addr >= DMA_BASE && Addr < DMA_BASE + DMA_REGS_SIZE) {
+		charge(P.RegCycles);
+		return dmaRead(Addr - DMA_BASE);
+	}
+	if (Addr >= TIMER_BASE && Addr < TIMER_BASE + TIMER_REGS_SIZE) {
+		charge(P.RegCycles);
+		return timerRead(Addr - TIMER_BASE);
+	}
+	return *(volatile u32 *) Addr;
+}
+
+void Xil_Out32(UINTPTR Addr, u32 Value) {
+	if (Addr >= DMA_BASE && Addr < DMA_BASE + DMA_REGS_SIZE) {
+		charge(P.RegCycles);
+		dmaWrite(Addr - DMA_BASE, Value);
+		return;
+	}
+	if (Addr >= TIMER_BASE && Addr < TIMER_BASE + TIMER_REGS_SIZE) {
+		charge(P.RegCycles);
+		timerWrite(Addr - TIMER_BASE, Value);
+		return;
+	}
+	*(volatile u32 *) Addr = Value;
+}
+
+void Xil_DCacheFlushRange(UINTPTR Addr, u32 Len) {
+	charge(((Addr % CACHE_LINE_LEN + Len + CACHE_LINE_LEN - 1) / CACHE_LINE_LEN)
+			* P.CacheLineCycles);
+}
+
+void Xil_DCacheInvalidateRange(UINTPTR Addr, u32 Len) {
+	Xil_DCacheFlushRange(Addr, Len);
+}
+
+void xil_printf(const char *Format, ...) {
+	char Text[1024];
+	char *Src, *Dst;
+	va_list Args;
+
+	if (!Verbose)
+		return;
+
+	va_start(Args, Format);
+	vsnprintf(Text, sizeof(Text), Format, Args);
+	va_end(Args);
+
+	for (Src = Dst = Text; *Src; Src++) {
+		if (*Src != '\r')
+			*Dst++ = *Src;
+	}
+	*Dst = '\0';
+	fputs(Text, stdout);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Interrupt controller ("drivers/intc/xintc_driver.h")
+ *
+ ******************************************************************************/
+int SetUpInterruptSystem(u8 InterruptId, XInterruptHandler Handler,
+		void *CallBackRef) {
+	int i;
+
+	for (i = 0; i < N_CHANNELS; i++) {
+		if (Channels[i].IrqId == InterruptId) {
+			Channels[i].Handler = Handler;
+			Channels[i].HandlerRef = CallBackRef;
+			return XST_SUCCESS;
+		}
+	}
+	return XST_FAILURE;
+}
+
+void preventIrqUpTo(u8 InterruptId) {
+	charge(P.RegCycles);
+	IrqLevel = InterruptId;
+}
+
+void allowAllIrq(void) {
+	charge(P.RegCycles);
+	IrqLevel = 0xFFFFFFFF;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * AXI DMA driver (the BD ring bookkeeping of the Xilinx axidma driver)
+ *
+ ******************************************************************************/
+static XAxiDma_Bd *ringSeekAhead(XAxiDma_BdRing *RingPtr, XAxiDma_Bd *BdPtr,
+		int NumBd) {
+	UINTPTR Addr = (UINTPTR) BdPtr + RingPtr->Separation * NumBd;
+
+	if (Addr > RingPtr->LastBdAddr)
+		Addr -= RingPtr->Length;
+	return (XAxiDma_Bd *) Addr;
+}
+
+static XAxiDma_Bd *ringSeekBack(XAxiDma_BdRing *RingPtr, XAxiDma_Bd *BdPtr,
+		int NumBd) {
+	UINTPTR Addr = (UINTPTR) BdPtr - RingPtr->Separation * NumBd;
+
+	if (Addr < RingPtr->FirstBdAddr)
+		Addr += RingPtr->Length;
+	return (XAxiDma_Bd *) Addr;
+}
+
+XAxiDma_Config *XAxiDma_LookupConfig(u32 DeviceId) {
+	return (DeviceId == Config.DeviceId) ? &Config : NULL;
+}
+
+static void initRing(XAxiDma_BdRing *RingPtr, UINTPTR ChanBase, int IsRx,
+		const XAxiDma_Config *Cfg) {
+	memset(RingPtr, 0, sizeof(*RingPtr));
+	RingPtr->ChanBase = ChanBase;
+	RingPtr->IsRxChannel = IsRx;
+	RingPtr->RunState = AXIDMA_CHANNEL_HALTED;
+	RingPtr->HasDRE = IsRx ? Cfg->HasS2MmDRE : Cfg->HasMm2SDRE;
+	RingPtr->DataWidth = (IsRx ? Cfg->S2MmDataWidth : Cfg->Mm2SDataWidth) >> 3;
+	RingPtr->MaxTransferLen = (1u << Cfg->SgLengthWidth) - 1;
+}
+
+int XAxiDma_CfgInitialize(XAxiDma *InstancePtr, XAxiDma_Config *Cfg) {
+	int TimeOut = 500;
+
+	InstancePtr->Initialized = 0;
+	InstancePtr->RegBase = Cfg->BaseAddr;
+	InstancePtr->HasMm2S = Cfg->HasMm2S;
+	InstancePtr->HasS2Mm = Cfg->HasS2Mm;
+	InstancePtr->HasSg = Cfg->HasSg;
+
+	initRing(&InstancePtr->TxBdRing, Cfg->BaseAddr + XAXIDMA_TX_OFFSET, 0, Cfg);
+	initRing(&InstancePtr->RxBdRing, Cfg->BaseAddr + XAXIDMA_RX_OFFSET, 1, Cfg);
+
+	XAxiDma_Reset(InstancePtr);
+	while (TimeOut && !XAxiDma_ResetIsDone(InstancePtr))
+		TimeOut--;
+	if (!TimeOut)
+		return XST_FAILURE;
+
+	InstancePtr->Initialized = 1;
+	return XST_SUCCESS;
+}
+
+void XAxiDma_Reset(XAxiDma *InstancePtr) {
+	XAxiDma_BdRing *TxRingPtr = XAxiDma_GetTxRing(InstancePtr);
+	XAxiDma_BdRing *RxRingPtr = XAxiDma_GetRxRing(InstancePtr);
+
+	// Resume point of the rings, as the Xilinx driver snapshots it
+	TxRingPtr->BdaRestart = (XAxiDma_Bd *) (UINTPTR) XAxiDma_ReadReg(
+			TxRingPtr->ChanBase, XAXIDMA_CDESC_OFFSET);
+	RxRingPtr->BdaRestart = (XAxiDma_Bd *) (UINTPTR) XAxiDma_ReadReg(
+			RxRingPtr->ChanBase, XAXIDMA_CDESC_OFFSET);
+
+	XAxiDma_WriteReg(TxRingPtr->ChanBase, XAXIDMA_CR_OFFSET,
+			XAXIDMA_CR_RESET_MASK);
+
+	TxRingPtr->RunState = AXIDMA_CHANNEL_HALTED;
+	RxRingPtr->RunState = AXIDMA_CHANNEL_HALTED;
+}
+
+int XAxiDma_ResetIsDone(XAxiDma *InstancePtr) {
+	return !(XAxiDma_ReadReg(InstancePtr->TxBdRing.ChanBase, XAXIDMA_CR_OFFSET)
+			& XAXIDMA_CR_RESET_MASK);
+}
+
+int XAxiDma_SelectCyclicMode(XAxiDma *InstancePtr, int Direction, int Select) {
+	XAxiDma_BdRing *RingPtr = (Direction == XAXIDMA_DMA_TO_DEVICE) ?
+			XAxiDma_GetTxRing(InstancePtr) : XAxiDma_GetRxRing(InstancePtr);
+	u32 Cr = XAxiDma_ReadReg(RingPtr->ChanBase, XAXIDMA_CR_OFFSET);
+
+	RingPtr->Cyclic = Select ? 1 : 0;
+	if (Select)
+		Cr |= XAXIDMA_CR_CYCLIC_MASK;
+	else
+		Cr &= ~XAXIDMA_CR_CYCLIC_MASK;
+	XAxiDma_WriteReg(RingPtr->ChanBase, XAXIDMA_CR_OFFSET, Cr);
+
+	return XST_SUCCESS;
+}
+
+int XAxiDma_BdRingCreate(XAxiDma_BdRing *RingPtr, UINTPTR PhysAddr,
+		UINTPTR VirtAddr, u32 Alignment, int BdCount) {
+	UINTPTR BdAddr;
+	int i;
+
+	RingPtr->AllCnt = 0;
+	RingPtr->FreeCnt = 0;
+	RingPtr->HwCnt = 0;
+	RingPtr->PreCnt = 0;
+	RingPtr->PostCnt = 0;
+	RingPtr->Cyclic = 0;
+
+	if (BdCount <= 0 || Alignment < XAXIDMA_BD_MINIMUM_ALIGNMENT
+			|| (Alignment & (Alignment - 1)) || (VirtAddr % Alignment)) {
+		return XST_INVALID_PARAM;
+	}
+
+	RingPtr->Separation = (sizeof(XAxiDma_Bd) + (Alignment - 1))
+			& ~(Alignment - 1);
+
+	memset((void *) VirtAddr, 0, RingPtr->Separation * BdCount);
+	BdAddr = VirtAddr;
+	for (i = 0; i < BdCount; i++) {
+		BD_WORD(BdAddr, XAXIDMA_BD_NDESC_OFFSET) = (i == BdCount - 1) ?
+				(u32) PhysAddr : (u32) (PhysAddr + (i + 1) * RingPtr->Separation);
+		BD_WORD(BdAddr, XAXIDMA_BD_HAS_DRE_OFFSET) = (RingPtr->HasDRE
+				<< XAXIDMA_BD_HAS_DRE_SHIFT) | RingPtr->DataWidth;
+		BdAddr += RingPtr->Separation;
+	}
+	chargeRing(BdCount);
+
+	RingPtr->FirstBdAddr = VirtAddr;
+	RingPtr->LastBdAddr = VirtAddr + (BdCount - 1) * RingPtr->Separation;
+	RingPtr->Length = RingPtr->Separation * BdCount;
+	RingPtr->AllCnt = BdCount;
+	RingPtr->FreeCnt = BdCount;
+	RingPtr->FreeHead = (XAxiDma_Bd *) VirtAddr;
+	RingPtr->PreHead = (XAxiDma_Bd *) VirtAddr;
+	RingPtr->HwHead = (XAxiDma_Bd *) VirtAddr;
+	RingPtr->HwTail = (XAxiDma_Bd *) VirtAddr;
+	RingPtr->PostHead = (XAxiDma_Bd *) VirtAddr;
+	RingPtr->BdaRestart = (XAxiDma_Bd *) VirtAddr;
+	RingPtr->CyclicBd = NULL;
+
+	return XST_SUCCESS;
+}
+
+int XAxiDma_BdRingClone(XAxiDma_BdRing *RingPtr, XAxiDma_Bd *SrcBdPtr) {
+	UINTPTR BdAddr;
+	int i;
+
+	if (RingPtr->AllCnt == 0)
+		return XST_DMA_SG_NO_LIST;
+	if (RingPtr->RunState != AXIDMA_CHANNEL_HALTED)
+		return XST_DEVICE_IS_STARTED;
+	if (RingPtr->FreeCnt != RingPtr->AllCnt)
+		return XST_DMA_SG_LIST_ERROR;
+
+	// Every field but the next pointer and the channel attributes
+	BdAddr = RingPtr->FirstBdAddr;
+	for (i = 0; i < RingPtr->AllCnt; i++) {
+		memcpy((u8 *) BdAddr + XAXIDMA_BD_START_CLEAR,
+				(u8 *) SrcBdPtr + XAXIDMA_BD_START_CLEAR,
+				XAXIDMA_BD_BYTES_TO_CLEAR);
+		BdAddr += RingPtr->Separation;
+	}
+	chargeRing(RingPtr->AllCnt);
+
+	return XST_SUCCESS;
+}
+
+int XAxiDma_BdRingStart(XAxiDma_BdRing *RingPtr) {
+	XAxiDma_Bd *BdPtr;
+
+	if (RingPtr->AllCnt == 0)
+		return XST_DMA_SG_NO_LIST;
+
+	charge(P.RingCycles);
+	if (RingPtr->RunState == AXIDMA_CHANNEL_HALTED) {
+		BdPtr = RingPtr->HwCnt ? RingPtr->HwHead : RingPtr->BdaRestart;
+		XAxiDma_WriteReg(RingPtr->ChanBase, XAXIDMA_CDESC_OFFSET,
+				(u32) (UINTPTR) BdPtr);
+		XAxiDma_WriteReg(RingPtr->ChanBase, XAXIDMA_CR_OFFSET,
+				XAxiDma_ReadReg(RingPtr->ChanBase, XAXIDMA_CR_OFFSET)
+						| XAXIDMA_CR_RUNSTOP_MASK);
+		RingPtr->RunState = AXIDMA_CHANNEL_NOT_HALTED;
+	}
+
+	// Processing starts at once if BDs were committed before
+	if (RingPtr->HwCnt > 0) {
+		BdPtr = RingPtr->Cyclic ? RingPtr->CyclicBd : RingPtr->HwTail;
+		XAxiDma_WriteReg(RingPtr->ChanBase, XAXIDMA_TDESC_OFFSET,
+				(u32) (UINTPTR) BdPtr);
+	}
+
+	return XST_SUCCESS;
+}
+
+int XAxiDma_BdRingSetCoalesce(XAxiDma_BdRing *RingPtr, u32 Counter,
+		u32 Timer) {
+	u32 Cr = XAxiDma_ReadReg(RingPtr->ChanBase, XAXIDMA_CR_OFFSET);
+
+	if (Counter != XAXIDMA_NO_CHANGE) {
+		if (Counter == 0 || Counter > 0xFF)
+			return XST_FAILURE;
+		Cr = (Cr & ~XAXIDMA_COALESCE_MASK) | (Counter << XAXIDMA_COALESCE_SHIFT);
+	}
+	if (Timer != XAXIDMA_NO_CHANGE) {
+		if (Timer > 0xFF)
+			return XST_FAILURE;
+		Cr = (Cr & ~XAXIDMA_DELAY_MASK) | (Timer << XAXIDMA_DELAY_SHIFT);
+	}
+	XAxiDma_WriteReg(RingPtr->ChanBase, XAXIDMA_CR_OFFSET, Cr);
+
+	return XST_SUCCESS;
+}
+
+int XAxiDma_BdRingAlloc(XAxiDma_BdRing *RingPtr, int NumBd,
+		XAxiDma_Bd **BdSetPtr) {
+	if (NumBd <= 0)
+		return XST_INVALID_PARAM;
+	charge(P.RingCycles);
+	if (RingPtr->FreeCnt < NumBd)
+		return XST_FAILURE;
+
+	*BdSetPtr = RingPtr->FreeHead;
+	RingPtr->FreeHead = ringSeekAhead(RingPtr, RingPtr->FreeHead, NumBd);
+	RingPtr->FreeCnt -= NumBd;
+	RingPtr->PreCnt += NumBd;
+
+	return XST_SUCCESS;
+}
+
+int XAxiDma_BdRingUnAlloc(XAxiDma_BdRing *RingPtr, int NumBd,
+		XAxiDma_Bd *BdSetPtr) {
+	if (NumBd <= 0)
+		return XST_INVALID_PARAM;
+	charge(P.RingCycles);
+	if (RingPtr->PreCnt < NumBd)
+		return XST_FAILURE;
+
+	RingPtr->FreeHead = ringSeekBack(RingPtr, RingPtr->FreeHead, NumBd);
+	RingPtr->FreeCnt += NumBd;
+	RingPtr->PreCnt -= NumBd;
+
+	return XST_SUCCESS;
+}
+
+int XAxiDma_BdRingToHw(XAxiDma_BdRing *RingPtr, int NumBd,
+		XAxiDma_Bd *BdSetPtr) {
+	XAxiDma_Bd *CurBdPtr = BdSetPtr;
+	u32 Cr;
+	int i;
+
+	if (NumBd < 0)
+		return XST_INVALID_PARAM;
+	if (NumBd == 0)
+		return XST_SUCCESS;
+	if (RingPtr->PreCnt < NumBd || RingPtr->PreHead != BdSetPtr)
+		return XST_DMA_SG_LIST_ERROR;
+
+	chargeRing(NumBd);
+
+	// A Tx packet starts with SOF and ends with EOF
+	Cr = BD_WORD(CurBdPtr, XAXIDMA_BD_CTRL_LEN_OFFSET);
+	if (!RingPtr->IsRxChannel && !(Cr & XAXIDMA_BD_CTRL_TXSOF_MASK))
+		return XST_FAILURE;
+
+	for (i = 0; i < NumBd; i++) {
+		Cr = BD_WORD(CurBdPtr, XAXIDMA_BD_CTRL_LEN_OFFSET);
+		if (!(Cr & RingPtr->MaxTransferLen))
+			return XST_INVALID_PARAM;
+		BD_WORD(CurBdPtr, XAXIDMA_BD_STS_OFFSET) &=
+				~XAXIDMA_BD_STS_COMPLETE_MASK;
+		if (i < NumBd - 1)
+			CurBdPtr = XAxiDma_BdRingNext(RingPtr, CurBdPtr);
+	}
+
+	if (!RingPtr->IsRxChannel && !(Cr & XAXIDMA_BD_CTRL_TXEOF_MASK))
+		return XST_FAILURE;
+
+	RingPtr->PreHead = ringSeekAhead(RingPtr, RingPtr->PreHead, NumBd);
+	RingPtr->PreCnt -= NumBd;
+	RingPtr->HwTail = CurBdPtr;
+	RingPtr->HwCnt += NumBd;
+	if (RingPtr->Cyclic)
+		RingPtr->CyclicBd = CurBdPtr;
+
+	if (RingPtr->RunState == AXIDMA_CHANNEL_NOT_HALTED) {
+		XAxiDma_WriteReg(RingPtr->ChanBase, XAXIDMA_TDESC_OFFSET,
+				(u32) (UINTPTR) CurBdPtr);
+	}
+
+	return XST_SUCCESS;
+}
+
+int XAxiDma_BdRingFromHw(XAxiDma_BdRing *RingPtr, int BdLimit,
+		XAxiDma_Bd **BdSetPtr) {
+	XAxiDma_Bd *CurBdPtr;
+	int BdCount = 0;
+	int BdPartialCount = 0;
+	u32 BdSts, BdCr;
+
+	charge(P.RingCycles);
+	if (RingPtr->HwCnt == 0) {
+		*BdSetPtr = NULL;
+		return 0;
+	}
+	if (BdLimit > RingPtr->HwCnt)
+		BdLimit = RingPtr->HwCnt;
+
+	CurBdPtr = RingPtr->HwHead;
+	while (BdCount < BdLimit) {
+		chargeBds(1);
+		BdSts = BD_WORD(CurBdPtr, XAXIDMA_BD_STS_OFFSET);
+		BdCr = BD_WORD(CurBdPtr, XAXIDMA_BD_CTRL_LEN_OFFSET);
+		if (!(BdSts & XAXIDMA_BD_STS_COMPLETE_MASK))
+			break;
+
+		BdCount++;
+
+		// Only whole packets are returned
+		if ((!RingPtr->IsRxChannel && (BdCr & XAXIDMA_BD_CTRL_TXEOF_MASK))
+				|| (RingPtr->IsRxChannel
+						&& (BdSts & XAXIDMA_BD_STS_RXEOF_MASK)))
+			BdPartialCount = 0;
+		else
+			BdPartialCount++;
+
+		if (CurBdPtr == RingPtr->HwTail)
+			break;
+		CurBdPtr = XAxiDma_BdRingNext(RingPtr, CurBdPtr);
+	}
+	BdCount -= BdPartialCount;
+
+	if (BdCount == 0) {
+		*BdSetPtr = NULL;
+		return 0;
+	}
+
+	*BdSetPtr = RingPtr->HwHead;
+	RingPtr->HwCnt -= BdCount;
+	RingPtr->PostCnt += BdCount;
+	RingPtr->HwHead = ringSeekAhead(RingPtr, RingPtr->HwHead, BdCount);
+	RingPtr->BdaRestart = RingPtr->HwHead;
+
+	return BdCount;
+}
+
+int XAxiDma_BdRingFree(XAxiDma_BdRing *RingPtr, int NumBd,
+		XAxiDma_Bd *BdSetPtr) {
+	if (NumBd < 0)
+		return XST_INVALID_PARAM;
+	if (NumBd == 0)
+		return XST_SUCCESS;
+	charge(P.RingCycles);
+	if (RingPtr->PostCnt < NumBd || RingPtr->PostHead != BdSetPtr)
+		return XST_DMA_SG_LIST_ERROR;
+
+	RingPtr->PostHead = ringSeekAhead(RingPtr, RingPtr->PostHead, NumBd);
+	RingPtr->FreeCnt += NumBd;
+	RingPtr->PostCnt -= NumBd;
+
+	return XST_SUCCESS;
+}
+
+void XAxiDma_BdRingDumpRegs(XAxiDma_BdRing *RingPtr) {
+	UINTPTR Base = RingPtr->ChanBase;
+
+	xil_printf("Dump registers %x:\r\n", (unsigned int) Base);
+	xil_printf("Control REG: %08x\r\n",
+			(unsigned int) XAxiDma_ReadReg(Base, XAXIDMA_CR_OFFSET));
+	xil_printf("Status REG: %08x\r\n",
+			(unsigned int) XAxiDma_ReadReg(Base, XAXIDMA_SR_OFFSET));
+	xil_printf("Cur BD REG: %08x\r\n",
+			(unsigned int) XAxiDma_ReadReg(Base, XAXIDMA_CDESC_OFFSET));
+	xil_printf("Tail BD REG: %08x\r\n",
+			(unsigned int) XAxiDma_ReadReg(Base, XAXIDMA_TDESC_OFFSET));
+}
+
+/*****************************************************************************/
+/*
+ *
+ * BD accessors
+ *
+ ******************************************************************************/
+void XAxiDma_BdClear(XAxiDma_Bd *BdPtr) {
+	charge(P.BdCycles);
+	memset((u8 *) BdPtr + XAXIDMA_BD_START_CLEAR, 0, XAXIDMA_BD_BYTES_TO_CLEAR);
+}
+
+int XAxiDma_BdSetBufAddr(XAxiDma_Bd *BdPtr, UINTPTR Addr) {
+	u32 Attr = BD_WORD(BdPtr, XAXIDMA_BD_HAS_DRE_OFFSET);
+	u32 WordLen = Attr & XAXIDMA_BD_WORDLEN_MASK;
+
+	charge(P.BdCycles);
+
+	// Without the realignment engine, buffers must be word aligned
+	if (!(Attr & XAXIDMA_BD_HAS_DRE_MASK) && WordLen
+			&& (Addr & (WordLen - 1))) {
+		return XST_INVALID_PARAM;
+	}
+
+	BD_WORD(BdPtr, XAXIDMA_BD_BUFA_OFFSET) = (u32) Addr;
+	return XST_SUCCESS;
+}
+
+int XAxiDma_BdSetLength(XAxiDma_Bd *BdPtr, u32 LenBytes, u32 LengthMask) {
+	charge(P.BdCycles);
+	if (LenBytes == 0 || LenBytes > LengthMask)
+		return XST_INVALID_PARAM;
+
+	BD_WORD(BdPtr, XAXIDMA_BD_CTRL_LEN_OFFSET) = (BD_WORD(BdPtr,
+			XAXIDMA_BD_CTRL_LEN_OFFSET) & ~LengthMask) | LenBytes;
+	return XST_SUCCESS;
+}
+
+void XAxiDma_BdSetCtrl(XAxiDma_Bd *BdPtr, u32 Data) {
+	charge(P.BdCycles);
+	BD_WORD(BdPtr, XAXIDMA_BD_CTRL_LEN_OFFSET) = (BD_WORD(BdPtr,
+			XAXIDMA_BD_CTRL_LEN_OFFSET) & ~XAXIDMA_BD_CTRL_ALL_MASK)
+			| (Data & XAXIDMA_BD_CTRL_ALL_MASK);
+}
+
+void XAxiDma_BdSetId(XAxiDma_Bd *BdPtr, UINTPTR Id) {
+	charge(P.BdCycles);
+	BD_WORD(BdPtr, XAXIDMA_BD_ID_OFFSET) = (u32) Id;
+}
+
+u32 XAxiDma_BdGetCtrl(XAxiDma_Bd *BdPtr) {
+	charge(P.BdCycles);
+	return BD_WORD(BdPtr, XAXIDMA_BD_CTRL_LEN_OFFSET) & XAXIDMA_BD_CTRL_ALL_MASK;
+}
+
+u32 XAxiDma_BdGetSts(XAxiDma_Bd *BdPtr) {
+	charge(P.BdCycles);
+	return BD_WORD(BdPtr, XAXIDMA_BD_STS_OFFSET) & XAXIDMA_BD_STS_ALL_MASK;
+}
+
+u32 XAxiDma_BdGetLength(XAxiDma_Bd *BdPtr, u32 LengthMask) {
+	charge(P.BdCycles);
+	return BD_WORD(BdPtr, XAXIDMA_BD_CTRL_LEN_OFFSET) & LengthMask;
+}
+
+u32 XAxiDma_BdGetActualLength(XAxiDma_Bd *BdPtr, u32 LengthMask) {
+	charge(P.BdCycles);
+	return BD_WORD(BdPtr, XAXIDMA_BD_STS_OFFSET) & LengthMask;
+}
+
+UINTPTR XAxiDma_BdGetId(XAxiDma_Bd *BdPtr) {
+	charge(P.BdCycles);
+	return BD_WORD(BdPtr, XAXIDMA_BD_ID_OFFSET);
+}
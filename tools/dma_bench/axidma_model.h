@@ -0,0 +1,91 @@
+/*
+ * axidma_model.h
+ *
+ * Host model of the DMA subsystem of the design, on which the firmware DMA
+ * driver ("drivers/dma/dma_driver.c") runs unchanged:
+ *
+ *  - the AXI DMA in scatter-gather mode, behind the Xilinx driver API of
+ *    "bsp/xaxidma.h": the MM2S and S2MM engines fetch, process and complete
+ *    the BDs written by the driver in the simulated DDR, with the interrupt
+ *    coalescing counter and delay timer of each channel;
+ *  - the AXI streams to the DAC and from the ADC paths, which run at a fixed
+ *    word rate behind a FIFO (the stream interface of ad9361_data);
+ *  - the interrupt controller and the MicroBlaze running the ISRs, which
+ *    are charged a CPU time per register access, BD access and cache line
+ *    maintained;
+ *  - the AXI Timer, as the time base of "drivers/timer/timestamp.c".
+ *
+ * The simulation advances in cycles of the 100 MHz clock shared by the AXI
+ * bus, the DMA and the CPU. An ISR runs on the state at its entry, its
+ * register writes take effect immediately, except the tail descriptor
+ * writes, which take effect at the CPU time they are issued. The channels
+ * do not contend for the DDR.
+ */
+
+#ifndef AXIDMA_MODEL_H_
+#define AXIDMA_MODEL_H_
+
+#include "xil_types.h"
+
+/************************** Constant Definitions *****************************/
+
+#define AXIDMA_MODEL_MAX_FIFO_BYTES		65536
+#define AXIDMA_MODEL_MAX_OUTSTANDING	16
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	u32 ClkHz;			/* AXI, DMA and CPU clock */
+
+	/* AXI DMA and DDR */
+	int DataBytes;		/* Memory-mapped and stream data width */
+	int BurstBeats;		/* Maximum burst length */
+	int Outstanding;	/* Bursts in flight per channel */
+	int DdrLatency;		/* Cycles from a request to its first beat */
+	int BdFetchCycles;	/* Descriptor fetch */
+	int BdUpdateCycles;	/* Descriptor status write back */
+	int SgLengthWidth;	/* Width of the BD length field */
+	int FifoBytes;		/* Stream FIFO of each direction */
+
+	/* MicroBlaze */
+	int IrqLatency;		/* Interrupt controller, vector and ISR entry */
+	int RegCycles;		/* AXI-Lite register access */
+	int BdCycles;		/* BD field access */
+	int RingCycles;		/* BD ring operation, plus a BD access and two
+						   cache lines per BD */
+	int CacheLineCycles;	/* Flush or invalidation of one cache line */
+} AxiDmaModelParams;
+
+typedef struct {
+	u64 nBytes;			/* Bytes moved by the engine */
+	u64 nBds;			/* BDs completed */
+	u32 LastBdLen;		/* Length of the last BD completed */
+	u64 nWords;			/* Stream words delivered (MM2S) or accepted (S2MM) */
+	u64 nLostWords;		/* Stream words missing (MM2S) or dropped (S2MM) */
+	u64 MaxRefillCycles;/* Longest gap between the data of consecutive BDs */
+	u32 nIrqs;			/* ISR runs */
+	u64 IsrCycles;		/* CPU cycles spent in the ISR, entry included */
+	u32 nErrors;		/* Channel errors (the engine halts) */
+} AxiDmaChannelStats;
+
+/*
+ * Observer of the words delivered to the DAC path, and generator of the words
+ * of the ADC path (an incrementing counter by default).
+ */
+typedef void (*AxiDmaSink)(u32 Word, void *Ref);
+typedef u32 (*AxiDmaSource)(void *Ref);
+
+/************************** Function Prototypes *****************************/
+
+void AxiDmaModel_defaultParams(AxiDmaModelParams *Params);
+int AxiDmaModel_init(const AxiDmaModelParams *Params);
+void AxiDmaModel_setStreamRate(double WordsPerSec);
+void AxiDmaModel_setSink(AxiDmaSink Sink, void *Ref);
+void AxiDmaModel_setSource(AxiDmaSource Source, void *Ref);
+void AxiDmaModel_setVerbose(int Verbose);
+void AxiDmaModel_run(u64 Cycles);
+u64 AxiDmaModel_now(void);
+void AxiDmaModel_getStats(int Direction, AxiDmaChannelStats *Stats);
+void AxiDmaModel_clearStats(void);
+
+#endif /* AXIDMA_MODEL_H_ */
@@ -0,0 +1,20 @@
+/*
+ * roe_bd_configuration.h
+ *
+ * Host stand-in of the block design configuration: both DMA channels are
+ * enabled, so that the capture and the loopback are built.
+ */
+
+#ifndef ROE_BD_CONFIGURATION_H
+#define ROE_BD_CONFIGURATION_H
+
+#define ROE_SRC_EMULATOR	0
+#define ROE_SRC_DMA			1
+#define ROE_SRC_ADC			2
+#define ROE_SINK_DMA		1
+#define ROE_SINK_DAC		2
+
+#define ROE_CPRI_SRC		ROE_SRC_DMA
+#define ROE_CPRI_SINK		ROE_SINK_DMA
+
+#endif /* ROE_BD_CONFIGURATION_H */
@@ -0,0 +1,238 @@
+/*
+ * xaxidma.h
+ *
+ * Host stand-in of the Xilinx AXI DMA driver (axidma v9), limited to the
+ * scatter-gather API used by "drivers/dma". Names, register and BD layouts,
+ * and the BD ring bookkeeping follow the Xilinx driver, so that the firmware
+ * driver builds unchanged. The functions are implemented by the AXI DMA model
+ * (see "../axidma_model.c"), which also charges their CPU time.
+ */
+
+#ifndef XAXIDMA_H
+#define XAXIDMA_H
+
+#include "xil_types.h"
+#include "xil_io.h"
+#include "xstatus.h"
+#include "xil_cache.h"
+#include "xil_printf.h"
+
+/************************** Constant Definitions *****************************/
+
+#define XAXIDMA_DMA_TO_DEVICE		0x00
+#define XAXIDMA_DEVICE_TO_DMA		0x01
+
+#define XAXIDMA_NO_CHANGE			0xFFFFFFFF
+#define XAXIDMA_ALL_BDS				0x0FFFFFFF
+
+/* Channel register blocks and registers */
+#define XAXIDMA_TX_OFFSET			0x00000000
+#define XAXIDMA_RX_OFFSET			0x00000030
+
+#define XAXIDMA_CR_OFFSET			0x00000000
+#define XAXIDMA_SR_OFFSET			0x00000004
+#define XAXIDMA_CDESC_OFFSET		0x00000008
+#define XAXIDMA_TDESC_OFFSET		0x00000010
+
+#define XAXIDMA_CR_RUNSTOP_MASK		0x00000001
+#define XAXIDMA_CR_RESET_MASK		0x00000004
+#define XAXIDMA_CR_CYCLIC_MASK		0x00000010
+
+#define XAXIDMA_HALTED_MASK			0x00000001
+#define XAXIDMA_IDLE_MASK			0x00000002
+#define XAXIDMA_ERR_INTERNAL_MASK	0x00000010
+#define XAXIDMA_ERR_SG_INT_MASK		0x00000100
+
+#define XAXIDMA_IRQ_IOC_MASK		0x00001000
+#define XAXIDMA_IRQ_DELAY_MASK		0x00002000
+#define XAXIDMA_IRQ_ERROR_MASK		0x00004000
+#define XAXIDMA_IRQ_ALL_MASK		0x00007000
+
+#define XAXIDMA_COALESCE_MASK		0x00FF0000
+#define XAXIDMA_COALESCE_SHIFT		16
+#define XAXIDMA_DELAY_MASK			0xFF000000
+#define XAXIDMA_DELAY_SHIFT			24
+
+/* Buffer descriptor */
+#define XAXIDMA_BD_NUM_WORDS		16U
+#define XAXIDMA_BD_MINIMUM_ALIGNMENT	0x40
+
+#define XAXIDMA_BD_NDESC_OFFSET		0x00
+#define XAXIDMA_BD_BUFA_OFFSET		0x08
+#define XAXIDMA_BD_CTRL_LEN_OFFSET	0x18
+#define XAXIDMA_BD_STS_OFFSET		0x1C
+#define XAXIDMA_BD_ID_OFFSET		0x34
+#define XAXIDMA_BD_HAS_DRE_OFFSET	0x3C
+
+#define XAXIDMA_BD_START_CLEAR		8
+#define XAXIDMA_BD_BYTES_TO_CLEAR	48
+
+#define XAXIDMA_BD_HAS_DRE_MASK		0xF00
+#define XAXIDMA_BD_HAS_DRE_SHIFT	8
+#define XAXIDMA_BD_WORDLEN_MASK		0xFF
+
+#define XAXIDMA_BD_CTRL_TXSOF_MASK	0x08000000
+#define XAXIDMA_BD_CTRL_TXEOF_MASK	0x04000000
+#define XAXIDMA_BD_CTRL_ALL_MASK	0x0C000000
+
+#define XAXIDMA_BD_STS_COMPLETE_MASK	0x80000000
+#define XAXIDMA_BD_STS_DEC_ERR_MASK		0x40000000
+#define XAXIDMA_BD_STS_SLV_ERR_MASK		0x20000000
+#define XAXIDMA_BD_STS_INT_ERR_MASK		0x10000000
+#define XAXIDMA_BD_STS_ALL_ERR_MASK		0x70000000
+#define XAXIDMA_BD_STS_RXSOF_MASK		0x08000000
+#define XAXIDMA_BD_STS_RXEOF_MASK		0x04000000
+#define XAXIDMA_BD_STS_ALL_MASK			0xFC000000
+
+/* Channel states */
+#define AXIDMA_CHANNEL_NOT_HALTED	1
+#define AXIDMA_CHANNEL_HALTED		2
+
+/**************************** Type Definitions *******************************/
+
+typedef u32 XAxiDma_Bd[XAXIDMA_BD_NUM_WORDS];
+
+typedef struct {
+	UINTPTR ChanBase;
+	int IsRxChannel;
+	volatile int RunState;
+	int HasDRE;
+	int DataWidth;
+	u32 MaxTransferLen;
+	UINTPTR FirstBdAddr;
+	UINTPTR LastBdAddr;
+	u32 Length;
+	UINTPTR Separation;
+	XAxiDma_Bd *FreeHead;
+	XAxiDma_Bd *PreHead;
+	XAxiDma_Bd *HwHead;
+	XAxiDma_Bd *HwTail;
+	XAxiDma_Bd *PostHead;
+	XAxiDma_Bd *BdaRestart;
+	XAxiDma_Bd *CyclicBd;
+	int FreeCnt;
+	int PreCnt;
+	int HwCnt;
+	int PostCnt;
+	int AllCnt;
+	int Cyclic;
+} XAxiDma_BdRing;
+
+typedef struct {
+	u32 DeviceId;
+	UINTPTR BaseAddr;
+	int HasMm2S;
+	int HasMm2SDRE;
+	int Mm2SDataWidth;
+	int HasS2Mm;
+	int HasS2MmDRE;
+	int S2MmDataWidth;
+	int HasSg;
+	int Mm2SBurstSize;
+	int S2MmBurstSize;
+	int SgLengthWidth;
+} XAxiDma_Config;
+
+typedef struct {
+	UINTPTR RegBase;
+	int HasMm2S;
+	int HasS2Mm;
+	int Initialized;
+	int HasSg;
+	XAxiDma_BdRing TxBdRing;
+	XAxiDma_BdRing RxBdRing;
+} XAxiDma;
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+#define XAxiDma_ReadReg(BaseAddress, RegOffset) \
+	Xil_In32((BaseAddress) + (RegOffset))
+
+#define XAxiDma_WriteReg(BaseAddress, RegOffset, Data) \
+	Xil_Out32((BaseAddress) + (RegOffset), (Data))
+
+#define XAxiDma_GetTxRing(InstancePtr)	(&((InstancePtr)->TxBdRing))
+#define XAxiDma_GetRxRing(InstancePtr)	(&((InstancePtr)->RxBdRing))
+
+#define XAxiDma_HasSg(InstancePtr)	((InstancePtr)->HasSg)
+
+#define XAxiDma_BdRingCntCalc(Alignment, Bytes) \
+	(u32) ((Bytes) / ((sizeof(XAxiDma_Bd) + ((Alignment) - 1)) \
+			& ~((Alignment) - 1)))
+
+#define XAxiDma_BdRingGetFreeCnt(RingPtr)	((RingPtr)->FreeCnt)
+
+#define XAxiDma_BdRingNext(RingPtr, BdPtr) \
+	((XAxiDma_Bd *) (((UINTPTR) (BdPtr) >= (RingPtr)->LastBdAddr) ? \
+			(RingPtr)->FirstBdAddr : \
+			(UINTPTR) (BdPtr) + (RingPtr)->Separation))
+
+#define XAxiDma_BdRingGetIrq(RingPtr) \
+	(XAxiDma_ReadReg((RingPtr)->ChanBase, XAXIDMA_SR_OFFSET) \
+			& XAXIDMA_IRQ_ALL_MASK)
+
+#define XAxiDma_BdRingAckIrq(RingPtr, Mask) \
+	XAxiDma_WriteReg((RingPtr)->ChanBase, XAXIDMA_SR_OFFSET, \
+			(Mask) & XAXIDMA_IRQ_ALL_MASK)
+
+#define XAxiDma_BdRingIntEnable(RingPtr, Mask) \
+	XAxiDma_WriteReg((RingPtr)->ChanBase, XAXIDMA_CR_OFFSET, \
+			XAxiDma_ReadReg((RingPtr)->ChanBase, XAXIDMA_CR_OFFSET) \
+			| ((Mask) & XAXIDMA_IRQ_ALL_MASK))
+
+#define XAxiDma_BdRingIntDisable(RingPtr, Mask) \
+	XAxiDma_WriteReg((RingPtr)->ChanBase, XAXIDMA_CR_OFFSET, \
+			XAxiDma_ReadReg((RingPtr)->ChanBase, XAXIDMA_CR_OFFSET) \
+			& ~((Mask) & XAXIDMA_IRQ_ALL_MASK))
+
+#define XAxiDma_IntrEnable(InstancePtr, Mask, Direction) \
+	XAxiDma_BdRingIntEnable((Direction) == XAXIDMA_DMA_TO_DEVICE ? \
+			XAxiDma_GetTxRing(InstancePtr) : \
+			XAxiDma_GetRxRing(InstancePtr), (Mask))
+
+#define XAxiDma_IntrDisable(InstancePtr, Mask, Direction) \
+	XAxiDma_BdRingIntDisable((Direction) == XAXIDMA_DMA_TO_DEVICE ? \
+			XAxiDma_GetTxRing(InstancePtr) : \
+			XAxiDma_GetRxRing(InstancePtr), (Mask))
+
+/************************** Function Prototypes ******************************/
+
+/* Instance */
+XAxiDma_Config *XAxiDma_LookupConfig(u32 DeviceId);
+int XAxiDma_CfgInitialize(XAxiDma *InstancePtr, XAxiDma_Config *Config);
+void XAxiDma_Reset(XAxiDma *InstancePtr);
+int XAxiDma_ResetIsDone(XAxiDma *InstancePtr);
+int XAxiDma_SelectCyclicMode(XAxiDma *InstancePtr, int Direction, int Select);
+
+/* BD ring */
+int XAxiDma_BdRingCreate(XAxiDma_BdRing *RingPtr, UINTPTR PhysAddr,
+		UINTPTR VirtAddr, u32 Alignment, int BdCount);
+int XAxiDma_BdRingClone(XAxiDma_BdRing *RingPtr, XAxiDma_Bd *SrcBdPtr);
+int XAxiDma_BdRingStart(XAxiDma_BdRing *RingPtr);
+int XAxiDma_BdRingSetCoalesce(XAxiDma_BdRing *RingPtr, u32 Counter,
+		u32 Timer);
+int XAxiDma_BdRingAlloc(XAxiDma_BdRing *RingPtr, int NumBd,
+		XAxiDma_Bd **BdSetPtr);
+int XAxiDma_BdRingUnAlloc(XAxiDma_BdRing *RingPtr, int NumBd,
+		XAxiDma_Bd *BdSetPtr);
+int XAxiDma_BdRingToHw(XAxiDma_BdRing *RingPtr, int NumBd,
+		XAxiDma_Bd *BdSetPtr);
+int XAxiDma_BdRingFromHw(XAxiDma_BdRing *RingPtr, int BdLimit,
+		XAxiDma_Bd **BdSetPtr);
+int XAxiDma_BdRingFree(XAxiDma_BdRing *RingPtr, int NumBd,
+		XAxiDma_Bd *BdSetPtr);
+void XAxiDma_BdRingDumpRegs(XAxiDma_BdRing *RingPtr);
+
+/* BD */
+void XAxiDma_BdClear(XAxiDma_Bd *BdPtr);
+int XAxiDma_BdSetBufAddr(XAxiDma_Bd *BdPtr, UINTPTR Addr);
+int XAxiDma_BdSetLength(XAxiDma_Bd *BdPtr, u32 LenBytes, u32 LengthMask);
+void XAxiDma_BdSetCtrl(XAxiDma_Bd *BdPtr, u32 Data);
+void XAxiDma_BdSetId(XAxiDma_Bd *BdPtr, UINTPTR Id);
+u32 XAxiDma_BdGetCtrl(XAxiDma_Bd *BdPtr);
+u32 XAxiDma_BdGetSts(XAxiDma_Bd *BdPtr);
+u32 XAxiDma_BdGetLength(XAxiDma_Bd *BdPtr, u32 LengthMask);
+u32 XAxiDma_BdGetActualLength(XAxiDma_Bd *BdPtr, u32 LengthMask);
+UINTPTR XAxiDma_BdGetId(XAxiDma_Bd *BdPtr);
+
+#endif /* XAXIDMA_H */
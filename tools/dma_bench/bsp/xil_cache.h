@@ -0,0 +1,16 @@
+/*
+ * xil_cache.h
+ *
+ * Host stand-in of the standalone BSP header. The host has no data cache to
+ * maintain, the model only charges the CPU time of the maintenance.
+ */
+
+#ifndef XIL_CACHE_H
+#define XIL_CACHE_H
+
+#include "xil_types.h"
+
+void Xil_DCacheFlushRange(UINTPTR Addr, u32 Len);
+void Xil_DCacheInvalidateRange(UINTPTR Addr, u32 Len);
+
+#endif /* XIL_CACHE_H */
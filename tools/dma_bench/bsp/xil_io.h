@@ -0,0 +1,17 @@
+/*
+ * xil_io.h
+ *
+ * Host stand-in of the standalone BSP header. Accesses to the registers of
+ * the modelled peripherals are dispatched to the model, the others go to
+ * memory (see "../axidma_model.c").
+ */
+
+#ifndef XIL_IO_H
+#define XIL_IO_H
+
+#include "xil_types.h"
+
+u32 Xil_In32(UINTPTR Addr);
+void Xil_Out32(UINTPTR Addr, u32 Value);
+
+#endif /* XIL_IO_H */
@@ -0,0 +1,13 @@
+/*
+ * xil_printf.h
+ *
+ * Host stand-in of the standalone BSP header. Output goes to stdout, without
+ * carriage returns, when the model is verbose.
+ */
+
+#ifndef XIL_PRINTF_H
+#define XIL_PRINTF_H
+
+void xil_printf(const char *Format, ...);
+
+#endif /* XIL_PRINTF_H */
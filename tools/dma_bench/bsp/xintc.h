@@ -0,0 +1,16 @@
+/*
+ * xintc.h
+ *
+ * Host stand-in of the interrupt controller driver header. Only the handler
+ * type is needed: "xintc_driver.h" functions are implemented by the model.
+ */
+
+#ifndef XINTC_H
+#define XINTC_H
+
+#include "xil_types.h"
+#include "xstatus.h"
+
+typedef void (*XInterruptHandler)(void *InstancePtr);
+
+#endif /* XINTC_H */
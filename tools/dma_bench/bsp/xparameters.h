@@ -0,0 +1,29 @@
+/*
+ * xparameters.h
+ *
+ * Host stand-in of the BSP parameters of the block design, limited to the
+ * peripherals the DMA driver uses. The DDR is mapped by the model at its
+ * address in the design, with a reduced size.
+ */
+
+#ifndef XPARAMETERS_H
+#define XPARAMETERS_H
+
+#define XPAR_MICROBLAZE_CORE_CLOCK_FREQ_HZ	100000000
+#define XPAR_MICROBLAZE_DCACHE_LINE_LEN		8
+
+#define XPAR_MIG7SERIES_0_BASEADDR			0x80000000
+#define XPAR_MIG7SERIES_0_HIGHADDR			0x83FFFFFF
+
+#define XPAR_TMRCTR_0_BASEADDR				0x41C00000
+#define XPAR_TMRCTR_0_CLOCK_FREQ_HZ			100000000
+
+#define XPAR_AD9361_DMA_DEVICE_ID			0
+#define XPAR_AD9361_DMA_BASEADDR			0x41E00000
+#define XPAR_AD9361_DMA_SG_LENGTH_WIDTH		23
+
+/* Inputs of the interrupt concatenation (see block_design.tcl) */
+#define XPAR_MICROBLAZE_0_AXI_INTC_AD9361_DMA_MM2S_INTROUT_INTR	3
+#define XPAR_MICROBLAZE_0_AXI_INTC_AD9361_DMA_S2MM_INTROUT_INTR	4
+
+#endif /* XPARAMETERS_H */
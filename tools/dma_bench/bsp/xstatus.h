@@ -0,0 +1,20 @@
+/*
+ * xstatus.h
+ *
+ * Host stand-in of the standalone BSP header (see "../axidma_model.h").
+ */
+
+#ifndef XSTATUS_H
+#define XSTATUS_H
+
+#include "xil_types.h"
+
+#define XST_SUCCESS				0L
+#define XST_FAILURE				1L
+#define XST_DEVICE_NOT_FOUND	2L
+#define XST_INVALID_PARAM		15L
+#define XST_DEVICE_IS_STARTED	5L
+#define XST_DMA_SG_LIST_ERROR	520L
+#define XST_DMA_SG_NO_LIST		523L
+
+#endif /* XSTATUS_H */
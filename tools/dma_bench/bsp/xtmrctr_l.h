@@ -0,0 +1,43 @@
+/*
+ * xtmrctr_l.h
+ *
+ * Host stand-in of the AXI Timer low-level driver header. The registers are
+ * those of the AXI Timer, served by the model (see "../axidma_model.c").
+ */
+
+#ifndef XTMRCTR_L_H
+#define XTMRCTR_L_H
+
+#include "xil_io.h"
+
+#define XTC_TIMER_COUNTER_OFFSET	16
+
+#define XTC_TCSR_OFFSET		0
+#define XTC_TLR_OFFSET		4
+#define XTC_TCR_OFFSET		8
+
+#define XTC_CSR_CASC_MASK			0x00000800
+#define XTC_CSR_ENABLE_TMR_MASK		0x00000080
+#define XTC_CSR_AUTO_RELOAD_MASK	0x00000010
+#define XTC_CSR_LOAD_MASK			0x00000020
+
+#define XTmrCtr_WriteReg(BaseAddress, TmrCtrNumber, RegOffset, ValueToWrite) \
+	Xil_Out32((BaseAddress) + ((TmrCtrNumber) * XTC_TIMER_COUNTER_OFFSET) \
+			+ (RegOffset), (ValueToWrite))
+
+#define XTmrCtr_ReadReg(BaseAddress, TmrCtrNumber, RegOffset) \
+	Xil_In32((BaseAddress) + ((TmrCtrNumber) * XTC_TIMER_COUNTER_OFFSET) \
+			+ (RegOffset))
+
+#define XTmrCtr_SetControlStatusReg(BaseAddress, TmrCtrNumber, RegisterValue) \
+	XTmrCtr_WriteReg((BaseAddress), (TmrCtrNumber), XTC_TCSR_OFFSET, \
+			(RegisterValue))
+
+#define XTmrCtr_SetLoadReg(BaseAddress, TmrCtrNumber, RegisterValue) \
+	XTmrCtr_WriteReg((BaseAddress), (TmrCtrNumber), XTC_TLR_OFFSET, \
+			(RegisterValue))
+
+#define XTmrCtr_GetTimerCounterReg(BaseAddress, TmrCtrNumber) \
+	XTmrCtr_ReadReg((BaseAddress), (TmrCtrNumber), XTC_TCR_OFFSET)
+
+#endif /* XTMRCTR_L_H */
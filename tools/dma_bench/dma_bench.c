@@ -0,0 +1,341 @@
+/*
+ * dma_bench.c
+ *
+ * Throughput, latency and CPU load benchmark of the DMA driver
+ * ("drivers/dma/dma_driver.c").
+ *
+ * The driver, the coalescing policy ("dma_coalesce.c"), the DDR allocator and
+ * the time base are built unchanged for the host, against stand-ins of the
+ * standalone BSP headers ("bsp/") and a cycle model of the AXI DMA, the
+ * converter streams, the interrupt controller and the CPU ("axidma_model.c").
+ * So the BD lengths, the coalescing thresholds and the ISRs measured are
+ * those of the firmware, for the transmit mode and settings it is built with.
+ *
+ * For each LTE mode, the driver is reconfigured with "setDmaLteMode()", the
+ * streams run at the sampling frequency of the mode for all the AxCs, and the
+ * transmission is started as main.c does: "startCyclicDmaRead()" in cyclic
+ * mode (with the preset waveform in LTE 5 MHz, and a 10 ms waveform loaded by
+ * "loadTxAxcWaveforms()" in the other modes), or "transmitRndCpriData()" in
+ * interrupt mode. After a warmup, it reports:
+ *
+ *  - Tx: the BD length, the throughput delivered to the DAC stream, the
+ *    underrun ratio (words not available when the stream requested them),
+ *    the interrupt rate and the worst gap between the data of two BDs;
+ *  - Rx: the throughput accepted from the ADC stream, the ratio of words
+ *    dropped on a full FIFO and the interrupt rate;
+ *  - the CPU load of the DMA ISRs, the channel errors and the state of the
+ *    adaptive coalescing of each channel;
+ *  - with "-d", the ADC-to-DAC loopback through DDR at the given depth.
+ *
+ * Build (from the repository root) and run on the host:
+ *
+ *   gcc -O2 -Wall -Wno-pointer-to-int-cast -Wno-int-to-pointer-cast -no-pie \
+ *       -Itools/dma_bench/bsp -Itools/dma_bench -Idrivers/sdr_testbed \
+ *       -Idrivers/dma -Idrivers/memory -Idrivers/timer -Idrivers/trace \
+ *       -Idrivers/intc -o dma_bench tools/dma_bench/dma_bench.c \
+ *       tools/dma_bench/axidma_model.c drivers/dma/dma_driver.c \
+ *       drivers/dma/dma_coalesce.c drivers/memory/dma_buffer.c \
+ *       drivers/memory/ddr_regions.c drivers/timer/timestamp.c \
+ *       drivers/trace/trace_log.c drivers/sdr_testbed/lte_modes.c
+ *   ./dma_bench [-m lte_mode] [-t sim_ms] [-f fifo_bytes] [-w sg_length_width]
+ *               [-l ddr_latency] [-o outstanding] [-i irq_latency]
+ *               [-d loopback_depth] [-v]
+ *
+ * The driver handles DDR addresses and the preset waveform as 32-bit
+ * addresses, hence "-no-pie" (the model maps the DDR at its address).
+ *
+ * The transmit settings of dma_driver.c are selected at build time, so sweep
+ * them with one build each, adding for instance:
+ *
+ *   -DTRANSMIT_IN_INTERRUPT_MODE
+ *   -DTRANSMIT_IN_INTERRUPT_MODE -DNUMBER_OF_BDS_PER_TX=4
+ *   -DTRANSMIT_IN_INTERRUPT_MODE -DN_DMA_READ_BURSTS=64 -DFIXED_COALESCING
+ *
+ * The maximum length of a BD is 2^(SG length width) - 1 bytes. The block
+ * design sets the width to 23 bits (the AXI DMA default is 14 bits), use "-w"
+ * to match the width configured in hardware. Driver messages (xil_printf) are
+ * only printed with "-v".
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "axidma_model.h"
+#include "xaxidma.h"
+#include "dma_driver.h"
+#include "lte_modes.h"
+#include "timestamp.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Duration of the waveforms loaded for the modes without preset
+ */
+#define WAVEFORM_MS		10
+
+#define WARMUP_MS		100
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	AxiDmaChannelStats Tx;
+	AxiDmaChannelStats Rx;
+	double Seconds;
+} BenchResult;
+
+/*****************************************************************************/
+
+static u64 msToCycles(const AxiDmaModelParams *Params, double Ms) {
+	return (u64) (Ms * 1e-3 * Params->ClkHz);
+}
+
+static double perSecond(u64 Count, double Seconds) {
+	return Count / Seconds;
+}
+
+static double ratio(u64 Part, u64 Other) {
+	return (Part + Other) ? 100.0 * Part / (Part + Other) : 0;
+}
+
+#ifndef TRANSMIT_IN_INTERRUPT_MODE
+/*****************************************************************************/
+/*
+ *
+ * Loads WAVEFORM_MS of a distinct ramp on each AxC, for the modes without a
+ * preset waveform.
+ *
+ ******************************************************************************/
+static int loadWaveforms(const LteProfile *Profile) {
+	u32 nSamples = Profile->SamplingFreq / 1000 * WAVEFORM_MS;
+	u32 *Waveforms[DMA_N_AXC];
+	int Status = XST_FAILURE;
+	u32 iSample;
+	int iAxc;
+
+	for (iAxc = 0; iAxc < DMA_N_AXC; iAxc++) {
+		Waveforms[iAxc] = malloc(nSamples * sizeof(u32));
+		if (Waveforms[iAxc] == NULL)
+			goto out;
+		for (iSample = 0; iSample < nSamples; iSample++)
+			Waveforms[iAxc][iSample] = ((u32) iAxc << 24) | iSample;
+	}
+
+	Status = loadTxAxcWaveforms((const u32 * const *) Waveforms, DMA_N_AXC,
+			nSamples);
+
+out:
+	while (--iAxc >= 0)
+		free(Waveforms[iAxc]);
+	return Status;
+}
+#endif
+
+/*****************************************************************************/
+/*
+ *
+ * Starts the transmission in the mode the driver is built for
+ *
+ ******************************************************************************/
+static int startTransmission(int LteMode) {
+#ifdef TRANSMIT_IN_INTERRUPT_MODE
+	return transmitRndCpriData();
+#else
+	const LteProfile *Profile = getLteProfile(LteMode);
+
+	if (LteMode != LTE5 && loadWaveforms(Profile) != XST_SUCCESS) {
+		fprintf(stderr, "Failed to load the %s waveforms\n", Profile->Name);
+		return XST_FAILURE;
+	}
+	return startCyclicDmaRead();
+#endif
+}
+
+static void measure(const AxiDmaModelParams *Params, double SimMs,
+		BenchResult *Res) {
+	AxiDmaModel_run(msToCycles(Params, WARMUP_MS));
+	AxiDmaModel_clearStats();
+	AxiDmaModel_run(msToCycles(Params, SimMs));
+
+	AxiDmaModel_getStats(XAXIDMA_DMA_TO_DEVICE, &Res->Tx);
+	AxiDmaModel_getStats(XAXIDMA_DEVICE_TO_DMA, &Res->Rx);
+	Res->Seconds = SimMs * 1e-3;
+}
+
+static void printCoalescing(const char *Name, int Direction) {
+	DmaCoalesceState State;
+
+	getDmaCoalesceState(Direction, &State);
+	if (State.Threshold == 0) {
+		// Not managed by the driver in this mode
+		return;
+	}
+	printf("    %s coalescing: threshold %u, delay %u, %u IRQ/s, "
+			"%u BD/s, max IRQ gap %u us, %u retunes\n", Name,
+			(unsigned int) State.Threshold, (unsigned int) State.DelayTimer,
+			(unsigned int) State.IrqRate, (unsigned int) State.BdRate,
+			(unsigned int) State.MaxIrqGapUs, (unsigned int) State.nRetunes);
+}
+
+static void printResult(const AxiDmaModelParams *Params, const char *Name,
+		const BenchResult *Res) {
+	const AxiDmaChannelStats *Tx = &Res->Tx;
+	const AxiDmaChannelStats *Rx = &Res->Rx;
+
+	printf("%-9s %9u %8.2f %8.4f%% %7.0f %9.2f %8.2f %8.4f%% %7.0f %6.2f%% %4u\n",
+			Name, (unsigned int) Tx->LastBdLen,
+			perSecond(Tx->nWords * 4, Res->Seconds) / 1e6,
+			ratio(Tx->nLostWords, Tx->nWords),
+			perSecond(Tx->nIrqs, Res->Seconds),
+			Tx->MaxRefillCycles * 1e6 / Params->ClkHz,
+			perSecond(Rx->nWords * 4, Res->Seconds) / 1e6,
+			ratio(Rx->nLostWords, Rx->nWords),
+			perSecond(Rx->nIrqs, Res->Seconds),
+			100.0 * (Tx->IsrCycles + Rx->IsrCycles)
+					/ (Res->Seconds * Params->ClkHz),
+			(unsigned int) (Tx->nErrors + Rx->nErrors));
+}
+
+static int runLoopback(const AxiDmaModelParams *Params, double SimMs,
+		u32 Depth) {
+	DmaLoopbackStats Stats;
+	BenchResult Res;
+
+	if (startDmaLoopback(Depth) != XST_SUCCESS) {
+		fprintf(stderr, "Failed to start the loopback\n");
+		return XST_FAILURE;
+	}
+	measure(Params, SimMs, &Res);
+	printResult(Params, "loopback", &Res);
+
+	getDmaLoopbackStats(&Stats);
+	printf("    %u buffers of %u us, latency %u/%u/%u us (min/mean/max, "
+			"nominal %u), %u underruns, %u overruns\n",
+			(unsigned int) Stats.nBuffersLooped, (unsigned int) Stats.BufferUs,
+			(unsigned int) Stats.MinLatencyUs,
+			(unsigned int) Stats.MeanLatencyUs,
+			(unsigned int) Stats.MaxLatencyUs,
+			(unsigned int) Stats.NominalLatencyUs,
+			(unsigned int) Stats.nUnderruns, (unsigned int) Stats.nOverruns);
+
+	return stopDmaLoopback();
+}
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"usage: %s [-m lte_mode] [-t sim_ms] [-f fifo_bytes] "
+			"[-w sg_length_width]\n"
+			"          [-l ddr_latency] [-o outstanding] [-i irq_latency] "
+			"[-d loopback_depth] [-v]\n", Prog);
+}
+
+int main(int argc, char **argv) {
+	AxiDmaModelParams Params;
+	const LteProfile *Profile;
+	BenchResult Res;
+	double SimMs = 200;
+	int FirstMode = 0;
+	int LastMode = N_LTE_MODES - 1;
+	u32 LoopbackDepth = 0;
+	int Status = 0;
+	int LteMode;
+	int Opt;
+
+	AxiDmaModel_defaultParams(&Params);
+
+	while ((Opt = getopt(argc, argv, "m:t:f:w:l:o:i:d:vh")) != -1) {
+		switch (Opt) {
+		case 'm':
+			FirstMode = LastMode = atoi(optarg);
+			break;
+		case 't':
+			SimMs = atof(optarg);
+			break;
+		case 'f':
+			Params.FifoBytes = atoi(optarg);
+			break;
+		case 'w':
+			Params.SgLengthWidth = atoi(optarg);
+			break;
+		case 'l':
+			Params.DdrLatency = atoi(optarg);
+			break;
+		case 'o':
+			Params.Outstanding = atoi(optarg);
+			break;
+		case 'i':
+			Params.IrqLatency = atoi(optarg);
+			break;
+		case 'd':
+			LoopbackDepth = atoi(optarg);
+			break;
+		case 'v':
+			AxiDmaModel_setVerbose(1);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (getLteProfile(FirstMode) == NULL || SimMs <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (AxiDmaModel_init(&Params) != XST_SUCCESS)
+		return 1;
+	initTimestamp();
+	if (initAXIDma() != XST_SUCCESS) {
+		fprintf(stderr, "DMA initialization failed (see -v)\n");
+		return 1;
+	}
+
+	printf("AXI DMA model: %.0f MHz, %d-bit, %d-beat bursts, %d outstanding, "
+			"DDR latency %d, FIFO %d bytes, max BD length %u\n",
+			Params.ClkHz / 1e6, Params.DataBytes * 8, Params.BurstBeats,
+			Params.Outstanding, Params.DdrLatency, Params.FifoBytes,
+			(1u << Params.SgLengthWidth) - 1);
+#ifdef TRANSMIT_IN_INTERRUPT_MODE
+	printf("Driver: interrupt mode, ");
+#else
+	printf("Driver: cyclic mode, ");
+#endif
+#ifdef FIXED_COALESCING
+	printf("fixed coalescing, ");
+#else
+	printf("adaptive coalescing, ");
+#endif
+	printf("%d AxC, %.0f ms simulated\n\n", DMA_N_AXC, SimMs);
+	printf("%-9s %9s %8s %9s %7s %9s %8s %9s %7s %7s %4s\n", "mode",
+			"Tx BD", "Tx MB/s", "underrun", "Tx IRQ", "refill us", "Rx MB/s",
+			"dropped", "Rx IRQ", "CPU", "err");
+
+	for (LteMode = FirstMode; LteMode <= LastMode; LteMode++) {
+		Profile = getLteProfile(LteMode);
+
+		setLteMode(LteMode);
+		if (setDmaLteMode(LteMode) != XST_SUCCESS) {
+			fprintf(stderr, "Failed to set up the DMA for %s\n", Profile->Name);
+			return 1;
+		}
+		AxiDmaModel_setStreamRate((double) Profile->SamplingFreq * DMA_N_AXC);
+
+		if (startTransmission(LteMode) != XST_SUCCESS) {
+			printf("%-9s transmission could not start (see -v)\n",
+					Profile->Name);
+			Status = 1;
+			continue;
+		}
+		measure(&Params, SimMs, &Res);
+		printResult(&Params, Profile->Name, &Res);
+		printCoalescing("Tx", XAXIDMA_DMA_TO_DEVICE);
+		printCoalescing("Rx", XAXIDMA_DEVICE_TO_DMA);
+
+		if (LoopbackDepth > 0
+				&& runLoopback(&Params, SimMs, LoopbackDepth) != XST_SUCCESS)
+			Status = 1;
+	}
+
+	return Status;
+}
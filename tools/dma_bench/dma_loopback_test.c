@@ -0,0 +1,161 @@
+/*
+ * dma_loopback_test.c
+ *
+ * Host test of the transitions between the loopback and the cyclic
+ * transmission of the DMA driver ("drivers/dma/dma_driver.c"), run on the
+ * AXI DMA model of dma_bench (see "axidma_model.h").
+ *
+ * AxC waveforms are loaded, the ADC-to-DAC loopback is started and stopped,
+ * and the cyclic transmission is restarted. Stopping the loopback sets the
+ * channels up again, which must neither overwrite the loaded waveforms with
+ * the random CPRI ramp nor lose their length. So the test checks that:
+ *
+ *  - the loopback plays buffers out and stops without channel errors;
+ *  - after the restart, the Tx BD is as long as the loaded waveforms;
+ *  - every word delivered to the DAC stream is the next word of the
+ *    interleaved AxC waveforms, with no underrun;
+ *  - the capture keeps running.
+ *
+ * Build (from the repository root) and run on the host:
+ *
+ *   gcc -O2 -Wall -Wno-pointer-to-int-cast -Wno-int-to-pointer-cast -no-pie \
+ *       -Itools/dma_bench/bsp -Itools/dma_bench -Idrivers/sdr_testbed \
+ *       -Idrivers/dma -Idrivers/memory -Idrivers/timer -Idrivers/trace \
+ *       -Idrivers/intc -o dma_loopback_test tools/dma_bench/dma_loopback_test.c \
+ *       tools/dma_bench/axidma_model.c drivers/dma/dma_driver.c \
+ *       drivers/dma/dma_coalesce.c drivers/memory/dma_buffer.c \
+ *       drivers/memory/ddr_regions.c drivers/timer/timestamp.c \
+ *       drivers/trace/trace_log.c drivers/sdr_testbed/lte_modes.c
+ *   ./dma_loopback_test
+ *
+ * It exits with a nonzero status on failure.
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include "axidma_model.h"
+#include "xaxidma.h"
+#include "dma_driver.h"
+#include "lte_modes.h"
+#include "timestamp.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * 1 ms of LTE 5 MHz samples per AxC
+ */
+#define N_SAMPLES			7680
+
+#define LOOPBACK_DEPTH		4
+#define LOOPBACK_MS			20
+#define CYCLIC_MS			5
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	u32 nWords;
+	u32 nMismatches;
+	u32 FirstMismatch;
+	u32 Expected;
+	u32 Received;
+} SinkCheck;
+
+/************************** Variable Definitions *****************************/
+
+static u32 Waveforms[DMA_N_AXC][N_SAMPLES];
+static int nFailures;
+
+/*****************************************************************************/
+
+static void check(int Condition, const char *What) {
+	printf("%s: %s\n", Condition ? "PASS" : "FAIL", What);
+	if (!Condition)
+		nFailures++;
+}
+
+static u32 expectedWord(u32 iWord) {
+	u32 iFrameWord = iWord % (N_SAMPLES * DMA_N_AXC);
+
+	return Waveforms[iFrameWord % DMA_N_AXC][iFrameWord / DMA_N_AXC];
+}
+
+static void checkWord(u32 Word, void *Ref) {
+	SinkCheck *Check = Ref;
+
+	if (Word != expectedWord(Check->nWords) && Check->nMismatches++ == 0) {
+		Check->FirstMismatch = Check->nWords;
+		Check->Expected = expectedWord(Check->nWords);
+		Check->Received = Word;
+	}
+	Check->nWords++;
+}
+
+static u64 msToCycles(const AxiDmaModelParams *Params, u32 Ms) {
+	return (u64) Ms * (Params->ClkHz / 1000);
+}
+
+int main(void) {
+	const u32 *AxcWaveforms[DMA_N_AXC];
+	const LteProfile *Profile = getLteProfile(LTE5);
+	AxiDmaModelParams Params;
+	AxiDmaChannelStats Tx, Rx;
+	DmaLoopbackStats Loopback;
+	SinkCheck Sink = { 0 };
+	u32 iSample;
+	int iAxc;
+
+	AxiDmaModel_defaultParams(&Params);
+	if (AxiDmaModel_init(&Params) != XST_SUCCESS)
+		return 1;
+	AxiDmaModel_setStreamRate((double) Profile->SamplingFreq * DMA_N_AXC);
+
+	initTimestamp();
+	setLteMode(LTE5);
+	check(initAXIDma() == XST_SUCCESS, "DMA initialized");
+
+	// A distinct ramp on each AxC, which the CPRI ramp never matches
+	for (iAxc = 0; iAxc < DMA_N_AXC; iAxc++) {
+		for (iSample = 0; iSample < N_SAMPLES; iSample++)
+			Waveforms[iAxc][iSample] = 0x80000000 | ((u32) iAxc << 24)
+					| iSample;
+		AxcWaveforms[iAxc] = Waveforms[iAxc];
+	}
+	check(loadTxAxcWaveforms(AxcWaveforms, DMA_N_AXC, N_SAMPLES)
+			== XST_SUCCESS, "AxC waveforms loaded");
+
+	/* Loopback */
+	check(startDmaLoopback(LOOPBACK_DEPTH) == XST_SUCCESS, "loopback started");
+	AxiDmaModel_run(msToCycles(&Params, LOOPBACK_MS));
+	getDmaLoopbackStats(&Loopback);
+	check(Loopback.nBuffersLooped > 0, "loopback buffers played out");
+	check(stopDmaLoopback() == XST_SUCCESS, "loopback stopped");
+
+	/* Cyclic transmission of the waveforms loaded before the loopback */
+	AxiDmaModel_clearStats();
+	AxiDmaModel_setSink(checkWord, &Sink);
+	check(startCyclicDmaRead() == XST_SUCCESS, "cyclic transmission restarted");
+	AxiDmaModel_run(msToCycles(&Params, CYCLIC_MS));
+
+	AxiDmaModel_getStats(XAXIDMA_DMA_TO_DEVICE, &Tx);
+	AxiDmaModel_getStats(XAXIDMA_DEVICE_TO_DMA, &Rx);
+
+	check(Tx.LastBdLen == N_SAMPLES * DMA_N_AXC * 4,
+			"Tx BD as long as the AxC waveforms");
+	check(Sink.nWords > N_SAMPLES * DMA_N_AXC,
+			"more than one waveform period transmitted");
+	if (Sink.nMismatches) {
+		printf("      word %u: expected %08x, received %08x (%u mismatches)\n",
+				(unsigned int) Sink.FirstMismatch,
+				(unsigned int) Sink.Expected, (unsigned int) Sink.Received,
+				(unsigned int) Sink.nMismatches);
+	}
+	check(Sink.nMismatches == 0, "DAC stream carries the AxC waveforms");
+	check(Tx.nLostWords == 0, "no DAC stream underrun");
+	check(Rx.nBds > 0 && Rx.nLostWords == 0, "capture running");
+	check(Tx.nErrors == 0 && Rx.nErrors == 0, "no channel error");
+
+	printf("%d failure(s)\n", nFailures);
+
+	return nFailures != 0;
+}
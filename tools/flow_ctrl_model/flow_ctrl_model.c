@@ -0,0 +1,296 @@
+/*
+ * flow_ctrl_model.c
+ *
+ * Host rate model of the cpri2ethernet flow control, as configured by
+ * "RoE_configEthFlowControl()" and dithered by "RoE_ditherFlowControl()"
+ * (radio_over_ethernet.c), with the interval computation of
+ * "drivers/sdr_testbed/flow_ctrl.c".
+ *
+ * For each number of BFs per packet, packets leave alternately after the
+ * first and the second inter-departure interval (registers 0x407 and 0x40C,
+ * latched at each departure). The firmware polling loop calls the dither at
+ * random intervals, and rewrites the second interval whenever a dither slot
+ * of FLOW_CTRL_DITHER_PAIRS pairs of packets is over. The loop also stalls
+ * periodically while the UART prints (by default one 3 ms line every
+ * 100 ms), which delays the rewrite by up to the stall.
+ *
+ * The departures drift from the ideal schedule (one packet every BfsPerPkt
+ * chip periods). The average rate is exact if and only if the drift stays
+ * bounded, so the model checks that the peak-to-peak drift over the whole
+ * run does not exceed twice the one over its first quarter, or the bound of
+ * the dither: one cycle per pair of packets between two rewrites (a slot plus
+ * the longest poll interval and stall). Stalls make the drift grow in rare
+ * steps, which the first check alone takes for an unbounded drift. It also
+ * reports the drift, which the receive buffer must absorb, and the rate error
+ * (slope of the drift), whose residual is within about drift / run time. For
+ * comparison, it reports the rate error without the dithering, and with the
+ * register values hardcoded before (8, 16, 32 and 64 BFs per packet). The
+ * exit status is 1 if any drift is unbounded.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -Wall -Idrivers/sdr_testbed -o flow_ctrl_model \
+ *       tools/flow_ctrl_model/flow_ctrl_model.c \
+ *       drivers/sdr_testbed/flow_ctrl.c -lm
+ *
+ * Examples:
+ *
+ *   ./flow_ctrl_model
+ *   ./flow_ctrl_model -l 2 -t 5
+ *   ./flow_ctrl_model -b 16 -p 20000
+ *   ./flow_ctrl_model -b 16 -s 30000000 -S 50000000
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include "flow_ctrl.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Firmware settings (mirrors of radio_over_ethernet.c)
+ */
+#define CPRI_CHIP_RATE			3840000
+#define ROE_AXI_CLK_HZ			100000000
+#define FLOW_CTRL_DITHER_PAIRS	256
+
+#define DEFAULT_SECONDS			2.0
+#define DEFAULT_POLL_CYCLES		2000
+#define DEFAULT_STALL_CYCLES	300000		/* 3 ms: one line at 115200 baud */
+#define DEFAULT_STALL_PERIOD	10000000	/* 100 ms */
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	double ErrorPpm;		/* BF rate error to the chip rate */
+	double Drift;			/* Peak-to-peak departure drift, in cycles */
+	int Bounded;
+} RateResult;
+
+/*
+ * Registers hardcoded before the intervals were computed
+ */
+typedef struct {
+	uint32_t BfsPerPkt;
+	uint32_t IntervalA;
+	uint32_t IntervalB;
+} LegacyIntervals;
+
+/************************** Variable Definitions *****************************/
+
+static const LegacyIntervals Legacy[] = {
+	{ 64, 0x682, 0x683 },
+	{ 32, 0x342, 0x341 },
+	{ 16, 0x1A0, 0x1A1 },
+	{ 8, 0x209, 0x208 },
+};
+
+static uint64_t RngState = 0x853C49E6748FEA9BULL;
+
+/*****************************************************************************/
+
+static uint32_t randBelow(uint32_t n) {
+	RngState ^= RngState >> 12;
+	RngState ^= RngState << 25;
+	RngState ^= RngState >> 27;
+	return (uint32_t) (((RngState * 0x2545F4914F6CDD1DULL) >> 32) % n);
+}
+
+/*
+ * Firmware polling loop
+ */
+typedef struct {
+	uint32_t PollCycles;	/* Polls at random intervals of 1 to PollCycles */
+	uint32_t StallCycles;	/* UART stall, every StallPeriod cycles */
+	uint32_t StallPeriod;
+} PollModel;
+
+/*****************************************************************************/
+/*
+ *
+ * Runs the hardware for Cycles AXI clock cycles. With Dither, the firmware
+ * polls as modeled by Poll.
+ *
+ ******************************************************************************/
+static void runRate(const FlowCtrlPlan *Plan, uint32_t BfsPerPkt,
+		int Dither, uint64_t Cycles, const PollModel *Poll, RateResult *R) {
+	FlowCtrlDither State;
+	double Period = (double) BfsPerPkt * ROE_AXI_CLK_HZ / CPRI_CHIP_RATE;
+	double MinDrift = 0, MaxDrift = 0, Sk = 0, Skk = 0, Sd = 0, Skd = 0, n;
+	double QuarterDrift = -1;
+	uint64_t t = 0, NextPoll = 0, SlotEnd = 0, LastWrite = 0, nPkts = 0;
+	uint64_t NextStall = randBelow(Poll->StallPeriod);
+	uint32_t RegB = Plan->IntervalB;
+	int Second = 0;
+
+	FlowCtrl_initDither(&State, Plan);
+
+	while (t < Cycles) {
+		double Drift;
+
+		if (QuarterDrift < 0 && t >= Cycles / 4) {
+			QuarterDrift = MaxDrift - MinDrift;
+		}
+
+		/* Firmware polls up to this departure */
+		while (Dither && Plan->DitherNum && NextPoll <= t) {
+			if (NextPoll >= SlotEnd) {
+				RegB = FlowCtrl_nextIntervalB(&State,
+						(uint32_t) (NextPoll - LastWrite));
+				LastWrite = NextPoll;
+				SlotEnd = NextPoll + (uint64_t) FLOW_CTRL_DITHER_PAIRS
+						* (Plan->IntervalA + RegB);
+			}
+			NextPoll += 1 + randBelow(Poll->PollCycles);
+			if (Poll->StallCycles && NextPoll >= NextStall) {
+				NextPoll += Poll->StallCycles;
+				NextStall += Poll->StallPeriod;
+			}
+		}
+
+		/* Departure, and the interval latched for the next one */
+		Drift = (double) t - nPkts * Period;
+		MinDrift = (Drift < MinDrift) ? Drift : MinDrift;
+		MaxDrift = (Drift > MaxDrift) ? Drift : MaxDrift;
+		Sk += nPkts;
+		Skk += (double) nPkts * nPkts;
+		Sd += Drift;
+		Skd += nPkts * Drift;
+		nPkts++;
+
+		t += Second ? RegB : Plan->IntervalA;
+		Second = !Second;
+	}
+
+	/*
+	 * Least-squares slope of the drift (cycles per packet): a bounded drift
+	 * means an exact average rate
+	 */
+	n = (double) nPkts;
+	R->ErrorPpm = -1e6 * (n * Skd - Sk * Sd) / (n * Skk - Sk * Sk) / Period;
+	R->Drift = MaxDrift - MinDrift;
+	R->Bounded = (R->Drift <= 2 * QuarterDrift + 2)
+			|| (R->Drift <= FLOW_CTRL_DITHER_PAIRS + 2
+					+ (double) (Poll->PollCycles + Poll->StallCycles)
+							/ (Plan->IntervalA + Plan->IntervalB));
+}
+
+static double legacyErrorPpm(uint32_t BfsPerPkt) {
+	uint32_t i;
+
+	for (i = 0; i < sizeof(Legacy) / sizeof(Legacy[0]); i++) {
+		if (Legacy[i].BfsPerPkt == BfsPerPkt) {
+			double Period = (double) BfsPerPkt * ROE_AXI_CLK_HZ
+					/ CPRI_CHIP_RATE;
+
+			return 1e6 * (2.0 * Period
+					/ (Legacy[i].IntervalA + Legacy[i].IntervalB) - 1.0);
+		}
+	}
+	return NAN;
+}
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"Usage: %s [options]\n"
+			"  -l <n>      CPRI line rate option (default 1)\n"
+			"  -b <n>      only this number of BFs per packet\n"
+			"  -t <s>      simulated time per configuration (default %.0f)\n"
+			"  -p <n>      firmware polling interval, up to n AXI cycles "
+			"(default %d)\n"
+			"  -s <n>      UART stall of the polling loop, in AXI cycles "
+			"(default %d, 0 for none)\n"
+			"  -S <n>      AXI cycles between stalls (default %d)\n", Prog,
+			DEFAULT_SECONDS, DEFAULT_POLL_CYCLES, DEFAULT_STALL_CYCLES,
+			DEFAULT_STALL_PERIOD);
+}
+
+int main(int argc, char **argv) {
+	uint32_t LineRate = 1, OnlyBfs = 0, Bfs, MaxBfs;
+	PollModel Poll = { DEFAULT_POLL_CYCLES, DEFAULT_STALL_CYCLES,
+			DEFAULT_STALL_PERIOD };
+	double Seconds = DEFAULT_SECONDS;
+	int Opt, Failed = 0;
+
+	while ((Opt = getopt(argc, argv, "l:b:t:p:s:S:h")) != -1) {
+		switch (Opt) {
+		case 'l':
+			LineRate = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			OnlyBfs = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			Seconds = atof(optarg);
+			break;
+		case 'p':
+			Poll.PollCycles = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			Poll.StallCycles = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'S':
+			Poll.StallPeriod = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	MaxBfs = FlowCtrl_maxBfsPerPkt(LineRate);
+	if (MaxBfs == 0 || Poll.PollCycles == 0 || Poll.StallPeriod == 0
+			|| Seconds <= 0 || OnlyBfs > MaxBfs) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	printf("Line rate option %u, up to %u BFs per packet\n", LineRate, MaxBfs);
+	printf("Polling every 1 to %u cycles, stalls of %u cycles every %u\n",
+			Poll.PollCycles, Poll.StallCycles, Poll.StallPeriod);
+	printf("%4s %6s %6s %9s %10s %10s %8s %14s %12s\n", "BFs", "A", "B",
+			"dither", "error ppm", "drift cyc", "bounded", "undithered ppm",
+			"legacy ppm");
+
+	for (Bfs = OnlyBfs ? OnlyBfs : 1; Bfs <= (OnlyBfs ? OnlyBfs : MaxBfs);
+			Bfs++) {
+		FlowCtrlPlan Plan;
+		RateResult Dithered, Fixed;
+		char Frac[16];
+		double LegacyPpm;
+
+		if (FlowCtrl_plan(&Plan, Bfs, CPRI_CHIP_RATE, ROE_AXI_CLK_HZ) != 0) {
+			printf("%4u invalid\n", Bfs);
+			Failed = 1;
+			continue;
+		}
+
+		runRate(&Plan, Bfs, 1, (uint64_t) (Seconds * ROE_AXI_CLK_HZ),
+				&Poll, &Dithered);
+		runRate(&Plan, Bfs, 0, (uint64_t) (Seconds * ROE_AXI_CLK_HZ),
+				&Poll, &Fixed);
+		if (!Dithered.Bounded) {
+			Failed = 1;
+		}
+
+		snprintf(Frac, sizeof(Frac), "%u/%u", Plan.DitherNum, Plan.DitherDen);
+		printf("%4u %6u %6u %9s %10.3f %10.1f %8s %14.2f", Bfs,
+				Plan.IntervalA, Plan.IntervalB, Plan.DitherNum ? Frac : "-",
+				Dithered.ErrorPpm, Dithered.Drift,
+				Dithered.Bounded ? "yes" : "NO", Fixed.ErrorPpm);
+		LegacyPpm = legacyErrorPpm(Bfs);
+		if (!isnan(LegacyPpm)) {
+			printf(" %12.2f", LegacyPpm);
+		}
+		printf("\n");
+	}
+
+	if (Failed) {
+		printf("Some rates are not exact\n");
+	}
+	return Failed;
+}
@@ -0,0 +1,221 @@
+/*
+ * iq_analyze.c
+ *
+ * Host build of the on-target IQ health analysis ("drivers/dsp/iq_analysis.c"):
+ * reports the in-band power, ACLR and EVM of a recorded capture, exactly as
+ * the firmware computes them, and optionally dumps the averaged spectrum.
+ *
+ * The input is either a file of 16-bit IQ samples, as written by the ADC DMA
+ * (I then Q of each sample, one or more interleaved channels), or a raw
+ * waveform container (".iqw") from "tools/wavegen", whose AxCs are
+ * interleaved sample by sample.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -Wall -Idrivers/dsp -Idrivers/sdr_testbed -o iq_analyze \
+ *       tools/iq_analyze/iq_analyze.c drivers/dsp/iq_analysis.c \
+ *       drivers/dsp/dsp_trig.c
+ *
+ * Examples:
+ *
+ *   ./iq_analyze -i capture.sc16 -m lte5
+ *   ./iq_analyze -i capture.sc16 -m lte20 -k 2 -c 1 -o spectrum.csv
+ *   ./iq_analyze -i wave.iqw -m lte5 -r 100
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "iq_analysis.h"
+#include "lte_modes.h"
+
+/************************** Constant Definitions *****************************/
+
+#define WAVE_CONTAINER_MAGIC	0x57465149	/* "IQFW" */
+#define WAVE_CONTAINER_HDR_LEN	32
+#define WAVE_ENC_RAW			0
+
+/*****************************************************************************/
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"Usage: %s -i <file> [options]\n"
+			"  -i <file>   16-bit IQ capture, or raw .iqw container\n"
+			"  -m <mode>   lte5 (default) or lte20\n"
+			"  -k <n>      interleaved channels in the capture (default 1)\n"
+			"  -c <n>      channel to analyze (default 0)\n"
+			"  -n <n>      analyze at most n samples\n"
+			"  -f <n>      spectrum FFT size (default from the mode)\n"
+			"  -o <file>   write the averaged spectrum (CSV: Hz, dBFS)\n"
+			"  -r <n>      repeat the analysis n times and report its time\n",
+			Prog);
+}
+
+/*
+ * Formats hundredths as a signed decimal
+ */
+static const char *centi(int32_t v, char *Buf) {
+	sprintf(Buf, "%s%d.%02d", (v < 0) ? "-" : "", abs(v) / 100, abs(v) % 100);
+	return Buf;
+}
+
+int main(int argc, char **argv) {
+	const char *InPath = NULL, *CsvPath = NULL;
+	IqAnalysisConfig Config;
+	IqAnalysisResult Result;
+	int LteMode = LTE5;
+	uint32_t nChannels = 1, Channel = 0, MaxSamples = 0, FftSize = 0;
+	uint32_t Repeat = 1, nSamples, Stride, r;
+	int16_t *Iq;
+	long Bytes;
+	size_t Offset = 0;
+	FILE *Fp;
+	char Buf[4][16];
+	clock_t Start;
+	int Opt;
+
+	while ((Opt = getopt(argc, argv, "i:m:k:c:n:f:o:r:h")) != -1) {
+		switch (Opt) {
+		case 'i':
+			InPath = optarg;
+			break;
+		case 'm':
+			if (strcmp(optarg, "lte5") == 0) {
+				LteMode = LTE5;
+			} else if (strcmp(optarg, "lte20") == 0) {
+				LteMode = LTE20;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'k':
+			nChannels = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			Channel = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			MaxSamples = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			FftSize = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			CsvPath = optarg;
+			break;
+		case 'r':
+			Repeat = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!InPath || nChannels == 0 || Channel >= nChannels || Repeat == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	Config = *IqAnalysis_lteConfig(LteMode);
+	if (FftSize) {
+		Config.SpectrumFftSize = FftSize;
+	}
+
+	Fp = fopen(InPath, "rb");
+	if (!Fp) {
+		perror(InPath);
+		return 1;
+	}
+	fseek(Fp, 0, SEEK_END);
+	Bytes = ftell(Fp);
+	fseek(Fp, 0, SEEK_SET);
+	Iq = malloc(Bytes > 0 ? (size_t) Bytes : 1);
+	if (!Iq || fread(Iq, 1, (size_t) Bytes, Fp) != (size_t) Bytes) {
+		fprintf(stderr, "Could not read %s\n", InPath);
+		fclose(Fp);
+		return 1;
+	}
+	fclose(Fp);
+
+	/* Waveform container: skip the header, AxCs are the channels */
+	if (Bytes >= WAVE_CONTAINER_HDR_LEN
+			&& *(uint32_t *) Iq == WAVE_CONTAINER_MAGIC) {
+		const uint8_t *Hdr = (const uint8_t *) Iq;
+		uint16_t Encoding = *(const uint16_t *) (Hdr + 6);
+		uint16_t nAxc = *(const uint16_t *) (Hdr + 24);
+
+		if (Encoding != WAVE_ENC_RAW) {
+			fprintf(stderr, "Only raw containers are supported\n");
+			return 1;
+		}
+		nChannels = nAxc ? nAxc : 1;
+		if (Channel >= nChannels) {
+			fprintf(stderr, "The container has %u AxC\n", nChannels);
+			return 1;
+		}
+		Offset = WAVE_CONTAINER_HDR_LEN / sizeof(int16_t);
+		Bytes -= WAVE_CONTAINER_HDR_LEN;
+	}
+
+	Stride = 2 * nChannels;
+	nSamples = (uint32_t) (Bytes / (long) (Stride * sizeof(int16_t)));
+	if (MaxSamples && nSamples > MaxSamples) {
+		nSamples = MaxSamples;
+	}
+
+	Start = clock();
+	for (r = 0; r < Repeat; r++) {
+		if (IqAnalysis_run(&Config, Iq + Offset + 2 * Channel, nSamples, Stride,
+				&Result) != 0) {
+			fprintf(stderr, "Capture too short or invalid configuration\n");
+			return 1;
+		}
+	}
+
+	printf("%u samples, %u spectrum blocks of %u\n", nSamples, Result.nBlocks,
+			Config.SpectrumFftSize);
+	printf("In-band power   %s dBFS\n", centi(Result.InBandDbfs, Buf[0]));
+	printf("ACLR lower      %s dB (%u%% of the channel in span)\n",
+			centi(Result.AclrLowerDb, Buf[1]), Result.AclrLowerCoverage);
+	printf("ACLR upper      %s dB (%u%% of the channel in span)\n",
+			centi(Result.AclrUpperDb, Buf[2]), Result.AclrUpperCoverage);
+	if (Result.nSymbols) {
+		printf("EVM             %s %% (%s dB), %u symbols, slot at %u\n",
+				centi((int32_t) Result.EvmPct, Buf[3]),
+				centi(Result.EvmDb, Buf[0]), Result.nSymbols,
+				Result.SlotStart);
+	} else {
+		printf("EVM             n/a (no OFDM symbol found)\n");
+	}
+	if (Repeat > 1) {
+		printf("%.3f ms per analysis\n", 1e3 * (double) (clock() - Start)
+				/ CLOCKS_PER_SEC / Repeat);
+	}
+
+	if (CsvPath) {
+		int32_t *Db = malloc(IQ_MAX_FFT * sizeof(int32_t));
+		uint32_t n, nBins = IqAnalysis_spectrumDb(Db, IQ_MAX_FFT);
+
+		Fp = fopen(CsvPath, "w");
+		if (!Fp) {
+			perror(CsvPath);
+			return 1;
+		}
+		for (n = 0; n < nBins; n++) {
+			double Freq = ((double) n - nBins / 2) * Config.SampleRate / nBins;
+
+			fprintf(Fp, "%.0f,%.2f\n", Freq, Db[n] / 100.0);
+		}
+		fclose(Fp);
+		free(Db);
+	}
+
+	free(Iq);
+	return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * nco_synth.c
+ *
+ * Host build of the NCO waveform synthesizer ("drivers/dsp/nco.c"), which
+ * the firmware uses to fill the DAC DMA buffer (dac_load_nco()). It writes
+ * the very samples the firmware would generate, and measures the generation
+ * throughput.
+ *
+ * Tones are given as "freq[:level]" and chirps as "start:stop[:level]", with
+ * frequencies in Hz (negative frequencies are below the carrier) and levels
+ * in dBFS (peak, default -6). The output is a file of interleaved 16-bit I
+ * and Q samples ("sc16"), which "tools/iq_analyze" can read.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -Wall -Idrivers/dsp -o nco_synth tools/nco_synth/nco_synth.c \
+ *       drivers/dsp/nco.c drivers/dsp/dsp_trig.c -lm
+ *
+ * Examples:
+ *
+ *   ./nco_synth -t 1000000 -t -2500000:-12 -n 7680 -o tones.sc16
+ *   ./nco_synth -r 30720000 -c -10000000:10000000 -n 30720 -o chirp.sc16
+ *   ./nco_synth -t 1000000 -t 2000000 -n 1000000 -k 4 -b 20
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "nco.h"
+
+/************************** Constant Definitions *****************************/
+
+#define DEFAULT_SAMPLE_RATE		7680000
+#define DEFAULT_LENGTH			7680
+#define DEFAULT_LEVEL_DBFS		-6.0
+
+/*****************************************************************************/
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"Usage: %s (-t freq[:dbfs] | -c start:stop[:dbfs])... [options]\n"
+			"  -t <tone>   complex tone (up to %d tones and chirps)\n"
+			"  -c <chirp>  linear chirp over the buffer length\n"
+			"  -r <Hz>     sample rate (default %d)\n"
+			"  -n <n>      buffer length in samples (default %d)\n"
+			"  -k <n>      DAC channels, copies of each sample (default 1)\n"
+			"  -o <file>   write the buffer as sc16\n"
+			"  -b <n>      generate the buffer n times and report the "
+			"throughput\n", Prog, NCO_MAX_TONES, DEFAULT_SAMPLE_RATE,
+			DEFAULT_LENGTH);
+}
+
+/*
+ * Parses "a[:b[:c]]" into up to 3 numbers, returning how many were found
+ */
+static int parseFields(const char *Arg, double *Fields) {
+	char *End;
+	int n = 0;
+
+	while (n < 3) {
+		Fields[n] = strtod(Arg, &End);
+		if (End == Arg) {
+			return -1;
+		}
+		n++;
+		if (*End != ':') {
+			break;
+		}
+		Arg = End + 1;
+	}
+	return (*End == '\0') ? n : -1;
+}
+
+static uint16_t levelToAmplitude(double Dbfs) {
+	double a = 32767.0 * pow(10.0, Dbfs / 20.0);
+
+	return (uint16_t) ((a > 32767.0) ? 32767.0 : a + 0.5);
+}
+
+int main(int argc, char **argv) {
+	NcoPlan Plan;
+	NcoState State;
+	double Fields[3], Level;
+	const char *OutPath = NULL;
+	uint32_t Length = DEFAULT_LENGTH, nCopies = 1, Repeat = 0, r, t, n;
+	uint32_t *Words;
+	clock_t Start;
+	int Opt, nFields;
+
+	memset(&Plan, 0, sizeof(Plan));
+	Plan.SampleRate = DEFAULT_SAMPLE_RATE;
+
+	while ((Opt = getopt(argc, argv, "t:c:r:n:k:o:b:h")) != -1) {
+		switch (Opt) {
+		case 't':
+		case 'c':
+			nFields = parseFields(optarg, Fields);
+			if (Plan.nTones == NCO_MAX_TONES || nFields < 1
+					|| (Opt == 'c' && nFields < 2)) {
+				usage(argv[0]);
+				return 1;
+			}
+			Plan.Tone[Plan.nTones].StartHz = (int32_t) Fields[0];
+			if (Opt == 'c') {
+				Plan.Tone[Plan.nTones].StopHz = (int32_t) Fields[1];
+				Level = (nFields > 2) ? Fields[2] : DEFAULT_LEVEL_DBFS;
+			} else {
+				Plan.Tone[Plan.nTones].StopHz = (int32_t) Fields[0];
+				Level = (nFields > 1) ? Fields[1] : DEFAULT_LEVEL_DBFS;
+			}
+			Plan.Tone[Plan.nTones].Amplitude = levelToAmplitude(Level);
+			Plan.nTones++;
+			break;
+		case 'r':
+			Plan.SampleRate = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			Length = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			nCopies = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			OutPath = optarg;
+			break;
+		case 'b':
+			Repeat = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (Plan.nTones == 0 || nCopies == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (NcoSynth_init(&State, &Plan, Length) != 0) {
+		fprintf(stderr, "Invalid plan: frequencies must be within +-%u Hz\n",
+				Plan.SampleRate / 2);
+		return 1;
+	}
+	for (t = 0; t < Plan.nTones; t++) {
+		printf("%s %u: %d Hz (requested %d Hz)", (Plan.Tone[t].StartHz
+				== Plan.Tone[t].StopHz) ? "Tone" : "Chirp", t,
+				NcoSynth_actualHz(&State, Plan.SampleRate, t),
+				Plan.Tone[t].StartHz);
+		if (Plan.Tone[t].StartHz != Plan.Tone[t].StopHz) {
+			printf(" to %d Hz", Plan.Tone[t].StopHz);
+		}
+		printf("\n");
+	}
+
+	Words = malloc((size_t) Length * nCopies * sizeof(uint32_t));
+	if (!Words) {
+		fprintf(stderr, "Out of memory (%u samples)\n", Length);
+		return 1;
+	}
+	NcoSynth_generate(&State, Words, Length, nCopies);
+
+	if (Repeat) {
+		double Seconds;
+
+		Start = clock();
+		for (r = 0; r < Repeat; r++) {
+			NcoSynth_generate(&State, Words, Length, nCopies);
+		}
+		Seconds = (double) (clock() - Start) / CLOCKS_PER_SEC;
+		printf("%.1f Msamples/s (%u tones, %u channels)\n",
+				Seconds > 0 ? 1e-6 * Length * (double) Repeat / Seconds : 0.0,
+				Plan.nTones, nCopies);
+	}
+
+	if (OutPath) {
+		FILE *Fp = fopen(OutPath, "wb");
+
+		if (!Fp) {
+			perror(OutPath);
+			return 1;
+		}
+		for (n = 0; n < Length; n++) {
+			uint32_t Word = Words[(size_t) n * nCopies];
+			int16_t Iq[2] = { (int16_t) (Word >> 16), (int16_t) Word };
+
+			fwrite(Iq, sizeof(int16_t), 2, Fp);
+		}
+		fclose(Fp);
+	}
+
+	free(Words);
+	return 0;
+}
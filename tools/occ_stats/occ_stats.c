@@ -0,0 +1,224 @@
+/*
+ * occ_stats.c
+ *
+ * Decoder of the occupancy statistics exported by the firmware (see
+ * RoE_exportOccStats() in "drivers/sdr_testbed/radio_over_ethernet.c"): reads
+ * the "occ_stats", "occ_hist" and "loss_hist" lines of a console log (other
+ * lines are ignored), rebuilds the statistics and summarizes them with the
+ * same code as the firmware ("drivers/sdr_testbed/occ_stats.c"). Every export,
+ * terminated by "occ_end", is reported.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -Wall -Idrivers/sdr_testbed -o occ_stats \
+ *       tools/occ_stats/occ_stats.c drivers/sdr_testbed/occ_stats.c
+ *
+ * Examples:
+ *
+ *   ./occ_stats console.log
+ *   ./occ_stats -H console.log > histogram.txt
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "occ_stats.h"
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	OccStats Stats;
+	uint32_t PeriodUs;
+	int PrintHist;
+	int nExports;
+} Decoder;
+
+/*****************************************************************************/
+
+static void printQ8(const char *Name, uint32_t ValueQ8) {
+	printf("  %-10s %u.%02u\n", Name, ValueQ8 >> 8,
+			((ValueQ8 & 0xFF) * 100) >> 8);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Prints the statistics of one export.
+ *
+ ******************************************************************************/
+static void report(Decoder *D) {
+	const OccStats *S = &D->Stats;
+	OccStatsSummary Summary;
+	int i;
+
+	OccStats_summarize(S, &Summary);
+
+	printf("Export %d: %u samples", ++D->nExports, S->nSamples);
+	if (D->PeriodUs) {
+		printf(" over %.3f s", (double) S->nSamples * D->PeriodUs / 1e6);
+	}
+	printf("\n");
+
+	if (S->nSamples) {
+		printf("Occupancy (words)\n");
+		printQ8("mean", Summary.MeanQ8);
+		printQ8("std", Summary.StdQ8);
+		printf("  %-10s %u\n", "min", Summary.Min);
+		printf("  %-10s %u\n", "p1", Summary.P1);
+		printf("  %-10s %u\n", "p50", Summary.P50);
+		printf("  %-10s %u\n", "p99", Summary.P99);
+		printf("  %-10s %u\n", "p99.9", Summary.P999);
+		printf("  %-10s %u\n", "max", Summary.Max);
+	}
+
+	printf("BF words lost: %llu in %u samples, max %u per sample\n",
+			(unsigned long long) S->WordsLost, S->nLossSamples, S->MaxLoss);
+	for (i = 0; i < OCC_STATS_LOSS_BINS; i++) {
+		if (S->LossHist[i]) {
+			printf("  %10u - %-10u %u\n", 1u << i, (2u << i) - 1,
+					S->LossHist[i]);
+		}
+	}
+
+	printf("Interrupts by code:");
+	for (i = 0; i < OCC_STATS_CODES; i++) {
+		printf(" %u", S->nCodes[i]);
+	}
+	printf("\nSteps: +%u -%u\n", S->nIncrease, S->nDecrease);
+
+	if (D->PrintHist && S->nSamples) {
+		printf("Histogram (first word, samples, %%)\n");
+		for (i = 0; i < OCC_STATS_BINS; i++) {
+			if (S->Hist[i]) {
+				printf("%u\t%u\t%.4f\n", (uint32_t) i << S->BinShift,
+						S->Hist[i], 100.0 * S->Hist[i] / S->nSamples);
+			}
+		}
+	}
+	printf("\n");
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Sets the field of an "occ_stats <name> <value>" line.
+ *
+ ******************************************************************************/
+static void setField(Decoder *D, const char *Name, uint64_t Value) {
+	OccStats *S = &D->Stats;
+	unsigned int Code;
+
+	if (strcmp(Name, "period_us") == 0) {
+		D->PeriodUs = (uint32_t) Value;
+	} else if (strcmp(Name, "bin_shift") == 0) {
+		S->BinShift = (uint32_t) Value;
+	} else if (strcmp(Name, "samples") == 0) {
+		S->nSamples = (uint32_t) Value;
+	} else if (strcmp(Name, "min") == 0) {
+		S->Min = (uint32_t) Value;
+	} else if (strcmp(Name, "max") == 0) {
+		S->Max = (uint32_t) Value;
+	} else if (strcmp(Name, "sum") == 0) {
+		S->Sum = Value;
+	} else if (strcmp(Name, "sum_sq") == 0) {
+		S->SumSq = Value;
+	} else if (strcmp(Name, "words_lost") == 0) {
+		S->WordsLost = Value;
+	} else if (strcmp(Name, "loss_samples") == 0) {
+		S->nLossSamples = (uint32_t) Value;
+	} else if (strcmp(Name, "max_loss") == 0) {
+		S->MaxLoss = (uint32_t) Value;
+	} else if (strcmp(Name, "increase") == 0) {
+		S->nIncrease = (uint32_t) Value;
+	} else if (strcmp(Name, "decrease") == 0) {
+		S->nDecrease = (uint32_t) Value;
+	} else if (sscanf(Name, "code%u", &Code) == 1 && Code < OCC_STATS_CODES) {
+		S->nCodes[Code] = (uint32_t) Value;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Decodes the exports of a console log. Lines may hold other text before
+ * them (the firmware starts them with "\r\n").
+ *
+ ******************************************************************************/
+static void decodeConsole(Decoder *D, FILE *f) {
+	char Line[512];
+
+	while (fgets(Line, sizeof(Line), f)) {
+		char *p, Name[32];
+		unsigned long long Value;
+		unsigned int First, Count;
+
+		if ((p = strstr(Line, "occ_stats ")) != NULL) {
+			if (sscanf(p, "occ_stats %31s %llx", Name, &Value) == 2) {
+				setField(D, Name, Value);
+			}
+		} else if ((p = strstr(Line, "occ_hist ")) != NULL) {
+			if (sscanf(p, "occ_hist %x %x", &First, &Count) == 2
+					&& (First >> D->Stats.BinShift) < OCC_STATS_BINS) {
+				D->Stats.Hist[First >> D->Stats.BinShift] = Count;
+			}
+		} else if ((p = strstr(Line, "loss_hist ")) != NULL) {
+			if (sscanf(p, "loss_hist %x %x", &First, &Count) == 2
+					&& First < OCC_STATS_LOSS_BINS) {
+				D->Stats.LossHist[First] = Count;
+			}
+		} else if (strstr(Line, "occ_end") != NULL) {
+			report(D);
+			memset(&D->Stats, 0, sizeof(D->Stats));
+		}
+	}
+}
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"Usage: %s [options] [console log ...]\n"
+			"  -H          also print the occupancy histogram\n"
+			"Reads the console log from stdin if no file is given.\n", Prog);
+}
+
+int main(int argc, char **argv) {
+	Decoder D;
+	int Opt, i;
+
+	memset(&D, 0, sizeof(D));
+
+	while ((Opt = getopt(argc, argv, "Hh")) != -1) {
+		switch (Opt) {
+		case 'H':
+			D.PrintHist = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind == argc) {
+		decodeConsole(&D, stdin);
+	} else {
+		for (i = optind; i < argc; i++) {
+			FILE *f = fopen(argv[i], "r");
+
+			if (f == NULL) {
+				perror(argv[i]);
+				return 1;
+			}
+			decodeConsole(&D, f);
+			fclose(f);
+		}
+	}
+
+	if (D.nExports == 0) {
+		fprintf(stderr, "No complete export (occ_end) found\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * pkt_plan.c
+ *
+ * Host front end of the fronthaul packet-size planner
+ * ("drivers/sdr_testbed/pkt_plan.c"), which "RoE_planPacketSize()" runs on
+ * the target.
+ *
+ * Given the line rate option, the number of AxCs, the compression ratio and a
+ * latency budget, it prints the number of BFs per packet that maximizes the
+ * link efficiency, and the flow control intervals to configure for it. With
+ * -v, it also lists every packetization that fits a packet, marking those
+ * that do not fit the budget or the link. The exit status is 1 if none fits.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -Wall -Idrivers/sdr_testbed -o pkt_plan tools/pkt_plan/pkt_plan.c \
+ *       drivers/sdr_testbed/pkt_plan.c drivers/sdr_testbed/flow_ctrl.c
+ *
+ * Examples:
+ *
+ *   ./pkt_plan -L 10
+ *   ./pkt_plan -l 2 -a 6 -c 2 -L 5 -v
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "pkt_plan.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Firmware settings (mirrors of radio_over_ethernet.c)
+ */
+#define CPRI_CHIP_RATE			3840000
+#define ROE_AXI_CLK_HZ			100000000
+
+#define DEFAULT_LATENCY_US		10.0
+
+/*****************************************************************************/
+
+static void printPlan(const PktPlan *Plan, const char *Note) {
+	printf("%4u %8u %6u %10.3f %10.3f %11.3f %6u %6u", Plan->BfsPerPkt,
+			Plan->PayloadBytes, Plan->WireBytes, Plan->EfficiencyPpm / 1e4,
+			Plan->LinkLoadPpm / 1e4, Plan->LatencyNs / 1e3,
+			Plan->FlowCtrl.IntervalA, Plan->FlowCtrl.IntervalB);
+	if (Plan->FlowCtrl.DitherNum) {
+		printf(" +1 in %u/%u", Plan->FlowCtrl.DitherNum,
+				Plan->FlowCtrl.DitherDen);
+	}
+	printf("%s\n", Note);
+}
+
+static void printHeader(void) {
+	printf("%4s %8s %6s %10s %10s %11s %6s %6s\n", "BFs", "payload", "wire",
+			"effic. %", "load %", "latency us", "A", "B");
+}
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"Usage: %s [options]\n"
+			"  -l <n>      CPRI line rate option (default 1)\n"
+			"  -a <n>      AxCs per BF (default 4 per line rate option)\n"
+			"  -c <ratio>  compression ratio (default 1)\n"
+			"  -L <us>     latency budget (default %.0f)\n"
+			"  -r <Mbps>   link rate (default %d, 1000BASE-T)\n"
+			"  -v          list all packetizations\n", Prog,
+			DEFAULT_LATENCY_US, PKT_PLAN_LINK_1000BASE_T);
+}
+
+int main(int argc, char **argv) {
+	PktPlanConfig Config;
+	PktPlan Plan;
+	double Compression = 1.0, LatencyUs = DEFAULT_LATENCY_US;
+	int Opt, Verbose = 0;
+
+	Config.LineRate = 1;
+	Config.nAxc = 0;
+	Config.LinkMbps = PKT_PLAN_LINK_1000BASE_T;
+	Config.ChipRate = CPRI_CHIP_RATE;
+	Config.AxiClkHz = ROE_AXI_CLK_HZ;
+
+	while ((Opt = getopt(argc, argv, "l:a:c:L:r:vh")) != -1) {
+		switch (Opt) {
+		case 'l':
+			Config.LineRate = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			Config.nAxc = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			Compression = atof(optarg);
+			break;
+		case 'L':
+			LatencyUs = atof(optarg);
+			break;
+		case 'r':
+			Config.LinkMbps = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			Verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (Config.nAxc == 0) {
+		Config.nAxc = 4 * Config.LineRate;
+	}
+	Config.CompressionQ8 = (uint32_t) (Compression * 256 + 0.5);
+	if (LatencyUs <= 0 || LatencyUs > 4e6 || Config.LinkMbps == 0
+			|| PktPlan_bfBytes(&Config) == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+	Config.LatencyBudgetNs = (uint32_t) (LatencyUs * 1e3);
+
+	printf("Line rate option %u, %u AxCs, compression %.2f: %u bytes per BF\n",
+			Config.LineRate, Config.nAxc, Config.CompressionQ8 / 256.0,
+			PktPlan_bfBytes(&Config));
+	printf("Latency budget %.3f us, link %u Mbps\n\n", LatencyUs,
+			Config.LinkMbps);
+
+	if (Verbose) {
+		uint32_t Bfs;
+
+		printHeader();
+		for (Bfs = 1; Bfs <= PKT_PLAN_MAX_BFS; Bfs++) {
+			int Status = PktPlan_evaluate(&Plan, &Config, Bfs);
+
+			if (Status < 0) {
+				break;
+			}
+			printPlan(&Plan, Status ? "  (does not fit)" : "");
+		}
+		printf("\n");
+	}
+
+	if (PktPlan_choose(&Plan, &Config) != 0) {
+		printf("No packetization fits the budget and the link\n");
+		return 1;
+	}
+	printf("Chosen:\n");
+	printHeader();
+	printPlan(&Plan, "");
+	return 0;
+}
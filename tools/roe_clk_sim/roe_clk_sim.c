@@ -0,0 +1,539 @@
+/*
+ * roe_clk_sim.c
+ *
+ * Closed-loop simulator of the RRU clock recovery (buffer-based
+ * synchronization), for tuning the RoE receive buffer and the occupancy
+ * controller off the hardware.
+ *
+ * The simulated loop runs the very controller of "RoE_pollStatus()"
+ * ("drivers/sdr_testbed/occupancy_ctrl.c"), configured as in
+ * "RoE_initClkControl()", against a discrete-event model of:
+ *
+ *  - the BBU side: one Ethernet packet of BFs_PER_PKT CPRI basic frames per
+ *    packet period (3.84 MHz BF rate), delayed by an exponential packet
+ *    delay variation (PDV), in order;
+ *  - the RoE receive buffer: BUFFER_DEPTH words, read out from the center
+ *    once the first packets filled it. Overflows drop the packet words that
+ *    do not fit, underflows starve the CPRI read side;
+ *  - the RRU CPRI read clock: nominal rate plus a constant offset (ppm) plus
+ *    the correction steps requested by the controller (adjustFreq()). The
+ *    Si5324 reaches the new frequency exponentially within its settling time
+ *    ("settle"). The clock wizard (MMCM) switches at once, but its output
+ *    stops for "settle" us while it is reconfigured (0 by default). Note that
+ *    each stall leaves "settle" us worth of words in the buffer, so anything
+ *    beyond a few us outweighs the correction of the step itself;
+ *  - the firmware: occupancy register polled every few us, controller updated
+ *    every update period, no further step until the configured hold time
+ *    (CLK_CTRL_SETTLE_US) has elapsed.
+ *
+ * Each run reports buffer underflows and overflows, the convergence time and
+ * the steady-state occupancy jitter, as logged by the firmware. Any parameter
+ * can be swept ("-s"), with several random runs per point ("-r"), e.g. to
+ * find the smallest buffer or the loop bandwidth that never underflows or
+ * overflows for a given PDV and clock offset. The exit status is 2 if any run
+ * underflowed, overflowed or did not converge.
+ *
+ * Simulated time runs a few hundred times faster than real time. The cost is
+ * mostly per packet and per PDV draw, so it goes up to about a thousand times
+ * with 64 BFs per packet and no PDV.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -Wall -Idrivers/sdr_testbed -o roe_clk_sim \
+ *       tools/roe_clk_sim/roe_clk_sim.c drivers/sdr_testbed/occupancy_ctrl.c -lm
+ *
+ * Examples:
+ *
+ *   ./roe_clk_sim -p 20 -j 5 -t 60
+ *   ./roe_clk_sim -c mmcm -p -35 -o trace.csv
+ *   ./roe_clk_sim -p 50 -j 5 -r 10 -s bw=50:800:50
+ *   ./roe_clk_sim -p 20 -j 10 -r 10 -P bfs=64 -s depth=2048:8192:1024
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "occupancy_ctrl.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * CPRI basic frame (chip) rate, and occupancy register width
+ */
+#define CPRI_BF_RATE			3840000.0
+#define OCCUPANCY_MAX			0x1FFF
+
+/*
+ * Firmware settings (mirrors of radio_over_ethernet.c)
+ */
+#define CLK_CTRL_MAX_STEPS		100
+
+/*
+ * Exponential PDV table: inverse CDF up to this probability
+ */
+#define EXP_TABLE_LEN			4096
+#define EXP_TABLE_SPAN			0.99
+
+#define CLK_SI5324				0
+#define CLK_MMCM				1
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * Simulation parameters, all sweepable
+ */
+typedef struct {
+	double Ppm;				/* RRU read clock offset to the BBU clock */
+	double JitterUs;		/* Mean of the exponential PDV */
+	double BfsPerPkt;		/* BFs_PER_PKT */
+	double LineRate;		/* LINE_RATE_OPTION */
+	double Depth;			/* BUFFER_DEPTH, in words */
+	double StepPpb;			/* CLK_CTRL_STEP_PPB */
+	double HystPpb;			/* CLK_CTRL_HYSTERESIS_PPB */
+	double BandwidthMhz;	/* CLK_CTRL_BANDWIDTH_MHZ */
+	double PeriodUs;		/* CLK_CTRL_PERIOD_US */
+	double HoldUs;			/* CLK_CTRL_SETTLE_US */
+	double SettleUs;		/* Actual settling time of the clock */
+	double PollUs;			/* Occupancy polling interval */
+	double Seconds;			/* Simulated time */
+} SimParams;
+
+typedef struct {
+	uint32_t Underflows;	/* Underflow episodes */
+	uint32_t Overflows;
+	double WordsLost;		/* Starved reads plus dropped words */
+	OccCtrlStats Ctrl;
+	int32_t MinOccupancy;	/* After convergence */
+	int32_t MaxOccupancy;
+} SimResult;
+
+/************************** Variable Definitions *****************************/
+
+static uint64_t RngState;
+
+/*****************************************************************************/
+
+static double randUniform(void) {
+	/* xorshift64*, 53 bits */
+	RngState ^= RngState >> 12;
+	RngState ^= RngState << 25;
+	RngState ^= RngState >> 27;
+	return (double) ((RngState * 0x2545F4914F6CDD1DULL) >> 11)
+			* (1.0 / 9007199254740992.0);
+}
+
+/*
+ * Exponential variate by inversion, from a table with linear interpolation
+ * (exact log() in the tail), which is several times faster than log()
+ */
+static double randExponential(double Mean) {
+	static double Table[EXP_TABLE_LEN + 1];
+	double u, x;
+	uint32_t i;
+
+	if (Mean <= 0) {
+		return 0.0;
+	}
+	if (Table[EXP_TABLE_LEN] == 0) {
+		for (i = 0; i <= EXP_TABLE_LEN; i++) {
+			Table[i] = -log(1.0 - EXP_TABLE_SPAN * i / EXP_TABLE_LEN);
+		}
+	}
+
+	u = randUniform();
+	if (u >= EXP_TABLE_SPAN) {
+		return -Mean * log(1.0 - u);
+	}
+	x = u * (EXP_TABLE_LEN / EXP_TABLE_SPAN);
+	i = (uint32_t) x;
+	return Mean * (Table[i] + (Table[i + 1] - Table[i]) * (x - i));
+}
+
+/*
+ * Controller configuration, as in RoE_initClkControl()
+ */
+static void configController(const SimParams *P, OccCtrlConfig *Config,
+		double WordRate, double WordsPerPkt) {
+	uint32_t PeriodUs = (uint32_t) P->PeriodUs;
+
+	Config->Setpoint = (uint32_t) P->Depth / 2;
+	Config->IntegralLimitPpb = CLK_CTRL_MAX_STEPS * (int32_t) P->StepPpb;
+	Config->StepPpb = (int32_t) P->StepPpb;
+	Config->HysteresisPpb = (int32_t) P->HystPpb;
+	Config->MaxSteps = CLK_CTRL_MAX_STEPS;
+	Config->HoldUpdates = ((uint32_t) P->HoldUs + PeriodUs - 1) / PeriodUs;
+	Config->ConvergedBand = (uint32_t) WordsPerPkt;
+	Config->ConvergedUpdates = 1000000 / PeriodUs;
+	OccCtrl_design(Config, (uint32_t) WordRate, PeriodUs,
+			(uint32_t) P->BandwidthMhz);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Simulates one run. Times are in us, clock corrections in ppb.
+ *
+ ******************************************************************************/
+static void simulate(const SimParams *P, int ClockModel, FILE *Trace,
+		SimResult *R) {
+	OccCtrlConfig Config;
+	OccCtrlState Ctrl;
+	double WordsPerPkt = P->BfsPerPkt * P->LineRate * 4;
+	double WordRate = CPRI_BF_RATE * P->LineRate * 4;
+	double PktPeriodUs = 1e6 * P->BfsPerPkt / CPRI_BF_RATE;
+	double Alpha = 1.0 - exp(-P->PollUs / (P->SettleUs / 3.0 + 1e-9));
+	double t = 0, End = P->Seconds * 1e6, Next, NextPoll = P->PollUs;
+	double NextUpdate = P->PeriodUs, NextArrival;
+	double Written = 0, Read = 0, Target = 0, Applied = 0, StallEnd = 0;
+	int Reading = 0, Started = 0, Underflow = 0, Overflow = 0;
+	uint64_t Pkt = 0;
+
+	memset(R, 0, sizeof(*R));
+	R->MinOccupancy = INT32_MAX;
+	R->MaxOccupancy = INT32_MIN;
+
+	configController(P, &Config, WordRate, WordsPerPkt);
+	OccCtrl_init(&Ctrl, &Config);
+
+	NextArrival = randExponential(P->JitterUs);
+
+	while (t < End) {
+		/* Read rate (words/us), constant until the next poll */
+		double Rate = Reading ? WordRate * 1e-6
+				* (1.0 + (P->Ppm * 1e3 + Applied) * 1e-9) : 0.0;
+
+		/* BBU packets arriving before the next poll, in order after their PDV */
+		for (;;) {
+			Next = (NextArrival < NextPoll) ? NextArrival : NextPoll;
+
+			/* CPRI read side */
+			if (Next > StallEnd) {
+				Read += (Next - ((t > StallEnd) ? t : StallEnd)) * Rate;
+			}
+			t = Next;
+
+			if (Read > Written) {
+				R->WordsLost += Read - Written;
+				Read = Written;
+				if (!Underflow) {
+					R->Underflows++;
+				}
+				Underflow = 1;
+			} else if (Written - Read > WordsPerPkt) {
+				Underflow = 0;
+			}
+
+			if (t != NextArrival) {
+				break;
+			}
+
+			Written += WordsPerPkt;
+			if (Written - Read > P->Depth) {
+				R->WordsLost += Written - Read - P->Depth;
+				Written = Read + P->Depth;
+				if (!Overflow) {
+					R->Overflows++;
+				}
+				Overflow = 1;
+			} else {
+				Overflow = 0;
+			}
+			/* Read out from the center, once filled up to it */
+			if (!Reading && Written >= P->Depth / 2) {
+				Reading = 1;
+				Rate = WordRate * 1e-6 * (1.0 + P->Ppm * 1e-6);
+			}
+
+			Pkt++;
+			Next = Pkt * PktPeriodUs + randExponential(P->JitterUs);
+			NextArrival = (Next > NextArrival) ? Next : NextArrival;
+		}
+
+		/* Firmware poll */
+		NextPoll += P->PollUs;
+		if (ClockModel == CLK_SI5324) {
+			Applied += (Target - Applied) * Alpha;
+		}
+
+		{
+			double Occ = floor(Written) - floor(Read);
+			uint32_t Sample = (Occ < 0) ? 0 : (Occ > OCCUPANCY_MAX) ?
+					OCCUPANCY_MAX : (uint32_t) Occ;
+			int Step;
+
+			if (Sample > 0) {
+				Started = 1;
+			}
+			if (!Started) {
+				continue;
+			}
+			OccCtrl_sample(&Ctrl, Sample);
+
+			if (Ctrl.ConvergedAt) {
+				if ((int32_t) Occ < R->MinOccupancy) {
+					R->MinOccupancy = (int32_t) Occ;
+				}
+				if ((int32_t) Occ > R->MaxOccupancy) {
+					R->MaxOccupancy = (int32_t) Occ;
+				}
+			}
+
+			if (t < NextUpdate) {
+				continue;
+			}
+			NextUpdate += P->PeriodUs;
+
+			Step = OccCtrl_update(&Ctrl);
+			if (Step != OCC_CTRL_HOLD) {
+				Target += Step * P->StepPpb;
+				if (ClockModel == CLK_MMCM) {
+					/* Output stopped while reconfigured */
+					StallEnd = t + P->SettleUs;
+					Applied = Target;
+				}
+			}
+
+			if (Trace) {
+				fprintf(Trace, "%.3f,%.2f,%d,%.0f,%.1f\n", t * 1e-3,
+						Ctrl.ErrorQ8 / 256.0, Ctrl.OutputPpb, Target, Applied);
+			}
+		}
+	}
+
+	OccCtrl_getStats(&Ctrl, &R->Ctrl);
+	if (!R->Ctrl.Converged) {
+		R->MinOccupancy = R->MaxOccupancy = 0;
+	}
+}
+
+/*****************************************************************************/
+
+typedef struct {
+	const char *Name;
+	size_t Offset;
+	const char *Help;
+} ParamInfo;
+
+static const ParamInfo Params[] = {
+	{ "ppm", offsetof(SimParams, Ppm), "RRU clock offset (ppm)" },
+	{ "jitter", offsetof(SimParams, JitterUs), "mean PDV (us)" },
+	{ "bfs", offsetof(SimParams, BfsPerPkt), "BFs per packet" },
+	{ "rate", offsetof(SimParams, LineRate), "CPRI line rate option" },
+	{ "depth", offsetof(SimParams, Depth), "buffer depth (words)" },
+	{ "step", offsetof(SimParams, StepPpb), "clock step (ppb)" },
+	{ "hyst", offsetof(SimParams, HystPpb), "step hysteresis (ppb)" },
+	{ "bw", offsetof(SimParams, BandwidthMhz), "loop natural freq (mHz)" },
+	{ "period", offsetof(SimParams, PeriodUs), "update period (us)" },
+	{ "hold", offsetof(SimParams, HoldUs), "firmware hold after a step (us)" },
+	{ "settle", offsetof(SimParams, SettleUs), "clock settling time (us)" },
+	{ "poll", offsetof(SimParams, PollUs), "polling interval (us)" },
+	{ "time", offsetof(SimParams, Seconds), "simulated time (s)" },
+};
+
+#define N_PARAMS	(sizeof(Params) / sizeof(Params[0]))
+
+static double *paramPtr(SimParams *P, const char *Name) {
+	uint32_t i;
+
+	for (i = 0; i < N_PARAMS; i++) {
+		if (strcmp(Name, Params[i].Name) == 0) {
+			return (double *) ((char *) P + Params[i].Offset);
+		}
+	}
+	return NULL;
+}
+
+static void usage(const char *Prog) {
+	uint32_t i;
+
+	fprintf(stderr,
+			"Usage: %s [options]\n"
+			"  -c <clk>      si5324 (default) or mmcm\n"
+			"  -p <ppm>      RRU clock offset (default 20)\n"
+			"  -j <us>       mean packet delay variation (default 5)\n"
+			"  -t <s>        simulated time (default 30)\n"
+			"  -P name=val   set any parameter\n"
+			"  -s name=start:stop:step  sweep a parameter\n"
+			"  -r <n>        random runs per point (default 1)\n"
+			"  -S <n>        random seed\n"
+			"  -o <file>     trace of the controller updates (CSV: ms, "
+			"error, output ppb, target ppb, applied ppb)\n"
+			"Parameters:\n", Prog);
+	for (i = 0; i < N_PARAMS; i++) {
+		fprintf(stderr, "  %-8s %s\n", Params[i].Name, Params[i].Help);
+	}
+}
+
+int main(int argc, char **argv) {
+	SimParams P = { .Ppm = 20, .JitterUs = 5, .BfsPerPkt = 16, .LineRate = 1,
+			.Depth = 8192, .StepPpb = 1000, .HystPpb = 250,
+			.BandwidthMhz = 200, .PeriodUs = 10000, .HoldUs = -1,
+			.SettleUs = -1, .PollUs = 20, .Seconds = 30 };
+	const char *TracePath = NULL, *SweepName = NULL;
+	double SweepStart = 0, SweepStop = 0, SweepStep = 1, *Swept = NULL;
+	double Value, SimSeconds = 0;
+	uint32_t nRuns = 1, Run;
+	uint64_t Seed = 1;
+	int ClockModel = CLK_SI5324, Opt, Failed = 0;
+	FILE *Trace = NULL;
+	clock_t Start;
+	char *Eq;
+
+	while ((Opt = getopt(argc, argv, "c:p:j:t:P:s:r:S:o:h")) != -1) {
+		switch (Opt) {
+		case 'c':
+			if (strcmp(optarg, "si5324") == 0) {
+				ClockModel = CLK_SI5324;
+			} else if (strcmp(optarg, "mmcm") == 0) {
+				ClockModel = CLK_MMCM;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'p':
+			P.Ppm = atof(optarg);
+			break;
+		case 'j':
+			P.JitterUs = atof(optarg);
+			break;
+		case 't':
+			P.Seconds = atof(optarg);
+			break;
+		case 'P':
+		case 's':
+			Eq = strchr(optarg, '=');
+			if (!Eq) {
+				usage(argv[0]);
+				return 1;
+			}
+			*Eq = '\0';
+			if (!paramPtr(&P, optarg)) {
+				fprintf(stderr, "Unknown parameter %s\n", optarg);
+				return 1;
+			}
+			if (Opt == 'P') {
+				*paramPtr(&P, optarg) = atof(Eq + 1);
+			} else if (sscanf(Eq + 1, "%lf:%lf:%lf", &SweepStart, &SweepStop,
+					&SweepStep) != 3 || SweepStep <= 0) {
+				usage(argv[0]);
+				return 1;
+			} else {
+				SweepName = optarg;
+			}
+			break;
+		case 'r':
+			nRuns = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'S':
+			Seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'o':
+			TracePath = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (nRuns == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	/* Clock defaults: Si5324 lock time, or MMCM reconfiguration */
+	if (P.SettleUs < 0) {
+		P.SettleUs = (ClockModel == CLK_SI5324) ? 70000 : 0;
+	}
+	if (P.HoldUs < 0) {
+		P.HoldUs = (ClockModel == CLK_SI5324) ? 70000 : 0;
+	}
+
+	if (TracePath) {
+		Trace = fopen(TracePath, "w");
+		if (!Trace) {
+			perror(TracePath);
+			return 1;
+		}
+	}
+	if (SweepName) {
+		Swept = paramPtr(&P, SweepName);
+	} else {
+		SweepStart = SweepStop = 0;
+	}
+
+	printf("%10s %5s %6s %6s %10s %9s %9s %8s %8s %8s\n",
+			SweepName ? SweepName : "", "runs", "under", "over", "lost words",
+			"conv ms", "rms words", "peak", "min occ", "max occ");
+
+	Start = clock();
+	for (Value = SweepStart; Value <= SweepStop + 1e-9; Value += SweepStep) {
+		uint32_t nUnder = 0, nOver = 0, nConverged = 0;
+		double Lost = 0, WorstConvMs = 0, SumRms = 0, WorstPeak = 0;
+		int32_t MinOcc = INT32_MAX, MaxOcc = INT32_MIN;
+
+		if (Swept) {
+			*Swept = Value;
+		}
+		if (P.PeriodUs < 1 || P.PollUs <= 0 || P.Depth < 2 || P.BfsPerPkt < 1) {
+			fprintf(stderr, "Invalid parameters\n");
+			return 1;
+		}
+
+		for (Run = 0; Run < nRuns; Run++) {
+			SimResult R;
+
+			RngState = (Seed + Run) * 0x9E3779B97F4A7C15ULL | 1;
+			simulate(&P, ClockModel, (Run == 0) ? Trace : NULL, &R);
+			SimSeconds += P.Seconds;
+
+			nUnder += (R.Underflows > 0);
+			nOver += (R.Overflows > 0);
+			Lost += R.WordsLost;
+			if (R.Ctrl.Converged) {
+				double ConvMs = R.Ctrl.ConvergenceUpdates * P.PeriodUs * 1e-3;
+
+				nConverged++;
+				WorstConvMs = (ConvMs > WorstConvMs) ? ConvMs : WorstConvMs;
+				SumRms += R.Ctrl.RmsJitterQ8 / 256.0;
+				if (R.Ctrl.PeakErrorQ8 / 256.0 > WorstPeak) {
+					WorstPeak = R.Ctrl.PeakErrorQ8 / 256.0;
+				}
+				MinOcc = (R.MinOccupancy < MinOcc) ? R.MinOccupancy : MinOcc;
+				MaxOcc = (R.MaxOccupancy > MaxOcc) ? R.MaxOccupancy : MaxOcc;
+			}
+		}
+
+		if (nUnder || nOver || nConverged < nRuns) {
+			Failed = 1;
+		}
+		printf("%10g %5u %6u %6u %10.0f ", Swept ? Value : 0.0, nRuns, nUnder,
+				nOver, Lost);
+		if (nConverged == nRuns) {
+			printf("%9.0f %9.2f %8.1f %8d %8d\n", WorstConvMs,
+					SumRms / nConverged, WorstPeak, MinOcc, MaxOcc);
+		} else {
+			printf("%9s (%u of %u runs did not converge)\n", "-",
+					nRuns - nConverged, nRuns);
+		}
+	}
+
+	{
+		double Wall = (double) (clock() - Start) / CLOCKS_PER_SEC;
+
+		printf("%.0f s simulated in %.2f s (%.0fx real time)\n", SimSeconds,
+				Wall, Wall > 0 ? SimSeconds / Wall : 0.0);
+	}
+
+	if (Trace) {
+		fclose(Trace);
+	}
+	return Failed ? 2 : 0;
+}
@@ -0,0 +1,589 @@
+/*
+ * roe_gen.c
+ *
+ * Software BBU: generates the RoE fronthaul traffic of the cpri2ethernet
+ * module, for load tests of the RRU receive path and of its clock recovery
+ * from a Linux host, without a second FPGA.
+ *
+ * Frames are laid out as in "tools/roe_model/roe_frame.h". Each AxC carries
+ * a complex tone from the NCO of "drivers/dsp/nco.c" (AxC k at (k + 1) times
+ * the base frequency, -6 dBFS), sampled at the chip rate, and every BF
+ * carries the control word. The departures follow one of the patterns:
+ *
+ *  - ready: each packet leaves as soon as its last BF is formed;
+ *  - ab:    the hardware flow control, alternating the two intervals of
+ *           "flow_ctrl.c", dithered as "RoE_ditherFlowControl()" does;
+ *  - burst: packets leave in back-to-back bursts of -k packets.
+ *
+ * The BBU clock can be offset (ppm), which the RRU clock recovery must
+ * track. Each packet is then delayed by a random PDV (uniform or
+ * exponential, keeping the frame order), and frames can be dropped, alone
+ * or in bursts of random (geometric) length.
+ *
+ * The frames go to a pcap file (nanosecond timestamps), or are sent in real
+ * time to a TAP interface (created if needed) or to a network interface
+ * through a raw socket, e.g. the one connected to the RRU or the loopback.
+ * The last two need CAP_NET_ADMIN / CAP_NET_RAW.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -Wall -Idrivers/sdr_testbed -Idrivers/dsp -Itools/roe_model \
+ *       -o roe_gen tools/roe_gen/roe_gen.c tools/roe_model/roe_frame.c \
+ *       drivers/sdr_testbed/flow_ctrl.c drivers/dsp/nco.c \
+ *       drivers/dsp/dsp_trig.c -lm
+ *
+ * Examples:
+ *
+ *   ./roe_gen -t 10 -o bbu.pcap
+ *   ./roe_gen -b 64 -m ab -r 20 -j 5 -J exp -L 1e-4 -B 3 -o bbu.pcap
+ *   sudo ./roe_gen -t 60 -m burst -k 4 -i eth1
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/if_tun.h>
+#include "flow_ctrl.h"
+#include "nco.h"
+#include "roe_frame.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Firmware settings (mirrors of radio_over_ethernet.c)
+ */
+#define CPRI_CHIP_RATE			3840000
+#define ROE_AXI_CLK_HZ			100000000
+#define FLOW_CTRL_DITHER_PAIRS	256
+#define BFs_PER_PKT				16
+#define CONTROL_WORD			0x00DE
+#define ROE_ETHER_TYPE			0xCD
+
+#define PS_PER_S				1000000000000ULL
+#define LINK_PS_PER_BYTE		8000	/* 1000BASE-T */
+#define MAX_AXC					ROE_BF_MAX_AXC(2)
+#define MAX_BFS_PER_PKT			(ROE_FRAME_MAX_PAYLOAD / 16)
+
+#define DEFAULT_TONE_HZ			100000
+#define TONE_AMPLITUDE			16384	/* -6 dBFS */
+
+/*
+ * Departure patterns and outputs
+ */
+#define MODE_READY				0
+#define MODE_AB					1
+#define MODE_BURST				2
+
+#define OUT_NONE				0
+#define OUT_PCAP				1
+#define OUT_TAP					2
+#define OUT_IFACE				3
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	uint32_t LineRate;
+	uint32_t BfsPerPkt;
+	uint32_t nAxc;
+	double Seconds;
+	double Ppm;				/* BBU clock offset */
+	int Mode;
+	uint32_t BurstPkts;
+	double JitterUs;		/* Mean PDV */
+	int ExpJitter;
+	double LossRate;		/* Probability that a loss burst starts */
+	double BurstLoss;		/* Mean frames per loss burst */
+	int32_t ToneHz;
+} GenConfig;
+
+typedef struct {
+	int Type;
+	FILE *Pcap;
+	int Fd;
+	struct sockaddr_ll Addr;
+} GenOutput;
+
+typedef struct {
+	uint64_t nPkts;
+	uint64_t nLost;
+	uint64_t nSent;
+	uint64_t nBytes;
+	uint64_t nErrors;
+	uint64_t nLate;			/* Sent more than one packet period late */
+	uint64_t MaxLateNs;
+	uint64_t LastNs;
+} GenStats;
+
+/************************** Variable Definitions *****************************/
+
+static uint64_t RngState = 0x853C49E6748FEA9BULL;
+
+/*****************************************************************************/
+
+static double uniform(void) {
+	RngState ^= RngState >> 12;
+	RngState ^= RngState << 25;
+	RngState ^= RngState >> 27;
+	return ((RngState * 0x2545F4914F6CDD1DULL) >> 11) * 0x1.0p-53;
+}
+
+/*
+ * End of BF k, in ps (without overflow)
+ */
+static uint64_t bfTime(uint64_t Bf) {
+	return Bf / CPRI_CHIP_RATE * PS_PER_S
+			+ Bf % CPRI_CHIP_RATE * PS_PER_S / CPRI_CHIP_RATE;
+}
+
+static uint64_t nowNs(void) {
+	struct timespec Ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &Ts);
+	return (uint64_t) Ts.tv_sec * 1000000000ULL + (uint64_t) Ts.tv_nsec;
+}
+
+/*
+ * Waits until the given monotonic time: sleeps while far from it, then spins,
+ * since packets are a few us apart
+ */
+static void waitUntilNs(uint64_t Ns) {
+	uint64_t Now = nowNs();
+
+	if (Ns > Now + 200000) {
+		struct timespec Ts;
+		uint64_t Wake = Ns - 100000;
+
+		Ts.tv_sec = (time_t) (Wake / 1000000000ULL);
+		Ts.tv_nsec = (long) (Wake % 1000000000ULL);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &Ts, NULL);
+	}
+	while (nowNs() < Ns) {
+	}
+}
+
+static int parseMac(uint8_t *Mac, const char *s) {
+	unsigned int b[6];
+	int i;
+
+	if (sscanf(s, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4],
+			&b[5]) != 6) {
+		return -1;
+	}
+	for (i = 0; i < 6; i++) {
+		Mac[i] = (uint8_t) b[i];
+	}
+	return 0;
+}
+
+static int openTap(GenOutput *Out, const char *Name) {
+	struct ifreq Ifr;
+
+	Out->Fd = open("/dev/net/tun", O_RDWR);
+	if (Out->Fd < 0) {
+		perror("/dev/net/tun");
+		return -1;
+	}
+	memset(&Ifr, 0, sizeof(Ifr));
+	Ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+	strncpy(Ifr.ifr_name, Name, IFNAMSIZ - 1);
+	if (ioctl(Out->Fd, TUNSETIFF, &Ifr) < 0) {
+		perror(Name);
+		close(Out->Fd);
+		return -1;
+	}
+	Out->Type = OUT_TAP;
+	return 0;
+}
+
+static int openIface(GenOutput *Out, const char *Name) {
+	Out->Fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if (Out->Fd < 0) {
+		perror("socket");
+		return -1;
+	}
+	memset(&Out->Addr, 0, sizeof(Out->Addr));
+	Out->Addr.sll_family = AF_PACKET;
+	Out->Addr.sll_ifindex = (int) if_nametoindex(Name);
+	Out->Addr.sll_halen = 6;
+	if (Out->Addr.sll_ifindex == 0) {
+		perror(Name);
+		close(Out->Fd);
+		return -1;
+	}
+	Out->Type = OUT_IFACE;
+	return 0;
+}
+
+static int sendFrame(GenOutput *Out, const uint8_t *Frame, size_t Length) {
+	ssize_t n = (ssize_t) Length;
+
+	switch (Out->Type) {
+	case OUT_TAP:
+		n = write(Out->Fd, Frame, Length);
+		break;
+	case OUT_IFACE:
+		n = sendto(Out->Fd, Frame, Length, 0, (struct sockaddr *) &Out->Addr,
+				sizeof(Out->Addr));
+		break;
+	}
+	return (n == (ssize_t) Length) ? 0 : -1;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Fills the BFs of one packet: control word, then one NCO sample per AxC
+ * (the NCO gives I in the 16 MSBs, the AxC containers hold it in the LSBs).
+ *
+ ******************************************************************************/
+static void fillBfs(uint32_t *Words, const GenConfig *Config,
+		NcoState *Nco, uint32_t ControlWord) {
+	uint32_t WordsPerBf = ROE_BF_WORDS(Config->LineRate);
+	uint32_t Samples[MAX_BFS_PER_PKT], Bf, k;
+
+	memset(Words, 0, 4 * WordsPerBf * Config->BfsPerPkt);
+	for (Bf = 0; Bf < Config->BfsPerPkt; Bf++) {
+		Words[Bf * WordsPerBf] = ControlWord << 16;
+	}
+	for (k = 0; k < Config->nAxc; k++) {
+		NcoSynth_generate(&Nco[k], Samples, Config->BfsPerPkt, 1);
+		for (Bf = 0; Bf < Config->BfsPerPkt; Bf++) {
+			Words[Bf * WordsPerBf + ROE_BF_AXC_WORD(Config->LineRate, k)] =
+					(Samples[Bf] << 16) | (Samples[Bf] >> 16);
+		}
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Generates the traffic for the configured time.
+ *
+ ******************************************************************************/
+static void generate(const GenConfig *Config, const RoeFrameHeader *Header,
+		uint32_t ControlWord, GenOutput *Out, GenStats *Stats) {
+	static NcoState Nco[MAX_AXC];
+	uint32_t Words[ROE_FRAME_MAX_PAYLOAD / 4];
+	uint8_t Frame[ROE_FRAME_HEADER + ROE_FRAME_MAX_PAYLOAD];
+	uint64_t End = (uint64_t) (Config->Seconds * PS_PER_S);
+	uint64_t CyclePs = PS_PER_S / ROE_AXI_CLK_HZ;
+	uint64_t LastDeparture = 0, LinkFree = 0, SlotEnd = 0, LastWrite = 0;
+	uint64_t StartNs = 0;
+	double Scale = 1.0 / (1.0 + Config->Ppm * 1e-6);
+	uint32_t RegB = 0, LossLeft = 0, k;
+	FlowCtrlDither Dither;
+	FlowCtrlPlan Plan;
+	int Second = 0;
+
+	for (k = 0; k < Config->nAxc; k++) {
+		NcoPlan Tone;
+
+		memset(&Tone, 0, sizeof(Tone));
+		Tone.SampleRate = CPRI_CHIP_RATE;
+		Tone.nTones = 1;
+		Tone.Tone[0].StartHz = Config->ToneHz * (int32_t) (k + 1);
+		Tone.Tone[0].StopHz = Tone.Tone[0].StartHz;
+		Tone.Tone[0].Amplitude = TONE_AMPLITUDE;
+		NcoSynth_init(&Nco[k], &Tone, CPRI_CHIP_RATE);
+	}
+
+	FlowCtrl_plan(&Plan, Config->BfsPerPkt, CPRI_CHIP_RATE, ROE_AXI_CLK_HZ);
+	FlowCtrl_initDither(&Dither, &Plan);
+	RegB = Plan.IntervalB;
+
+	if (Out->Type == OUT_TAP || Out->Type == OUT_IFACE) {
+		StartNs = nowNs();
+	}
+
+	while (1) {
+		uint64_t FirstBf = Stats->nPkts * Config->BfsPerPkt;
+		uint64_t Departure = bfTime(FirstBf + Config->BfsPerPkt), Arrival;
+		size_t Length;
+
+		switch (Config->Mode) {
+		case MODE_AB:
+			if (Stats->nPkts > 0) {
+				uint64_t Interval = Second ? RegB : Plan.IntervalA;
+
+				if (Departure < LastDeparture + Interval * CyclePs) {
+					Departure = LastDeparture + Interval * CyclePs;
+				}
+				Second = !Second;
+			}
+			if (Plan.DitherNum && Departure >= SlotEnd) {
+				RegB = FlowCtrl_nextIntervalB(&Dither,
+						(uint32_t) ((Departure - LastWrite) / CyclePs));
+				LastWrite = Departure;
+				SlotEnd = Departure + (uint64_t) FLOW_CTRL_DITHER_PAIRS
+						* (Plan.IntervalA + RegB) * CyclePs;
+			}
+			break;
+		case MODE_BURST:
+			/* Wait for the last packet of the burst */
+			Departure = bfTime((Stats->nPkts / Config->BurstPkts + 1)
+					* Config->BurstPkts * Config->BfsPerPkt);
+			break;
+		}
+		LastDeparture = Departure;
+
+		/* BBU clock offset */
+		Departure = (uint64_t) (Departure * Scale);
+		if (Departure >= End) {
+			break;
+		}
+
+		fillBfs(Words, Config, Nco, ControlWord);
+		Length = RoeFrame_build(Frame, Header, Words,
+				ROE_BF_WORDS(Config->LineRate) * Config->BfsPerPkt);
+		Stats->nPkts++;
+
+		/* Loss bursts */
+		if (LossLeft == 0 && Config->LossRate > 0
+				&& uniform() < Config->LossRate) {
+			LossLeft = 1;
+			while (uniform() > 1.0 / Config->BurstLoss) {
+				LossLeft++;
+			}
+		}
+		if (LossLeft) {
+			LossLeft--;
+			Stats->nLost++;
+			continue;
+		}
+
+		/* PDV, in order over the link */
+		Arrival = Departure;
+		if (Config->JitterUs > 0) {
+			double Pdv = Config->ExpJitter ? -log(1.0 - uniform())
+					: 2.0 * uniform();
+
+			Arrival += (uint64_t) (Pdv * Config->JitterUs * 1e6);
+		}
+		if (Arrival < LinkFree) {
+			Arrival = LinkFree;
+		}
+		LinkFree = Arrival + RoeFrame_wireBytes(Length) * LINK_PS_PER_BYTE;
+
+		Stats->LastNs = Arrival / 1000;
+		if (Out->Type == OUT_PCAP) {
+			RoeFrame_writePcapRecord(Out->Pcap, Arrival / 1000, Frame, Length);
+		} else if (Out->Type != OUT_NONE) {
+			uint64_t Due = StartNs + Arrival / 1000, Now;
+
+			waitUntilNs(Due);
+			if (sendFrame(Out, Frame, Length) != 0) {
+				Stats->nErrors++;
+				continue;
+			}
+			Now = nowNs();
+			if (Now - Due > Stats->MaxLateNs) {
+				Stats->MaxLateNs = Now - Due;
+			}
+			if ((Now - Due) * (uint64_t) CPRI_CHIP_RATE
+					> (uint64_t) Config->BfsPerPkt * 1000000000ULL) {
+				Stats->nLate++;
+			}
+		}
+		Stats->nSent++;
+		Stats->nBytes += Length;
+	}
+}
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"Usage: %s [options]\n"
+			"  -l <n>      CPRI line rate option (default 1)\n"
+			"  -b <n>      BFs per packet (default %d)\n"
+			"  -a <n>      AxCs with a tone (default all)\n"
+			"  -t <s>      duration (default 1)\n"
+			"  -m <mode>   departures: ready (default), ab or burst\n"
+			"  -k <n>      packets per burst (default 2)\n"
+			"  -r <ppm>    BBU clock offset (default 0)\n"
+			"  -j <us>     mean packet delay variation (default 0)\n"
+			"  -J <dist>   PDV distribution: uniform (default) or exp\n"
+			"  -L <rate>   probability that a loss burst starts (default 0)\n"
+			"  -B <n>      mean frames per loss burst (default 1)\n"
+			"  -f <Hz>     tone frequency of AxC 0 (default %d)\n"
+			"  -c <word>   control word (default 0x%04X)\n"
+			"  -e <type>   EtherType (default 0x%X)\n"
+			"  -s <mac>    source MAC (default b0:b1:b2:b3:b4:b5)\n"
+			"  -d <mac>    destination MAC (default a0:a1:a2:a3:a4:a5)\n"
+			"  -S <seed>   random seed\n"
+			"  -o <pcap>   write a capture\n"
+			"  -T <name>   send to a TAP interface, in real time\n"
+			"  -i <name>   send to a network interface, in real time\n", Prog,
+			BFs_PER_PKT, DEFAULT_TONE_HZ, CONTROL_WORD, ROE_ETHER_TYPE);
+}
+
+int main(int argc, char **argv) {
+	static const uint8_t BbuMac[6] = { 0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5 };
+	static const uint8_t RruMac[6] = { 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5 };
+	GenConfig Config;
+	GenOutput Out;
+	GenStats Stats;
+	RoeFrameHeader Header;
+	const char *PcapPath = NULL, *TapName = NULL, *IfName = NULL;
+	uint32_t ControlWord = CONTROL_WORD;
+	int Opt;
+	double Wall;
+	uint64_t Start;
+
+	memset(&Config, 0, sizeof(Config));
+	Config.LineRate = 1;
+	Config.BfsPerPkt = BFs_PER_PKT;
+	Config.Seconds = 1.0;
+	Config.Mode = MODE_READY;
+	Config.BurstPkts = 2;
+	Config.BurstLoss = 1.0;
+	Config.ToneHz = DEFAULT_TONE_HZ;
+	memcpy(Header.Src, BbuMac, 6);
+	memcpy(Header.Dst, RruMac, 6);
+	Header.EtherType = ROE_ETHER_TYPE;
+
+	while ((Opt = getopt(argc, argv, "l:b:a:t:m:k:r:j:J:L:B:f:c:e:s:d:S:o:T:i:h"))
+			!= -1) {
+		switch (Opt) {
+		case 'l':
+			Config.LineRate = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			Config.BfsPerPkt = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			Config.nAxc = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			Config.Seconds = atof(optarg);
+			break;
+		case 'm':
+			if (!strcmp(optarg, "ready")) {
+				Config.Mode = MODE_READY;
+			} else if (!strcmp(optarg, "ab")) {
+				Config.Mode = MODE_AB;
+			} else if (!strcmp(optarg, "burst")) {
+				Config.Mode = MODE_BURST;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'k':
+			Config.BurstPkts = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			Config.Ppm = atof(optarg);
+			break;
+		case 'j':
+			Config.JitterUs = atof(optarg);
+			break;
+		case 'J':
+			Config.ExpJitter = !strcmp(optarg, "exp");
+			break;
+		case 'L':
+			Config.LossRate = atof(optarg);
+			break;
+		case 'B':
+			Config.BurstLoss = atof(optarg);
+			break;
+		case 'f':
+			Config.ToneHz = (int32_t) strtol(optarg, NULL, 0);
+			break;
+		case 'c':
+			ControlWord = (uint32_t) strtoul(optarg, NULL, 0) & 0xFFFF;
+			break;
+		case 'e':
+			Header.EtherType = (uint16_t) strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+		case 'd':
+			if (parseMac((Opt == 's') ? Header.Src : Header.Dst, optarg)) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'S':
+			RngState = strtoull(optarg, NULL, 0) | 1;
+			break;
+		case 'o':
+			PcapPath = optarg;
+			break;
+		case 'T':
+			TapName = optarg;
+			break;
+		case 'i':
+			IfName = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (Config.nAxc == 0) {
+		Config.nAxc = ROE_BF_MAX_AXC(Config.LineRate);
+	}
+	if (Config.LineRate < 1 || Config.LineRate > 2 || Config.BfsPerPkt == 0
+			|| Config.BfsPerPkt > FlowCtrl_maxBfsPerPkt(Config.LineRate)
+			|| Config.nAxc > ROE_BF_MAX_AXC(Config.LineRate)
+			|| Config.Seconds <= 0 || Config.BurstPkts == 0
+			|| Config.BurstLoss < 1.0 || Config.JitterUs < 0
+			|| (int64_t) Config.ToneHz * Config.nAxc > CPRI_CHIP_RATE / 2
+			|| (PcapPath != NULL) + (TapName != NULL) + (IfName != NULL) > 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	memset(&Out, 0, sizeof(Out));
+	if (PcapPath) {
+		Out.Pcap = fopen(PcapPath, "wb");
+		if (Out.Pcap == NULL) {
+			perror(PcapPath);
+			return 1;
+		}
+		RoeFrame_writePcapHeader(Out.Pcap);
+		Out.Type = OUT_PCAP;
+	} else if (TapName && openTap(&Out, TapName) != 0) {
+		return 1;
+	} else if (IfName && openIface(&Out, IfName) != 0) {
+		return 1;
+	}
+
+	memset(&Stats, 0, sizeof(Stats));
+	Start = nowNs();
+	generate(&Config, &Header, ControlWord, &Out, &Stats);
+	Wall = (nowNs() - Start) * 1e-9;
+
+	if (Out.Pcap) {
+		fclose(Out.Pcap);
+	} else if (Out.Type != OUT_NONE) {
+		close(Out.Fd);
+	}
+
+	printf("Packets:    %llu generated, %llu lost, %llu sent, %llu errors\n",
+			(unsigned long long) Stats.nPkts, (unsigned long long) Stats.nLost,
+			(unsigned long long) Stats.nSent,
+			(unsigned long long) Stats.nErrors);
+	printf("Traffic:    %.3f Mbps of frames over %.3f s\n",
+			Stats.nBytes * 8.0 / Config.Seconds / 1e6, Config.Seconds);
+	if (Out.Type == OUT_TAP || Out.Type == OUT_IFACE) {
+		printf("Pacing:     %llu frames late by more than a packet period, "
+				"at most %.1f us\n", (unsigned long long) Stats.nLate,
+				Stats.MaxLateNs / 1e3);
+	} else {
+		printf("Generated in %.3f s (%.0f times real time)\n", Wall,
+				Config.Seconds / Wall);
+	}
+	return Stats.nErrors ? 2 : 0;
+}
@@ -0,0 +1,475 @@
+/*
+ * roe_metrics.c
+ *
+ * Receiver of the RRU metrics streams: status reports (RoE receive buffer
+ * and clock recovery) and radio telemetry, sent over the fronthaul by
+ * RoE_sendMetrics() (see "drivers/sdr_testbed/roe_metrics.h"), so that RRUs
+ * are monitored remotely instead of through their UART.
+ *
+ * Frames are read live from a network interface (raw socket, needs
+ * CAP_NET_RAW), e.g. a port mirroring the fronthaul, or from a pcap file.
+ * Reports are aggregated per RRU (source MAC), and a summary line is printed
+ * per RRU every -p seconds (capture time): occupancy mean and range, BF words
+ * lost, occupancy interrupts and clock corrections over the interval, the
+ * applied frequency offset, missing reports (sequence gaps) and the latest
+ * telemetry. With -o, every status report is also written as a CSV line.
+ *
+ * The exit status is 2 if BF words were lost or reports went missing.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -Wall -Idrivers/sdr_testbed -o roe_metrics \
+ *       tools/roe_metrics/roe_metrics.c drivers/sdr_testbed/roe_metrics.c
+ *
+ * Examples:
+ *
+ *   ./roe_metrics -r fronthaul.pcap
+ *   sudo ./roe_metrics -i eth1 -p 10 -o rru.csv
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include "roe_metrics.h"
+
+/************************** Constant Definitions *****************************/
+
+#define MAX_RRUS				16
+#define MAX_FRAME				2048
+#define VLAN_TPID				0x8100
+
+#define PCAP_MAGIC_US			0xA1B2C3D4
+#define PCAP_MAGIC_NS			0xA1B23C4D
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	FILE *f;
+	int Swapped;
+	int Ns;
+} PcapReader;
+
+/*
+ * Counters of an RRU since the start, and over the current interval
+ */
+typedef struct {
+	uint8_t Mac[6];
+	int Valid;					/* At least one status report */
+	int HasTelemetry;
+	uint16_t StatusSeq;
+	uint16_t TelemetrySeq;
+	RoeMetricsStatus First;		/* First status report */
+	RoeMetricsStatus Last;
+	RoeMetricsTelemetry Telemetry;
+	uint64_t nStatus;
+	uint64_t nTelemetry;
+	uint64_t nMissing;			/* Reports not received */
+	/* Interval */
+	RoeMetricsStatus Start;		/* Last report of the previous interval */
+	uint64_t OccupancySum;
+	uint32_t nInterval;
+	uint16_t OccupancyMin;
+	uint16_t OccupancyMax;
+	uint64_t nMissingStart;
+} RruState;
+
+typedef struct {
+	RruState Rru[MAX_RRUS];
+	int nRrus;
+	uint64_t nFrames;
+	uint64_t nMalformed;
+	FILE *Csv;
+} Receiver;
+
+/************************** Variable Definitions *****************************/
+
+static volatile sig_atomic_t Stop = 0;
+
+/*****************************************************************************/
+
+static void onSignal(int Signal) {
+	(void) Signal;
+	Stop = 1;
+}
+
+static uint32_t swap32(uint32_t x) {
+	return (x >> 24) | ((x >> 8) & 0xFF00) | ((x << 8) & 0xFF0000) | (x << 24);
+}
+
+static int openPcap(PcapReader *Pcap, const char *Path) {
+	uint32_t Header[6];
+
+	Pcap->f = fopen(Path, "rb");
+	if (Pcap->f == NULL) {
+		perror(Path);
+		return -1;
+	}
+	if (fread(Header, sizeof(Header), 1, Pcap->f) != 1) {
+		fprintf(stderr, "%s: not a pcap file\n", Path);
+		return -1;
+	}
+	Pcap->Swapped = (Header[0] == swap32(PCAP_MAGIC_US)
+			|| Header[0] == swap32(PCAP_MAGIC_NS));
+	if (Pcap->Swapped) {
+		Header[0] = swap32(Header[0]);
+		Header[5] = swap32(Header[5]);
+	}
+	if ((Header[0] != PCAP_MAGIC_US && Header[0] != PCAP_MAGIC_NS)
+			|| Header[5] != 1) {
+		fprintf(stderr, "%s: not an Ethernet pcap file\n", Path);
+		return -1;
+	}
+	Pcap->Ns = (Header[0] == PCAP_MAGIC_NS);
+	return 0;
+}
+
+/*
+ * Next record: returns its captured length, or -1 at the end
+ */
+static int readPcap(PcapReader *Pcap, uint8_t *Frame, uint64_t *TimeNs) {
+	uint32_t Record[4], Length;
+
+	if (fread(Record, sizeof(Record), 1, Pcap->f) != 1) {
+		return -1;
+	}
+	if (Pcap->Swapped) {
+		Record[0] = swap32(Record[0]);
+		Record[1] = swap32(Record[1]);
+		Record[2] = swap32(Record[2]);
+	}
+	*TimeNs = (uint64_t) Record[0] * 1000000000ULL
+			+ (uint64_t) Record[1] * (Pcap->Ns ? 1 : 1000);
+	Length = Record[2];
+	if (Length > MAX_FRAME) {
+		/* Not a metrics frame */
+		return fseek(Pcap->f, Length, SEEK_CUR) ? -1 : 0;
+	}
+	if (Length && fread(Frame, Length, 1, Pcap->f) != 1) {
+		return -1;
+	}
+	return (int) Length;
+}
+
+static int openSocket(const char *Name) {
+	struct sockaddr_ll Addr;
+	int Fd;
+
+	Fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if (Fd < 0) {
+		perror("socket");
+		return -1;
+	}
+	memset(&Addr, 0, sizeof(Addr));
+	Addr.sll_family = AF_PACKET;
+	Addr.sll_protocol = htons(ETH_P_ALL);
+	Addr.sll_ifindex = (int) if_nametoindex(Name);
+	if (Addr.sll_ifindex == 0
+			|| bind(Fd, (struct sockaddr *) &Addr, sizeof(Addr)) < 0) {
+		perror(Name);
+		close(Fd);
+		return -1;
+	}
+	return Fd;
+}
+
+static uint64_t nowNs(void) {
+	struct timespec Ts;
+
+	clock_gettime(CLOCK_REALTIME, &Ts);
+	return (uint64_t) Ts.tv_sec * 1000000000ULL + (uint64_t) Ts.tv_nsec;
+}
+
+static RruState *findRru(Receiver *R, const uint8_t *Mac) {
+	int i;
+
+	for (i = 0; i < R->nRrus; i++) {
+		if (!memcmp(R->Rru[i].Mac, Mac, 6)) {
+			return &R->Rru[i];
+		}
+	}
+	if (R->nRrus == MAX_RRUS) {
+		return NULL;
+	}
+	memset(&R->Rru[R->nRrus], 0, sizeof(RruState));
+	memcpy(R->Rru[R->nRrus].Mac, Mac, 6);
+	return &R->Rru[R->nRrus++];
+}
+
+static void resetInterval(RruState *Rru) {
+	Rru->Start = Rru->Last;
+	Rru->OccupancySum = 0;
+	Rru->nInterval = 0;
+	Rru->OccupancyMin = 0xFFFF;
+	Rru->OccupancyMax = 0;
+	Rru->nMissingStart = Rru->nMissing;
+}
+
+/*
+ * Missing reports between two sequence numbers
+ */
+static uint32_t seqGap(uint16_t Last, uint16_t Seq) {
+	return (uint16_t) (Seq - Last - 1);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Accounts for a metrics frame (VLAN tag allowed).
+ *
+ ******************************************************************************/
+static void receive(Receiver *R, uint64_t TimeNs, uint8_t *Frame,
+		size_t Length) {
+	RoeMetricsHeader Header;
+	RoeMetricsStatus Status;
+	RoeMetricsTelemetry Telemetry;
+	RruState *Rru;
+	int Type;
+
+	if (Length >= 18 && ((Frame[12] << 8) | Frame[13]) == VLAN_TPID) {
+		memmove(Frame + 12, Frame + 16, Length - 16);
+		Length -= 4;
+	}
+	Type = RoeMetrics_parse(Frame, Length, &Header, &Status, &Telemetry);
+	if (Type == 0) {
+		return;
+	}
+	R->nFrames++;
+	if (Type < 0 || (Rru = findRru(R, Header.Src)) == NULL) {
+		R->nMalformed++;
+		return;
+	}
+
+	if (Type == ROE_METRICS_TYPE_TELEMETRY) {
+		if (Rru->HasTelemetry) {
+			Rru->nMissing += seqGap(Rru->TelemetrySeq, Header.Seq);
+		}
+		Rru->TelemetrySeq = Header.Seq;
+		Rru->Telemetry = Telemetry;
+		Rru->HasTelemetry = 1;
+		Rru->nTelemetry++;
+		return;
+	}
+
+	if (!Rru->Valid) {
+		Rru->Valid = 1;
+		Rru->First = Status;
+		Rru->Last = Status;
+		resetInterval(Rru);
+	} else {
+		Rru->nMissing += seqGap(Rru->StatusSeq, Header.Seq);
+	}
+	Rru->StatusSeq = Header.Seq;
+	Rru->Last = Status;
+	Rru->nStatus++;
+
+	Rru->OccupancySum += Status.Occupancy;
+	Rru->nInterval++;
+	if (Status.nSamples && Status.OccupancyMin < Rru->OccupancyMin) {
+		Rru->OccupancyMin = Status.OccupancyMin;
+	}
+	if (Status.nSamples && Status.OccupancyMax > Rru->OccupancyMax) {
+		Rru->OccupancyMax = Status.OccupancyMax;
+	}
+
+	if (R->Csv) {
+		fprintf(R->Csv, "%.6f,%02x:%02x:%02x:%02x:%02x:%02x,%u,%u,%u,%u,%u,"
+				"%u,%u,%u,%d,%u,%u\n", TimeNs * 1e-9, Header.Src[0],
+				Header.Src[1], Header.Src[2], Header.Src[3], Header.Src[4],
+				Header.Src[5], Header.Seq, Header.TimeUs, Status.Occupancy,
+				Status.OccupancyMin, Status.OccupancyMax, Status.BfWordsLost,
+				Status.nEmptyInterrupts, Status.nFullInterrupts,
+				Status.FreqOffsetPpb, Status.nIncrease, Status.nDecrease);
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Prints a line per RRU for the interval, and starts the next one.
+ *
+ ******************************************************************************/
+static void summarize(Receiver *R, double Time) {
+	int i;
+
+	for (i = 0; i < R->nRrus; i++) {
+		RruState *Rru = &R->Rru[i];
+
+		if (!Rru->Valid) {
+			continue;
+		}
+		printf("%9.3f %02x:%02x:%02x:%02x:%02x:%02x", Time, Rru->Mac[0],
+				Rru->Mac[1], Rru->Mac[2], Rru->Mac[3], Rru->Mac[4],
+				Rru->Mac[5]);
+		if (Rru->nInterval) {
+			printf(" occ %5llu [%u, %u]",
+					(unsigned long long) (Rru->OccupancySum / Rru->nInterval),
+					Rru->OccupancyMin, Rru->OccupancyMax);
+		} else {
+			printf(" occ     - (no reports)");
+		}
+		printf(" lost %u int -%u +%u freq %+d ppb steps +%u -%u missing %llu",
+				Rru->Last.BfWordsLost - Rru->Start.BfWordsLost,
+				(uint16_t) (Rru->Last.nEmptyInterrupts
+						- Rru->Start.nEmptyInterrupts),
+				(uint16_t) (Rru->Last.nFullInterrupts
+						- Rru->Start.nFullInterrupts),
+				Rru->Last.FreqOffsetPpb,
+				(uint16_t) (Rru->Last.nIncrease - Rru->Start.nIncrease),
+				(uint16_t) (Rru->Last.nDecrease - Rru->Start.nDecrease),
+				(unsigned long long) (Rru->nMissing - Rru->nMissingStart));
+		if (Rru->HasTelemetry) {
+			printf(" | %.1f C rssi %.1f/%.1f dB gain %d/%d dB",
+					Rru->Telemetry.TemperatureMc / 1000.0,
+					Rru->Telemetry.RssiMdb[0] / 1000.0,
+					Rru->Telemetry.RssiMdb[1] / 1000.0,
+					Rru->Telemetry.RxGainDb[0], Rru->Telemetry.RxGainDb[1]);
+		}
+		printf("\n");
+		resetInterval(Rru);
+	}
+	fflush(stdout);
+}
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"Usage: %s (-r <pcap> | -i <interface>) [options]\n"
+			"  -r <pcap>   read a capture\n"
+			"  -i <name>   receive live on a network interface\n"
+			"  -p <s>      summary period (default 1)\n"
+			"  -t <s>      stop after this time, live (default: on Ctrl-C)\n"
+			"  -o <csv>    write every status report\n", Prog);
+}
+
+int main(int argc, char **argv) {
+	static Receiver R;
+	static uint8_t Frame[MAX_FRAME];
+	PcapReader Pcap = { NULL, 0, 0 };
+	const char *PcapPath = NULL, *IfName = NULL, *CsvPath = NULL;
+	double Period = 1.0, Duration = 0;
+	uint64_t StartNs = 0, NextNs = 0, EndNs = 0, TimeNs = 0;
+	int Fd = -1, Opt, i, Failed = 0;
+
+	while ((Opt = getopt(argc, argv, "r:i:p:t:o:h")) != -1) {
+		switch (Opt) {
+		case 'r':
+			PcapPath = optarg;
+			break;
+		case 'i':
+			IfName = optarg;
+			break;
+		case 'p':
+			Period = atof(optarg);
+			break;
+		case 't':
+			Duration = atof(optarg);
+			break;
+		case 'o':
+			CsvPath = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if ((PcapPath == NULL) == (IfName == NULL) || Period <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (PcapPath && openPcap(&Pcap, PcapPath) != 0) {
+		return 1;
+	}
+	if (IfName) {
+		struct timeval Timeout = { 0, 100000 };
+
+		Fd = openSocket(IfName);
+		if (Fd < 0) {
+			return 1;
+		}
+		// Wake up regularly to print the summaries
+		setsockopt(Fd, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout));
+		signal(SIGINT, onSignal);
+		StartNs = nowNs();
+		NextNs = StartNs + (uint64_t) (Period * 1e9);
+		EndNs = (Duration > 0) ? StartNs + (uint64_t) (Duration * 1e9) : 0;
+	}
+	if (CsvPath) {
+		R.Csv = fopen(CsvPath, "w");
+		if (R.Csv == NULL) {
+			perror(CsvPath);
+			return 1;
+		}
+		fprintf(R.Csv, "time,rru,seq,rru_time_us,occupancy,occupancy_min,"
+				"occupancy_max,bf_words_lost,empty_interrupts,"
+				"full_interrupts,freq_offset_ppb,increase_steps,"
+				"decrease_steps\n");
+	}
+
+	while (!Stop) {
+		int Length;
+
+		if (PcapPath) {
+			Length = readPcap(&Pcap, Frame, &TimeNs);
+			if (Length < 0) {
+				break;
+			}
+			if (StartNs == 0) {
+				StartNs = TimeNs;
+				NextNs = StartNs + (uint64_t) (Period * 1e9);
+			}
+		} else {
+			Length = (int) recv(Fd, Frame, sizeof(Frame), 0);
+			TimeNs = nowNs();
+			if (EndNs && TimeNs >= EndNs) {
+				break;
+			}
+		}
+
+		while (TimeNs >= NextNs) {
+			summarize(&R, (NextNs - StartNs) * 1e-9);
+			NextNs += (uint64_t) (Period * 1e9);
+		}
+		if (Length > 0) {
+			receive(&R, TimeNs, Frame, (size_t) Length);
+		}
+	}
+	summarize(&R, (TimeNs > StartNs) ? (TimeNs - StartNs) * 1e-9 : 0);
+
+	printf("\nFrames:     %llu metrics, %llu malformed\n",
+			(unsigned long long) R.nFrames, (unsigned long long) R.nMalformed);
+	for (i = 0; i < R.nRrus; i++) {
+		RruState *Rru = &R.Rru[i];
+
+		printf("RRU %02x:%02x:%02x:%02x:%02x:%02x: %llu status, %llu "
+				"telemetry, %llu missing reports, %u BF words lost\n",
+				Rru->Mac[0], Rru->Mac[1], Rru->Mac[2], Rru->Mac[3],
+				Rru->Mac[4], Rru->Mac[5], (unsigned long long) Rru->nStatus,
+				(unsigned long long) Rru->nTelemetry,
+				(unsigned long long) Rru->nMissing,
+				Rru->Last.BfWordsLost - Rru->First.BfWordsLost);
+		if (Rru->nMissing || Rru->Last.BfWordsLost != Rru->First.BfWordsLost) {
+			Failed = 1;
+		}
+	}
+
+	if (R.Csv) {
+		fclose(R.Csv);
+	}
+	if (PcapPath) {
+		fclose(Pcap.f);
+	} else {
+		close(Fd);
+	}
+	return (Failed || R.nMalformed) ? 2 : 0;
+}
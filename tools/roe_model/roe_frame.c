@@ -0,0 +1,132 @@
+/*
+ * roe_frame.c
+ *
+ * Ethernet frames of the cpri2ethernet module (see roe_frame.h).
+ */
+
+/***************************** Include Files *********************************/
+
+#include <string.h>
+#include "roe_frame.h"
+
+/*****************************************************************************/
+/*
+ *
+ * Frame header from the MAC address and EtherType registers, as written by
+ * RoE_initCpri2Ethernet(). For MAC ac:87:a3:27:f0:e5, the low register holds
+ * 0x27a387ac (byte 0 in the LSBs).
+ *
+ ******************************************************************************/
+void RoeFrame_headerFromRegs(RoeFrameHeader *Header, uint32_t Mac0,
+		uint32_t Mac1, uint32_t Mac2, uint32_t EtherType) {
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		Header->Src[i] = (uint8_t) (Mac0 >> (8 * i));
+		Header->Dst[i] = (uint8_t) (Mac1 >> (8 * i));
+	}
+	Header->Dst[4] = (uint8_t) Mac2;
+	Header->Dst[5] = (uint8_t) (Mac2 >> 8);
+	Header->Src[4] = (uint8_t) (Mac2 >> 16);
+	Header->Src[5] = (uint8_t) (Mac2 >> 24);
+	Header->EtherType = (uint16_t) EtherType;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Builds a frame (without FCS) carrying nWords payload words, padded to the
+ * smallest Ethernet frame.
+ *
+ * Returns the frame length.
+ *
+ ******************************************************************************/
+size_t RoeFrame_build(uint8_t *Frame, const RoeFrameHeader *Header,
+		const uint32_t *Words, size_t nWords) {
+	size_t i, Length = ROE_FRAME_HEADER + 4 * nWords;
+
+	memcpy(Frame, Header->Dst, 6);
+	memcpy(Frame + 6, Header->Src, 6);
+	Frame[12] = (uint8_t) (Header->EtherType >> 8);
+	Frame[13] = (uint8_t) Header->EtherType;
+
+	for (i = 0; i < nWords; i++) {
+		uint8_t *p = Frame + ROE_FRAME_HEADER + 4 * i;
+
+		p[0] = (uint8_t) (Words[i] >> 24);
+		p[1] = (uint8_t) (Words[i] >> 16);
+		p[2] = (uint8_t) (Words[i] >> 8);
+		p[3] = (uint8_t) Words[i];
+	}
+
+	if (Length < ROE_FRAME_MIN) {
+		memset(Frame + Length, 0, ROE_FRAME_MIN - Length);
+		Length = ROE_FRAME_MIN;
+	}
+	return Length;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Splits a frame (without FCS) into its header and payload. The payload may
+ * include padding.
+ *
+ * Returns 0 on success, -1 if the frame is too short.
+ *
+ ******************************************************************************/
+int RoeFrame_parse(const uint8_t *Frame, size_t Length,
+		RoeFrameHeader *Header, const uint8_t **Payload,
+		size_t *PayloadLength) {
+	if (Length < ROE_FRAME_HEADER) {
+		return -1;
+	}
+	memcpy(Header->Dst, Frame, 6);
+	memcpy(Header->Src, Frame + 6, 6);
+	Header->EtherType = (uint16_t) ((Frame[12] << 8) | Frame[13]);
+	*Payload = Frame + ROE_FRAME_HEADER;
+	*PayloadLength = Length - ROE_FRAME_HEADER;
+	return 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Bytes a frame (without FCS) occupies on the wire.
+ *
+ ******************************************************************************/
+size_t RoeFrame_wireBytes(size_t Length) {
+	return ((Length < ROE_FRAME_MIN) ? ROE_FRAME_MIN : Length)
+			+ ROE_FRAME_WIRE_OVERHEAD;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Header of a capture file (host byte order, nanosecond timestamps).
+ *
+ ******************************************************************************/
+void RoeFrame_writePcapHeader(FILE *f) {
+	uint32_t Header[6] = { ROE_PCAP_MAGIC_NS, 0x00040002, 0, 0, 65535,
+			ROE_PCAP_LINKTYPE_ETHERNET };
+
+	fwrite(Header, sizeof(Header), 1, f);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Appends a frame (without FCS) to a capture file.
+ *
+ ******************************************************************************/
+void RoeFrame_writePcapRecord(FILE *f, uint64_t TimeNs, const uint8_t *Frame,
+		size_t Length) {
+	uint32_t Record[4];
+
+	Record[0] = (uint32_t) (TimeNs / 1000000000);
+	Record[1] = (uint32_t) (TimeNs % 1000000000);
+	Record[2] = (uint32_t) Length;
+	Record[3] = (uint32_t) Length;
+	fwrite(Record, sizeof(Record), 1, f);
+	fwrite(Frame, Length, 1, f);
+}
@@ -0,0 +1,106 @@
+/*
+ * roe_frame.h
+ *
+ * Layout of the Ethernet frames of the cpri2ethernet module, as configured by
+ * the RoE registers, for the host tools.
+ */
+
+#ifndef ROE_FRAME_H_
+#define ROE_FRAME_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * RoE register offsets from the base address (as in radio_over_ethernet.c)
+ */
+#define ROE_REG_RESET			0x000
+#define ROE_REG_ETH_TYPE_CPRI	0x101	/* Demux filter of the CPRI stream */
+#define ROE_REG_ETH_TYPE_2		0x102	/* Demux filter of the status metrics */
+#define ROE_REG_ETH_TYPE_METRICS	0x103	/* Demux filter of the telemetry */
+#define ROE_REG_BFS_PER_PKT		0x403
+#define ROE_REG_MAC_0			0x404	/* Source MAC bytes 3 to 0 */
+#define ROE_REG_MAC_1			0x405	/* Destination MAC bytes 3 to 0 */
+#define ROE_REG_MAC_2			0x406	/* Src and dest MAC bytes 5, 4 */
+#define ROE_REG_INTERVAL_A		0x407
+#define ROE_REG_ETH_TYPE		0x408
+#define ROE_REG_OP_CTRL			0x409
+#define ROE_REG_CPRI_SRC		0x40A
+#define ROE_REG_OCCUPANCY		0x40B
+#define ROE_REG_INTERVAL_B		0x40C
+
+/*
+ * Operation control and CPRI source bits
+ */
+#define ROE_OP_CPRI2ETHERNET	0x00000001
+#define ROE_OP_FLOW_CONTROL		0x00000002
+#define ROE_SRC_EMULATION		0x00000001
+
+/*
+ * Words of a BF, and the word of an AxC container in it
+ */
+#define ROE_BF_WORDS(LineRate)		(4 * (LineRate))
+#define ROE_BF_MAX_AXC(LineRate)	(ROE_BF_WORDS(LineRate) - 1)
+#define ROE_BF_AXC_WORD(LineRate, Axc)	(ROE_BF_WORDS(LineRate) - 1 - (Axc))
+
+/*
+ * Frame layout: MAC header, then the BFs as big-endian 32-bit words.
+ *
+ * A BF holds 4 * LineRate words. Its 16 MSBs (first word) are the control
+ * word (RoE_setCpriControlWord()), and the AxC containers fill it from the
+ * LSBs: AxC 0 is the last word, AxC 1 the one before, and so on, up to
+ * 4 * LineRate - 1 AxCs. Each container holds the I sample in its 16 LSBs
+ * and the Q sample in its 16 MSBs, as the DMA does.
+ */
+#define ROE_FRAME_HEADER		14
+#define ROE_FRAME_MAX_PAYLOAD	1500
+#define ROE_FRAME_MIN			60		/* Without FCS */
+#define ROE_FRAME_WIRE_OVERHEAD	24		/* FCS, preamble, SFD and gap */
+
+/*
+ * Captures: pcap with nanosecond timestamps, Ethernet link type
+ */
+#define ROE_PCAP_MAGIC_US		0xA1B2C3D4
+#define ROE_PCAP_MAGIC_NS		0xA1B23C4D
+#define ROE_PCAP_HEADER			24
+#define ROE_PCAP_RECORD			16
+#define ROE_PCAP_LINKTYPE_ETHERNET	1
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	uint8_t Dst[6];
+	uint8_t Src[6];
+	uint16_t EtherType;
+} RoeFrameHeader;
+
+/************************** Function Prototypes *****************************/
+void RoeFrame_headerFromRegs(RoeFrameHeader *Header, uint32_t Mac0,
+		uint32_t Mac1, uint32_t Mac2, uint32_t EtherType);
+size_t RoeFrame_build(uint8_t *Frame, const RoeFrameHeader *Header,
+		const uint32_t *Words, size_t nWords);
+int RoeFrame_parse(const uint8_t *Frame, size_t Length,
+		RoeFrameHeader *Header, const uint8_t **Payload,
+		size_t *PayloadLength);
+size_t RoeFrame_wireBytes(size_t Length);
+void RoeFrame_writePcapHeader(FILE *f);
+void RoeFrame_writePcapRecord(FILE *f, uint64_t TimeNs, const uint8_t *Frame,
+		size_t Length);
+
+/*****************************************************************************/
+/*
+ *
+ * Payload word at the given index.
+ *
+ ******************************************************************************/
+static inline uint32_t RoeFrame_word(const uint8_t *Payload, size_t Index) {
+	const uint8_t *p = Payload + 4 * Index;
+
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16)
+			| ((uint32_t) p[2] << 8) | p[3];
+}
+
+#endif /* ROE_FRAME_H_ */
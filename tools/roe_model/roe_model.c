@@ -0,0 +1,618 @@
+/*
+ * roe_model.c
+ *
+ * Host model of the RoE datapath, for regression tests of the firmware
+ * configuration off the hardware.
+ *
+ * The model consumes the register writes of the firmware: either a console
+ * log of a build with DEBUG_ROE_REGS (lines "roe_reg <offset> <value>", see
+ * "RoE_writeReg()"), or the sequence of the default firmware (EtherType
+ * filters, control word, "RoE_initCpri2Ethernet()" and the CPRI emulator).
+ * Then it runs:
+ *
+ *  - the packer (cpri2ethernet): BFs of 4 * LineRate words at the chip rate,
+ *    packed by BFs-per-packet (0x403) into frames with the MAC addresses and
+ *    EtherType of 0x404 to 0x408 ("roe_frame.c"). With flow control (0x409),
+ *    packets leave alternately after the intervals of 0x407 and 0x40C,
+ *    dithered as "RoE_ditherFlowControl()" does. The emulator data is a
+ *    pseudo-random function of the BF and word index, and the first word of
+ *    each BF carries the control word of 0x40A in its 16 MSBs;
+ *  - the 1000BASE-T link: serialization with the framing overhead, a fixed
+ *    latency and random frame losses;
+ *  - the receive path: EtherType demux (0x101 to 0x103), then the
+ *    depacketizer, which checks every payload bit against the emulator data
+ *    and writes the words into the receive buffer. The buffer is read at the
+ *    CPRI word rate of the RRU clock (with a ppm offset), from the moment it
+ *    reaches the start level.
+ *
+ * It reports the frames, the throughput, the largest transmit backlog, the
+ * occupancy range, underflows, overflows and payload errors. The received
+ * frames can be saved to a pcap file, with their arrival times. The exit
+ * status is 2 if any frame was not demultiplexed to the CPRI stream, or on
+ * payload errors, underflows or overflows.
+ *
+ * Runs are per packet, so the simulated traffic goes at several Gbps.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -Wall -Idrivers/sdr_testbed -Itools/roe_model -o roe_model \
+ *       tools/roe_model/roe_model.c tools/roe_model/roe_frame.c \
+ *       drivers/sdr_testbed/flow_ctrl.c
+ *
+ * Examples:
+ *
+ *   ./roe_model -t 10
+ *   ./roe_model -F -b 64 -p 20 -o roe.pcap
+ *   ./roe_model -f console.log -l 2 -L 1e-4
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "flow_ctrl.h"
+#include "roe_frame.h"
+#include "roe_metrics.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Firmware settings (mirrors of radio_over_ethernet.c and main.c)
+ */
+#define CPRI_CHIP_RATE			3840000
+#define ROE_AXI_CLK_HZ			100000000
+#define FLOW_CTRL_DITHER_PAIRS	256
+#define BFs_PER_PKT				16
+#define BUFFER_DEPTH			8192
+#define CONTROL_WORD			0x00DE
+
+#define N_REGS					0x410
+#define PS_PER_S				1000000000000ULL
+#define LINK_PS_PER_BYTE		8000	/* 1000BASE-T */
+#define MAX_WORDS_PER_PKT		(ROE_FRAME_MAX_PAYLOAD / 4)
+
+#define DEFAULT_SECONDS			1.0
+#define DEFAULT_LATENCY_NS		5000
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	uint32_t LineRate;
+	double Seconds;
+	double Ppm;				/* RRU clock offset */
+	double LossRate;
+	uint64_t LatencyPs;		/* Link latency, after serialization */
+	uint32_t Depth;			/* Receive buffer, in words */
+	uint32_t StartLevel;	/* Occupancy at which reading starts */
+	int Dither;
+	FILE *Pcap;
+} ModelConfig;
+
+typedef struct {
+	/* Registers */
+	uint32_t Reg[N_REGS];
+	uint32_t nWrites;
+	uint32_t nResets;
+
+	/* Packer and link */
+	uint64_t nPkts;
+	uint64_t nBytes;
+	uint64_t LinkFree;
+	uint64_t LastDeparture;
+	uint64_t SlotEnd;
+	uint64_t LastWrite;
+	uint32_t RegB;
+	int Second;
+	uint64_t MaxBacklogBfs;
+	FlowCtrlDither Dither;
+	int Dithering;
+
+	/* Receive path */
+	uint64_t nLost;
+	uint64_t nCpri;
+	uint64_t nStream2;
+	uint64_t nMetrics;
+	uint64_t nOther;
+	uint64_t nPayloadErrors;
+	uint64_t nShort;
+	int Reading;
+	uint64_t ReadStart;
+	uint64_t ReadsIssued;
+	uint32_t Occupancy;
+	uint32_t MinOccupancy;
+	uint32_t MaxOccupancy;
+	uint64_t Underflows;
+	uint64_t Overflows;
+} RoeModel;
+
+/************************** Variable Definitions *****************************/
+
+/*
+ * Local and destination MAC addresses of the BBU (main.c)
+ */
+static const uint8_t AxiEthernetMAC[6] = {
+		0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5 };
+static const uint8_t destMAC[6] = { 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5 };
+
+static uint64_t RngState = 0x853C49E6748FEA9BULL;
+
+/*****************************************************************************/
+
+static double uniform(void) {
+	RngState ^= RngState >> 12;
+	RngState ^= RngState << 25;
+	RngState ^= RngState >> 27;
+	return ((RngState * 0x2545F4914F6CDD1DULL) >> 11) * 0x1.0p-53;
+}
+
+/*
+ * Emulator data of word w of BF k (a hash, so that the checker can compute
+ * it for any BF, regardless of losses)
+ */
+static uint32_t emulatorWord(const RoeModel *M, uint64_t Bf, uint32_t Word,
+		uint32_t WordsPerBf) {
+	uint64_t x = Bf * WordsPerBf + Word + 0x9E3779B97F4A7C15ULL;
+
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	x ^= x >> 31;
+	if (Word == 0) {
+		return (M->Reg[ROE_REG_CPRI_SRC] & 0xFFFF0000)
+				| (uint32_t) (x & 0xFFFF);
+	}
+	return (uint32_t) x;
+}
+
+/*
+ * End of BF k, and BFs generated by time t (in ps, without overflow)
+ */
+static uint64_t bfTime(uint64_t Bf) {
+	return Bf / CPRI_CHIP_RATE * PS_PER_S
+			+ Bf % CPRI_CHIP_RATE * PS_PER_S / CPRI_CHIP_RATE;
+}
+
+static uint64_t bfsAt(uint64_t t) {
+	return t / PS_PER_S * CPRI_CHIP_RATE
+			+ t % PS_PER_S * CPRI_CHIP_RATE / PS_PER_S;
+}
+
+static void writeReg(RoeModel *M, uint32_t Offset, uint32_t Value) {
+	if (Offset >= N_REGS) {
+		fprintf(stderr, "Warning: write to unknown register 0x%X\n", Offset);
+		return;
+	}
+	if (Offset == ROE_REG_RESET) {
+		M->nResets++;
+	}
+	M->Reg[Offset] = Value;
+	M->nWrites++;
+}
+
+static uint32_t macReg(const uint8_t *Mac, int First) {
+	return ((uint32_t) Mac[First + 3] << 24)
+			| ((uint32_t) Mac[First + 2] << 16)
+			| ((uint32_t) Mac[First + 1] << 8) | Mac[First];
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Register writes of the default firmware: RoE_setEthTypeFilters(),
+ * RoE_setCpriControlWord(), RoE_initCpri2Ethernet() and
+ * RoE_initCpriEmulator().
+ *
+ ******************************************************************************/
+static void defaultWrites(RoeModel *M, uint32_t LineRate, uint32_t BfsPerPkt,
+		int FlowControl) {
+	uint32_t OpCtrl = ROE_OP_CPRI2ETHERNET;
+
+	writeReg(M, ROE_REG_RESET, 0);
+
+	writeReg(M, ROE_REG_ETH_TYPE_CPRI, 0xCD);
+	writeReg(M, ROE_REG_ETH_TYPE_2, ROE_METRICS_ETHER_TYPE_STATUS);
+	writeReg(M, ROE_REG_ETH_TYPE_METRICS, ROE_METRICS_ETHER_TYPE_TELEMETRY);
+
+	writeReg(M, ROE_REG_CPRI_SRC, CONTROL_WORD << 16);
+
+	writeReg(M, ROE_REG_BFS_PER_PKT, BfsPerPkt);
+	writeReg(M, ROE_REG_MAC_0, macReg(AxiEthernetMAC, 0));
+	writeReg(M, ROE_REG_MAC_1, macReg(destMAC, 0));
+	writeReg(M, ROE_REG_MAC_2, ((uint32_t) AxiEthernetMAC[5] << 24)
+			| ((uint32_t) AxiEthernetMAC[4] << 16)
+			| ((uint32_t) destMAC[5] << 8) | destMAC[4]);
+	writeReg(M, ROE_REG_ETH_TYPE, 0xCD);
+
+	if (FlowControl) {
+		FlowCtrlPlan Plan;
+
+		if (BfsPerPkt <= FlowCtrl_maxBfsPerPkt(LineRate)
+				&& FlowCtrl_plan(&Plan, BfsPerPkt, CPRI_CHIP_RATE,
+						ROE_AXI_CLK_HZ) == 0) {
+			writeReg(M, ROE_REG_INTERVAL_A, Plan.IntervalA);
+			writeReg(M, ROE_REG_INTERVAL_B, Plan.IntervalB);
+		}
+		OpCtrl |= ROE_OP_FLOW_CONTROL;
+	}
+	writeReg(M, ROE_REG_OP_CTRL, OpCtrl);
+
+	writeReg(M, ROE_REG_CPRI_SRC, M->Reg[ROE_REG_CPRI_SRC] | ROE_SRC_EMULATION);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Register writes from a console log ("roe_reg <offset> <value>" lines, in
+ * hex, anywhere in the line).
+ *
+ * Returns the number of writes, or -1 if the log cannot be read.
+ *
+ ******************************************************************************/
+static int logWrites(RoeModel *M, const char *Path) {
+	FILE *f = strcmp(Path, "-") ? fopen(Path, "r") : stdin;
+	char Line[256];
+	int n = 0;
+
+	if (f == NULL) {
+		perror(Path);
+		return -1;
+	}
+	while (fgets(Line, sizeof(Line), f) != NULL) {
+		const char *p = strstr(Line, "roe_reg ");
+		unsigned int Offset, Value;
+
+		if (p != NULL && sscanf(p + 8, "%x %x", &Offset, &Value) == 2) {
+			writeReg(M, Offset, Value);
+			n++;
+		}
+	}
+	if (f != stdin) {
+		fclose(f);
+	}
+	return n;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Receive path: demux, depacketizer and receive buffer, for a frame fully
+ * received at time t.
+ *
+ ******************************************************************************/
+static void receive(RoeModel *M, const ModelConfig *Config, uint64_t t,
+		const uint8_t *Frame, size_t Length, uint64_t FirstBf,
+		uint32_t BfsPerPkt, uint32_t WordsPerBf) {
+	RoeFrameHeader Header;
+	const uint8_t *Payload;
+	size_t PayloadLength;
+	uint32_t nWords = BfsPerPkt * WordsPerBf, i, Space;
+
+	if (RoeFrame_parse(Frame, Length, &Header, &Payload, &PayloadLength)) {
+		M->nShort++;
+		return;
+	}
+
+	/* Demux */
+	if (M->Reg[ROE_REG_ETH_TYPE_CPRI] != Header.EtherType) {
+		if (M->Reg[ROE_REG_ETH_TYPE_2] == Header.EtherType) {
+			M->nStream2++;
+		} else if (M->Reg[ROE_REG_ETH_TYPE_METRICS] == Header.EtherType) {
+			M->nMetrics++;
+		} else {
+			M->nOther++;
+		}
+		return;
+	}
+	M->nCpri++;
+	if (PayloadLength < 4 * nWords) {
+		M->nShort++;
+		return;
+	}
+
+	/* Depacketizer */
+	for (i = 0; i < nWords; i++) {
+		uint32_t Expected = emulatorWord(M, FirstBf + i / WordsPerBf,
+				i % WordsPerBf, WordsPerBf);
+
+		if (RoeFrame_word(Payload, i) != Expected) {
+			M->nPayloadErrors++;
+		}
+	}
+
+	/* Read side, up to now */
+	if (M->Reading) {
+		double WordRate = (double) CPRI_CHIP_RATE * WordsPerBf
+				* (1.0 + Config->Ppm * 1e-6);
+		uint64_t Due = (uint64_t) ((double) (t - M->ReadStart) * 1e-12
+				* WordRate) - M->ReadsIssued;
+
+		M->ReadsIssued += Due;
+		if (Due > M->Occupancy) {
+			M->Underflows += Due - M->Occupancy;
+			M->Occupancy = 0;
+		} else {
+			M->Occupancy -= (uint32_t) Due;
+		}
+		if (M->Occupancy < M->MinOccupancy) {
+			M->MinOccupancy = M->Occupancy;
+		}
+	}
+
+	/* Write side */
+	Space = Config->Depth - M->Occupancy;
+	if (nWords > Space) {
+		M->Overflows += nWords - Space;
+		M->Occupancy = Config->Depth;
+	} else {
+		M->Occupancy += nWords;
+	}
+	if (M->Occupancy > M->MaxOccupancy) {
+		M->MaxOccupancy = M->Occupancy;
+	}
+
+	if (!M->Reading && M->Occupancy >= Config->StartLevel) {
+		M->Reading = 1;
+		M->ReadStart = t;
+		M->MinOccupancy = M->Occupancy;
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Runs the datapath for the configured time.
+ *
+ * Returns 0 on success, -1 if the registers do not enable a valid stream.
+ *
+ ******************************************************************************/
+static int run(RoeModel *M, const ModelConfig *Config) {
+	uint32_t BfsPerPkt = M->Reg[ROE_REG_BFS_PER_PKT];
+	uint32_t WordsPerBf = 4 * Config->LineRate;
+	uint32_t OpCtrl = M->Reg[ROE_REG_OP_CTRL];
+	uint64_t End = (uint64_t) (Config->Seconds * PS_PER_S);
+	uint64_t CyclePs = PS_PER_S / ROE_AXI_CLK_HZ;
+	RoeFrameHeader Header;
+	uint32_t Words[MAX_WORDS_PER_PKT];
+	uint8_t Frame[ROE_FRAME_HEADER + ROE_FRAME_MAX_PAYLOAD];
+
+	if (!(OpCtrl & ROE_OP_CPRI2ETHERNET)) {
+		fprintf(stderr, "cpri2ethernet is not enabled (opCtrl 0x%X)\n", OpCtrl);
+		return -1;
+	}
+	if (!(M->Reg[ROE_REG_CPRI_SRC] & ROE_SRC_EMULATION)) {
+		fprintf(stderr, "The CPRI emulator is not enabled\n");
+		return -1;
+	}
+	if (BfsPerPkt == 0 || BfsPerPkt * WordsPerBf > MAX_WORDS_PER_PKT) {
+		fprintf(stderr, "%u BFs per packet do not fit a frame\n", BfsPerPkt);
+		return -1;
+	}
+
+	RoeFrame_headerFromRegs(&Header, M->Reg[ROE_REG_MAC_0],
+			M->Reg[ROE_REG_MAC_1], M->Reg[ROE_REG_MAC_2],
+			M->Reg[ROE_REG_ETH_TYPE]);
+
+	/* Firmware dithering of the second interval, for the planned intervals */
+	M->RegB = M->Reg[ROE_REG_INTERVAL_B];
+	if ((OpCtrl & ROE_OP_FLOW_CONTROL) && Config->Dither) {
+		FlowCtrlPlan Plan;
+
+		if (FlowCtrl_plan(&Plan, BfsPerPkt, CPRI_CHIP_RATE,
+				ROE_AXI_CLK_HZ) == 0 && Plan.DitherNum
+				&& Plan.IntervalA == M->Reg[ROE_REG_INTERVAL_A]
+				&& Plan.IntervalB == M->Reg[ROE_REG_INTERVAL_B]) {
+			FlowCtrl_initDither(&M->Dither, &Plan);
+			M->Dithering = 1;
+		}
+	}
+
+	if (Config->Pcap) {
+		RoeFrame_writePcapHeader(Config->Pcap);
+	}
+
+	while (1) {
+		uint64_t FirstBf = M->nPkts * BfsPerPkt;
+		uint64_t Ready = bfTime(FirstBf + BfsPerPkt);
+		uint64_t Departure = Ready, Backlog;
+		uint32_t i, nWords = BfsPerPkt * WordsPerBf;
+		size_t Length;
+
+		if (Departure < M->LinkFree) {
+			Departure = M->LinkFree;
+		}
+		if ((OpCtrl & ROE_OP_FLOW_CONTROL) && M->nPkts > 0) {
+			uint64_t Interval = M->Second ? M->RegB
+					: M->Reg[ROE_REG_INTERVAL_A];
+
+			if (Departure < M->LastDeparture + Interval * CyclePs) {
+				Departure = M->LastDeparture + Interval * CyclePs;
+			}
+			M->Second = !M->Second;
+		}
+		if (Departure >= End) {
+			break;
+		}
+
+		if (M->Dithering && Departure >= M->SlotEnd) {
+			M->RegB = FlowCtrl_nextIntervalB(&M->Dither,
+					(uint32_t) ((Departure - M->LastWrite) / CyclePs));
+			M->LastWrite = Departure;
+			M->SlotEnd = Departure + (uint64_t) FLOW_CTRL_DITHER_PAIRS
+					* (M->Dither.Plan.IntervalA + M->RegB) * CyclePs;
+		}
+
+		/* BFs generated, but not sent yet */
+		Backlog = bfsAt(Departure) - FirstBf;
+		if (Backlog > M->MaxBacklogBfs) {
+			M->MaxBacklogBfs = Backlog;
+		}
+
+		for (i = 0; i < nWords; i++) {
+			Words[i] = emulatorWord(M, FirstBf + i / WordsPerBf,
+					i % WordsPerBf, WordsPerBf);
+		}
+		Length = RoeFrame_build(Frame, &Header, Words, nWords);
+
+		M->LastDeparture = Departure;
+		M->LinkFree = Departure + RoeFrame_wireBytes(Length) * LINK_PS_PER_BYTE;
+		M->nBytes += Length;
+		M->nPkts++;
+
+		if (Config->LossRate > 0 && uniform() < Config->LossRate) {
+			M->nLost++;
+			continue;
+		}
+		if (Config->Pcap) {
+			RoeFrame_writePcapRecord(Config->Pcap,
+					(M->LinkFree + Config->LatencyPs) / 1000, Frame, Length);
+		}
+		receive(M, Config, M->LinkFree + Config->LatencyPs, Frame, Length,
+				FirstBf, BfsPerPkt, WordsPerBf);
+	}
+
+	return 0;
+}
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"Usage: %s [options]\n"
+			"  -f <log>    replay the register writes of a console log "
+			"(\"-\" for stdin)\n"
+			"  -b <n>      BFs per packet of the default writes (default %d)\n"
+			"  -F          flow control in the default writes\n"
+			"  -l <n>      CPRI line rate option (default 1)\n"
+			"  -t <s>      simulated time (default %.0f)\n"
+			"  -p <ppm>    RRU clock offset (default 0)\n"
+			"  -d <ns>     link latency (default %d)\n"
+			"  -L <rate>   frame loss rate (default 0)\n"
+			"  -D <words>  receive buffer depth (default %d)\n"
+			"  -n          no firmware dithering of the flow control\n"
+			"  -o <pcap>   save the frames\n", Prog, BFs_PER_PKT,
+			DEFAULT_SECONDS, DEFAULT_LATENCY_NS, BUFFER_DEPTH);
+}
+
+int main(int argc, char **argv) {
+	static RoeModel M;
+	ModelConfig Config;
+	const char *LogPath = NULL, *PcapPath = NULL;
+	uint32_t BfsPerPkt = BFs_PER_PKT;
+	int Opt, FlowControl = 0, Failed;
+	double Wall, SimBits;
+	clock_t Start;
+
+	memset(&Config, 0, sizeof(Config));
+	Config.LineRate = 1;
+	Config.Seconds = DEFAULT_SECONDS;
+	Config.LatencyPs = DEFAULT_LATENCY_NS * 1000ULL;
+	Config.Depth = BUFFER_DEPTH;
+	Config.Dither = 1;
+
+	while ((Opt = getopt(argc, argv, "f:b:Fl:t:p:d:L:D:no:h")) != -1) {
+		switch (Opt) {
+		case 'f':
+			LogPath = optarg;
+			break;
+		case 'b':
+			BfsPerPkt = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'F':
+			FlowControl = 1;
+			break;
+		case 'l':
+			Config.LineRate = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			Config.Seconds = atof(optarg);
+			break;
+		case 'p':
+			Config.Ppm = atof(optarg);
+			break;
+		case 'd':
+			Config.LatencyPs = (uint64_t) (atof(optarg) * 1000);
+			break;
+		case 'L':
+			Config.LossRate = atof(optarg);
+			break;
+		case 'D':
+			Config.Depth = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			Config.Dither = 0;
+			break;
+		case 'o':
+			PcapPath = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (Config.LineRate < 1 || Config.LineRate > 2 || Config.Seconds <= 0
+			|| Config.Seconds > 3600 || Config.Depth == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+	Config.StartLevel = Config.Depth / 2;
+
+	if (LogPath) {
+		int n = logWrites(&M, LogPath);
+
+		if (n < 0) {
+			return 1;
+		}
+		printf("%d register writes replayed from %s\n", n, LogPath);
+	} else {
+		defaultWrites(&M, Config.LineRate, BfsPerPkt, FlowControl);
+	}
+
+	if (PcapPath) {
+		Config.Pcap = fopen(PcapPath, "wb");
+		if (Config.Pcap == NULL) {
+			perror(PcapPath);
+			return 1;
+		}
+	}
+
+	Start = clock();
+	if (run(&M, &Config) != 0) {
+		return 1;
+	}
+	Wall = (double) (clock() - Start) / CLOCKS_PER_SEC;
+	if (Config.Pcap) {
+		fclose(Config.Pcap);
+	}
+
+	SimBits = (M.nBytes + M.nPkts * ROE_FRAME_WIRE_OVERHEAD) * 8.0;
+	printf("Registers:  %u writes, %u resets\n", M.nWrites, M.nResets);
+	printf("BFs per packet %u, EtherType 0x%04X, opCtrl 0x%X, intervals "
+			"%u / %u\n", M.Reg[ROE_REG_BFS_PER_PKT], M.Reg[ROE_REG_ETH_TYPE],
+			M.Reg[ROE_REG_OP_CTRL], M.Reg[ROE_REG_INTERVAL_A],
+			M.Reg[ROE_REG_INTERVAL_B]);
+	printf("Frames:     %llu sent, %llu lost, %llu CPRI, %llu stream 02, "
+			"%llu metrics, %llu dropped, %llu short\n",
+			(unsigned long long) M.nPkts, (unsigned long long) M.nLost,
+			(unsigned long long) M.nCpri, (unsigned long long) M.nStream2,
+			(unsigned long long) M.nMetrics, (unsigned long long) M.nOther,
+			(unsigned long long) M.nShort);
+	printf("Throughput: %.3f Mbps on the wire, largest backlog %llu BFs\n",
+			SimBits / Config.Seconds / 1e6,
+			(unsigned long long) M.MaxBacklogBfs);
+	printf("Occupancy:  %u to %u words (%s), %llu underflows, "
+			"%llu overflows\n", M.MinOccupancy, M.MaxOccupancy,
+			M.Reading ? "reading" : "not reading",
+			(unsigned long long) M.Underflows,
+			(unsigned long long) M.Overflows);
+	printf("Payload:    %llu word errors\n",
+			(unsigned long long) M.nPayloadErrors);
+	if (Wall > 0) {
+		printf("Simulated %.2f Gbps (%.0f times real time)\n",
+				SimBits / Wall / 1e9, Config.Seconds / Wall);
+	}
+
+	Failed = (M.nStream2 || M.nMetrics || M.nOther || M.nShort
+			|| M.nPayloadErrors || M.Underflows || M.Overflows);
+	return Failed ? 2 : 0;
+}
@@ -0,0 +1,458 @@
+/*
+ * roe_pcap.c
+ *
+ * Decoder of RoE fronthaul captures: extracts the IQ samples of each AxC
+ * from the cpri2ethernet frames of a pcap file, and reports statistics of
+ * the stream.
+ *
+ * The capture is mapped in memory and decoded in one pass. Frames of the
+ * RoE EtherType (0xCD by default, with or without a VLAN tag) are split into
+ * BFs, laid out as described in "tools/roe_model/roe_frame.h": control word
+ * in the 16 MSBs, AxC 0 in the 32 LSBs. The frames carry no sequence number,
+ * so gaps are detected from the capture timestamps: a frame arriving more
+ * than 1.5 packet periods after the previous one counts the missing frames
+ * (rounded number of periods in between). With -z, the IQ files are padded
+ * with zeros in their place, so that they stay aligned in time.
+ *
+ * It reports the frames, BFs, gaps, control words that differ from the
+ * expected one, the BF rate error to the chip rate (ppm, from the
+ * timestamps), the inter-arrival range, the power of each AxC and the decode
+ * throughput. The IQ files ("<prefix>_axc<k>.sc16") hold 16-bit I then Q
+ * samples, as read by "tools/iq_analyze". The exit status is 2 if there are
+ * gaps, malformed frames or control word errors.
+ *
+ * The number of BFs per packet is taken from the first RoE frame, unless it
+ * is padded (small packets), in which case it must be given (-b).
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -Wall -Itools/roe_model -o roe_pcap tools/roe_pcap/roe_pcap.c \
+ *       tools/roe_model/roe_frame.c -lm
+ *
+ * Examples:
+ *
+ *   ./roe_pcap -i roe.pcap
+ *   ./roe_pcap -i roe.pcap -o capture -z
+ *   ./roe_pcap -i roe.pcap -l 2 -a 2 -c 0xDE -o capture
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "roe_frame.h"
+
+/************************** Constant Definitions *****************************/
+
+#define CPRI_CHIP_RATE			3840000
+#define ROE_ETHER_TYPE			0xCD
+
+#define ETHER_TYPE_VLAN			0x8100
+#define VLAN_TAG				4
+
+#define OUT_BUFFER_SAMPLES		(1 << 16)
+#define MAX_AXC					ROE_BF_MAX_AXC(2)
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * IQ output of one AxC, buffered
+ */
+typedef struct {
+	FILE *f;
+	int16_t *Buf;
+	uint32_t n;
+	uint64_t Power;			/* Sum of I^2 + Q^2 */
+} AxcOutput;
+
+typedef struct {
+	const uint8_t *Data;
+	size_t Size;
+	int Swapped;
+	uint32_t TsScale;		/* ns per timestamp fraction unit */
+	uint32_t LinkType;
+} PcapFile;
+
+typedef struct {
+	uint64_t nRecords;
+	uint64_t nRoe;
+	uint64_t nOther;
+	uint64_t nMalformed;
+	uint64_t nTruncated;
+	uint64_t nBfs;
+	uint64_t nGaps;
+	uint64_t nMissing;
+	uint64_t nCtrlErrors;
+	uint64_t FirstNs;
+	uint64_t LastNs;
+	uint64_t MinGapNs;
+	uint64_t MaxGapNs;
+} DecodeStats;
+
+/*****************************************************************************/
+
+static uint32_t rd32(const PcapFile *Pcap, const uint8_t *p) {
+	uint32_t x;
+
+	memcpy(&x, p, 4);
+	return Pcap->Swapped ? __builtin_bswap32(x) : x;
+}
+
+static int openPcap(PcapFile *Pcap, const char *Path) {
+	struct stat St;
+	uint32_t Magic;
+	void *Map;
+	int Fd = open(Path, O_RDONLY);
+
+	if (Fd < 0 || fstat(Fd, &St) != 0) {
+		perror(Path);
+		return -1;
+	}
+	if (St.st_size < ROE_PCAP_HEADER) {
+		fprintf(stderr, "%s: not a pcap file\n", Path);
+		close(Fd);
+		return -1;
+	}
+	Map = mmap(NULL, (size_t) St.st_size, PROT_READ, MAP_PRIVATE, Fd, 0);
+	close(Fd);
+	if (Map == MAP_FAILED) {
+		perror(Path);
+		return -1;
+	}
+	madvise(Map, (size_t) St.st_size, MADV_SEQUENTIAL);
+
+	Pcap->Data = Map;
+	Pcap->Size = (size_t) St.st_size;
+	memcpy(&Magic, Pcap->Data, 4);
+	Pcap->Swapped = (Magic == __builtin_bswap32(ROE_PCAP_MAGIC_US)
+			|| Magic == __builtin_bswap32(ROE_PCAP_MAGIC_NS));
+	Magic = rd32(Pcap, Pcap->Data);
+	if (Magic != ROE_PCAP_MAGIC_US && Magic != ROE_PCAP_MAGIC_NS) {
+		fprintf(stderr, "%s: not a pcap file\n", Path);
+		munmap(Map, Pcap->Size);
+		return -1;
+	}
+	Pcap->TsScale = (Magic == ROE_PCAP_MAGIC_NS) ? 1 : 1000;
+	Pcap->LinkType = rd32(Pcap, Pcap->Data + 20) & 0x0FFFFFFF;
+	if (Pcap->LinkType != ROE_PCAP_LINKTYPE_ETHERNET) {
+		fprintf(stderr, "%s: link type %u is not Ethernet\n", Path,
+				Pcap->LinkType);
+		munmap(Map, Pcap->Size);
+		return -1;
+	}
+	return 0;
+}
+
+static void flushAxc(AxcOutput *Out) {
+	uint32_t i;
+
+	/* Power, here rather than per BF, where it would not vectorize */
+	for (i = 0; i < 2 * Out->n; i++) {
+		Out->Power += (uint32_t) (Out->Buf[i] * Out->Buf[i]);
+	}
+	if (Out->f && Out->n) {
+		fwrite(Out->Buf, sizeof(int16_t), 2 * Out->n, Out->f);
+	}
+	Out->n = 0;
+}
+
+/*
+ * Makes room for n samples (at most OUT_BUFFER_SAMPLES)
+ */
+static inline void reserveAxc(AxcOutput *Out, uint32_t n) {
+	if (Out->n + n > OUT_BUFFER_SAMPLES) {
+		flushAxc(Out);
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Decodes the BFs of one RoE frame payload. Inlined with constant line rate
+ * and AxC count for the usual cases, so that the AxC loop unrolls.
+ *
+ ******************************************************************************/
+static inline __attribute__((always_inline)) void decodeBfsInline(
+		const uint8_t *Payload, uint32_t BfsPerPkt,
+		uint32_t LineRate, uint32_t nAxc, int32_t ControlWord,
+		AxcOutput *Out, DecodeStats *Stats) {
+	uint32_t WordsPerBf = ROE_BF_WORDS(LineRate), Bf, k;
+	uint64_t nCtrlErrors = 0;
+	int16_t *Buf[MAX_AXC];
+
+	for (k = 0; k < nAxc; k++) {
+		reserveAxc(&Out[k], BfsPerPkt);
+		Buf[k] = Out[k].Buf + 2 * Out[k].n;
+	}
+
+	for (Bf = 0; Bf < BfsPerPkt; Bf++) {
+		const uint8_t *p = Payload + 4 * WordsPerBf * Bf;
+
+		nCtrlErrors += (RoeFrame_word(p, 0) >> 16) != (uint32_t) ControlWord;
+		for (k = 0; k < nAxc; k++) {
+			uint32_t Word = RoeFrame_word(p, ROE_BF_AXC_WORD(LineRate, k));
+
+			Buf[k][2 * Bf] = (int16_t) Word;
+			Buf[k][2 * Bf + 1] = (int16_t) (Word >> 16);
+		}
+	}
+
+	for (k = 0; k < nAxc; k++) {
+		Out[k].n += BfsPerPkt;
+	}
+	Stats->nCtrlErrors += nCtrlErrors;
+	Stats->nBfs += BfsPerPkt;
+}
+
+static void decodeBfs(const uint8_t *Payload, uint32_t BfsPerPkt,
+		uint32_t LineRate, uint32_t nAxc, int32_t ControlWord,
+		AxcOutput *Out, DecodeStats *Stats) {
+	if (LineRate == 1 && nAxc == ROE_BF_MAX_AXC(1)) {
+		decodeBfsInline(Payload, BfsPerPkt, 1, ROE_BF_MAX_AXC(1), ControlWord,
+				Out, Stats);
+	} else if (LineRate == 2 && nAxc == ROE_BF_MAX_AXC(2)) {
+		decodeBfsInline(Payload, BfsPerPkt, 2, ROE_BF_MAX_AXC(2), ControlWord,
+				Out, Stats);
+	} else {
+		decodeBfsInline(Payload, BfsPerPkt, LineRate, nAxc, ControlWord, Out,
+				Stats);
+	}
+}
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"Usage: %s -i <pcap> [options]\n"
+			"  -i <pcap>   capture (pcap, microsecond or nanosecond)\n"
+			"  -l <n>      CPRI line rate option (default 1)\n"
+			"  -b <n>      BFs per packet (default from the first frame)\n"
+			"  -a <n>      AxCs to extract (default all)\n"
+			"  -e <type>   RoE EtherType (default 0x%X)\n"
+			"  -c <word>   expected control word (default from the first BF)\n"
+			"  -o <prefix> write <prefix>_axc<k>.sc16 IQ files\n"
+			"  -z          pad the IQ files with zeros over gaps\n", Prog,
+			ROE_ETHER_TYPE);
+}
+
+int main(int argc, char **argv) {
+	static AxcOutput Out[MAX_AXC];
+	PcapFile Pcap;
+	DecodeStats Stats;
+	const char *InPath = NULL, *Prefix = NULL;
+	uint32_t LineRate = 1, BfsPerPkt = 0, nAxc = 0, EtherType = ROE_ETHER_TYPE;
+	int32_t ControlWord = -1;
+	int Opt, ZeroFill = 0;
+	uint64_t PeriodNs = 0, PrevNs = 0;
+	size_t Pos;
+	uint32_t k;
+	clock_t Start;
+	double Wall;
+
+	while ((Opt = getopt(argc, argv, "i:l:b:a:e:c:o:zh")) != -1) {
+		switch (Opt) {
+		case 'i':
+			InPath = optarg;
+			break;
+		case 'l':
+			LineRate = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			BfsPerPkt = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			nAxc = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'e':
+			EtherType = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			ControlWord = (int32_t) (strtoul(optarg, NULL, 0) & 0xFFFF);
+			break;
+		case 'o':
+			Prefix = optarg;
+			break;
+		case 'z':
+			ZeroFill = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (nAxc == 0) {
+		nAxc = ROE_BF_MAX_AXC(LineRate);
+	}
+	if (InPath == NULL || LineRate < 1 || LineRate > 2
+			|| nAxc > ROE_BF_MAX_AXC(LineRate)) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (openPcap(&Pcap, InPath) != 0) {
+		return 1;
+	}
+
+	for (k = 0; k < nAxc; k++) {
+		Out[k].Buf = malloc(OUT_BUFFER_SAMPLES * 2 * sizeof(int16_t));
+		if (Out[k].Buf == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+		if (Prefix) {
+			char Path[512];
+
+			snprintf(Path, sizeof(Path), "%s_axc%u.sc16", Prefix, k);
+			Out[k].f = fopen(Path, "wb");
+			if (Out[k].f == NULL) {
+				perror(Path);
+				return 1;
+			}
+		}
+	}
+
+	memset(&Stats, 0, sizeof(Stats));
+	Stats.MinGapNs = UINT64_MAX;
+	Start = clock();
+
+	for (Pos = ROE_PCAP_HEADER; Pos + ROE_PCAP_RECORD <= Pcap.Size;) {
+		const uint8_t *Rec = Pcap.Data + Pos;
+		uint32_t CapLen = rd32(&Pcap, Rec + 8), Len = rd32(&Pcap, Rec + 12);
+		uint64_t Ns = rd32(&Pcap, Rec) * 1000000000ULL
+				+ (uint64_t) rd32(&Pcap, Rec + 4) * Pcap.TsScale;
+		const uint8_t *Frame = Rec + ROE_PCAP_RECORD, *Payload;
+		size_t PayloadLength;
+		RoeFrameHeader Header;
+
+		if (Pos + ROE_PCAP_RECORD + CapLen > Pcap.Size) {
+			Stats.nTruncated++;
+			break;
+		}
+		Pos += ROE_PCAP_RECORD + CapLen;
+		Stats.nRecords++;
+
+		if (CapLen < Len
+				|| RoeFrame_parse(Frame, CapLen, &Header, &Payload,
+						&PayloadLength) != 0) {
+			Stats.nMalformed++;
+			continue;
+		}
+		if (Header.EtherType == ETHER_TYPE_VLAN && PayloadLength >= VLAN_TAG) {
+			Header.EtherType = (uint16_t) ((Payload[2] << 8) | Payload[3]);
+			Payload += VLAN_TAG;
+			PayloadLength -= VLAN_TAG;
+		}
+		if (Header.EtherType != EtherType) {
+			Stats.nOther++;
+			continue;
+		}
+
+		/* First RoE frame: packet size, period and control word */
+		if (Stats.nRoe == 0) {
+			if (BfsPerPkt == 0) {
+				if (PayloadLength <= ROE_FRAME_MIN - ROE_FRAME_HEADER) {
+					fprintf(stderr, "Padded frames, give the BFs per "
+							"packet (-b)\n");
+					return 1;
+				}
+				BfsPerPkt = (uint32_t) (PayloadLength
+						/ (4 * ROE_BF_WORDS(LineRate)));
+			}
+			if (BfsPerPkt == 0) {
+				fprintf(stderr, "Frames shorter than one BF\n");
+				return 1;
+			}
+			PeriodNs = (uint64_t) BfsPerPkt * 1000000000ULL / CPRI_CHIP_RATE;
+			if (ControlWord < 0 && PayloadLength >= 4) {
+				ControlWord = (int32_t) (RoeFrame_word(Payload, 0) >> 16);
+			}
+			Stats.FirstNs = Ns;
+		} else {
+			uint64_t Gap = (Ns > PrevNs) ? Ns - PrevNs : 0;
+
+			Stats.MinGapNs = (Gap < Stats.MinGapNs) ? Gap : Stats.MinGapNs;
+			Stats.MaxGapNs = (Gap > Stats.MaxGapNs) ? Gap : Stats.MaxGapNs;
+			if (2 * Gap > 3 * PeriodNs) {
+				uint64_t Missing = (Gap + PeriodNs / 2) / PeriodNs - 1;
+
+				Stats.nGaps++;
+				Stats.nMissing += Missing;
+				if (ZeroFill) {
+					uint64_t n = Missing * BfsPerPkt;
+
+					for (k = 0; k < nAxc; k++) {
+						uint64_t Left = n;
+
+						while (Left) {
+							uint32_t Chunk = (Left > OUT_BUFFER_SAMPLES)
+									? OUT_BUFFER_SAMPLES : (uint32_t) Left;
+
+							reserveAxc(&Out[k], Chunk);
+							memset(Out[k].Buf + 2 * Out[k].n, 0,
+									Chunk * 2 * sizeof(int16_t));
+							Out[k].n += Chunk;
+							Left -= Chunk;
+						}
+					}
+				}
+			}
+		}
+		PrevNs = Ns;
+		Stats.LastNs = Ns;
+		Stats.nRoe++;
+
+		if (PayloadLength < 4 * ROE_BF_WORDS(LineRate) * BfsPerPkt) {
+			Stats.nMalformed++;
+			continue;
+		}
+		decodeBfs(Payload, BfsPerPkt, LineRate, nAxc, ControlWord, Out,
+				&Stats);
+	}
+
+	for (k = 0; k < nAxc; k++) {
+		flushAxc(&Out[k]);
+		if (Out[k].f) {
+			fclose(Out[k].f);
+		}
+	}
+	Wall = (double) (clock() - Start) / CLOCKS_PER_SEC;
+
+	printf("Records:    %llu, %llu RoE, %llu other, %llu malformed%s\n",
+			(unsigned long long) Stats.nRecords,
+			(unsigned long long) Stats.nRoe,
+			(unsigned long long) Stats.nOther,
+			(unsigned long long) Stats.nMalformed,
+			Stats.nTruncated ? ", truncated capture" : "");
+	printf("BFs:        %llu (%u per packet, line rate option %u), control "
+			"word 0x%04X, %llu errors\n", (unsigned long long) Stats.nBfs,
+			BfsPerPkt, LineRate, (unsigned) (ControlWord & 0xFFFF),
+			(unsigned long long) Stats.nCtrlErrors);
+	printf("Gaps:       %llu, about %llu frames missing\n",
+			(unsigned long long) Stats.nGaps,
+			(unsigned long long) Stats.nMissing);
+	if (Stats.nRoe > 1) {
+		double Span = (double) (Stats.LastNs - Stats.FirstNs) * 1e-9;
+		double BfRate = (double) (Stats.nRoe - 1 + Stats.nMissing) * BfsPerPkt
+				/ Span;
+
+		printf("Timing:     %.6f s, BF rate error %+.2f ppm, inter-arrival "
+				"%.3f to %.3f us (period %.3f)\n", Span,
+				(BfRate / CPRI_CHIP_RATE - 1.0) * 1e6, Stats.MinGapNs / 1e3,
+				Stats.MaxGapNs / 1e3, BfsPerPkt * 1e6 / CPRI_CHIP_RATE);
+	}
+	for (k = 0; k < nAxc && Stats.nBfs; k++) {
+		printf("AxC %u:      %.2f dBFS\n", k, 10 * log10((double) Out[k].Power
+				/ Stats.nBfs / (32768.0 * 32768.0) + 1e-30));
+	}
+	if (Wall > 0) {
+		printf("Decoded %.2f GB/s\n", Pcap.Size / Wall / 1e9);
+	}
+
+	munmap((void *) Pcap.Data, Pcap.Size);
+	return (Stats.nGaps || Stats.nMalformed || Stats.nCtrlErrors) ? 2 : 0;
+}
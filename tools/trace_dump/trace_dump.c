@@ -0,0 +1,246 @@
+/*
+ * trace_dump.c
+ *
+ * Decoder of the firmware trace log (see "drivers/trace/trace_log.c"): turns
+ * the binary events back into text, using the format strings of
+ * "drivers/trace/trace_events.h", which are not compiled into the firmware.
+ *
+ * The events are read either from a console log, where Trace_drain() printed
+ * them as "trc" lines (other lines are ignored), or from a memory dump of
+ * the "traceLog" variable, e.g. read through JTAG with
+ *
+ *   xsct% mrd -bin -file trace.bin &traceLog <12 + 4 * TRACE_LOG_EVENTS>
+ *
+ * in which case the events that were not drained yet are decoded. Each event
+ * is printed with its time in ms since the first event (timer wraps are
+ * followed, as long as events are less than one wrap apart).
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -Wall -Idrivers/trace -o trace_dump tools/trace_dump/trace_dump.c
+ *
+ * Examples:
+ *
+ *   ./trace_dump console.log
+ *   ./trace_dump -m trace.bin -f 100000000
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "trace_events.h"
+
+/************************** Constant Definitions *****************************/
+
+#define DEFAULT_TIMER_HZ		100000000
+#define LOG_HEADER_WORDS		3	/* Head, Tail, nDropped */
+#define EVENT_WORDS				4
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	const char *Name;
+	const char *Format;
+} EventFormat;
+
+typedef struct {
+	double TimerHz;
+	int Started;
+	uint32_t LastTimestamp;
+	uint64_t Ticks;				/* Since the first event */
+	uint64_t nEvents;
+	uint64_t nDropped;
+	uint64_t nUnknown;
+} Decoder;
+
+/************************** Variable Definitions *****************************/
+
+#define TRACE_EVENT_FORMAT(Id, Format)	{ #Id, Format },
+
+static const EventFormat Formats[TRACE_N_EVENTS] = {
+	TRACE_EVENTS(TRACE_EVENT_FORMAT)
+};
+
+/*****************************************************************************/
+
+static void printEvent(Decoder *D, uint32_t Timestamp, uint32_t IdArg0,
+		uint32_t Arg1, uint32_t Arg2) {
+	uint32_t Id = IdArg0 >> 16, Arg0 = IdArg0 & 0xFFFF;
+
+	if (D->Started) {
+		D->Ticks += (uint32_t) (Timestamp - D->LastTimestamp);
+	}
+	D->Started = 1;
+	D->LastTimestamp = Timestamp;
+	D->nEvents++;
+
+	printf("%12.3f ms  ", D->Ticks * 1e3 / D->TimerHz);
+	if (Id >= TRACE_N_EVENTS) {
+		printf("unknown event %u: %x %x %x\n", Id, Arg0, Arg1, Arg2);
+		D->nUnknown++;
+		return;
+	}
+	printf("%s: ", Formats[Id].Name);
+	printf(Formats[Id].Format, Arg0, Arg1, Arg2);
+	printf("\n");
+}
+
+static void printDropped(Decoder *D, uint32_t nDropped) {
+	printf("%12s     %u events dropped\n", "", nDropped);
+	D->nDropped += nDropped;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Decodes the "trc" lines of a console log. Lines may hold other text before
+ * them (the firmware starts them with "\r\n").
+ *
+ ******************************************************************************/
+static int decodeConsole(Decoder *D, FILE *f) {
+	char Line[512];
+
+	while (fgets(Line, sizeof(Line), f)) {
+		char *p;
+		unsigned int Timestamp, IdArg0, Arg1, Arg2, nDropped;
+
+		if ((p = strstr(Line, "trc_drop ")) != NULL) {
+			if (sscanf(p, "trc_drop %u", &nDropped) == 1) {
+				printDropped(D, nDropped);
+			}
+		} else if ((p = strstr(Line, "trc ")) != NULL) {
+			if (sscanf(p, "trc %x %x %x %x", &Timestamp, &IdArg0, &Arg1,
+					&Arg2) == 4) {
+				printEvent(D, Timestamp, IdArg0, Arg1, Arg2);
+			}
+		}
+	}
+	return 0;
+}
+
+static uint32_t word(const uint8_t *p, int BigEndian) {
+	if (BigEndian) {
+		return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16)
+				| ((uint32_t) p[2] << 8) | p[3];
+	}
+	return ((uint32_t) p[3] << 24) | ((uint32_t) p[2] << 16)
+			| ((uint32_t) p[1] << 8) | p[0];
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Decodes the pending events of a memory dump of the log (TraceLog of
+ * trace_log.h, little-endian as on the MicroBlaze unless BigEndian).
+ *
+ ******************************************************************************/
+static int decodeDump(Decoder *D, const char *Path, int BigEndian) {
+	static uint8_t Dump[4 * (LOG_HEADER_WORDS
+			+ EVENT_WORDS * TRACE_LOG_EVENTS)];
+	uint32_t Head, Tail, nDropped, i;
+	FILE *f = fopen(Path, "rb");
+
+	if (f == NULL) {
+		perror(Path);
+		return -1;
+	}
+	if (fread(Dump, sizeof(Dump), 1, f) != 1) {
+		fprintf(stderr, "%s: shorter than the log (%u events of %u bytes)\n",
+				Path, TRACE_LOG_EVENTS, 4 * EVENT_WORDS);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	Head = word(Dump, BigEndian);
+	Tail = word(Dump + 4, BigEndian);
+	nDropped = word(Dump + 8, BigEndian);
+	if (Head - Tail > TRACE_LOG_EVENTS) {
+		fprintf(stderr, "%s: inconsistent log (head %u, tail %u)\n", Path,
+				Head, Tail);
+		return -1;
+	}
+	printf("Log: %u events written, %u pending, %u dropped\n", Head,
+			Head - Tail, nDropped);
+
+	for (i = Tail; i != Head; i++) {
+		const uint8_t *p = Dump + 4 * (LOG_HEADER_WORDS
+				+ EVENT_WORDS * (i % TRACE_LOG_EVENTS));
+
+		printEvent(D, word(p, BigEndian), word(p + 4, BigEndian),
+				word(p + 8, BigEndian), word(p + 12, BigEndian));
+	}
+	if (nDropped) {
+		printDropped(D, nDropped);
+	}
+	return 0;
+}
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"Usage: %s [options] [console log ...]\n"
+			"  -m <file>   decode a memory dump of traceLog instead\n"
+			"  -B          the dump is big-endian\n"
+			"  -f <Hz>     timestamp clock (default %d)\n"
+			"Reads the console log from stdin if no file is given.\n", Prog,
+			DEFAULT_TIMER_HZ);
+}
+
+int main(int argc, char **argv) {
+	Decoder D;
+	const char *DumpPath = NULL;
+	int Opt, BigEndian = 0, Status = 0, i;
+
+	memset(&D, 0, sizeof(D));
+	D.TimerHz = DEFAULT_TIMER_HZ;
+
+	while ((Opt = getopt(argc, argv, "m:Bf:h")) != -1) {
+		switch (Opt) {
+		case 'm':
+			DumpPath = optarg;
+			break;
+		case 'B':
+			BigEndian = 1;
+			break;
+		case 'f':
+			D.TimerHz = atof(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (D.TimerHz <= 0 || (DumpPath && optind < argc)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (DumpPath) {
+		Status = decodeDump(&D, DumpPath, BigEndian);
+	} else if (optind == argc) {
+		Status = decodeConsole(&D, stdin);
+	} else {
+		for (i = optind; i < argc && Status == 0; i++) {
+			FILE *f = fopen(argv[i], "r");
+
+			if (f == NULL) {
+				perror(argv[i]);
+				return 1;
+			}
+			Status = decodeConsole(&D, f);
+			fclose(f);
+		}
+	}
+	if (Status) {
+		return 1;
+	}
+
+	fprintf(stderr, "%llu events, %llu dropped, %llu unknown\n",
+			(unsigned long long) D.nEvents, (unsigned long long) D.nDropped,
+			(unsigned long long) D.nUnknown);
+	return 0;
+}
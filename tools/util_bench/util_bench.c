@@ -0,0 +1,348 @@
+/*
+ * util_bench.c
+ *
+ * Host check of the integer helpers of the AD9361 driver
+ * ("drivers/fmcomms2/util_math.h"): compares find_first_bit(), ilog2(),
+ * int_sqrt(), do_div() and the reciprocal division against the generic
+ * implementations they replaced, on edge cases and random operands, then
+ * times both versions.
+ *
+ * Host timings only show the relative cost of the algorithms. On the
+ * MicroBlaze, the gain of the 64-bit division paths is much larger, since
+ * the design has no hardware divider.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -Wall -Idrivers/fmcomms2 -o util_bench \
+ *       tools/util_bench/util_bench.c
+ *
+ * Examples:
+ *
+ *   ./util_bench
+ *   ./util_bench -n 10000000 -s 7
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "util_math.h"
+
+/************************** Constant Definitions *****************************/
+
+#define DEFAULT_ITERATIONS		1000000
+#define BENCH_OPERANDS			4096
+
+/*
+ * Typical divisor: the DAC clock of the DDS frequency computation
+ */
+#define DAC_CLK_HZ				245760000U
+
+/************************** Variable Definitions *****************************/
+
+static uint64_t RngState = 0x853C49E6748FEA9BULL;
+static volatile uint64_t Sink;
+
+/*****************************************************************************/
+/*
+ * Generic implementations replaced by util_math.h (formerly in util.c)
+ */
+
+static uint32_t ref_int_sqrt(uint32_t x) {
+	uint32_t b, m, y = 0;
+
+	if (x <= 1)
+		return x;
+
+	m = 1UL << 30;
+	while (m != 0) {
+		b = y + m;
+		y >>= 1;
+
+		if (x >= b) {
+			x -= b;
+			y += m;
+		}
+		m >>= 2;
+	}
+
+	return y;
+}
+
+static int32_t ref_ilog2(int32_t x) {
+	int32_t A = !(!(x >> 16));
+	int32_t count = 0;
+	int32_t x_copy = x;
+
+	count = count + (A << 4);
+
+	x_copy = (((~A + 1) & (x >> 16)) + (~(~A + 1) & x));
+
+	A = !(!(x_copy >> 8));
+	count = count + (A << 3);
+	x_copy = (((~A + 1) & (x_copy >> 8)) + (~(~A + 1) & x_copy));
+
+	A = !(!(x_copy >> 4));
+	count = count + (A << 2);
+	x_copy = (((~A + 1) & (x_copy >> 4)) + (~(~A + 1) & x_copy));
+
+	A = !(!(x_copy >> 2));
+	count = count + (A << 1);
+	x_copy = (((~A + 1) & (x_copy >> 2)) + (~(~A + 1) & x_copy));
+
+	A = !(!(x_copy >> 1));
+	count = count + A;
+
+	return count;
+}
+
+static uint64_t ref_do_div(uint64_t *n, uint64_t base) {
+	uint64_t mod = *n % base;
+
+	*n = *n / base;
+	return mod;
+}
+
+static uint32_t ref_find_first_bit(uint32_t word) {
+	int32_t num = 0;
+
+	if ((word & 0xffff) == 0) {
+		num += 16;
+		word >>= 16;
+	}
+	if ((word & 0xff) == 0) {
+		num += 8;
+		word >>= 8;
+	}
+	if ((word & 0xf) == 0) {
+		num += 4;
+		word >>= 4;
+	}
+	if ((word & 0x3) == 0) {
+		num += 2;
+		word >>= 2;
+	}
+	if ((word & 0x1) == 0)
+		num += 1;
+	return num;
+}
+
+/*****************************************************************************/
+
+static uint64_t rand64(void) {
+	/* xorshift64* */
+	RngState ^= RngState >> 12;
+	RngState ^= RngState << 25;
+	RngState ^= RngState >> 27;
+	return RngState * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ * Random value with a random number of significant bits, so that small
+ * operands are as likely as large ones
+ */
+static uint64_t randBits(uint32_t MaxBits) {
+	uint32_t Bits = 1 + (uint32_t) (rand64() % MaxBits);
+
+	return (Bits >= 64) ? rand64() : rand64() & ((1ULL << Bits) - 1);
+}
+
+static uint32_t checkWord(uint32_t x) {
+	uint32_t Errors = 0;
+
+	if (util_find_first_bit(x) != ref_find_first_bit(x)) {
+		printf("find_first_bit(0x%08x): %u, expected %u\n", x,
+				util_find_first_bit(x), ref_find_first_bit(x));
+		Errors++;
+	}
+	if (util_ilog2((int32_t) x) != ref_ilog2((int32_t) x)) {
+		printf("ilog2(0x%08x): %d, expected %d\n", x, util_ilog2((int32_t) x),
+				ref_ilog2((int32_t) x));
+		Errors++;
+	}
+	if (util_int_sqrt(x) != ref_int_sqrt(x)) {
+		printf("int_sqrt(%u): %u, expected %u\n", x, util_int_sqrt(x),
+				ref_int_sqrt(x));
+		Errors++;
+	}
+	return Errors;
+}
+
+static uint32_t checkDiv(uint64_t n, uint64_t Base) {
+	uint64_t q = n, Ref = n, Mod, RefMod;
+	uint32_t Errors = 0;
+
+	Mod = util_do_div(&q, Base);
+	RefMod = ref_do_div(&Ref, Base);
+	if (q != Ref || Mod != RefMod) {
+		printf("do_div(%llu, %llu): %llu r %llu, expected %llu r %llu\n",
+				(unsigned long long) n, (unsigned long long) Base,
+				(unsigned long long) q, (unsigned long long) Mod,
+				(unsigned long long) Ref, (unsigned long long) RefMod);
+		Errors++;
+	}
+
+	if (Base <= UINT32_MAX) {
+		struct util_recip Recip;
+
+		util_recip_init(&Recip, (uint32_t) Base);
+		q = n;
+		Mod = util_recip_div(&q, &Recip);
+		if (q != Ref || Mod != RefMod) {
+			printf("recip_div(%llu, %llu): %llu r %llu, expected %llu r %llu\n",
+					(unsigned long long) n, (unsigned long long) Base,
+					(unsigned long long) q, (unsigned long long) Mod,
+					(unsigned long long) Ref, (unsigned long long) RefMod);
+			Errors++;
+		}
+	}
+	return Errors;
+}
+
+static uint32_t crossCheck(uint32_t nRandom) {
+	static const uint64_t EdgeBases[] = { 1, 2, 3, 7, 10, 1000, 65536, 65537,
+			DAC_CLK_HZ, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, 0x100000000ULL,
+			0x100000001ULL, 1ULL << 63, UINT64_MAX };
+	static const uint64_t EdgeNums[] = { 0, 1, 2, 0xFFFFFFFF, 0x100000000ULL,
+			(uint64_t) DAC_CLK_HZ << 32, 1ULL << 63, UINT64_MAX - 1,
+			UINT64_MAX };
+	uint32_t Errors = 0, i, j;
+
+	for (i = 0; i < 32; i++) {
+		Errors += checkWord(1U << i);
+		Errors += checkWord((1U << i) - 1);
+		Errors += checkWord(~(1U << i));
+		Errors += checkWord((1U << i) + 1);
+	}
+	Errors += checkWord(0xFFFFFFFF);
+	for (i = 0; i < 65536; i++) {
+		Errors += checkWord(i * i);
+		Errors += checkWord(i * i - 1);
+	}
+
+	for (i = 0; i < sizeof(EdgeBases) / sizeof(EdgeBases[0]); i++) {
+		for (j = 0; j < sizeof(EdgeNums) / sizeof(EdgeNums[0]); j++) {
+			Errors += checkDiv(EdgeNums[j], EdgeBases[i]);
+			Errors += checkDiv(EdgeNums[j] - EdgeNums[j] % EdgeBases[i],
+					EdgeBases[i]);
+		}
+	}
+
+	for (i = 0; i < nRandom && Errors < 20; i++) {
+		uint64_t Base = randBits(64);
+
+		Errors += checkWord((uint32_t) randBits(32));
+		Errors += checkDiv(randBits(64), Base ? Base : 1);
+		Errors += checkDiv(randBits(64), (uint32_t) Base ? (uint32_t) Base : 1);
+		Errors += checkDiv(randBits(64), 1ULL << (Base % 64));
+	}
+	return Errors;
+}
+
+/*****************************************************************************/
+
+#define TIME_LOOP(Label, Ref, Fast) do {									\
+	clock_t Start = clock();												\
+	double RefNs, FastNs;													\
+	uint64_t Acc = 0;														\
+	for (i = 0; i < nIterations; i++) {										\
+		Ref;																\
+	}																		\
+	RefNs = 1e9 * (double) (clock() - Start) / CLOCKS_PER_SEC / nIterations;\
+	Start = clock();														\
+	for (i = 0; i < nIterations; i++) {										\
+		Fast;																\
+	}																		\
+	FastNs = 1e9 * (double) (clock() - Start) / CLOCKS_PER_SEC / nIterations;\
+	Sink = Acc;																\
+	printf("%-26s %8.2f ns %8.2f ns  x%.1f\n", Label, RefNs, FastNs,		\
+			FastNs > 0 ? RefNs / FastNs : 0.0);								\
+} while (0)
+
+static void benchmark(uint32_t nIterations) {
+	static uint32_t Words[BENCH_OPERANDS];
+	static uint64_t Nums[BENCH_OPERANDS], Bases[BENCH_OPERANDS];
+	struct util_recip Recip;
+	uint64_t n;
+	uint32_t i, k;
+
+	for (k = 0; k < BENCH_OPERANDS; k++) {
+		Words[k] = (uint32_t) randBits(32) | 1U << (k % 32);
+		Nums[k] = randBits(64);
+		Bases[k] = randBits(32) | 1;
+	}
+	util_recip_init(&Recip, DAC_CLK_HZ);
+
+	printf("%-26s %11s %11s\n", "", "generic", "util_math");
+
+#define K	(i & (BENCH_OPERANDS - 1))
+	TIME_LOOP("find_first_bit", Acc += ref_find_first_bit(Words[K]),
+			Acc += util_find_first_bit(Words[K]));
+	TIME_LOOP("ilog2", Acc += ref_ilog2((int32_t) Words[K]),
+			Acc += util_ilog2((int32_t) Words[K]));
+	TIME_LOOP("int_sqrt", Acc += ref_int_sqrt(Words[K]),
+			Acc += util_int_sqrt(Words[K]));
+	TIME_LOOP("do_div (32-bit operands)",
+			n = Words[K]; Acc += ref_do_div(&n, Bases[K]) + n,
+			n = Words[K]; Acc += util_do_div(&n, Bases[K]) + n);
+	TIME_LOOP("do_div (power of two)",
+			n = Nums[K]; Acc += ref_do_div(&n, 1ULL << (K % 64)) + n,
+			n = Nums[K]; Acc += util_do_div(&n, 1ULL << (K % 64)) + n);
+	TIME_LOOP("do_div / recip (DAC clk)",
+			n = Nums[K]; Acc += ref_do_div(&n, DAC_CLK_HZ) + n,
+			n = Nums[K]; Acc += util_recip_div(&n, &Recip) + n);
+#undef K
+}
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"Usage: %s [options]\n"
+			"  -n <n>      random cross-check cases and benchmark iterations "
+			"(default %d)\n"
+			"  -s <n>      random seed\n"
+			"  -q          cross-check only\n", Prog, DEFAULT_ITERATIONS);
+}
+
+int main(int argc, char **argv) {
+	uint32_t nIterations = DEFAULT_ITERATIONS, Errors;
+	int Opt, Bench = 1;
+
+	while ((Opt = getopt(argc, argv, "n:s:qh")) != -1) {
+		switch (Opt) {
+		case 'n':
+			nIterations = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			RngState ^= strtoull(optarg, NULL, 0) * 0x9E3779B97F4A7C15ULL;
+			if (RngState == 0) {
+				RngState = 1;
+			}
+			break;
+		case 'q':
+			Bench = 0;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (nIterations == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	Errors = crossCheck(nIterations);
+	if (Errors) {
+		printf("Cross-check FAILED (%u mismatches)\n", Errors);
+		return 1;
+	}
+	printf("Cross-check passed (%u random cases)\n", nIterations);
+
+	if (Bench) {
+		benchmark(nIterations);
+	}
+	return 0;
+}
@@ -0,0 +1,892 @@
+/*
+ * wavegen.c
+ *
+ * Waveform compiler: converts IQ sample files into firmware-ready transmit
+ * waveforms for the DMA driver (see "drivers/dma/dma_driver.c").
+ *
+ * The input is either a file of interleaved IQ samples, as 16-bit signed
+ * integers ("sc16") or 32-bit floats ("cf32"), or an LTE-like OFDM signal
+ * generated by the tool itself (random QPSK on all the occupied subcarriers
+ * of a 5 or 20 MHz carrier, normal cyclic prefix).
+ *
+ * The samples are then:
+ *  1. resampled to the AD9361 sample rate by a polyphase FIR (the rational
+ *     factor is derived from the input and output rates);
+ *  2. scaled to the requested RMS level (dBFS) and saturated to 16 bits;
+ *  3. packed as one 32-bit word per IQ sample, with Q in the 16 MSBs and I in
+ *     the 16 LSBs, as expected by the DAC/ADC DMA interfaces;
+ *  4. truncated by the given mask. For example, when the CPRI IQ sample size
+ *     is 30 bits, the packer drops the LSB of I and Q, so the mask should be
+ *     0xFFFEFFFE.
+ *
+ * Multiple antenna-carriers (AxC) are supported with "-a". The DAC DMA
+ * interface demultiplexes the DMA stream round-robin (word k feeds AxC
+ * k % n_axc), so the AxC streams are interleaved sample by sample in that
+ * order. Each "-i" input (or each generated carrier, with distinct seeds)
+ * feeds one AxC; when there are fewer inputs than AxCs, they are repeated
+ * cyclically. All AxCs are cut to the length of the shortest stream.
+ *
+ * Two output formats are supported:
+ *  - a C header following the convention of "waveforms/lte_5Mhz.h"
+ *    ("N_TX_IQ_SAMPLES" and "u32 txWaveform[N_TX_IQ_SAMPLES]", holding the
+ *    interleaved AxCs), or, with "-p", one array per AxC plus the table
+ *    "axcWaveforms" to be passed to "loadTxAxcWaveforms()";
+ *  - a binary container (".iqw"), with the header "WaveContainerHeader" below
+ *    followed by the packed words. The words are either stored raw or
+ *    run-length encoded, which pays off for waveforms with repeated samples.
+ *
+ * All the per-sample processing runs on planar (separate I and Q) float
+ * arrays, in simple loops that the compiler vectorizes, so hundreds of MB of
+ * input are processed in a few seconds. Build with optimization enabled:
+ *
+ *   gcc -O3 -march=native -Wall -o wavegen wavegen.c -lm
+ *
+ * Examples:
+ *
+ *   ./wavegen -g lte5 -t 10 -H lte_5Mhz.h
+ *   ./wavegen -g lte5 -a 2 -p -H lte_5Mhz_2axc.h
+ *   ./wavegen -i capture.cf32 -f cf32 -r 10e6 -o 7.68e6 -m 0xFFFEFFFE -c wave.iqw
+ */
+
+/***************************** Include Files *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+
+/************************** Constant Definitions *****************************/
+
+#define WAVE_CONTAINER_MAGIC	0x57465149	/* "IQFW" */
+#define WAVE_CONTAINER_VERSION	1
+
+#define WAVE_ENC_RAW			0
+#define WAVE_ENC_RLE			1
+
+/*
+ * Run-length records: a 16-bit header followed by words. With the MSB set, the
+ * next word is repeated (header & 0x7FFF) times; otherwise (header) literal
+ * words follow.
+ */
+#define RLE_REPEAT_FLAG			0x8000
+#define RLE_MAX_RUN				0x7FFF
+
+/*
+ * Resampler
+ */
+#define TAPS_PER_PHASE			32
+#define KAISER_BETA				8.0
+#define MAX_PROTOTYPE_TAPS		(16 * 1024 * 1024)
+
+#define DEFAULT_OUT_RATE		7.68e6
+#define DEFAULT_RMS_DBFS		-15.0
+
+#define MAX_AXC					4
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/**************************** Type Definitions *******************************/
+
+/*
+ * Container header (little-endian)
+ */
+typedef struct {
+	uint32_t Magic;
+	uint16_t Version;
+	uint16_t Encoding;		/* WAVE_ENC_RAW or WAVE_ENC_RLE */
+	uint32_t nSamples;		/* Number of 32-bit IQ words (all AxCs) */
+	uint32_t SampleRate;	/* In Hz */
+	uint32_t Mask;			/* Truncation mask applied to the words */
+	uint32_t PayloadBytes;	/* Bytes following this header */
+	uint16_t nAxc;			/* Interleaved AxCs */
+	uint16_t Reserved0;
+	uint32_t Reserved1;
+} WaveContainerHeader;
+
+/*
+ * Planar complex signal
+ */
+typedef struct {
+	float *I;
+	float *Q;
+	size_t n;
+} Signal;
+
+/*
+ * LTE-like carrier
+ */
+typedef struct {
+	const char *Name;
+	double SampleRate;
+	int FftSize;
+	int nSubcarriers;
+	int CpFirst;	/* Cyclic prefix of the first symbol in a slot */
+	int CpOther;
+} LteCarrier;
+
+static const LteCarrier LteCarriers[] = {
+	{ "lte5", 7.68e6, 512, 300, 40, 36 },
+	{ "lte20", 30.72e6, 2048, 1200, 160, 144 },
+};
+
+/*****************************************************************************/
+/*
+ *
+ * Allocates a planar signal of n samples (zeroed).
+ *
+ ******************************************************************************/
+static int allocSignal(Signal *Sig, size_t n) {
+	Sig->I = calloc(n ? n : 1, sizeof(float));
+	Sig->Q = calloc(n ? n : 1, sizeof(float));
+	Sig->n = n;
+	if (!Sig->I || !Sig->Q) {
+		fprintf(stderr, "Out of memory (%zu samples)\n", n);
+		return -1;
+	}
+	return 0;
+}
+
+static void freeSignal(Signal *Sig) {
+	free(Sig->I);
+	free(Sig->Q);
+	Sig->I = Sig->Q = NULL;
+	Sig->n = 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Reads a whole file of interleaved sc16 or cf32 IQ samples.
+ *
+ ******************************************************************************/
+static int readIqFile(const char *Path, int IsFloat, Signal *Sig) {
+	FILE *Fp;
+	long Size;
+	size_t SampleBytes = IsFloat ? 8 : 4;
+	size_t n, k;
+	void *Raw;
+
+	Fp = fopen(Path, "rb");
+	if (!Fp) {
+		perror(Path);
+		return -1;
+	}
+	fseek(Fp, 0, SEEK_END);
+	Size = ftell(Fp);
+	fseek(Fp, 0, SEEK_SET);
+	n = Size / SampleBytes;
+
+	Raw = malloc(n * SampleBytes + 1);
+	if (!Raw || allocSignal(Sig, n) != 0) {
+		fclose(Fp);
+		free(Raw);
+		return -1;
+	}
+	if (fread(Raw, SampleBytes, n, Fp) != n) {
+		fprintf(stderr, "%s: short read\n", Path);
+		fclose(Fp);
+		free(Raw);
+		return -1;
+	}
+	fclose(Fp);
+
+	if (IsFloat) {
+		const float *restrict In = Raw;
+		float *restrict I = Sig->I, *restrict Q = Sig->Q;
+
+		for (k = 0; k < n; k++) {
+			I[k] = In[2 * k];
+			Q[k] = In[2 * k + 1];
+		}
+	} else {
+		const int16_t *restrict In = Raw;
+		float *restrict I = Sig->I, *restrict Q = Sig->Q;
+
+		for (k = 0; k < n; k++) {
+			I[k] = In[2 * k] * (1.0f / 32768.0f);
+			Q[k] = In[2 * k + 1] * (1.0f / 32768.0f);
+		}
+	}
+
+	free(Raw);
+	return 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * In-place radix-2 complex FFT (Inverse if Dir > 0), on double arrays.
+ *
+ ******************************************************************************/
+static void fft(double *Re, double *Im, int n, int Dir) {
+	int i, j, k, Len;
+
+	for (i = 1, j = 0; i < n; i++) {
+		int Bit = n >> 1;
+		for (; j & Bit; Bit >>= 1)
+			j ^= Bit;
+		j ^= Bit;
+		if (i < j) {
+			double T;
+			T = Re[i]; Re[i] = Re[j]; Re[j] = T;
+			T = Im[i]; Im[i] = Im[j]; Im[j] = T;
+		}
+	}
+
+	for (Len = 2; Len <= n; Len <<= 1) {
+		double Ang = (Dir > 0 ? 2 : -2) * M_PI / Len;
+		double WRe = cos(Ang), WIm = sin(Ang);
+
+		for (i = 0; i < n; i += Len) {
+			double CRe = 1, CIm = 0;
+
+			for (k = 0; k < Len / 2; k++) {
+				int a = i + k, b = i + k + Len / 2;
+				double TRe = Re[b] * CRe - Im[b] * CIm;
+				double TIm = Re[b] * CIm + Im[b] * CRe;
+				double NRe;
+
+				Re[b] = Re[a] - TRe;
+				Im[b] = Im[a] - TIm;
+				Re[a] += TRe;
+				Im[a] += TIm;
+
+				NRe = CRe * WRe - CIm * WIm;
+				CIm = CRe * WIm + CIm * WRe;
+				CRe = NRe;
+			}
+		}
+	}
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Generates "DurationMs" of an LTE-like downlink carrier: every OFDM symbol
+ * carries random QPSK on all the occupied subcarriers (DC excluded), with
+ * 7 symbols per 0.5 ms slot and normal cyclic prefix.
+ *
+ ******************************************************************************/
+static int generateLte(const LteCarrier *Car, double DurationMs,
+		unsigned int Seed, Signal *Sig) {
+	int N = Car->FftSize;
+	size_t SlotLen = (size_t) (Car->SampleRate * 0.5e-3);
+	size_t nSlots = (size_t) ceil(DurationMs / 0.5);
+	double *Re, *Im;
+	size_t Pos = 0, s;
+	int Sym, k;
+	uint32_t Lfsr = Seed ? Seed : 1;
+
+	if (allocSignal(Sig, nSlots * SlotLen) != 0)
+		return -1;
+	Re = malloc(N * sizeof(double));
+	Im = malloc(N * sizeof(double));
+	if (!Re || !Im) {
+		free(Re);
+		free(Im);
+		return -1;
+	}
+
+	for (s = 0; s < nSlots; s++) {
+		for (Sym = 0; Sym < 7; Sym++) {
+			int Cp = (Sym == 0) ? Car->CpFirst : Car->CpOther;
+
+			memset(Re, 0, N * sizeof(double));
+			memset(Im, 0, N * sizeof(double));
+
+			// Occupied subcarriers: -n/2..-1 and 1..n/2
+			for (k = -Car->nSubcarriers / 2; k <= Car->nSubcarriers / 2; k++) {
+				int Bin;
+
+				if (k == 0)
+					continue;
+				Bin = (k + N) % N;
+				// xorshift32
+				Lfsr ^= Lfsr << 13;
+				Lfsr ^= Lfsr >> 17;
+				Lfsr ^= Lfsr << 5;
+				Re[Bin] = (Lfsr & 1) ? M_SQRT1_2 : -M_SQRT1_2;
+				Im[Bin] = (Lfsr & 2) ? M_SQRT1_2 : -M_SQRT1_2;
+			}
+
+			fft(Re, Im, N, 1);
+
+			for (k = 0; k < Cp; k++) {
+				Sig->I[Pos + k] = Re[N - Cp + k];
+				Sig->Q[Pos + k] = Im[N - Cp + k];
+			}
+			Pos += Cp;
+			for (k = 0; k < N; k++) {
+				Sig->I[Pos + k] = Re[k];
+				Sig->Q[Pos + k] = Im[k];
+			}
+			Pos += N;
+		}
+	}
+
+	Sig->n = Pos;
+	free(Re);
+	free(Im);
+	return 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Zeroth-order modified Bessel function (Kaiser window).
+ *
+ ******************************************************************************/
+static double besselI0(double x) {
+	double Sum = 1, Term = 1;
+	int k;
+
+	for (k = 1; k < 50; k++) {
+		Term *= (x / (2 * k)) * (x / (2 * k));
+		Sum += Term;
+		if (Term < 1e-12 * Sum)
+			break;
+	}
+	return Sum;
+}
+
+static unsigned long gcd(unsigned long a, unsigned long b) {
+	while (b) {
+		unsigned long t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Resamples the signal by the rational factor OutRate/InRate with a polyphase
+ * FIR. The prototype is a Kaiser-windowed sinc with TAPS_PER_PHASE taps per
+ * phase, cut off at 90% of the lowest Nyquist frequency.
+ *
+ * Each phase is stored time-reversed, so that every output sample is a plain
+ * dot product over contiguous input samples.
+ *
+ ******************************************************************************/
+static int resample(const Signal *In, double InRate, double OutRate,
+		Signal *Out) {
+	unsigned long InHz = (unsigned long) llround(InRate);
+	unsigned long OutHz = (unsigned long) llround(OutRate);
+	unsigned long G, L, M;
+	size_t nTaps, nOut, n;
+	float *Bank, *PadI, *PadQ;
+	double Cutoff, Center;
+	size_t k;
+	unsigned long p;
+	const int T = TAPS_PER_PHASE;
+
+	G = gcd(InHz, OutHz);
+	L = OutHz / G;
+	M = InHz / G;
+
+	if (L == 1 && M == 1) {
+		if (allocSignal(Out, In->n) != 0)
+			return -1;
+		memcpy(Out->I, In->I, In->n * sizeof(float));
+		memcpy(Out->Q, In->Q, In->n * sizeof(float));
+		return 0;
+	}
+
+	nTaps = (size_t) L * T;
+	if (nTaps > MAX_PROTOTYPE_TAPS) {
+		fprintf(stderr, "Resampling factor %lu/%lu is too fine; round the "
+				"rates\n", L, M);
+		return -1;
+	}
+
+	fprintf(stderr, "Resampling %.0f -> %.0f Hz (L = %lu, M = %lu)\n", InRate,
+			OutRate, L, M);
+
+	// Polyphase bank: Bank[p * T + j] = h[(T - 1 - j) * L + p]
+	Bank = malloc(nTaps * sizeof(float));
+	if (!Bank)
+		return -1;
+	Cutoff = 0.9 * 0.5 / (L > M ? L : M);	// cycles/sample at L * InRate
+	Center = (nTaps - 1) / 2.0;
+	for (k = 0; k < nTaps; k++) {
+		double x = k - Center;
+		double r = x / Center;
+		double Sinc = (x == 0) ? 2 * Cutoff :
+				sin(2 * M_PI * Cutoff * x) / (M_PI * x);
+		double Win = besselI0(KAISER_BETA * sqrt(fmax(0, 1 - r * r)))
+				/ besselI0(KAISER_BETA);
+		unsigned long Phase = k % L;
+		size_t Tap = k / L;
+
+		// Gain L compensates for the zero stuffing
+		Bank[Phase * T + (T - 1 - Tap)] = (float) (L * Sinc * Win);
+	}
+
+	// Input with T - 1 leading zeros, so that y[n] only reads valid memory
+	PadI = calloc(In->n + 2 * T, sizeof(float));
+	PadQ = calloc(In->n + 2 * T, sizeof(float));
+	nOut = (size_t) ((double) In->n * L / M);
+	if (!PadI || !PadQ || allocSignal(Out, nOut) != 0) {
+		free(Bank);
+		free(PadI);
+		free(PadQ);
+		return -1;
+	}
+	memcpy(PadI + T - 1, In->I, In->n * sizeof(float));
+	memcpy(PadQ + T - 1, In->Q, In->n * sizeof(float));
+
+	for (n = 0; n < nOut; n++) {
+		// Output n is at input time n * M / L
+		unsigned long long Pos = (unsigned long long) n * M;
+		size_t Base = (size_t) (Pos / L);
+		const float *restrict h;
+		const float *restrict xi;
+		const float *restrict xq;
+		float AccI = 0, AccQ = 0;
+		int j;
+
+		p = (unsigned long) (Pos % L);
+		h = Bank + p * T;
+		xi = PadI + Base;
+		xq = PadQ + Base;
+		for (j = 0; j < T; j++) {
+			AccI += h[j] * xi[j];
+			AccQ += h[j] * xq[j];
+		}
+		Out->I[n] = AccI;
+		Out->Q[n] = AccQ;
+	}
+
+	free(Bank);
+	free(PadI);
+	free(PadQ);
+	return 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Scales the signal to the given RMS level (dBFS, relative to a full-scale
+ * 16-bit sine), packs it into 32-bit words (Q in the MSBs, I in the LSBs) and
+ * applies the truncation mask.
+ *
+ * @return	The number of saturated components.
+ *
+ ******************************************************************************/
+static size_t packWords(const Signal *Sig, double RmsDbfs, uint32_t Mask,
+		uint32_t *restrict Words) {
+	const float *restrict I = Sig->I;
+	const float *restrict Q = Sig->Q;
+	double Power = 0;
+	float Gain;
+	size_t k, nClipped = 0;
+
+	for (k = 0; k < Sig->n; k++)
+		Power += (double) I[k] * I[k] + (double) Q[k] * Q[k];
+	Power /= (Sig->n ? Sig->n : 1);
+
+	Gain = (Power > 0) ?
+			(float) (32767.0 * pow(10, RmsDbfs / 20) / sqrt(Power)) : 0;
+
+	for (k = 0; k < Sig->n; k++) {
+		float Fi = nearbyintf(I[k] * Gain);
+		float Fq = nearbyintf(Q[k] * Gain);
+
+		nClipped += (Fi > 32767.0f || Fi < -32768.0f);
+		nClipped += (Fq > 32767.0f || Fq < -32768.0f);
+		Fi = fminf(fmaxf(Fi, -32768.0f), 32767.0f);
+		Fq = fminf(fmaxf(Fq, -32768.0f), 32767.0f);
+
+		Words[k] = (((uint32_t) (uint16_t) (int16_t) Fq << 16)
+				| (uint16_t) (int16_t) Fi) & Mask;
+	}
+
+	return nClipped;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Writes "n" words, taken every "Stride" words, as the body of a C array.
+ *
+ ******************************************************************************/
+static int writeArrayBody(FILE *Fp, const uint32_t *Words, size_t n,
+		size_t Stride) {
+	static const char Hex[] = "0123456789ABCDEF";
+	char *Buf;
+	size_t Len = 0;
+	size_t k;
+
+	// One formatted line per word ("\t0x%08X,\n" is 13 bytes)
+	Buf = malloc(n * 13 + 1);
+	if (!Buf)
+		return -1;
+	for (k = 0; k < n; k++) {
+		uint32_t w = Words[k * Stride];
+		int d;
+
+		Buf[Len++] = '\t';
+		Buf[Len++] = '0';
+		Buf[Len++] = 'x';
+		for (d = 7; d >= 0; d--)
+			Buf[Len++] = Hex[(w >> (4 * d)) & 0xF];
+		if (k + 1 < n)
+			Buf[Len++] = ',';
+		Buf[Len++] = '\n';
+	}
+	fwrite(Buf, 1, Len, Fp);
+	free(Buf);
+	return 0;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Writes the interleaved words of "nAxc" AxCs with "n" samples each as a C
+ * header. By default, a single "txWaveform" array holds the interleaved
+ * stream; with "PerAxc", each AxC gets its own array.
+ *
+ ******************************************************************************/
+static int writeHeader(const char *Path, const uint32_t *Words, size_t n,
+		int nAxc, int PerAxc) {
+	FILE *Fp;
+	char Guard[256];
+	const char *Base;
+	size_t k;
+	int a;
+	int Status = 0;
+
+	Fp = fopen(Path, "w");
+	if (!Fp) {
+		perror(Path);
+		return -1;
+	}
+
+	// Include guard from the file name, e.g. lte_5Mhz.h -> LTE_5MHZ_H_
+	Base = strrchr(Path, '/') ? strrchr(Path, '/') + 1 : Path;
+	for (k = 0; Base[k] && k < sizeof(Guard) - 2; k++) {
+		char c = Base[k];
+		Guard[k] = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' :
+				((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) ? c : '_';
+	}
+	Guard[k++] = '_';
+	Guard[k] = '\0';
+
+	fprintf(Fp, "#ifndef %s\n#define %s\n\n", Guard, Guard);
+	fprintf(Fp, "#define N_TX_AXC %d\n", nAxc);
+
+	if (!PerAxc) {
+		fprintf(Fp, "#define N_TX_IQ_SAMPLES %zu\n\n", n * nAxc);
+		fprintf(Fp, "u32 txWaveform[N_TX_IQ_SAMPLES]={\n");
+		Status = writeArrayBody(Fp, Words, n * nAxc, 1);
+		fprintf(Fp, "};\n");
+	} else {
+		fprintf(Fp, "#define N_AXC_IQ_SAMPLES %zu\n", n);
+		for (a = 0; a < nAxc && Status == 0; a++) {
+			fprintf(Fp, "\nu32 axcWaveform%d[N_AXC_IQ_SAMPLES]={\n", a);
+			Status = writeArrayBody(Fp, Words + a, n, nAxc);
+			fprintf(Fp, "};\n");
+		}
+		fprintf(Fp, "\nconst u32 * const axcWaveforms[N_TX_AXC]={");
+		for (a = 0; a < nAxc; a++)
+			fprintf(Fp, "%s axcWaveform%d", a ? "," : "", a);
+		fprintf(Fp, " };\n");
+	}
+
+	fprintf(Fp, "\n#endif /* %s */\n", Guard);
+	fclose(Fp);
+	return Status;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Run-length encodes the words (see RLE_REPEAT_FLAG).
+ *
+ * @return	The number of bytes written into Out, which must hold at least
+ *		n * 4 + (n / RLE_MAX_RUN + 1) * 2 * 2 bytes.
+ *
+ ******************************************************************************/
+static size_t rleEncode(const uint32_t *Words, size_t n, uint8_t *Out) {
+	size_t Len = 0, k = 0;
+
+	while (k < n) {
+		size_t Run = 1;
+		uint16_t Hdr;
+
+		while (k + Run < n && Words[k + Run] == Words[k] && Run < RLE_MAX_RUN)
+			Run++;
+
+		if (Run >= 2) {
+			Hdr = RLE_REPEAT_FLAG | (uint16_t) Run;
+			memcpy(Out + Len, &Hdr, 2);
+			memcpy(Out + Len + 2, &Words[k], 4);
+			Len += 6;
+			k += Run;
+		} else {
+			// Literals up to the next run of at least 2 words
+			size_t Lit = 1;
+
+			while (k + Lit < n && Lit < RLE_MAX_RUN
+					&& !(k + Lit + 1 < n
+							&& Words[k + Lit] == Words[k + Lit + 1]))
+				Lit++;
+			Hdr = (uint16_t) Lit;
+			memcpy(Out + Len, &Hdr, 2);
+			memcpy(Out + Len + 2, &Words[k], Lit * 4);
+			Len += 2 + Lit * 4;
+			k += Lit;
+		}
+	}
+
+	return Len;
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Writes the words into a container, run-length encoded when that is smaller.
+ *
+ ******************************************************************************/
+static int writeContainer(const char *Path, const uint32_t *Words, size_t n,
+		int nAxc, double SampleRate, uint32_t Mask) {
+	WaveContainerHeader Hdr;
+	uint8_t *Rle;
+	size_t RleLen;
+	FILE *Fp;
+
+	Rle = malloc(n * 4 + (n / RLE_MAX_RUN + 1) * 4 + 16);
+	if (!Rle)
+		return -1;
+	RleLen = rleEncode(Words, n, Rle);
+
+	memset(&Hdr, 0, sizeof(Hdr));
+	Hdr.Magic = WAVE_CONTAINER_MAGIC;
+	Hdr.Version = WAVE_CONTAINER_VERSION;
+	Hdr.nSamples = (uint32_t) n;
+	Hdr.SampleRate = (uint32_t) llround(SampleRate);
+	Hdr.Mask = Mask;
+	Hdr.nAxc = (uint16_t) nAxc;
+	if (RleLen < n * 4) {
+		Hdr.Encoding = WAVE_ENC_RLE;
+		Hdr.PayloadBytes = (uint32_t) RleLen;
+	} else {
+		Hdr.Encoding = WAVE_ENC_RAW;
+		Hdr.PayloadBytes = (uint32_t) (n * 4);
+	}
+
+	Fp = fopen(Path, "wb");
+	if (!Fp) {
+		perror(Path);
+		free(Rle);
+		return -1;
+	}
+	fwrite(&Hdr, sizeof(Hdr), 1, Fp);
+	if (Hdr.Encoding == WAVE_ENC_RLE)
+		fwrite(Rle, 1, RleLen, Fp);
+	else
+		fwrite(Words, 4, n, Fp);
+	fclose(Fp);
+
+	fprintf(stderr, "Container: %s, %u payload bytes (%.1f%% of raw)\n",
+			Hdr.Encoding == WAVE_ENC_RLE ? "run-length encoded" : "raw",
+			Hdr.PayloadBytes, 100.0 * Hdr.PayloadBytes / (n ? n * 4 : 1));
+
+	free(Rle);
+	return 0;
+}
+
+static void usage(const char *Prog) {
+	fprintf(stderr,
+			"usage: %s (-i file [-i file ...] -f sc16|cf32 -r in_rate |\n"
+			"           -g lte5|lte20 [-t ms] [-s seed])\n"
+			"          [-a n_axc] [-o out_rate] [-l rms_dbfs] [-m mask]\n"
+			"          (-H header.h [-p] | -c container.iqw)\n", Prog);
+}
+
+/*****************************************************************************/
+/*
+ *
+ * Produces the packed words of one AxC stream, from the given input file or
+ * from the generator.
+ *
+ ******************************************************************************/
+static uint32_t *compileStream(const char *InPath, int IsFloat, double InRate,
+		const LteCarrier *Car, double DurationMs, unsigned int Seed,
+		double OutRate, double RmsDbfs, uint32_t Mask, size_t *nWords) {
+	Signal In = { 0 }, Out = { 0 };
+	uint32_t *Words;
+	size_t nClipped;
+
+	if (Car) {
+		if (generateLte(Car, DurationMs, Seed, &In) != 0)
+			return NULL;
+		InRate = Car->SampleRate;
+	} else if (readIqFile(InPath, IsFloat, &In) != 0) {
+		return NULL;
+	}
+
+	if (resample(&In, InRate, OutRate, &Out) != 0) {
+		freeSignal(&In);
+		return NULL;
+	}
+	freeSignal(&In);
+
+	Words = malloc((Out.n ? Out.n : 1) * sizeof(uint32_t));
+	if (!Words) {
+		freeSignal(&Out);
+		return NULL;
+	}
+	nClipped = packWords(&Out, RmsDbfs, Mask, Words);
+
+	fprintf(stderr, "%s: %zu IQ samples at %.0f Hz, mask 0x%08X, %zu "
+			"clipped components\n", Car ? Car->Name : InPath, Out.n, OutRate,
+			Mask, nClipped);
+
+	*nWords = Out.n;
+	freeSignal(&Out);
+	return Words;
+}
+
+int main(int argc, char **argv) {
+	const char *InPaths[MAX_AXC];
+	const char *Format = "sc16", *Gen = NULL;
+	const char *HeaderPath = NULL, *ContainerPath = NULL;
+	const LteCarrier *Car = NULL;
+	double InRate = 0, OutRate = DEFAULT_OUT_RATE;
+	double RmsDbfs = DEFAULT_RMS_DBFS, DurationMs = 10;
+	unsigned int Seed = 1;
+	uint32_t Mask = 0xFFFFFFFF;
+	uint32_t *Streams[MAX_AXC] = { NULL };
+	size_t nStreamWords[MAX_AXC];
+	uint32_t *Words;
+	size_t n, k;
+	int nInputs = 0, nStreams, nAxc = 1, PerAxc = 0;
+	int IsFloat;
+	int Opt;
+	int a;
+	int Status = 0;
+
+	while ((Opt = getopt(argc, argv, "i:f:r:g:t:s:a:o:l:m:H:pc:h")) != -1) {
+		switch (Opt) {
+		case 'i':
+			if (nInputs == MAX_AXC) {
+				usage(argv[0]);
+				return 1;
+			}
+			InPaths[nInputs++] = optarg;
+			break;
+		case 'f':
+			Format = optarg;
+			break;
+		case 'r':
+			InRate = atof(optarg);
+			break;
+		case 'g':
+			Gen = optarg;
+			break;
+		case 't':
+			DurationMs = atof(optarg);
+			break;
+		case 's':
+			Seed = (unsigned int) strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			nAxc = atoi(optarg);
+			break;
+		case 'o':
+			OutRate = atof(optarg);
+			break;
+		case 'l':
+			RmsDbfs = atof(optarg);
+			break;
+		case 'm':
+			Mask = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			HeaderPath = optarg;
+			break;
+		case 'p':
+			PerAxc = 1;
+			break;
+		case 'c':
+			ContainerPath = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if ((!nInputs == !Gen) || (!HeaderPath && !ContainerPath) || OutRate <= 0
+			|| (nAxc != 1 && nAxc != 2 && nAxc != 4) || nInputs > nAxc) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	IsFloat = (strcmp(Format, "cf32") == 0);
+	if (Gen) {
+		for (k = 0; k < sizeof(LteCarriers) / sizeof(LteCarriers[0]); k++)
+			if (strcmp(Gen, LteCarriers[k].Name) == 0)
+				Car = &LteCarriers[k];
+		if (!Car || DurationMs <= 0) {
+			usage(argv[0]);
+			return 1;
+		}
+		// An independent carrier for each AxC
+		nStreams = nAxc;
+	} else {
+		if ((!IsFloat && strcmp(Format, "sc16") != 0) || InRate <= 0) {
+			usage(argv[0]);
+			return 1;
+		}
+		nStreams = nInputs;
+	}
+
+	n = (size_t) -1;
+	for (a = 0; a < nStreams; a++) {
+		Streams[a] = compileStream(Car ? NULL : InPaths[a], IsFloat, InRate,
+				Car, DurationMs, Seed + a, OutRate, RmsDbfs, Mask,
+				&nStreamWords[a]);
+		if (!Streams[a]) {
+			Status = 1;
+			goto out;
+		}
+		if (nStreamWords[a] < n)
+			n = nStreamWords[a];
+	}
+
+	// Interleave in the order of the DMA interface demux
+	Words = malloc((n ? n * nAxc : 1) * sizeof(uint32_t));
+	if (!Words) {
+		Status = 1;
+		goto out;
+	}
+	for (a = 0; a < nAxc; a++) {
+		const uint32_t *restrict Src = Streams[a % nStreams];
+		uint32_t *restrict Dst = Words + a;
+
+		for (k = 0; k < n; k++)
+			Dst[k * nAxc] = Src[k];
+	}
+
+	if (nAxc > 1)
+		fprintf(stderr, "%d AxC interleaved, %zu IQ samples each\n", nAxc, n);
+
+	if (HeaderPath && writeHeader(HeaderPath, Words, n, nAxc, PerAxc) != 0)
+		Status = 1;
+	if (ContainerPath && writeContainer(ContainerPath, Words, n * nAxc, nAxc,
+			OutRate, Mask) != 0)
+		Status = 1;
+
+	free(Words);
+out:
+	for (a = 0; a < nStreams; a++)
+		free(Streams[a]);
+	return Status;
+}